@@ -34,11 +34,26 @@ SRC_FILES=(
     "compositor_input.c"
     "compositor_window.c"
     "compositor_render.c"
+    "compositor_render_opt.c"
+    "compositor_damage_tiles.c"
     "compositor_perf.c"
+    "compositor_histogram.c"
+    "compositor_trace.c"
     "compositor_perf_opt.c"
+    "compositor_cpu_sampler.c"
+    "compositor_thermal.c"
+    "compositor_perf_ctrl.c"
+    "compositor_frame_sched.c"
+    "compositor_frame_timeline.c"
     "compositor_game.c"
     "compositor_monitor.c"
+    "compositor_rollup.c"
+    "compositor_monitor_log.c"
     "compositor_vulkan.c"
+    "compositor_pipeline_cache.c"
+    "compositor_vulkan_alloc.c"
+    "compositor_vulkan_layers.c"
+    "compositor_vulkan_upload.c"
     "compositor_garbage_collector.c"
     "compositor_memory_pool.c"
     "compositor_resource_manager.c"
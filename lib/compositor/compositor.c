@@ -8,6 +8,10 @@
 #include "compositor_perf_opt.h"
 #include "compositor_game.h"
 #include "compositor_monitor.h"
+#include "compositor_frame_sched.h"
+#include "compositor_frame_timeline.h"
+#include "compositor_trace.h"
+#include "compositor_cpu_sampler.h"
 #include "memory_pool.h"
 #include <android/log.h>
 #include <android/native_window.h>
@@ -22,6 +26,7 @@
 #include <sys/epoll.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/timerfd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <time.h>
@@ -48,6 +53,41 @@
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
 #define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
 
+// 内存预算刷新间隔（1秒）
+#define MEMORY_BUDGET_UPDATE_INTERVAL_NS 1000000000ULL
+// 每帧最多绘制的窗口数
+#define RENDER_MAX_WINDOWS 256
+// 每帧读取的屏幕损伤矩形上限（读满时视为损伤未知）
+#define RENDER_MAX_DAMAGE_RECTS 64
+
+// 一帧动态记录的上下文（渲染线程只读）
+struct frame_record_context {
+    struct window* windows[RENDER_MAX_WINDOWS];
+    uint32_t window_count;
+    VkRect2D clip;              // 重绘区域，所有任务的裁剪矩形都限定在其中
+    bool background_task;       // 背景层作为第一个任务记录（局部重绘或使用离屏缓存时）
+    bool ui_task;               // UI层作为最后一个任务记录
+    bool background_cached;     // 背景层从离屏缓存合成
+    bool ui_cached;             // UI层从离屏缓存合成
+};
+
+// 后台上传像素的窗口数上限
+#define UPLOAD_MAX_WINDOW_TEXTURES 32
+// 上传的窗口像素格式（与交换链一致，全屏时可直接复制）
+#define UPLOAD_WINDOW_FORMAT VK_FORMAT_B8G8R8A8_SRGB
+
+// 像素经后台上传的窗口纹理
+struct window_texture {
+    struct window* window;      // 为NULL表示空闲
+    struct vulkan_texture texture;
+    uint64_t attached_swap;     // 已附加到窗口的版本（texture.swap_count）
+    bool opaque;
+};
+
+// 预记录的次要命令缓冲区索引
+#define PRERECORDED_BACKGROUND 0
+#define PRERECORDED_UI 1
+
 // 简化的合成器状态结构
 struct compositor_state {
     ANativeWindow* window;
@@ -77,6 +117,34 @@ struct compositor_state {
     uint64_t last_frame_time;
     float fps;
     
+    // 空闲等待（epoll监听Wayland事件循环、输入唤醒和帧定时器）
+    int idle_epoll_fd;
+    int frame_timer_fd;
+    bool idle_enabled;
+    bool frame_requested;
+    bool animation_active;
+    bool first_frame_presented;
+    
+    // 启动耗时统计（从初始化开始到第一帧呈现）
+    uint64_t init_start_ns;
+    
+    // 单个不透明全屏窗口的直接呈现
+    bool direct_present_enabled;
+    bool direct_present_active;             // 上一帧是否直接呈现（用于记录状态切换）
+    struct compositor_bypass_stats bypass_stats;
+    
+    // 后台上传的窗口纹理
+    struct window_texture window_textures[UPLOAD_MAX_WINDOW_TEXTURES];
+    
+    // 按Vulkan内存预算推导的资源内存上限
+    size_t memory_limit;
+    uint64_t last_budget_update_ns;
+    
+    // GPU计时（帧开始间隔用于换算GPU使用率）
+    uint64_t last_render_start_ns;
+    uint64_t frame_interval_ns;
+    uint64_t gpu_timings_frame;       // 已发布的GPU计时帧号+1
+    
     // 输入
     struct wlr_seat* seat;
     struct wlr_cursor* cursor;
@@ -128,6 +196,9 @@ struct compositor_state {
 
 static struct compositor_state g_state = {0};
 
+// 应用数据目录（用于持久化管线缓存，需在初始化前设置）
+static char g_data_dir[256] = {0};
+
 // 内部函数声明
 static int init_wayland(void);
 static int init_wlroots(void);
@@ -144,6 +215,28 @@ static void cleanup_wlroots(void);
 static void cleanup_xwayland(void);
 static int render_frame(void);
 static void update_fps(void);
+static void update_memory_budget(void);
+static void publish_gpu_timings(void);
+static int init_idle_wait(void);
+static void cleanup_idle_wait(void);
+static bool wait_for_frame_work(void);
+static void record_frame_task(VkCommandBuffer cmd_buffer, uint32_t task_index, void* user_data);
+static void record_background_commands(VkCommandBuffer cmd_buffer, void* user_data);
+static void record_ui_commands(VkCommandBuffer cmd_buffer, void* user_data);
+static void get_frame_damage(uint32_t image_index, struct vulkan_frame_damage* damage);
+static bool update_layer_cache(VkCommandBuffer cmd_buffer, render_layer_type_t layer,
+                               void (*record_func)(VkCommandBuffer, void*));
+static void invalidate_layer(render_layer_type_t layer);
+static int init_prerecorded_command_buffers(void);
+static void mark_all_command_buffers_dirty(void);
+static void mark_secondary_command_buffers_dirty(void);
+static void record_composition(VkCommandBuffer cmd_buffer, uint32_t image_index);
+static bool record_direct_present(VkCommandBuffer cmd_buffer, uint32_t image_index);
+static bool can_direct_present(struct window** window_out, enum compositor_bypass_refusal* reason);
+static struct window_texture* find_window_texture(struct window* window);
+static void release_window_texture_entry(struct window_texture* entry);
+static void release_window_textures(void);
+static void acquire_window_textures(void);
 
 // 初始化合成器
 int compositor_init(ANativeWindow* window, int width, int height) {
@@ -158,6 +251,10 @@ int compositor_init(ANativeWindow* window, int width, int height) {
     }
     
     memset(&g_state, 0, sizeof(g_state));
+    g_state.init_start_ns = frame_sched_get_time_ns();
+    trace_set_thread_name("compositor");
+    g_state.idle_epoll_fd = -1;
+    g_state.frame_timer_fd = -1;
     g_state.window = window;
     g_state.width = width;
     g_state.height = height;
@@ -384,6 +481,14 @@ int compositor_init(ANativeWindow* window, int width, int height) {
         return -1;
     }
     
+    // 资源内存上限跟随驱动报告的预算
+    update_memory_budget();
+    
+    // 在后台线程中加载持久化管线缓存，失败时不影响启动
+    if (vulkan_init_pipeline_cache(&g_state.vulkan, g_data_dir[0] ? g_data_dir : NULL) != 0) {
+        LOGE("Failed to initialize pipeline cache");
+    }
+    
     // 初始化预记录的命令缓冲区
     if (init_prerecorded_command_buffers() != 0) {
         LOGE("Failed to initialize prerecorded command buffers");
@@ -421,6 +526,41 @@ int compositor_init(ANativeWindow* window, int width, int height) {
         return -1;
     }
     
+    // 初始化帧调度器
+    if (frame_sched_init(60) != 0) {
+        LOGE("Failed to initialize frame scheduler");
+        cleanup_xwayland();
+        cleanup_vulkan();
+        cleanup_wlroots();
+        cleanup_wayland();
+        compositor_input_destroy();
+        perf_monitor_destroy();
+        resource_manager_destroy();
+        renderer_destroy();
+        window_manager_destroy();
+        memory_pool_opt_destroy(g_state.memory_pool);
+        memory_pool_opt_manager_destroy();
+        return -1;
+    }
+    
+    // 初始化帧时间线（失败时只是不记录各阶段耗时）
+    if (frame_timeline_init() != 0) {
+        LOGE("Failed to initialize frame timeline");
+    }
+    
+    // 初始化CPU采样器（失败时CPU使用率计数器保持为0）
+    if (cpu_sampler_init(CPU_SAMPLER_DEFAULT_INTERVAL_MS) != 0) {
+        LOGE("Failed to initialize CPU sampler");
+    }
+    
+    // 初始化空闲等待，失败时退回到每次都出帧的轮询模式
+    if (init_idle_wait() == 0) {
+        g_state.idle_enabled = true;
+    } else {
+        LOGE("Failed to initialize idle wait, falling back to polling");
+    }
+    
+    g_state.direct_present_enabled = true;
     g_state.initialized = true;
     LOGI("Compositor initialized successfully");
     return 0;
@@ -432,43 +572,268 @@ int compositor_step(void) {
         return -1;
     }
     
+    // 空闲模式下阻塞等待客户端请求、输入或下一帧的调度时间
+    if (g_state.idle_enabled && !wait_for_frame_work()) {
+        // 只是输入批处理超时等唤醒，没有需要呈现的内容
+        compositor_input_step();
+        wl_event_loop_dispatch(g_state.event_loop, 0);
+        wl_display_flush_clients(g_state.display);
+        return 0;
+    }
+    
+    // 睡眠到最晚安全开始时间，之后再锁存输入和客户端提交以降低延迟
+    uint64_t deadline_ns = frame_sched_wait_for_start();
+    
     // 开始性能监控
+    TRACE_SCOPE("frame");
     perf_monitor_begin_frame();
+    frame_timeline_begin_frame(deadline_ns);
     
-    // 处理输入事件
+    // 处理输入事件（分发批处理队列中的事件）
     perf_monitor_begin_measure(PERF_COUNTER_INPUT_TIME);
-    compositor_handle_input(0, 0, 0, 0, 0);
+    compositor_input_step();
+    compositor_input_consume_activity();
     perf_monitor_end_measure(PERF_COUNTER_INPUT_TIME);
+    frame_timeline_mark(FRAME_STAGE_INPUT);
     
     // 处理 Wayland 事件
+    TRACE_BEGIN("wayland_dispatch");
     wl_event_loop_dispatch(g_state.event_loop, 0);
     wl_display_flush_clients(g_state.display);
+    TRACE_END("wayland_dispatch");
+    frame_timeline_mark(FRAME_STAGE_DISPATCH);
     
     // 更新窗口管理器
+    TRACE_BEGIN("window_update");
     window_manager_update();
+    TRACE_END("window_update");
+    frame_timeline_mark(FRAME_STAGE_WINDOW_UPDATE);
     
     // 更新渲染器
+    TRACE_BEGIN("renderer_update");
     renderer_update();
+    TRACE_END("renderer_update");
+    frame_timeline_mark(FRAME_STAGE_RENDERER_UPDATE);
     
     // 渲染帧
     perf_monitor_begin_measure(PERF_COUNTER_RENDER_TIME);
     int result = render_frame();
     perf_monitor_end_measure(PERF_COUNTER_RENDER_TIME);
     
+    // 记录本帧的绘制调用次数并归因错过的截止时间
+    struct render_stats render_stats;
+    renderer_get_stats(&render_stats);
+    frame_timeline_set_draw_calls(render_stats.draw_calls);
+    frame_timeline_end_frame(result == 0);
+    
     if (result != 0) {
         LOGE("Failed to render frame: %d", result);
+        frame_sched_frame_done(perf_monitor_get_counter(PERF_COUNTER_RENDER_TIME));
         perf_monitor_end_frame();
         return result;
     }
     
+    // 用本帧渲染耗时更新调度器的预测
+    frame_sched_frame_done(perf_monitor_get_counter(PERF_COUNTER_RENDER_TIME));
+    
     // 更新性能监控器
     perf_monitor_end_frame();
+    update_fps();
+    
+    // 报告启动到第一帧的耗时，用于对比管线缓存冷/热启动
+    if (!g_state.first_frame_presented) {
+        struct pipeline_cache_stats cache_stats;
+        vulkan_get_pipeline_cache_stats(&g_state.vulkan, &cache_stats);
+        LOGI("First frame after %.2f ms (pipeline cache %s, %zu bytes, loaded in %.2f ms)",
+             (frame_sched_get_time_ns() - g_state.init_start_ns) / 1000000.0f,
+             cache_stats.warm ? "warm" : "cold", cache_stats.loaded_size,
+             cache_stats.load_time_us / 1000.0f);
+    }
+    
+    // 本帧已呈现，清除已消费的脏区域和帧请求
+    renderer_clear_dirty_regions();
+    g_state.frame_requested = false;
+    g_state.first_frame_presented = true;
     
     // 更新内存使用统计
     struct memory_stats mem_stats;
     resource_get_memory_stats(&mem_stats);
     perf_monitor_set_counter(PERF_COUNTER_MEMORY_USAGE, mem_stats.total_used / 1024.0f / 1024.0f); // MB
     
+    // 预算会随其他进程的占用变化，定期刷新
+    if (frame_sched_get_time_ns() - g_state.last_budget_update_ns >= MEMORY_BUDGET_UPDATE_INTERVAL_NS) {
+        update_memory_budget();
+    }
+    
+    return 1;
+}
+
+// 设置应用数据目录（需在初始化前调用）
+int compositor_set_data_dir(const char* path) {
+    if (!path) {
+        g_data_dir[0] = '\0';
+        return 0;
+    }
+    
+    if (strlen(path) >= sizeof(g_data_dir)) {
+        LOGE("Data directory path too long");
+        return -1;
+    }
+    
+    strcpy(g_data_dir, path);
+    return 0;
+}
+
+// 请求呈现一帧（用于没有脏区域跟踪的一次性更新）
+void compositor_request_frame(void) {
+    g_state.frame_requested = true;
+}
+
+// 设置动画是否进行中（进行中时每个刷新周期都出帧）
+void compositor_set_animation_active(bool active) {
+    g_state.animation_active = active;
+}
+
+// 启用/禁用空闲等待
+int compositor_set_idle_enabled(bool enabled) {
+    if (enabled && g_state.idle_epoll_fd < 0) {
+        return -1;
+    }
+    
+    g_state.idle_enabled = enabled;
+    return 0;
+}
+
+// 直接呈现相关API
+int compositor_set_direct_present_enabled(bool enabled) {
+    if (!g_state.initialized) {
+        return -1;
+    }
+    
+    g_state.direct_present_enabled = enabled;
+    LOGI("Direct present %s", enabled ? "enabled" : "disabled");
+    return 0;
+}
+
+bool compositor_is_direct_present_enabled(void) {
+    return g_state.direct_present_enabled;
+}
+
+int compositor_get_bypass_stats(struct compositor_bypass_stats* stats) {
+    if (!g_state.initialized || !stats) {
+        return -1;
+    }
+    
+    *stats = g_state.bypass_stats;
+    return 0;
+}
+
+// 在后台上传窗口的像素，上传完成前窗口继续显示旧内容
+int compositor_upload_window_pixels(struct window* window, const void* pixels, uint32_t width, uint32_t height,
+                                    uint32_t stride, bool opaque, void (*release)(void* user_data), void* user_data) {
+    if (!g_state.vulkan_initialized || !window) {
+        if (release) {
+            release(user_data);
+        }
+        return -1;
+    }
+    
+    struct window_texture* entry = find_window_texture(window);
+    if (!entry) {
+        entry = find_window_texture(NULL);
+        if (!entry) {
+            LOGE("Too many uploaded window textures");
+            if (release) {
+                release(user_data);
+            }
+            return -1;
+        }
+        entry->window = window;
+        entry->attached_swap = 0;
+        vulkan_texture_init(&entry->texture, UPLOAD_WINDOW_FORMAT);
+    }
+    entry->opaque = opaque;
+    
+    int ret = vulkan_upload_texture(&g_state.vulkan, &entry->texture, pixels, width, height, stride,
+                                    release, user_data);
+    
+    // 上传完成后由下一帧交接
+    if (ret == 0) {
+        g_state.frame_requested = true;
+    }
+    return ret;
+}
+
+// 释放窗口的上传纹理（window_destroy在释放窗口前调用）
+void compositor_release_window_texture(struct window* window) {
+    struct window_texture* entry = window ? find_window_texture(window) : NULL;
+    if (!entry) {
+        return;
+    }
+    
+    if (entry->texture.current.image != VK_NULL_HANDLE &&
+        window->buffer.image == (uint64_t)entry->texture.current.image) {
+        window_attach_buffer(window, NULL);
+    }
+    
+    release_window_texture_entry(entry);
+}
+
+// 用SPIR-V着色器创建离屏层缓存的合成管线
+int compositor_set_layer_cache_shaders(const uint32_t* vertex_spirv, size_t vertex_size,
+                                       const uint32_t* fragment_spirv, size_t fragment_size) {
+    if (!g_state.vulkan_initialized || !vertex_spirv || !fragment_spirv || vertex_size == 0 || fragment_size == 0) {
+        return -1;
+    }
+    
+    VkShaderModule modules[2] = {VK_NULL_HANDLE, VK_NULL_HANDLE};
+    const uint32_t* code[2] = {vertex_spirv, fragment_spirv};
+    size_t sizes[2] = {vertex_size, fragment_size};
+    int ret = 0;
+    
+    for (int i = 0; i < 2 && ret == 0; i++) {
+        VkShaderModuleCreateInfo module_info = {
+            .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .codeSize = sizes[i],
+            .pCode = code[i]
+        };
+        
+        if (vkCreateShaderModule(g_state.vulkan.device, &module_info, NULL, &modules[i]) != VK_SUCCESS) {
+            LOGE("Failed to create layer cache shader module %d", i);
+            ret = -1;
+        }
+    }
+    
+    if (ret == 0) {
+        ret = vulkan_layer_cache_create_pipeline(&g_state.vulkan, modules[0], modules[1]);
+    }
+    
+    // 管线创建后着色器模块不再需要
+    for (int i = 0; i < 2; i++) {
+        if (modules[i] != VK_NULL_HANDLE) {
+            vkDestroyShaderModule(g_state.vulkan.device, modules[i], NULL);
+        }
+    }
+    
+    if (ret == 0) {
+        // 已启用的层从此改为从缓存合成，次要命令缓冲区需要重新记录
+        mark_secondary_command_buffers_dirty();
+        invalidate_layer(RENDER_LAYER_BACKGROUND);
+        invalidate_layer(RENDER_LAYER_UI);
+        g_state.frame_requested = true;
+    }
+    return ret;
+}
+
+// 获取后台上传统计
+int compositor_get_upload_stats(struct vulkan_upload_stats* stats) {
+    if (!g_state.vulkan_initialized || !stats) {
+        return -1;
+    }
+    
+    vulkan_upload_get_stats(&g_state.vulkan, stats);
     return 0;
 }
 
@@ -506,25 +871,92 @@ bool compositor_is_adaptive_quality_enabled(void) {
 }
 
 int compositor_set_target_fps(int fps) {
-    return perf_opt_set_target_fps(fps);
+    if (fps <= 0) {
+        return -1;
+    }
+    
+    return perf_opt_set_target_fps((uint32_t)fps);
 }
 
 int compositor_get_target_fps(void) {
-    return perf_opt_get_target_fps();
+    return (int)perf_opt_get_target_fps();
 }
 
 int compositor_set_quality_level(int level) {
-    return perf_opt_set_quality_level(level);
+    if (level < 0) {
+        return -1;
+    }
+    
+    // 超出范围的等级被忽略
+    perf_opt_set_quality_level((uint32_t)level);
+    return perf_opt_get_quality_level() == (uint32_t)level ? 0 : -1;
 }
 
 int compositor_get_quality_level(void) {
-    return perf_opt_get_quality_level();
+    return (int)perf_opt_get_quality_level();
+}
+
+int compositor_set_frame_deadline_miss_rate(float miss_rate) {
+    frame_sched_set_target_miss_rate(miss_rate);
+    return 0;
+}
+
+int compositor_set_refresh_rate(int refresh_rate) {
+    if (refresh_rate <= 0) {
+        return -1;
+    }
+    
+    frame_sched_set_refresh_rate((uint32_t)refresh_rate);
+    return 0;
+}
+
+int compositor_set_frames_in_flight(int count) {
+    if (!g_state.initialized || count <= 0) {
+        return -1;
+    }
+    
+    return vulkan_set_frames_in_flight(&g_state.vulkan, (uint32_t)count);
 }
 
 int compositor_get_perf_opt_stats(struct perf_opt_stats *stats) {
     return perf_opt_get_stats(stats);
 }
 
+// 获取帧时间线统计（各阶段平均/最大耗时和错过帧的归因）
+int compositor_get_frame_timeline_stats(struct frame_timeline_stats* stats) {
+    if (!stats) {
+        return -1;
+    }
+    
+    frame_timeline_get_stats(stats);
+    return 0;
+}
+
+// 获取最近的帧记录（最新的在前）
+int compositor_get_frame_records(struct frame_record* records, uint32_t max_count) {
+    if (!records) {
+        return -1;
+    }
+    
+    return (int)frame_timeline_get_records(records, max_count);
+}
+
+// 把帧时间线写入文件
+int compositor_dump_frame_timeline(const char* path) {
+    return frame_timeline_dump(path);
+}
+
+// 启用/禁用跟踪（编译时COMPOSITOR_ENABLE_TRACE为0则没有效果）
+int compositor_set_trace_enabled(bool enabled) {
+    trace_set_enabled(enabled);
+    return 0;
+}
+
+// 把各线程缓冲的跟踪事件导出为Chrome trace-event JSON
+int compositor_flush_trace(const char* path) {
+    return trace_flush(path);
+}
+
 // 游戏模式相关API
 int compositor_set_game_mode_enabled(bool enabled) {
     return game_mode_set_enabled(enabled);
@@ -635,6 +1067,12 @@ void compositor_destroy(void) {
         LOGI("Memory pool system destroyed");
     }
     
+    // 销毁帧调度器
+    frame_sched_destroy();
+    frame_timeline_destroy();
+    cpu_sampler_destroy();
+    cleanup_idle_wait();
+    
     // 销毁性能优化模块
     if (g_state.perf_opt_initialized) {
         perf_opt_destroy(&g_state.perf_opt);
@@ -665,6 +1103,11 @@ void compositor_destroy(void) {
         g_state.renderer_initialized = false;
     }
     
+    // 上传纹理引用窗口，须在窗口销毁前释放
+    if (g_state.vulkan_initialized) {
+        release_window_textures();
+    }
+    
     // 销毁窗口管理器
     if (g_state.window_manager_initialized) {
         window_manager_destroy(&g_state.window_manager);
@@ -673,7 +1116,7 @@ void compositor_destroy(void) {
     
     // 销毁Vulkan
     if (g_state.vulkan_initialized) {
-        vulkan_destroy(&g_state.vulkan);
+        cleanup_vulkan();
         g_state.vulkan_initialized = false;
     }
     
@@ -1430,6 +1873,8 @@ static int create_vulkan_sync_objects(void) {
 
 // 清理Vulkan资源
 static void cleanup_vulkan(void) {
+    // 上传的纹理图像须在上传器销毁前交给它回收
+    release_window_textures();
     vulkan_destroy(&g_state.vulkan);
 }
 
@@ -1489,6 +1934,122 @@ static void cleanup_wlroots(void) {
     }
 }
 
+// 初始化空闲等待
+static int init_idle_wait(void) {
+    g_state.idle_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (g_state.idle_epoll_fd < 0) {
+        LOGE("Failed to create epoll fd: %s", strerror(errno));
+        return -1;
+    }
+    
+    g_state.frame_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (g_state.frame_timer_fd < 0) {
+        LOGE("Failed to create frame timer: %s", strerror(errno));
+        cleanup_idle_wait();
+        return -1;
+    }
+    
+    // 监听Wayland事件循环、输入唤醒和帧定时器
+    int fds[3] = {
+        wl_event_loop_get_fd(g_state.event_loop),
+        compositor_input_get_wakeup_fd(),
+        g_state.frame_timer_fd
+    };
+    
+    for (int i = 0; i < 3; i++) {
+        if (fds[i] < 0) {
+            continue;
+        }
+        
+        struct epoll_event ev = {
+            .events = EPOLLIN,
+            .data.fd = fds[i]
+        };
+        
+        if (epoll_ctl(g_state.idle_epoll_fd, EPOLL_CTL_ADD, fds[i], &ev) != 0) {
+            LOGE("Failed to add fd %d to epoll: %s", fds[i], strerror(errno));
+            cleanup_idle_wait();
+            return -1;
+        }
+    }
+    
+    return 0;
+}
+
+// 清理空闲等待
+static void cleanup_idle_wait(void) {
+    if (g_state.frame_timer_fd >= 0) {
+        close(g_state.frame_timer_fd);
+        g_state.frame_timer_fd = -1;
+    }
+    
+    if (g_state.idle_epoll_fd >= 0) {
+        close(g_state.idle_epoll_fd);
+        g_state.idle_epoll_fd = -1;
+    }
+    
+    g_state.idle_enabled = false;
+}
+
+// 等待需要出帧的事件，返回是否应该呈现新帧
+static bool wait_for_frame_work(void) {
+    // 已有脏区域、帧请求或动画时，只需等到下一帧的调度时间
+    bool frame_pending = g_state.frame_requested || g_state.animation_active ||
+                         !g_state.first_frame_presented || renderer_has_damage();
+    
+    struct itimerspec timer = {0};
+    if (frame_pending) {
+        uint64_t start = frame_sched_get_next_start();
+        if (start == 0) {
+            start = 1; // 全零会解除定时器
+        }
+        timer.it_value.tv_sec = (time_t)(start / 1000000000ULL);
+        timer.it_value.tv_nsec = (long)(start % 1000000000ULL);
+    }
+    timerfd_settime(g_state.frame_timer_fd, TFD_TIMER_ABSTIME, &timer, NULL);
+    
+    // 批处理队列中还有事件时需要在超时后回来刷新
+    int timeout_ms = compositor_input_has_pending_events() ? 1 : -1;
+    
+    struct epoll_event events[3];
+    int count = epoll_wait(g_state.idle_epoll_fd, events, 3, timeout_ms);
+    if (count < 0) {
+        if (errno != EINTR) {
+            LOGE("epoll_wait failed: %s", strerror(errno));
+        }
+        return frame_pending;
+    }
+    
+    bool activity = false;
+    bool client_requests = false;
+    for (int i = 0; i < count; i++) {
+        int fd = events[i].data.fd;
+        
+        if (fd == g_state.frame_timer_fd) {
+            uint64_t expirations;
+            if (read(fd, &expirations, sizeof(expirations)) < 0) {
+                // 定时器已被重新设置，忽略
+            }
+        } else if (fd == compositor_input_get_wakeup_fd()) {
+            // 新输入需要尽快反映到屏幕上
+            activity |= compositor_input_consume_activity();
+        } else {
+            client_requests = true;
+        }
+    }
+    
+    // 客户端请求先分发，是否出帧由其带来的损伤、帧回调或动画决定，
+    // 不产生损伤的请求（如查询、无变化的提交）不会唤醒渲染
+    if (client_requests) {
+        wl_event_loop_dispatch(g_state.event_loop, 0);
+        wl_display_flush_clients(g_state.display);
+        frame_pending = g_state.frame_requested || g_state.animation_active ||
+                        !g_state.first_frame_presented || renderer_has_damage();
+    }
+    
+    return frame_pending || activity;
+}
+
 // 清理 Xwayland 资源
 static void cleanup_xwayland(void) {
     if (g_state.xwayland_started && g_state.xwayland_pid > 0) {
@@ -1516,6 +2077,13 @@ static int render_frame(void) {
     // 记录开始时间
     clock_gettime(CLOCK_MONOTONIC, &start_time);
     
+    // 记录帧开始间隔
+    uint64_t render_start_ns = frame_sched_get_time_ns();
+    if (g_state.last_render_start_ns != 0) {
+        g_state.frame_interval_ns = render_start_ns - g_state.last_render_start_ns;
+    }
+    g_state.last_render_start_ns = render_start_ns;
+    
     // 更新性能优化模块
     perf_opt_update();
     
@@ -1528,13 +2096,9 @@ static int render_frame(void) {
     // 开始性能监控
     perf_monitor_begin_measure(PERF_COUNTER_RENDER_TIME);
     
-    // 应用性能优化设置
-    struct perf_opt_settings opt_settings;
-    if (perf_opt_get_settings(&opt_settings) == 0) {
-        // 根据性能优化设置调整渲染参数
-        renderer_set_quality(opt_settings.quality_level);
-        renderer_set_max_fps(opt_settings.target_fps);
-    }
+    // 应用性能优化模块的决策：目标帧率交给帧调度器按刷新周期的整数倍节拍，质量等级交给渲染器
+    frame_sched_set_target_fps(perf_opt_get_target_fps());
+    renderer_set_quality_level(perf_opt_get_quality_level());
     
     // 应用游戏模式设置
     if (game_mode_is_enabled()) {
@@ -1548,17 +2112,29 @@ static int render_frame(void) {
     
     uint32_t image_index;
     
-    // 开始渲染帧
+    // 开始渲染帧（等待帧槽和获取图像单独计入时间线）
+    frame_timeline_mark(FRAME_STAGE_PREPARE);
+    TRACE_BEGIN("acquire");
     if (vulkan_begin_frame(&g_state.vulkan, &image_index) != 0) {
+        TRACE_END("acquire");
         LOGE("Failed to begin frame");
         perf_monitor_end_measure(PERF_COUNTER_RENDER_TIME);
         return -1;
     }
+    TRACE_END("acquire");
+    frame_timeline_mark(FRAME_STAGE_ACQUIRE);
+    
+    // 发布本帧槽上次提交时测得的GPU耗时
+    publish_gpu_timings();
+    
+    // 把上传完成的窗口像素交接给本帧
+    acquire_window_textures();
     
     // 获取命令缓冲区
     VkCommandBuffer cmd_buffer = vulkan_get_command_buffer(&g_state.vulkan, image_index);
     if (cmd_buffer == VK_NULL_HANDLE) {
         LOGE("Failed to get command buffer");
+        vulkan_abort_frame(&g_state.vulkan, image_index);
         perf_monitor_end_measure(PERF_COUNTER_RENDER_TIME);
         return -1;
     }
@@ -1574,46 +2150,42 @@ static int render_frame(void) {
     VkResult result = vkBeginCommandBuffer(cmd_buffer, &begin_info);
     if (result != VK_SUCCESS) {
         LOGE("Failed to begin command buffer: %d", result);
+        vulkan_abort_frame(&g_state.vulkan, image_index);
         perf_monitor_end_measure(PERF_COUNTER_RENDER_TIME);
         return -1;
     }
     
-    // 开始渲染通道
-    VkRenderPassBeginInfo render_pass_info = {
-        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-        .pNext = NULL,
-        .renderPass = g_state.vulkan.render_pass,
-        .framebuffer = vulkan_get_current_framebuffer(&g_state.vulkan, image_index),
-        .renderArea = {
-            .offset = {0, 0},
-            .extent = {g_state.width, g_state.height}
-        },
-        .clearValueCount = 1,
-        .pClearValues = &(VkClearValue){.color = {{0.0f, 0.0f, 0.0f, 1.0f}}}
-    };
-    
-    vkCmdBeginRenderPass(cmd_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
-    
-    // 执行缓存的命令缓冲区（如果有的话）
-    vulkan_execute_cached_command_buffers(&g_state.vulkan, cmd_buffer);
+    // GPU计时从渲染通道开始前算起
+    vulkan_gpu_timer_begin_frame(&g_state.vulkan, cmd_buffer);
     
-    // 这里可以添加动态渲染命令
+    // 单个不透明全屏窗口时跳过合成，把客户端缓冲区直接复制到交换链图像
+    if (!record_direct_present(cmd_buffer, image_index)) {
+        record_composition(cmd_buffer, image_index);
+    }
     
-    vkCmdEndRenderPass(cmd_buffer);
+    vulkan_gpu_timer_end_frame(&g_state.vulkan, cmd_buffer);
     
     result = vkEndCommandBuffer(cmd_buffer);
     if (result != VK_SUCCESS) {
         LOGE("Failed to end command buffer: %d", result);
+        vulkan_abort_frame(&g_state.vulkan, image_index);
         perf_monitor_end_measure(PERF_COUNTER_RENDER_TIME);
         return -1;
     }
     
-    // 结束渲染帧
-    if (vulkan_end_frame(&g_state.vulkan, image_index) != 0) {
+    frame_timeline_mark(FRAME_STAGE_RECORD);
+    
+    // 结束渲染帧（提交和呈现耗时计入呈现计数器）
+    perf_monitor_begin_measure(PERF_COUNTER_PRESENT_TIME);
+    ret = vulkan_end_frame(&g_state.vulkan, image_index);
+    perf_monitor_end_measure(PERF_COUNTER_PRESENT_TIME);
+    if (ret != 0) {
         LOGE("Failed to end frame");
         perf_monitor_end_measure(PERF_COUNTER_RENDER_TIME);
         return -1;
     }
+    frame_timeline_mark_at(FRAME_STAGE_SUBMIT, g_state.vulkan.submit_end_ns);
+    frame_timeline_mark(FRAME_STAGE_PRESENT);
     
     // 结束性能监控
     perf_monitor_end_measure(PERF_COUNTER_RENDER_TIME);
@@ -1646,7 +2218,7 @@ static int render_frame(void) {
 static void update_fps(void) {
     g_state.frame_count++;
     
-    uint64_t current_time = time(NULL) * 1000; // 简化：使用秒级时间
+    uint64_t current_time = frame_sched_get_time_ns() / 1000000; // 毫秒
     if (current_time - g_state.last_frame_time >= 1000) {
         g_state.fps = (float)g_state.frame_count;
         g_state.frame_count = 0;
@@ -1656,29 +2228,69 @@ static void update_fps(void) {
     }
 }
 
-// 添加缺失的perf_opt_get_settings和game_mode_get_settings函数实现
-struct perf_opt_settings {
-    uint32_t quality_level;
-    uint32_t target_fps;
-};
-
-struct game_mode_settings {
-    bool input_boost;
-    bool priority_boost;
-};
+// 按Vulkan内存预算更新资源管理器的内存上限
+static void update_memory_budget(void) {
+    g_state.last_budget_update_ns = frame_sched_get_time_ns();
+    
+    struct vulkan_memory_budget budget;
+    if (vulkan_alloc_get_budget(&g_state.vulkan.allocator, &budget) != 0 || budget.total_budget == 0) {
+        return;
+    }
+    
+    // 资源可以保留已占用的部分，再加上预算中剩余的余量
+    struct resource_manager_stats stats;
+    resource_get_stats(&stats);
+    VkDeviceSize headroom = budget.total_budget > budget.total_usage ? budget.total_budget - budget.total_usage : 0;
+    size_t limit = stats.used_memory + (size_t)headroom;
+    
+    // 变化不足1/16时不更新，避免每秒重复设置
+    size_t previous = g_state.memory_limit;
+    if (previous != 0 && limit > previous - previous / 16 && limit < previous + previous / 16) {
+        return;
+    }
+    
+    g_state.memory_limit = limit;
+    resource_set_memory_limit(limit);
+    LOGD("Memory budget %s: %llu MB budget, %llu MB used",
+         budget.from_driver ? "from driver" : "estimated",
+         (unsigned long long)(budget.total_budget / (1024 * 1024)),
+         (unsigned long long)(budget.total_usage / (1024 * 1024)));
+}
 
-static int perf_opt_get_settings(struct perf_opt_settings *settings) {
-    if (!settings) {
-        return -1;
+// 把读回的GPU耗时发布到性能监控和监控模块（每个测得的帧只发布一次）
+static void publish_gpu_timings(void) {
+    struct vulkan_gpu_timings timings;
+    if (vulkan_get_gpu_timings(&g_state.vulkan, &timings) != 0 || timings.frame + 1 == g_state.gpu_timings_frame) {
+        return;
     }
+    g_state.gpu_timings_frame = timings.frame + 1;
     
-    // 简化实现：返回默认设置
-    settings->quality_level = 2; // 中等质量
-    settings->target_fps = 60;   // 60 FPS
+    // 合成时间取渲染通道的GPU耗时（微秒）
+    perf_monitor_update_counter(PERF_COUNTER_COMPOSITE_TIME, (uint64_t)(timings.frame_ms * 1000.0f));
     
-    return 0;
+    // GPU使用率按GPU耗时占帧间隔的比例估算
+    if (g_state.frame_interval_ns > 0) {
+        float usage = timings.frame_ms * 1000000.0f * 100.0f / (float)g_state.frame_interval_ns;
+        perf_monitor_update_counter(PERF_COUNTER_GPU_USAGE, (uint64_t)(usage > 100.0f ? 100.0f : usage));
+    }
+    
+    monitor_add_data_point(MONITOR_DATA_TYPE_GPU_FRAME_TIME, timings.frame_ms);
+    monitor_add_data_point(MONITOR_DATA_TYPE_GPU_BASE_TIME, timings.stage_ms[VULKAN_GPU_STAGE_BASE]);
+    monitor_add_data_point(MONITOR_DATA_TYPE_GPU_LAYER_TIME, timings.layers_ms);
+    monitor_add_data_point(MONITOR_DATA_TYPE_GPU_RESOLVE_TIME, timings.stage_ms[VULKAN_GPU_STAGE_RESOLVE]);
+    monitor_add_data_point(MONITOR_DATA_TYPE_GPU_CACHE_TIME, timings.stage_ms[VULKAN_GPU_STAGE_CACHE]);
+    monitor_add_data_point(MONITOR_DATA_TYPE_GPU_BACKGROUND_TIME, timings.stage_ms[VULKAN_GPU_STAGE_BACKGROUND]);
+    monitor_add_data_point(MONITOR_DATA_TYPE_GPU_WINDOW_TIME, timings.stage_ms[VULKAN_GPU_STAGE_WINDOWS]);
+    monitor_add_data_point(MONITOR_DATA_TYPE_GPU_BATCH_TIME, timings.stage_ms[VULKAN_GPU_STAGE_BATCHES]);
+    monitor_add_data_point(MONITOR_DATA_TYPE_GPU_UI_TIME, timings.stage_ms[VULKAN_GPU_STAGE_UI]);
 }
 
+// 添加缺失的game_mode_get_settings函数实现
+struct game_mode_settings {
+    bool input_boost;
+    bool priority_boost;
+};
+
 static int game_mode_get_settings(struct game_mode_settings *settings) {
     if (!settings) {
         return -1;
@@ -1692,16 +2304,6 @@ static int game_mode_get_settings(struct game_mode_settings *settings) {
 }
 
 // 添加缺失的renderer_set_*函数实现
-static void renderer_set_quality(uint32_t level) {
-    // 实际实现应该调用渲染器的设置质量函数
-    LOGI("Setting renderer quality to %u", level);
-}
-
-static void renderer_set_max_fps(uint32_t fps) {
-    // 实际实现应该调用渲染器的设置最大帧率函数
-    LOGI("Setting renderer max FPS to %u", fps);
-}
-
 static void renderer_set_input_boost_enabled(bool enabled) {
     // 实际实现应该调用渲染器的设置输入增强函数
     LOGI("Setting renderer input boost %s", enabled ? "enabled" : "disabled");
@@ -1728,16 +2330,352 @@ static void record_background_commands(VkCommandBuffer cmd_buffer, void* user_da
     };
     vkCmdSetViewport(cmd_buffer, 0, 1, &viewport);
     
-    // 示例：设置裁剪矩形
+    // 示例：设置裁剪矩形（局部重绘时user_data为重绘区域，预记录时为全屏）
     VkRect2D scissor = {
         .offset = {0, 0},
         .extent = {g_state.width, g_state.height}
     };
+    if (user_data) {
+        scissor = *(const VkRect2D*)user_data;
+    }
     vkCmdSetScissor(cmd_buffer, 0, 1, &scissor);
     
     // 这里可以添加更多的静态渲染命令
 }
 
+// 记录完整的合成：按损伤区域重绘背景、窗口、批处理和UI
+static void record_composition(VkCommandBuffer cmd_buffer, uint32_t image_index) {
+    // 交换链图像保留上次绘制的内容，只重绘该图像上次绘制以来的损伤区域
+    struct vulkan_frame_damage damage;
+    get_frame_damage(image_index, &damage);
+    
+    // 没有任何损伤：图像已是最新内容，不清除、不重绘，只呈现（增量呈现只报告最小矩形）
+    if (damage.skip) {
+        return;
+    }
+    
+    // 开始渲染通道（局部重绘时加载原有内容，renderArea之外的像素不被改写）
+    VkRenderPassBeginInfo render_pass_info = {
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+        .pNext = NULL,
+        .renderPass = damage.full ? g_state.vulkan.render_pass : g_state.vulkan.render_pass_load,
+        .framebuffer = vulkan_get_current_framebuffer(&g_state.vulkan, image_index),
+        .renderArea = damage.render_area,
+        .clearValueCount = 1,
+        .pClearValues = &(VkClearValue){.color = {{0.0f, 0.0f, 0.0f, 1.0f}}}
+    };
+    
+    // 使用离屏缓存的层在渲染通道外按本层损伤重建，没有损伤的层直接复用
+    struct frame_record_context record_context;
+    record_context.clip = damage.render_area;
+    record_context.background_cached = update_layer_cache(cmd_buffer, RENDER_LAYER_BACKGROUND, record_background_commands);
+    record_context.ui_cached = update_layer_cache(cmd_buffer, RENDER_LAYER_UI, record_ui_commands);
+    vulkan_gpu_timer_write(&g_state.vulkan, cmd_buffer, VULKAN_TIMESTAMP_CACHE_END);
+    
+    // 渲染通道内容全部来自次要命令缓冲区
+    vkCmdBeginRenderPass(cmd_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    
+    // 预记录的背景和UI使用全屏裁剪，只能在整帧重绘时执行；局部重绘或使用离屏缓存时作为任务记录。
+    // 背景作为任务时UI也必须作为任务，保证UI绘制在背景之上
+    record_context.background_task = !damage.full || record_context.background_cached;
+    record_context.ui_task = !damage.full || record_context.ui_cached || record_context.background_task;
+    if (!record_context.background_task) {
+        vulkan_execute_cached_command_buffer(&g_state.vulkan, cmd_buffer, PRERECORDED_BACKGROUND);
+    }
+    if (!record_context.ui_task) {
+        vulkan_execute_cached_command_buffer(&g_state.vulkan, cmd_buffer, PRERECORDED_UI);
+    }
+    
+    // 结束当前批处理，批次在窗口之后的任务中绘制
+    if (g_state.vulkan.batch_manager.batch_count > 0) {
+        vulkan_end_batch(&g_state.vulkan);
+    }
+    
+    // 每个可见窗口一个任务（从底到顶），之后一个任务绘制批处理，前后可能还有背景和UI任务
+    record_context.window_count = window_get_visible_windows(record_context.windows, RENDER_MAX_WINDOWS);
+    uint32_t task_count = record_context.window_count + 1 +
+                          (record_context.background_task ? 1 : 0) + (record_context.ui_task ? 1 : 0);
+    
+    if (vulkan_render_multithread(&g_state.vulkan, cmd_buffer, record_frame_task, &record_context, task_count) != 0) {
+        LOGE("Failed to record frame commands");
+    }
+    
+    vkCmdEndRenderPass(cmd_buffer);
+}
+
+// 尝试直接呈现：满足条件时把唯一窗口的缓冲区复制到交换链图像，跳过层排序、批处理和混合
+static bool record_direct_present(VkCommandBuffer cmd_buffer, uint32_t image_index) {
+    struct window* window = NULL;
+    enum compositor_bypass_refusal reason = COMPOSITOR_BYPASS_DISABLED;
+    
+    bool bypass = can_direct_present(&window, &reason);
+    if (bypass) {
+        vulkan_gpu_timer_write(&g_state.vulkan, cmd_buffer, VULKAN_TIMESTAMP_LAYERS_BEGIN);
+        bypass = vulkan_direct_present(&g_state.vulkan, cmd_buffer, image_index, (VkImage)window->buffer.image,
+                                       (VkFormat)window->buffer.format, window->buffer.width,
+                                       window->buffer.height) == 0;
+        vulkan_gpu_timer_write(&g_state.vulkan, cmd_buffer, VULKAN_TIMESTAMP_WINDOWS_END);
+        if (!bypass) {
+            reason = COMPOSITOR_BYPASS_INCOMPATIBLE;
+        }
+    }
+    
+    if (bypass != g_state.direct_present_active) {
+        if (bypass) {
+            LOGI("Direct present started for window %u", window->id);
+        } else {
+            LOGI("Direct present stopped: reason %d", reason);
+        }
+        g_state.direct_present_active = bypass;
+    }
+    
+    if (!bypass) {
+        g_state.bypass_stats.composited_frames++;
+        g_state.bypass_stats.refused[reason]++;
+        return false;
+    }
+    
+    g_state.bypass_stats.bypassed_frames++;
+    if (vulkan_get_direct_present_mode(&g_state.vulkan, (VkFormat)window->buffer.format, window->buffer.width,
+                                       window->buffer.height) == VULKAN_DIRECT_PRESENT_COPY) {
+        g_state.bypass_stats.copied_frames++;
+    } else {
+        g_state.bypass_stats.blitted_frames++;
+    }
+    
+    // 整个图像被覆盖，按全屏损伤记账，之后合成的帧在其他图像上整帧重绘
+    struct vulkan_frame_damage damage;
+    vulkan_prepare_frame_damage(&g_state.vulkan, image_index, NULL, 0, &damage);
+    frame_timeline_set_damage_area((uint32_t)g_state.width * (uint32_t)g_state.height);
+    
+    // 本帧各层的损伤在帧末清除而没有重建缓存，有损伤的层缓存需要整层重建
+    for (int i = 0; i < RENDER_LAYER_COUNT; i++) {
+        uint32_t count = 0;
+        renderer_get_dirty_regions((render_layer_type_t)i, &count);
+        if (count > 0) {
+            vulkan_layer_cache_invalidate(&g_state.vulkan, (render_layer_type_t)i);
+        }
+    }
+    
+    return true;
+}
+
+// 根据窗口管理器状态检查能否直接呈现，不能时给出原因
+static bool can_direct_present(struct window** window_out, enum compositor_bypass_refusal* reason) {
+    if (!g_state.direct_present_enabled) {
+        *reason = COMPOSITOR_BYPASS_DISABLED;
+        return false;
+    }
+    
+    // 只需要知道是否恰好一个可见窗口
+    struct window* windows[2];
+    uint32_t count = window_get_visible_windows(windows, 2);
+    if (count == 0) {
+        *reason = COMPOSITOR_BYPASS_NO_WINDOW;
+        return false;
+    }
+    if (count > 1) {
+        *reason = COMPOSITOR_BYPASS_MULTIPLE_WINDOWS;
+        return false;
+    }
+    
+    struct window* window = windows[0];
+    if (window->attrs.x != 0 || window->attrs.y != 0 ||
+        window->attrs.width != g_state.width || window->attrs.height != g_state.height) {
+        *reason = COMPOSITOR_BYPASS_NOT_FULLSCREEN;
+        return false;
+    }
+    
+    if (window->buffer.image == 0) {
+        *reason = COMPOSITOR_BYPASS_NO_BUFFER;
+        return false;
+    }
+    
+    if (!window->buffer.opaque) {
+        *reason = COMPOSITOR_BYPASS_NOT_OPAQUE;
+        return false;
+    }
+    
+    // 窗口之上的内容需要混合，背景层被不透明窗口完全遮挡
+    if (renderer_layer_has_content(RENDER_LAYER_OVERLAY) || renderer_layer_has_content(RENDER_LAYER_UI) ||
+        renderer_layer_has_content(RENDER_LAYER_CURSOR) || g_state.vulkan.batch_manager.batch_count > 0) {
+        *reason = COMPOSITOR_BYPASS_OVERLAY_CONTENT;
+        return false;
+    }
+    
+    if (vulkan_get_direct_present_mode(&g_state.vulkan, (VkFormat)window->buffer.format, window->buffer.width,
+                                       window->buffer.height) == VULKAN_DIRECT_PRESENT_NONE) {
+        *reason = COMPOSITOR_BYPASS_INCOMPATIBLE;
+        return false;
+    }
+    
+    *window_out = window;
+    return true;
+}
+
+// 查找窗口的上传纹理（window为NULL时查找空闲项）
+static struct window_texture* find_window_texture(struct window* window) {
+    for (uint32_t i = 0; i < UPLOAD_MAX_WINDOW_TEXTURES; i++) {
+        if (g_state.window_textures[i].window == window) {
+            return &g_state.window_textures[i];
+        }
+    }
+    return NULL;
+}
+
+// 内部函数：释放一个上传纹理项（只访问纹理项本身，窗口可能已经释放）
+static void release_window_texture_entry(struct window_texture* entry) {
+    vulkan_texture_destroy(&g_state.vulkan, &entry->texture);
+    entry->window = NULL;
+    entry->attached_swap = 0;
+}
+
+// 释放所有上传纹理（按纹理项释放，不访问窗口）
+static void release_window_textures(void) {
+    for (uint32_t i = 0; i < UPLOAD_MAX_WINDOW_TEXTURES; i++) {
+        if (g_state.window_textures[i].window) {
+            release_window_texture_entry(&g_state.window_textures[i]);
+        }
+    }
+}
+
+// 把上传完成的新版本附加到窗口；未完成的继续显示旧版本，下一个刷新周期再检查
+static void acquire_window_textures(void) {
+    bool pending = false;
+    
+    for (uint32_t i = 0; i < UPLOAD_MAX_WINDOW_TEXTURES; i++) {
+        struct window_texture* entry = &g_state.window_textures[i];
+        if (!entry->window) {
+            continue;
+        }
+        
+        if (vulkan_texture_acquire(&g_state.vulkan, &entry->texture) &&
+            entry->texture.swap_count != entry->attached_swap) {
+            struct window_buffer buffer = {
+                .image = (uint64_t)entry->texture.current.image,
+                .format = UPLOAD_WINDOW_FORMAT,
+                .width = entry->texture.current.width,
+                .height = entry->texture.current.height,
+                .opaque = entry->opaque
+            };
+            window_attach_buffer(entry->window, &buffer);
+            entry->attached_swap = entry->texture.swap_count;
+            
+            struct window_attributes* attrs = &entry->window->attrs;
+            renderer_mark_layer_dirty(RENDER_LAYER_APPLICATION, attrs->x, attrs->y, attrs->width, attrs->height);
+        }
+        
+        if (vulkan_texture_has_pending(&g_state.vulkan, &entry->texture)) {
+            pending = true;
+        }
+    }
+    
+    if (pending) {
+        g_state.frame_requested = true;
+    }
+}
+
+// 记录一帧的动态任务（在渲染线程上执行）：任务依次为[背景]、各窗口、批处理、[UI]，
+// 方括号内的任务只在局部重绘或该层使用离屏缓存时存在。所有裁剪矩形都限定在重绘区域内。
+// 渲染期间主线程阻塞在vulkan_render_multithread，窗口不会被修改
+static void record_frame_task(VkCommandBuffer cmd_buffer, uint32_t task_index, void* user_data) {
+    const struct frame_record_context* context = (const struct frame_record_context*)user_data;
+    
+    // 第一个任务之前的内容（清除和预记录层）计入基础阶段，之后每类任务各自计时
+    if (task_index == 0) {
+        vulkan_gpu_timer_write(&g_state.vulkan, cmd_buffer, VULKAN_TIMESTAMP_LAYERS_BEGIN);
+    }
+    
+    // 背景和UI任务（使用离屏缓存时只合成一个全屏四边形）
+    uint32_t first_window = context->background_task ? 1 : 0;
+    uint32_t batch_task = first_window + context->window_count;
+    if (context->background_task && task_index == 0) {
+        if (context->background_cached) {
+            vulkan_layer_cache_draw(&g_state.vulkan, cmd_buffer, RENDER_LAYER_BACKGROUND, &context->clip);
+        } else {
+            record_background_commands(cmd_buffer, (void*)&context->clip);
+        }
+        vulkan_gpu_timer_write(&g_state.vulkan, cmd_buffer, VULKAN_TIMESTAMP_BACKGROUND_END);
+        return;
+    }
+    if (context->ui_task && task_index == batch_task + 1) {
+        if (context->ui_cached) {
+            vulkan_layer_cache_draw(&g_state.vulkan, cmd_buffer, RENDER_LAYER_UI, &context->clip);
+        } else {
+            record_ui_commands(cmd_buffer, (void*)&context->clip);
+        }
+        vulkan_gpu_timer_write(&g_state.vulkan, cmd_buffer, VULKAN_TIMESTAMP_LAYERS_END);
+        return;
+    }
+    
+    // 批处理任务（任务按顺序执行，开始时刻即窗口任务的结束时刻）
+    if (task_index == batch_task) {
+        vulkan_gpu_timer_write(&g_state.vulkan, cmd_buffer, VULKAN_TIMESTAMP_WINDOWS_END);
+        VkRect2D scissor = context->clip;
+        vkCmdSetScissor(cmd_buffer, 0, 1, &scissor);
+        vulkan_render_batches(&g_state.vulkan, cmd_buffer);
+        vulkan_gpu_timer_write(&g_state.vulkan, cmd_buffer, VULKAN_TIMESTAMP_BATCHES_END);
+        return;
+    }
+    
+    // 窗口任务：窗口矩形与重绘区域求交
+    struct window* window = context->windows[task_index - first_window];
+    int x0 = window->attrs.x > context->clip.offset.x ? window->attrs.x : context->clip.offset.x;
+    int y0 = window->attrs.y > context->clip.offset.y ? window->attrs.y : context->clip.offset.y;
+    int x1 = window->attrs.x + window->attrs.width;
+    int y1 = window->attrs.y + window->attrs.height;
+    int clip_x1 = context->clip.offset.x + (int)context->clip.extent.width;
+    int clip_y1 = context->clip.offset.y + (int)context->clip.extent.height;
+    if (x1 > clip_x1) x1 = clip_x1;
+    if (y1 > clip_y1) y1 = clip_y1;
+    if (x1 <= x0 || y1 <= y0) {
+        return;
+    }
+    
+    VkViewport viewport = {
+        .x = (float)window->attrs.x,
+        .y = (float)window->attrs.y,
+        .width = (float)window->attrs.width,
+        .height = (float)window->attrs.height,
+        .minDepth = 0.0f,
+        .maxDepth = 1.0f
+    };
+    vkCmdSetViewport(cmd_buffer, 0, 1, &viewport);
+    
+    VkRect2D scissor = {
+        .offset = {x0, y0},
+        .extent = {(uint32_t)(x1 - x0), (uint32_t)(y1 - y0)}
+    };
+    vkCmdSetScissor(cmd_buffer, 0, 1, &scissor);
+    
+    // 这里可以添加窗口内容的绘制命令（绑定窗口纹理并绘制）
+}
+
+// 获取本帧的重绘区域（屏幕损伤来自渲染优化模块，矩形过多时已合并为包围盒，没有损伤时跳过绘制）
+static void get_frame_damage(uint32_t image_index, struct vulkan_frame_damage* damage) {
+    struct dirty_region regions[RENDER_MAX_DAMAGE_RECTS];
+    VkRect2D rects[RENDER_MAX_DAMAGE_RECTS];
+    uint32_t count = render_opt_get_screen_damage(regions, RENDER_MAX_DAMAGE_RECTS);
+    
+    for (uint32_t i = 0; i < count; i++) {
+        rects[i].offset.x = regions[i].x;
+        rects[i].offset.y = regions[i].y;
+        rects[i].extent.width = regions[i].width > 0 ? (uint32_t)regions[i].width : 0;
+        rects[i].extent.height = regions[i].height > 0 ? (uint32_t)regions[i].height : 0;
+    }
+    
+    if (vulkan_prepare_frame_damage(&g_state.vulkan, image_index, rects, count, damage) != 0) {
+        damage->full = true;
+        damage->skip = false;
+        damage->render_area.offset.x = 0;
+        damage->render_area.offset.y = 0;
+        damage->render_area.extent.width = (uint32_t)g_state.width;
+        damage->render_area.extent.height = (uint32_t)g_state.height;
+    }
+    
+    frame_timeline_set_damage_area(damage->skip ? 0 : damage->render_area.extent.width * damage->render_area.extent.height);
+}
+
 // 示例：记录UI元素的次要命令缓冲区
 static void record_ui_commands(VkCommandBuffer cmd_buffer, void* user_data) {
     // 这里可以添加UI渲染命令
@@ -1758,14 +2696,14 @@ static int init_prerecorded_command_buffers(void) {
     }
     
     // 记录静态背景命令缓冲区
-    if (vulkan_record_secondary_command_buffer(&g_state.vulkan, 0, 
+    if (vulkan_record_secondary_command_buffer(&g_state.vulkan, PRERECORDED_BACKGROUND, 
                                               record_background_commands, NULL) != 0) {
         LOGE("Failed to record background command buffer");
         return -1;
     }
     
     // 记录UI命令缓冲区
-    if (vulkan_record_secondary_command_buffer(&g_state.vulkan, 1, 
+    if (vulkan_record_secondary_command_buffer(&g_state.vulkan, PRERECORDED_UI, 
                                               record_ui_commands, NULL) != 0) {
         LOGE("Failed to record UI command buffer");
         return -1;
@@ -1782,16 +2720,68 @@ static void mark_all_command_buffers_dirty(void) {
     }
     
     // 标记所有主要命令缓冲区为脏
-    for (uint32_t i = 0; i < g_state.vulkan.image_count; i++) {
+    for (uint32_t i = 0; i < g_state.vulkan.frames_in_flight; i++) {
         vulkan_mark_command_buffer_dirty(&g_state.vulkan, COMMAND_BUFFER_TYPE_PRIMARY, i);
     }
     
-    // 标记所有次要命令缓冲区为脏
+    // 次要命令缓冲区不只是预记录的背景和UI，全部重新记录
+    mark_secondary_command_buffers_dirty();
+    
+    // 尺寸改变影响所有层
+    for (int i = 0; i < RENDER_LAYER_COUNT; i++) {
+        invalidate_layer((render_layer_type_t)i);
+    }
+    
+    LOGI("All command buffers marked as dirty");
+}
+
+// 标记所有次要命令缓冲区为脏
+static void mark_secondary_command_buffers_dirty(void) {
     for (uint32_t i = 0; i < g_state.vulkan.secondary_buffer_count; i++) {
         vulkan_mark_command_buffer_dirty(&g_state.vulkan, COMMAND_BUFFER_TYPE_SECONDARY, i);
     }
+}
+
+// 使单个层的预记录命令和离屏缓存失效
+static void invalidate_layer(render_layer_type_t layer) {
+    if (layer == RENDER_LAYER_BACKGROUND) {
+        vulkan_mark_command_buffer_dirty(&g_state.vulkan, COMMAND_BUFFER_TYPE_SECONDARY, PRERECORDED_BACKGROUND);
+    } else if (layer == RENDER_LAYER_UI) {
+        vulkan_mark_command_buffer_dirty(&g_state.vulkan, COMMAND_BUFFER_TYPE_SECONDARY, PRERECORDED_UI);
+    }
     
-    LOGI("All command buffers marked as dirty");
+    vulkan_layer_cache_invalidate(&g_state.vulkan, layer);
+}
+
+// 按本层损伤重建层的离屏缓存，返回本帧是否从缓存合成该层
+static bool update_layer_cache(VkCommandBuffer cmd_buffer, render_layer_type_t layer,
+                               void (*record_func)(VkCommandBuffer, void*)) {
+    // 跟随渲染器的层设置启用或禁用缓存；切换后该层的绘制方式改变，所有次要命令缓冲区都需重新记录
+    bool cached = renderer_is_layer_cached(layer);
+    bool was_active = vulkan_layer_cache_is_active(&g_state.vulkan, layer);
+    if (vulkan_layer_cache_set_enabled(&g_state.vulkan, layer, cached) != 0) {
+        return false;
+    }
+    if (vulkan_layer_cache_is_active(&g_state.vulkan, layer) != was_active) {
+        // 在途帧可能仍在执行旧的次要命令缓冲区，等待后立即重新记录（脏的缓冲区不会被执行）
+        vulkan_device_wait_idle(&g_state.vulkan);
+        mark_secondary_command_buffers_dirty();
+        invalidate_layer(layer);
+        if (init_prerecorded_command_buffers() != 0) {
+            LOGE("Failed to rerecord command buffers after layer %d cache change", layer);
+        }
+    }
+    if (!cached) {
+        return false;
+    }
+    
+    if (!vulkan_layer_cache_is_active(&g_state.vulkan, layer)) {
+        return false;
+    }
+    
+    uint32_t count = 0;
+    const struct dirty_region* regions = renderer_get_dirty_regions(layer, &count);
+    return vulkan_layer_cache_update(&g_state.vulkan, cmd_buffer, layer, regions, count, record_func) == 0;
 }
 
 // 内存池相关API实现
@@ -1927,6 +2917,12 @@ void compositor_destroy(void) {
         g_state.game_mode_initialized = false;
     }
     
+    // 清理帧调度器
+    frame_sched_destroy();
+    frame_timeline_destroy();
+    cpu_sampler_destroy();
+    cleanup_idle_wait();
+    
     // 清理性能优化
     if (g_state.perf_opt_initialized) {
         perf_opt_destroy(&g_state.perf_opt);
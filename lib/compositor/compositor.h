@@ -3,25 +3,66 @@
 
 #include <android/native_window.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include "compositor_perf_opt.h"
 #include "compositor_game.h"
 #include "compositor_monitor.h"
 #include "compositor_memory_pool_opt.h"
+#include "compositor_vulkan_upload.h"
+#include "compositor_frame_timeline.h"
 #include "memory_pool.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+struct window;
+
+// 没有直接呈现（跳过合成）的原因
+enum compositor_bypass_refusal {
+    COMPOSITOR_BYPASS_DISABLED = 0,        // 直接呈现已禁用
+    COMPOSITOR_BYPASS_NO_WINDOW,           // 没有可见窗口
+    COMPOSITOR_BYPASS_MULTIPLE_WINDOWS,    // 有多个可见窗口
+    COMPOSITOR_BYPASS_NOT_FULLSCREEN,      // 窗口没有正好覆盖整个输出
+    COMPOSITOR_BYPASS_NO_BUFFER,           // 窗口还没有提交缓冲区
+    COMPOSITOR_BYPASS_NOT_OPAQUE,          // 缓冲区含需要混合的透明像素
+    COMPOSITOR_BYPASS_OVERLAY_CONTENT,     // 窗口之上还有覆盖层、UI、光标或待绘制的批次
+    COMPOSITOR_BYPASS_INCOMPATIBLE,        // 缓冲区格式无法复制或blit到交换链
+    COMPOSITOR_BYPASS_REFUSAL_COUNT
+};
+
+// 直接呈现统计
+struct compositor_bypass_stats {
+    uint64_t bypassed_frames;              // 跳过合成直接呈现的帧数
+    uint64_t copied_frames;                // 其中格式和尺寸一致、直接复制的帧数
+    uint64_t blitted_frames;               // 其中需要格式转换或缩放的帧数
+    uint64_t composited_frames;            // 完整合成的帧数
+    uint64_t refused[COMPOSITOR_BYPASS_REFUSAL_COUNT]; // 按原因统计的合成帧数
+};
+
+// 设置应用数据目录，用于持久化管线缓存等（需在 compositor_init 之前调用）
+// - path: 建议使用 GameActivity.app->activity->internalDataPath，传 NULL 则不持久化
+int compositor_set_data_dir(const char* path);
+
 // 初始化合成器
 // - window: 来自 GameActivity.app->window
 // - width/height: 建议从 ANativeWindow_getWidth/Height 获取
 int compositor_init(ANativeWindow* window, int width, int height);
 
 // 主循环单步（应在 GameActivity 的渲染线程中循环调用）
-// 返回 0 表示正常，非 0 表示错误
+// 空闲时会阻塞等待客户端请求、输入或下一帧的调度时间
+// 返回 1 表示呈现了新帧，0 表示没有需要呈现的内容，负数表示错误
 int compositor_step(void);
 
+// 请求呈现一帧（用于没有脏区域跟踪的一次性更新）
+void compositor_request_frame(void);
+
+// 设置动画是否进行中（进行中时每个刷新周期都出帧）
+void compositor_set_animation_active(bool active);
+
+// 启用/禁用空闲等待（禁用时每次调用都会出帧）
+int compositor_set_idle_enabled(bool enabled);
+
 // 销毁合成器
 void compositor_destroy(void);
 
@@ -78,6 +119,36 @@ int compositor_get_target_fps(void);
 int compositor_set_quality_level(int level);
 int compositor_get_quality_level(void);
 int compositor_get_perf_opt_stats(struct perf_opt_stats *stats);
+int compositor_set_frame_deadline_miss_rate(float miss_rate);
+int compositor_set_refresh_rate(int refresh_rate);
+int compositor_set_frames_in_flight(int count);
+
+// 直接呈现相关API（单个不透明全屏窗口时跳过合成）
+int compositor_set_direct_present_enabled(bool enabled);
+bool compositor_is_direct_present_enabled(void);
+int compositor_get_bypass_stats(struct compositor_bypass_stats* stats);
+
+// 后台纹理上传相关API（渲染线程调用）
+// - pixels: BGRA8像素，stride为每行字节数；上传完成前窗口继续显示旧内容
+// - release: 像素复制到暂存区后在上传线程中调用，之后可以释放客户端缓冲区（失败时立即调用）
+int compositor_upload_window_pixels(struct window* window, const void* pixels, uint32_t width, uint32_t height,
+                                    uint32_t stride, bool opaque, void (*release)(void* user_data), void* user_data);
+void compositor_release_window_texture(struct window* window);
+int compositor_get_upload_stats(struct vulkan_upload_stats* stats);
+
+// 离屏层缓存相关API（SPIR-V着色器按vulkan_layer_cache_set_pipeline的约定编写，管线经持久化的管线缓存编译，
+// 设置前已按层启用的缓存不生效）
+int compositor_set_layer_cache_shaders(const uint32_t* vertex_spirv, size_t vertex_size,
+                                       const uint32_t* fragment_spirv, size_t fragment_size);
+
+// 帧时间线相关API（各阶段时间戳、错过截止时间的阶段归因）
+int compositor_get_frame_timeline_stats(struct frame_timeline_stats* stats);
+int compositor_get_frame_records(struct frame_record* records, uint32_t max_count);
+int compositor_dump_frame_timeline(const char* path);
+
+// 跟踪相关API（各线程的区间事件导出为可在ui.perfetto.dev离线查看的JSON）
+int compositor_set_trace_enabled(bool enabled);
+int compositor_flush_trace(const char* path);
 
 // 游戏模式相关API
 int compositor_set_game_mode_enabled(bool enabled);
@@ -0,0 +1,418 @@
+#include "compositor_cpu_sampler.h"
+#include "compositor_trace.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <android/log.h>
+
+#define LOG_TAG "CpuSampler"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+// 线程的上一次读数（只由采样线程访问）
+struct thread_sample {
+    uint32_t tid;
+    uint64_t cpu_ticks;                    // utime + stime
+    uint64_t run_ns;                       // schedstat：运行时间
+    uint64_t wait_ns;                      // schedstat：在运行队列中等待的时间
+    uint64_t involuntary_switches;
+    bool has_schedstat;
+};
+
+// CPU采样器状态
+static struct {
+    bool initialized;
+    bool running;                          // 采样线程是否继续运行（持有mutex时访问）
+    uint32_t interval_ms;
+    pthread_t thread;
+    pthread_mutex_t mutex;                 // 保护running和已发布的统计
+    pthread_cond_t cond;
+    long clock_ticks;                      // 每秒时钟滴答数
+    uint32_t cpu_count;
+    
+    // 采样线程私有
+    struct thread_sample samples[CPU_SAMPLER_MAX_THREADS];
+    uint32_t sample_count;
+    uint64_t process_ticks;
+    uint64_t last_sample_ns;
+    
+    // 已发布的统计
+    struct cpu_process_stats process;
+    struct cpu_thread_stats threads[CPU_SAMPLER_MAX_THREADS];
+    uint32_t thread_count;
+    atomic_uint process_usage_permille;    // 供渲染线程无锁读取
+} g_sampler = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER
+};
+
+// 内部函数声明
+static void* sampler_thread_main(void* arg);
+static void take_sample(void);
+static int read_file(const char* path, char* buffer, size_t size);
+static int read_stat(const char* path, char* name, uint64_t* cpu_ticks);
+static int read_schedstat(uint32_t tid, uint64_t* run_ns, uint64_t* wait_ns);
+static int read_involuntary_switches(uint32_t tid, uint64_t* switches);
+static const struct thread_sample* find_previous(uint32_t tid);
+static int compare_thread_usage(const void* a, const void* b);
+static uint64_t sampler_get_time_ns(void);
+
+// 初始化CPU采样器（启动后台采样线程，interval_ms为0时使用默认间隔）
+int cpu_sampler_init(uint32_t interval_ms) {
+    if (g_sampler.initialized) {
+        LOGE("CPU sampler already initialized");
+        return -1;
+    }
+    
+    g_sampler.interval_ms = interval_ms ? interval_ms : CPU_SAMPLER_DEFAULT_INTERVAL_MS;
+    g_sampler.clock_ticks = sysconf(_SC_CLK_TCK);
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    g_sampler.cpu_count = cpus > 0 ? (uint32_t)cpus : 1;
+    if (g_sampler.clock_ticks <= 0) {
+        g_sampler.clock_ticks = 100;
+    }
+    
+    g_sampler.sample_count = 0;
+    g_sampler.process_ticks = 0;
+    g_sampler.last_sample_ns = 0;
+    memset(&g_sampler.process, 0, sizeof(g_sampler.process));
+    g_sampler.thread_count = 0;
+    atomic_store(&g_sampler.process_usage_permille, 0);
+    g_sampler.running = true;
+    
+    if (pthread_create(&g_sampler.thread, NULL, sampler_thread_main, NULL) != 0) {
+        LOGE("Failed to create CPU sampler thread");
+        return -1;
+    }
+    
+    g_sampler.initialized = true;
+    LOGI("CPU sampler initialized (%u ms, %u CPUs)", g_sampler.interval_ms, g_sampler.cpu_count);
+    return 0;
+}
+
+// 销毁CPU采样器
+void cpu_sampler_destroy(void) {
+    if (!g_sampler.initialized) {
+        return;
+    }
+    
+    pthread_mutex_lock(&g_sampler.mutex);
+    g_sampler.running = false;
+    pthread_cond_signal(&g_sampler.cond);
+    pthread_mutex_unlock(&g_sampler.mutex);
+    
+    pthread_join(g_sampler.thread, NULL);
+    g_sampler.initialized = false;
+    atomic_store(&g_sampler.process_usage_permille, 0);
+    
+    LOGI("CPU sampler destroyed");
+}
+
+// 获取进程CPU使用率（百分比，无锁，可每帧调用）
+float cpu_sampler_get_process_usage(void) {
+    return atomic_load_explicit(&g_sampler.process_usage_permille, memory_order_relaxed) / 10.0f;
+}
+
+// 获取进程统计
+void cpu_sampler_get_process_stats(struct cpu_process_stats* stats) {
+    if (!stats) {
+        return;
+    }
+    
+    pthread_mutex_lock(&g_sampler.mutex);
+    *stats = g_sampler.process;
+    pthread_mutex_unlock(&g_sampler.mutex);
+}
+
+// 获取各线程统计（按CPU使用率从高到低），返回复制的条数
+uint32_t cpu_sampler_get_threads(struct cpu_thread_stats* threads, uint32_t max_count) {
+    if (!threads || max_count == 0) {
+        return 0;
+    }
+    
+    pthread_mutex_lock(&g_sampler.mutex);
+    uint32_t count = g_sampler.thread_count < max_count ? g_sampler.thread_count : max_count;
+    memcpy(threads, g_sampler.threads, count * sizeof(struct cpu_thread_stats));
+    pthread_mutex_unlock(&g_sampler.mutex);
+    
+    return count;
+}
+
+// 打印CPU统计
+void cpu_sampler_print_stats(void) {
+    struct cpu_process_stats process;
+    struct cpu_thread_stats threads[CPU_SAMPLER_MAX_THREADS];
+    
+    cpu_sampler_get_process_stats(&process);
+    uint32_t count = cpu_sampler_get_threads(threads, CPU_SAMPLER_MAX_THREADS);
+    
+    LOGI("CPU Statistics:");
+    LOGI("  Process: %.1f%% (%.2f of %u cores), %u threads", process.cpu_percent, process.cpu_cores,
+         process.cpu_count, process.thread_count);
+    LOGI("  Run Queue Wait: %.1f ms/s, Involuntary Switches: %.1f/s",
+         process.runqueue_wait_ms, process.involuntary_switches);
+    
+    for (uint32_t i = 0; i < count; i++) {
+        LOGI("  [%u] %-15s %5.1f%%  wait %6.1f ms/s  nvcsw %6.1f/s", threads[i].tid, threads[i].name,
+             threads[i].cpu_percent, threads[i].runqueue_wait_ms, threads[i].involuntary_switches);
+    }
+}
+
+// 采样线程：按间隔读取/proc并发布结果
+static void* sampler_thread_main(void* arg) {
+    (void)arg;
+    trace_set_thread_name("cpu-sampler");
+    
+    pthread_mutex_lock(&g_sampler.mutex);
+    while (g_sampler.running) {
+        pthread_mutex_unlock(&g_sampler.mutex);
+        take_sample();
+        pthread_mutex_lock(&g_sampler.mutex);
+        
+        if (!g_sampler.running) {
+            break;
+        }
+        
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += g_sampler.interval_ms / 1000;
+        deadline.tv_nsec += (long)(g_sampler.interval_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&g_sampler.cond, &g_sampler.mutex, &deadline);
+    }
+    pthread_mutex_unlock(&g_sampler.mutex);
+    
+    return NULL;
+}
+
+// 读取一次进程和各线程的计数，与上一次读数求差后发布
+static void take_sample(void) {
+    TRACE_SCOPE("cpu_sample");
+    
+    uint64_t now_ns = sampler_get_time_ns();
+    uint64_t process_ticks = 0;
+    char name[CPU_SAMPLER_NAME_SIZE];
+    if (read_stat("/proc/self/stat", name, &process_ticks) != 0) {
+        return;
+    }
+    
+    struct thread_sample samples[CPU_SAMPLER_MAX_THREADS];
+    struct cpu_thread_stats threads[CPU_SAMPLER_MAX_THREADS];
+    uint32_t count = 0;
+    bool have_previous = g_sampler.last_sample_ns != 0;
+    double elapsed_s = have_previous ? (now_ns - g_sampler.last_sample_ns) / 1e9 : 0.0;
+    
+    DIR* dir = opendir("/proc/self/task");
+    if (!dir) {
+        LOGE("Failed to open /proc/self/task");
+        return;
+    }
+    
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL && count < CPU_SAMPLER_MAX_THREADS) {
+        if (entry->d_name[0] < '0' || entry->d_name[0] > '9') {
+            continue;
+        }
+        
+        struct thread_sample* sample = &samples[count];
+        struct cpu_thread_stats* thread = &threads[count];
+        char path[64];
+        
+        memset(sample, 0, sizeof(*sample));
+        memset(thread, 0, sizeof(*thread));
+        sample->tid = (uint32_t)strtoul(entry->d_name, NULL, 10);
+        
+        // 线程可能在读取期间退出
+        snprintf(path, sizeof(path), "/proc/self/task/%u/stat", sample->tid);
+        if (read_stat(path, thread->name, &sample->cpu_ticks) != 0) {
+            continue;
+        }
+        sample->has_schedstat = read_schedstat(sample->tid, &sample->run_ns, &sample->wait_ns) == 0;
+        read_involuntary_switches(sample->tid, &sample->involuntary_switches);
+        
+        thread->tid = sample->tid;
+        thread->total_involuntary_switches = sample->involuntary_switches;
+        
+        // 新线程在下一次采样时才有速率
+        const struct thread_sample* previous = have_previous ? find_previous(sample->tid) : NULL;
+        if (previous && elapsed_s > 0.0) {
+            if (sample->has_schedstat && previous->has_schedstat) {
+                // schedstat以纳秒计，比stat的时钟滴答精确
+                thread->cpu_percent = (float)((sample->run_ns - previous->run_ns) / 1e9 / elapsed_s * 100.0);
+                thread->runqueue_wait_ms = (float)((sample->wait_ns - previous->wait_ns) / 1e6 / elapsed_s);
+            } else {
+                thread->cpu_percent = (float)((double)(sample->cpu_ticks - previous->cpu_ticks) /
+                                              g_sampler.clock_ticks / elapsed_s * 100.0);
+            }
+            thread->involuntary_switches =
+                (float)((sample->involuntary_switches - previous->involuntary_switches) / elapsed_s);
+        }
+        
+        count++;
+    }
+    closedir(dir);
+    
+    qsort(threads, count, sizeof(struct cpu_thread_stats), compare_thread_usage);
+    
+    // 进程级统计（/proc/self/stat包含已退出线程的时间）
+    struct cpu_process_stats process;
+    memset(&process, 0, sizeof(process));
+    process.thread_count = count;
+    process.cpu_count = g_sampler.cpu_count;
+    process.sample_time_ns = now_ns;
+    if (have_previous && elapsed_s > 0.0) {
+        process.cpu_cores = (float)((double)(process_ticks - g_sampler.process_ticks) /
+                                    g_sampler.clock_ticks / elapsed_s);
+        process.cpu_percent = process.cpu_cores / g_sampler.cpu_count * 100.0f;
+        if (process.cpu_percent > 100.0f) {
+            process.cpu_percent = 100.0f;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            process.runqueue_wait_ms += threads[i].runqueue_wait_ms;
+            process.involuntary_switches += threads[i].involuntary_switches;
+        }
+    }
+    
+    // 保存本次读数
+    memcpy(g_sampler.samples, samples, count * sizeof(struct thread_sample));
+    g_sampler.sample_count = count;
+    g_sampler.process_ticks = process_ticks;
+    g_sampler.last_sample_ns = now_ns;
+    
+    if (!have_previous) {
+        return;
+    }
+    
+    // 发布
+    pthread_mutex_lock(&g_sampler.mutex);
+    g_sampler.process = process;
+    memcpy(g_sampler.threads, threads, count * sizeof(struct cpu_thread_stats));
+    g_sampler.thread_count = count;
+    pthread_mutex_unlock(&g_sampler.mutex);
+    
+    atomic_store_explicit(&g_sampler.process_usage_permille, (uint32_t)(process.cpu_percent * 10.0f + 0.5f),
+                          memory_order_relaxed);
+}
+
+// 读取整个小文件，返回读取的字节数
+static int read_file(const char* path, char* buffer, size_t size) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return -1;
+    }
+    
+    size_t length = fread(buffer, 1, size - 1, file);
+    fclose(file);
+    buffer[length] = '\0';
+    return (int)length;
+}
+
+// 读取stat中的线程名和utime+stime（线程名可能包含空格和括号，以最后一个')'为界）
+static int read_stat(const char* path, char* name, uint64_t* cpu_ticks) {
+    char buffer[512];
+    if (read_file(path, buffer, sizeof(buffer)) <= 0) {
+        return -1;
+    }
+    
+    char* open = strchr(buffer, '(');
+    char* close = strrchr(buffer, ')');
+    if (!open || !close || close < open) {
+        return -1;
+    }
+    
+    size_t length = (size_t)(close - open - 1);
+    if (length >= CPU_SAMPLER_NAME_SIZE) {
+        length = CPU_SAMPLER_NAME_SIZE - 1;
+    }
+    memcpy(name, open + 1, length);
+    name[length] = '\0';
+    
+    // 字段3（state）到字段13之后是utime和stime
+    unsigned long long utime = 0;
+    unsigned long long stime = 0;
+    if (sscanf(close + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime, &stime) != 2) {
+        return -1;
+    }
+    
+    *cpu_ticks = utime + stime;
+    return 0;
+}
+
+// 读取schedstat：运行时间、运行队列等待时间（纳秒）
+static int read_schedstat(uint32_t tid, uint64_t* run_ns, uint64_t* wait_ns) {
+    char path[64];
+    char buffer[128];
+    
+    snprintf(path, sizeof(path), "/proc/self/task/%u/schedstat", tid);
+    if (read_file(path, buffer, sizeof(buffer)) <= 0) {
+        return -1;
+    }
+    
+    unsigned long long run = 0;
+    unsigned long long wait = 0;
+    if (sscanf(buffer, "%llu %llu", &run, &wait) != 2) {
+        return -1;
+    }
+    
+    *run_ns = run;
+    *wait_ns = wait;
+    return 0;
+}
+
+// 从status读取非自愿上下文切换次数
+static int read_involuntary_switches(uint32_t tid, uint64_t* switches) {
+    char path[64];
+    char buffer[2048];
+    
+    snprintf(path, sizeof(path), "/proc/self/task/%u/status", tid);
+    if (read_file(path, buffer, sizeof(buffer)) <= 0) {
+        return -1;
+    }
+    
+    const char* line = strstr(buffer, "nonvoluntary_ctxt_switches:");
+    if (!line) {
+        return -1;
+    }
+    
+    *switches = strtoull(line + strlen("nonvoluntary_ctxt_switches:"), NULL, 10);
+    return 0;
+}
+
+// 查找线程的上一次读数
+static const struct thread_sample* find_previous(uint32_t tid) {
+    for (uint32_t i = 0; i < g_sampler.sample_count; i++) {
+        if (g_sampler.samples[i].tid == tid) {
+            return &g_sampler.samples[i];
+        }
+    }
+    return NULL;
+}
+
+// 按CPU使用率从高到低排序
+static int compare_thread_usage(const void* a, const void* b) {
+    float ua = ((const struct cpu_thread_stats*)a)->cpu_percent;
+    float ub = ((const struct cpu_thread_stats*)b)->cpu_percent;
+    
+    if (ua > ub) {
+        return -1;
+    } else if (ua < ub) {
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
+// 获取当前时间（纳秒）
+static uint64_t sampler_get_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
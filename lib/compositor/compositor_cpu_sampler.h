@@ -0,0 +1,61 @@
+#ifndef COMPOSITOR_CPU_SAMPLER_H
+#define COMPOSITOR_CPU_SAMPLER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 跟踪的线程数上限
+#define CPU_SAMPLER_MAX_THREADS 64
+// 线程名长度（与内核comm一致）
+#define CPU_SAMPLER_NAME_SIZE 16
+// 默认采样间隔（毫秒）
+#define CPU_SAMPLER_DEFAULT_INTERVAL_MS 500
+
+// 单个线程在上一个采样间隔内的统计
+struct cpu_thread_stats {
+    uint32_t tid;
+    char name[CPU_SAMPLER_NAME_SIZE];
+    float cpu_percent;                     // 占一个核心的百分比
+    float runqueue_wait_ms;                // 每秒在运行队列中等待的时间（毫秒）
+    float involuntary_switches;            // 每秒非自愿上下文切换次数
+    uint64_t total_involuntary_switches;   // 累计非自愿上下文切换次数
+};
+
+// 整个进程在上一个采样间隔内的统计
+struct cpu_process_stats {
+    float cpu_percent;                     // 占全部在线核心的百分比
+    float cpu_cores;                       // 折合占用的核心数
+    float runqueue_wait_ms;                // 各线程每秒在运行队列中等待的时间之和（毫秒）
+    float involuntary_switches;            // 各线程每秒非自愿上下文切换次数之和
+    uint32_t thread_count;
+    uint32_t cpu_count;
+    uint64_t sample_time_ns;               // 采样时间（CLOCK_MONOTONIC，0表示尚无结果）
+};
+
+// 初始化CPU采样器（启动后台采样线程，interval_ms为0时使用默认间隔）
+int cpu_sampler_init(uint32_t interval_ms);
+
+// 销毁CPU采样器
+void cpu_sampler_destroy(void);
+
+// 获取进程CPU使用率（百分比，无锁，可每帧调用）
+float cpu_sampler_get_process_usage(void);
+
+// 获取进程统计
+void cpu_sampler_get_process_stats(struct cpu_process_stats* stats);
+
+// 获取各线程统计（按CPU使用率从高到低），返回复制的条数
+uint32_t cpu_sampler_get_threads(struct cpu_thread_stats* threads, uint32_t max_count);
+
+// 打印CPU统计
+void cpu_sampler_print_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COMPOSITOR_CPU_SAMPLER_H
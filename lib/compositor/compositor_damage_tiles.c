@@ -0,0 +1,311 @@
+#include "compositor_damage_tiles.h"
+#include <stdlib.h>
+#include <string.h>
+#include <android/log.h>
+
+#define LOG_TAG "DamageTiles"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+// 内部函数声明
+static bool damage_tiles_rect_range(const struct damage_tiles* tiles, int x, int y, int width, int height,
+                                    uint32_t* tx0, uint32_t* ty0, uint32_t* tx1, uint32_t* ty1);
+static uint64_t damage_tiles_word_mask(uint32_t word, uint32_t tx0, uint32_t tx1);
+static void damage_tiles_emit_row(const struct damage_tiles* tiles, const uint64_t* row, uint32_t ty, uint32_t rows,
+                                  damage_tiles_span_fn fn, void* user_data);
+static void damage_tiles_emit_span(const struct damage_tiles* tiles, uint32_t tx0, uint32_t tx1, uint32_t ty, uint32_t rows,
+                                   damage_tiles_span_fn fn, void* user_data);
+
+// 初始化瓦片位图（屏幕尺寸未知时可传0，位图在首次调整大小时分配）
+int damage_tiles_init(struct damage_tiles* tiles, int screen_width, int screen_height, uint32_t tile_size) {
+    if (!tiles || screen_width < 0 || screen_height < 0) {
+        return -1;
+    }
+    
+    // 瓦片边长必须是2的幂，便于用移位代替除法
+    if (tile_size == 0 || (tile_size & (tile_size - 1)) != 0) {
+        LOGE("Invalid tile size: %u", tile_size);
+        return -1;
+    }
+    
+    memset(tiles, 0, sizeof(*tiles));
+    tiles->tile_size = tile_size;
+    tiles->tile_shift = (uint32_t)__builtin_ctz(tile_size);
+    
+    return damage_tiles_resize(tiles, screen_width, screen_height);
+}
+
+// 调整瓦片位图的屏幕尺寸（重新分配并清空位图，尺寸为0时释放位图）
+int damage_tiles_resize(struct damage_tiles* tiles, int screen_width, int screen_height) {
+    if (!tiles || tiles->tile_size == 0 || screen_width < 0 || screen_height < 0) {
+        return -1;
+    }
+    
+    if (tiles->bits && tiles->screen_width == screen_width && tiles->screen_height == screen_height) {
+        damage_tiles_clear(tiles);
+        return 0;
+    }
+    
+    free(tiles->bits);
+    tiles->bits = NULL;
+    tiles->tiles_x = ((uint32_t)screen_width + tiles->tile_size - 1) >> tiles->tile_shift;
+    tiles->tiles_y = ((uint32_t)screen_height + tiles->tile_size - 1) >> tiles->tile_shift;
+    tiles->words_per_row = (tiles->tiles_x + 63) / 64;
+    tiles->word_count = tiles->words_per_row * tiles->tiles_y;
+    tiles->screen_width = screen_width;
+    tiles->screen_height = screen_height;
+    
+    if (tiles->word_count == 0) {
+        return 0;
+    }
+    
+    tiles->bits = (uint64_t*)calloc(tiles->word_count, sizeof(uint64_t));
+    if (!tiles->bits) {
+        LOGE("Failed to allocate tile bitmap");
+        tiles->word_count = 0;
+        return -1;
+    }
+    
+    return 0;
+}
+
+// 销毁瓦片位图
+void damage_tiles_destroy(struct damage_tiles* tiles) {
+    if (!tiles) {
+        return;
+    }
+    
+    free(tiles->bits);
+    tiles->bits = NULL;
+    tiles->word_count = 0;
+}
+
+// 清除所有脏瓦片
+void damage_tiles_clear(struct damage_tiles* tiles) {
+    if (!tiles || !tiles->bits) {
+        return;
+    }
+    
+    memset(tiles->bits, 0, tiles->word_count * sizeof(uint64_t));
+}
+
+// 标记矩形覆盖的瓦片为脏
+void damage_tiles_mark_rect(struct damage_tiles* tiles, int x, int y, int width, int height) {
+    uint32_t tx0, ty0, tx1, ty1;
+    if (!tiles || !tiles->bits || !damage_tiles_rect_range(tiles, x, y, width, height, &tx0, &ty0, &tx1, &ty1)) {
+        return;
+    }
+    
+    // 每个字的掩码只计算一次，再逐行按字进行或运算
+    uint32_t first_word = tx0 / 64;
+    uint32_t last_word = (tx1 - 1) / 64;
+    
+    for (uint32_t w = first_word; w <= last_word; w++) {
+        uint64_t mask = damage_tiles_word_mask(w, tx0, tx1);
+        uint64_t* word = &tiles->bits[ty0 * tiles->words_per_row + w];
+        
+        for (uint32_t ty = ty0; ty < ty1; ty++) {
+            *word |= mask;
+            word += tiles->words_per_row;
+        }
+    }
+}
+
+// 合并两个位图（dst |= src）
+void damage_tiles_union(struct damage_tiles* dst, const struct damage_tiles* src) {
+    if (!dst || !src || !dst->bits || !src->bits || dst->word_count != src->word_count) {
+        return;
+    }
+    
+    // 简单的按字循环，编译器会将其向量化为NEON指令
+    for (uint32_t i = 0; i < dst->word_count; i++) {
+        dst->bits[i] |= src->bits[i];
+    }
+}
+
+// 求两个位图的交集（dst &= src）
+void damage_tiles_intersect(struct damage_tiles* dst, const struct damage_tiles* src) {
+    if (!dst || !src || !dst->bits || !src->bits || dst->word_count != src->word_count) {
+        return;
+    }
+    
+    for (uint32_t i = 0; i < dst->word_count; i++) {
+        dst->bits[i] &= src->bits[i];
+    }
+}
+
+// 检查矩形是否与脏瓦片相交
+bool damage_tiles_intersects_rect(const struct damage_tiles* tiles, int x, int y, int width, int height) {
+    uint32_t tx0, ty0, tx1, ty1;
+    if (!tiles || !tiles->bits || !damage_tiles_rect_range(tiles, x, y, width, height, &tx0, &ty0, &tx1, &ty1)) {
+        return false;
+    }
+    
+    uint32_t first_word = tx0 / 64;
+    uint32_t last_word = (tx1 - 1) / 64;
+    
+    for (uint32_t w = first_word; w <= last_word; w++) {
+        uint64_t mask = damage_tiles_word_mask(w, tx0, tx1);
+        const uint64_t* word = &tiles->bits[ty0 * tiles->words_per_row + w];
+        
+        for (uint32_t ty = ty0; ty < ty1; ty++) {
+            if (*word & mask) {
+                return true;
+            }
+            word += tiles->words_per_row;
+        }
+    }
+    
+    return false;
+}
+
+// 检查位图是否为空
+bool damage_tiles_is_empty(const struct damage_tiles* tiles) {
+    if (!tiles || !tiles->bits) {
+        return true;
+    }
+    
+    uint64_t acc = 0;
+    for (uint32_t i = 0; i < tiles->word_count; i++) {
+        acc |= tiles->bits[i];
+    }
+    
+    return acc == 0;
+}
+
+// 获取脏瓦片数量
+uint32_t damage_tiles_count(const struct damage_tiles* tiles) {
+    if (!tiles || !tiles->bits) {
+        return 0;
+    }
+    
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < tiles->word_count; i++) {
+        count += (uint32_t)__builtin_popcountll(tiles->bits[i]);
+    }
+    
+    return count;
+}
+
+// 遍历脏区域跨度（相同的相邻行会被合并为一个矩形）
+void damage_tiles_for_each_span(const struct damage_tiles* tiles, damage_tiles_span_fn fn, void* user_data) {
+    if (!tiles || !tiles->bits || !fn) {
+        return;
+    }
+    
+    const uint64_t* run_row = NULL;
+    uint32_t run_start = 0;
+    size_t row_bytes = tiles->words_per_row * sizeof(uint64_t);
+    
+    for (uint32_t ty = 0; ty < tiles->tiles_y; ty++) {
+        const uint64_t* row = &tiles->bits[ty * tiles->words_per_row];
+        
+        // 与上一行完全相同则延续当前矩形
+        if (run_row && memcmp(row, run_row, row_bytes) == 0) {
+            continue;
+        }
+        
+        // 输出之前累积的行
+        if (run_row) {
+            damage_tiles_emit_row(tiles, run_row, run_start, ty - run_start, fn, user_data);
+            run_row = NULL;
+        }
+        
+        // 检查当前行是否有脏瓦片
+        uint64_t acc = 0;
+        for (uint32_t w = 0; w < tiles->words_per_row; w++) {
+            acc |= row[w];
+        }
+        
+        if (acc) {
+            run_row = row;
+            run_start = ty;
+        }
+    }
+    
+    if (run_row) {
+        damage_tiles_emit_row(tiles, run_row, run_start, tiles->tiles_y - run_start, fn, user_data);
+    }
+}
+
+// 内部函数：将像素矩形转换为瓦片范围（右、下边界不包含）
+static bool damage_tiles_rect_range(const struct damage_tiles* tiles, int x, int y, int width, int height,
+                                    uint32_t* tx0, uint32_t* ty0, uint32_t* tx1, uint32_t* ty1) {
+    int x0 = x < 0 ? 0 : x;
+    int y0 = y < 0 ? 0 : y;
+    int x1 = x + width > tiles->screen_width ? tiles->screen_width : x + width;
+    int y1 = y + height > tiles->screen_height ? tiles->screen_height : y + height;
+    
+    if (x1 <= x0 || y1 <= y0) {
+        return false;
+    }
+    
+    *tx0 = (uint32_t)x0 >> tiles->tile_shift;
+    *ty0 = (uint32_t)y0 >> tiles->tile_shift;
+    *tx1 = ((uint32_t)x1 + tiles->tile_size - 1) >> tiles->tile_shift;
+    *ty1 = ((uint32_t)y1 + tiles->tile_size - 1) >> tiles->tile_shift;
+    return true;
+}
+
+// 内部函数：计算瓦片范围[tx0, tx1)在指定字内的位掩码
+static uint64_t damage_tiles_word_mask(uint32_t word, uint32_t tx0, uint32_t tx1) {
+    uint32_t base = word * 64;
+    uint32_t lo = tx0 > base ? tx0 - base : 0;
+    uint32_t hi = tx1 < base + 64 ? tx1 - base : 64;
+    
+    uint64_t high_mask = hi >= 64 ? ~(uint64_t)0 : (((uint64_t)1 << hi) - 1);
+    uint64_t low_mask = ((uint64_t)1 << lo) - 1;
+    return high_mask & ~low_mask;
+}
+
+// 内部函数：输出一行中所有连续的脏瓦片跨度
+static void damage_tiles_emit_row(const struct damage_tiles* tiles, const uint64_t* row, uint32_t ty, uint32_t rows,
+                                  damage_tiles_span_fn fn, void* user_data) {
+    int64_t span_start = -1;
+    
+    for (uint32_t w = 0; w < tiles->words_per_row; w++) {
+        uint64_t word = row[w];
+        uint32_t base = w * 64;
+        uint32_t bit = 0;
+        
+        // 用ctz按字跳过连续的0或1，而不是逐位扫描
+        while (bit < 64) {
+            if (span_start < 0) {
+                uint64_t rest = word >> bit;
+                if (!rest) {
+                    break;
+                }
+                bit += (uint32_t)__builtin_ctzll(rest);
+                span_start = base + bit;
+            } else {
+                uint64_t rest = ~word >> bit;
+                if (!rest) {
+                    // 跨度延续到下一个字
+                    break;
+                }
+                bit += (uint32_t)__builtin_ctzll(rest);
+                damage_tiles_emit_span(tiles, (uint32_t)span_start, base + bit, ty, rows, fn, user_data);
+                span_start = -1;
+            }
+        }
+    }
+    
+    if (span_start >= 0) {
+        damage_tiles_emit_span(tiles, (uint32_t)span_start, tiles->tiles_x, ty, rows, fn, user_data);
+    }
+}
+
+// 内部函数：将瓦片跨度转换为像素矩形并回调
+static void damage_tiles_emit_span(const struct damage_tiles* tiles, uint32_t tx0, uint32_t tx1, uint32_t ty, uint32_t rows,
+                                   damage_tiles_span_fn fn, void* user_data) {
+    int x0 = (int)(tx0 << tiles->tile_shift);
+    int y0 = (int)(ty << tiles->tile_shift);
+    int x1 = (int)(tx1 << tiles->tile_shift);
+    int y1 = (int)((ty + rows) << tiles->tile_shift);
+    
+    // 最后一列/行的瓦片可能超出屏幕
+    if (x1 > tiles->screen_width) x1 = tiles->screen_width;
+    if (y1 > tiles->screen_height) y1 = tiles->screen_height;
+    
+    fn(user_data, x0, y0, x1 - x0, y1 - y0);
+}
@@ -0,0 +1,67 @@
+#ifndef COMPOSITOR_DAMAGE_TILES_H
+#define COMPOSITOR_DAMAGE_TILES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 默认瓦片边长（像素，必须是2的幂）
+#define DAMAGE_TILE_SIZE 32
+
+// 瓦片位图：每个瓦片一位，每行按64位字对齐
+struct damage_tiles {
+    uint64_t* bits;          // 位图数据
+    uint32_t tile_size;      // 瓦片边长（像素）
+    uint32_t tile_shift;     // log2(tile_size)
+    uint32_t tiles_x;        // 水平瓦片数
+    uint32_t tiles_y;        // 垂直瓦片数
+    uint32_t words_per_row;  // 每行64位字数
+    uint32_t word_count;     // 位图总字数
+    int screen_width;
+    int screen_height;
+};
+
+// 脏区域跨度回调（像素坐标）
+typedef void (*damage_tiles_span_fn)(void* user_data, int x, int y, int width, int height);
+
+// 初始化瓦片位图（屏幕尺寸可为0，此时延迟到damage_tiles_resize再分配）
+int damage_tiles_init(struct damage_tiles* tiles, int screen_width, int screen_height, uint32_t tile_size);
+
+// 调整瓦片位图的屏幕尺寸（清空所有脏瓦片）
+int damage_tiles_resize(struct damage_tiles* tiles, int screen_width, int screen_height);
+
+// 销毁瓦片位图
+void damage_tiles_destroy(struct damage_tiles* tiles);
+
+// 清除所有脏瓦片
+void damage_tiles_clear(struct damage_tiles* tiles);
+
+// 标记矩形覆盖的瓦片为脏
+void damage_tiles_mark_rect(struct damage_tiles* tiles, int x, int y, int width, int height);
+
+// 合并两个位图（dst |= src）
+void damage_tiles_union(struct damage_tiles* dst, const struct damage_tiles* src);
+
+// 求两个位图的交集（dst &= src）
+void damage_tiles_intersect(struct damage_tiles* dst, const struct damage_tiles* src);
+
+// 检查矩形是否与脏瓦片相交
+bool damage_tiles_intersects_rect(const struct damage_tiles* tiles, int x, int y, int width, int height);
+
+// 检查位图是否为空
+bool damage_tiles_is_empty(const struct damage_tiles* tiles);
+
+// 获取脏瓦片数量
+uint32_t damage_tiles_count(const struct damage_tiles* tiles);
+
+// 遍历脏区域跨度（相同的相邻行会被合并为一个矩形）
+void damage_tiles_for_each_span(const struct damage_tiles* tiles, damage_tiles_span_fn fn, void* user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COMPOSITOR_DAMAGE_TILES_H
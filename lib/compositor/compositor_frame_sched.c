@@ -0,0 +1,318 @@
+#include "compositor_frame_sched.h"
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <android/log.h>
+
+#define LOG_TAG "FrameSched"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+
+// 默认目标错过率（1%）
+#define FRAME_SCHED_DEFAULT_MISS_RATE 0.01f
+// 错过率指数平均系数
+#define FRAME_SCHED_MISS_RATE_ALPHA 0.05f
+
+// 全局帧调度器状态
+static struct frame_sched g_frame_sched = {0};
+
+// 内部函数声明
+static uint64_t frame_sched_predict_render_cost(void);
+static uint64_t frame_sched_next_vblank(uint64_t earliest_ns);
+static void frame_sched_update_multiplier(void);
+static uint64_t frame_sched_plan(uint64_t now, uint64_t* vblank_out);
+static void frame_sched_sleep_until(uint64_t deadline_ns);
+
+// 初始化帧调度器
+int frame_sched_init(uint32_t refresh_rate) {
+    if (g_frame_sched.initialized) {
+        LOGE("Frame scheduler already initialized");
+        return -1;
+    }
+    
+    if (refresh_rate == 0) {
+        LOGE("Invalid refresh rate: %u", refresh_rate);
+        return -1;
+    }
+    
+    memset(&g_frame_sched, 0, sizeof(g_frame_sched));
+    g_frame_sched.enabled = true;
+    g_frame_sched.refresh_period_ns = 1000000000ULL / refresh_rate;
+    g_frame_sched.refresh_rate = refresh_rate;
+    g_frame_sched.period_multiplier = 1;
+    g_frame_sched.vblank_anchor_ns = frame_sched_get_time_ns();
+    g_frame_sched.target_miss_rate = FRAME_SCHED_DEFAULT_MISS_RATE;
+    g_frame_sched.safety_margin_ns = g_frame_sched.refresh_period_ns / 16;
+    g_frame_sched.initialized = true;
+    
+    LOGI("Frame scheduler initialized: %u Hz", refresh_rate);
+    return 0;
+}
+
+// 销毁帧调度器
+void frame_sched_destroy(void) {
+    if (!g_frame_sched.initialized) {
+        return;
+    }
+    
+    LOGI("Frame scheduler destroyed: %llu frames, %llu missed",
+         (unsigned long long)g_frame_sched.frames, (unsigned long long)g_frame_sched.missed_frames);
+    memset(&g_frame_sched, 0, sizeof(g_frame_sched));
+}
+
+// 启用/禁用帧调度（禁用时立即开始每一帧）
+void frame_sched_set_enabled(bool enabled) {
+    g_frame_sched.enabled = enabled;
+}
+
+// 检查帧调度是否启用
+bool frame_sched_is_enabled(void) {
+    return g_frame_sched.initialized && g_frame_sched.enabled;
+}
+
+// 设置刷新率
+void frame_sched_set_refresh_rate(uint32_t refresh_rate) {
+    if (!g_frame_sched.initialized || refresh_rate == 0) {
+        return;
+    }
+    
+    g_frame_sched.refresh_period_ns = 1000000000ULL / refresh_rate;
+    g_frame_sched.refresh_rate = refresh_rate;
+    frame_sched_update_multiplier();
+    
+    // 余量不能超过新周期的一半
+    if (g_frame_sched.safety_margin_ns > g_frame_sched.refresh_period_ns / 2) {
+        g_frame_sched.safety_margin_ns = g_frame_sched.refresh_period_ns / 2;
+    }
+}
+
+// 设置目标帧率（按刷新周期的整数倍节拍，0表示跟随刷新率）
+void frame_sched_set_target_fps(uint32_t fps) {
+    if (!g_frame_sched.initialized || fps == g_frame_sched.target_fps) {
+        return;
+    }
+    
+    g_frame_sched.target_fps = fps;
+    frame_sched_update_multiplier();
+}
+
+// 设置目标错过率（0.001-0.5）
+void frame_sched_set_target_miss_rate(float miss_rate) {
+    if (miss_rate < 0.001f) miss_rate = 0.001f;
+    if (miss_rate > 0.5f) miss_rate = 0.5f;
+    
+    g_frame_sched.target_miss_rate = miss_rate;
+}
+
+// 通知实际的垂直同步时间（用于校准相位）
+void frame_sched_notify_vblank(uint64_t timestamp_ns) {
+    if (!g_frame_sched.initialized) {
+        return;
+    }
+    
+    g_frame_sched.vblank_anchor_ns = timestamp_ns;
+}
+
+// 睡眠到最晚安全开始时间，返回目标垂直同步时间
+uint64_t frame_sched_wait_for_start(void) {
+    uint64_t now = frame_sched_get_time_ns();
+    
+    if (!g_frame_sched.initialized) {
+        return now;
+    }
+    
+    g_frame_sched.last_sleep_ns = 0;
+    
+    if (!g_frame_sched.enabled) {
+        g_frame_sched.wake_time_ns = now;
+        g_frame_sched.target_vblank_ns = frame_sched_next_vblank(now);
+        return g_frame_sched.target_vblank_ns;
+    }
+    
+    // 尽量晚开始，使锁存的输入和客户端提交尽可能新
+    uint64_t vblank;
+    uint64_t start = frame_sched_plan(now, &vblank);
+    if (start > now) {
+        frame_sched_sleep_until(start);
+        g_frame_sched.last_sleep_ns = start - now;
+        now = frame_sched_get_time_ns();
+    }
+    
+    g_frame_sched.wake_time_ns = now;
+    g_frame_sched.target_vblank_ns = vblank;
+    return vblank;
+}
+
+// 获取下一帧的计划开始时间（不睡眠）
+uint64_t frame_sched_get_next_start(void) {
+    uint64_t now = frame_sched_get_time_ns();
+    
+    if (!g_frame_sched.initialized || !g_frame_sched.enabled) {
+        return now;
+    }
+    
+    uint64_t vblank;
+    return frame_sched_plan(now, &vblank);
+}
+
+// 当前帧完成，记录渲染耗时（微秒）
+void frame_sched_frame_done(uint64_t render_time_us) {
+    if (!g_frame_sched.initialized) {
+        return;
+    }
+    
+    uint64_t now = frame_sched_get_time_ns();
+    uint64_t render_ns = render_time_us * 1000;
+    
+    // 记录渲染耗时
+    g_frame_sched.render_history[g_frame_sched.history_head] = render_ns;
+    g_frame_sched.history_head = (g_frame_sched.history_head + 1) % FRAME_SCHED_HISTORY_SIZE;
+    if (g_frame_sched.history_count < FRAME_SCHED_HISTORY_SIZE) {
+        g_frame_sched.history_count++;
+    }
+    
+    // 除渲染以外的开销（输入、Wayland分发、窗口更新）按指数平均跟踪
+    uint64_t total = now - g_frame_sched.wake_time_ns;
+    uint64_t latch = total > render_ns ? total - render_ns : 0;
+    g_frame_sched.latch_cost_ns = (g_frame_sched.latch_cost_ns * 7 + latch) / 8;
+    
+    // 统计截止时间错过情况
+    bool missed = now > g_frame_sched.target_vblank_ns;
+    g_frame_sched.frames++;
+    if (missed) {
+        g_frame_sched.missed_frames++;
+    }
+    g_frame_sched.miss_rate = g_frame_sched.miss_rate * (1.0f - FRAME_SCHED_MISS_RATE_ALPHA) +
+                              (missed ? FRAME_SCHED_MISS_RATE_ALPHA : 0.0f);
+    
+    // 错过率高于目标时快速增加余量，否则缓慢收回以降低延迟
+    uint64_t period = g_frame_sched.refresh_period_ns;
+    if (missed && g_frame_sched.miss_rate > g_frame_sched.target_miss_rate) {
+        g_frame_sched.safety_margin_ns += period / 32;
+        if (g_frame_sched.safety_margin_ns > period / 2) {
+            g_frame_sched.safety_margin_ns = period / 2;
+        }
+        LOGD("Deadline missed, margin now %llu us", (unsigned long long)(g_frame_sched.safety_margin_ns / 1000));
+    } else if (!missed && g_frame_sched.miss_rate < g_frame_sched.target_miss_rate) {
+        g_frame_sched.safety_margin_ns -= g_frame_sched.safety_margin_ns / 64;
+        if (g_frame_sched.safety_margin_ns < period / 64) {
+            g_frame_sched.safety_margin_ns = period / 64;
+        }
+    }
+}
+
+// 获取帧调度统计
+void frame_sched_get_stats(struct frame_sched_stats* stats) {
+    if (!stats) {
+        return;
+    }
+    
+    memset(stats, 0, sizeof(*stats));
+    if (!g_frame_sched.initialized) {
+        return;
+    }
+    
+    stats->frames = g_frame_sched.frames;
+    stats->missed_frames = g_frame_sched.missed_frames;
+    stats->miss_rate = g_frame_sched.miss_rate;
+    stats->target_miss_rate = g_frame_sched.target_miss_rate;
+    stats->refresh_period_ns = g_frame_sched.refresh_period_ns;
+    stats->period_multiplier = g_frame_sched.period_multiplier;
+    stats->predicted_cost_ns = frame_sched_predict_render_cost() + g_frame_sched.latch_cost_ns;
+    stats->safety_margin_ns = g_frame_sched.safety_margin_ns;
+    stats->last_sleep_ns = g_frame_sched.last_sleep_ns;
+}
+
+// 获取当前时间（纳秒）
+uint64_t frame_sched_get_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// 内部函数：按目标错过率取渲染耗时的分位数
+static uint64_t frame_sched_predict_render_cost(void) {
+    uint32_t count = g_frame_sched.history_count;
+    
+    // 没有历史数据时保守地预留半个周期
+    if (count == 0) {
+        return g_frame_sched.refresh_period_ns / 2;
+    }
+    
+    // 样本数很少，插入排序即可
+    uint64_t sorted[FRAME_SCHED_HISTORY_SIZE];
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t value = g_frame_sched.render_history[i];
+        uint32_t j = i;
+        while (j > 0 && sorted[j - 1] > value) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = value;
+    }
+    
+    // 允许错过率为p时取(1-p)分位数
+    uint32_t index = (uint32_t)((1.0f - g_frame_sched.target_miss_rate) * (float)count);
+    if (index >= count) {
+        index = count - 1;
+    }
+    
+    return sorted[index];
+}
+
+// 内部函数：计算不早于指定时间的垂直同步时间
+static uint64_t frame_sched_next_vblank(uint64_t earliest_ns) {
+    uint64_t anchor = g_frame_sched.vblank_anchor_ns;
+    uint64_t period = g_frame_sched.refresh_period_ns;
+    
+    if (earliest_ns <= anchor) {
+        return anchor;
+    }
+    
+    uint64_t periods = (earliest_ns - anchor + period - 1) / period;
+    return anchor + periods * period;
+}
+
+// 内部函数：按目标帧率计算每帧占用的刷新周期数（取不超过目标帧率的最高整除帧率，避免帧间隔抖动）
+static void frame_sched_update_multiplier(void) {
+    uint32_t fps = g_frame_sched.target_fps;
+    uint32_t multiplier = 1;
+    
+    if (fps > 0 && fps < g_frame_sched.refresh_rate) {
+        multiplier = (g_frame_sched.refresh_rate + fps - 1) / fps;
+    }
+    
+    if (multiplier != g_frame_sched.period_multiplier) {
+        LOGI("Pacing every %u refresh periods (target %u FPS at %u Hz)", multiplier, fps, g_frame_sched.refresh_rate);
+        g_frame_sched.period_multiplier = multiplier;
+    }
+}
+
+// 内部函数：计算最晚安全开始时间和目标垂直同步时间
+static uint64_t frame_sched_plan(uint64_t now, uint64_t* vblank_out) {
+    // 一帧的预计开销 = 渲染耗时分位数 + 锁存开销 + 自适应余量
+    uint64_t cost = frame_sched_predict_render_cost() +
+                    g_frame_sched.latch_cost_ns +
+                    g_frame_sched.safety_margin_ns;
+    
+    // 找到第一个来得及的垂直同步，距上一帧至少相隔目标帧率对应的刷新周期数
+    uint64_t earliest = now + cost;
+    uint64_t paced = g_frame_sched.target_vblank_ns +
+                     g_frame_sched.refresh_period_ns * g_frame_sched.period_multiplier;
+    uint64_t vblank = frame_sched_next_vblank(earliest > paced ? earliest : paced);
+    
+    *vblank_out = vblank;
+    return vblank - cost;
+}
+
+// 内部函数：按绝对时间睡眠，被信号打断时继续睡眠
+static void frame_sched_sleep_until(uint64_t deadline_ns) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)(deadline_ns / 1000000000ULL);
+    ts.tv_nsec = (long)(deadline_ns % 1000000000ULL);
+    
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+        // 继续等待
+    }
+}
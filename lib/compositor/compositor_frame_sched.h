@@ -0,0 +1,93 @@
+#ifndef COMPOSITOR_FRAME_SCHED_H
+#define COMPOSITOR_FRAME_SCHED_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 渲染耗时历史样本数
+#define FRAME_SCHED_HISTORY_SIZE 64
+
+// 帧调度统计
+struct frame_sched_stats {
+    uint64_t frames;                // 已调度帧数
+    uint64_t missed_frames;         // 错过截止时间的帧数
+    float miss_rate;                // 近期错过率（指数平均）
+    float target_miss_rate;         // 目标错过率
+    uint64_t refresh_period_ns;     // 刷新周期
+    uint32_t period_multiplier;     // 每帧占用的刷新周期数
+    uint64_t predicted_cost_ns;     // 预测的一帧开销（锁存+渲染）
+    uint64_t safety_margin_ns;      // 安全余量
+    uint64_t last_sleep_ns;         // 上一帧开始前的睡眠时间
+};
+
+// 帧调度器状态
+struct frame_sched {
+    bool initialized;
+    bool enabled;
+    uint64_t refresh_period_ns;     // 刷新周期
+    uint32_t refresh_rate;          // 刷新率
+    uint32_t target_fps;            // 目标帧率（0表示跟随刷新率）
+    uint32_t period_multiplier;     // 每帧占用的刷新周期数（目标帧率低于刷新率时大于1）
+    uint64_t vblank_anchor_ns;      // 已知的垂直同步时间点
+    uint64_t target_vblank_ns;      // 当前帧的目标垂直同步时间
+    uint64_t wake_time_ns;          // 当前帧实际开始时间
+    float target_miss_rate;         // 目标错过率
+    float miss_rate;                // 近期错过率（指数平均）
+    uint64_t safety_margin_ns;      // 自适应安全余量
+    uint64_t latch_cost_ns;         // 锁存输入和客户端提交的平均开销
+    uint64_t render_history[FRAME_SCHED_HISTORY_SIZE]; // 渲染耗时历史（纳秒）
+    uint32_t history_count;
+    uint32_t history_head;
+    uint64_t frames;
+    uint64_t missed_frames;
+    uint64_t last_sleep_ns;
+};
+
+// 初始化帧调度器
+int frame_sched_init(uint32_t refresh_rate);
+
+// 销毁帧调度器
+void frame_sched_destroy(void);
+
+// 启用/禁用帧调度（禁用时立即开始每一帧）
+void frame_sched_set_enabled(bool enabled);
+
+// 检查帧调度是否启用
+bool frame_sched_is_enabled(void);
+
+// 设置刷新率
+void frame_sched_set_refresh_rate(uint32_t refresh_rate);
+
+// 设置目标帧率（按刷新周期的整数倍节拍，0表示跟随刷新率）
+void frame_sched_set_target_fps(uint32_t fps);
+
+// 设置目标错过率（0.001-0.5）
+void frame_sched_set_target_miss_rate(float miss_rate);
+
+// 通知实际的垂直同步时间（用于校准相位）
+void frame_sched_notify_vblank(uint64_t timestamp_ns);
+
+// 睡眠到最晚安全开始时间，返回目标垂直同步时间
+uint64_t frame_sched_wait_for_start(void);
+
+// 获取下一帧的计划开始时间（不睡眠）
+uint64_t frame_sched_get_next_start(void);
+
+// 当前帧完成，记录渲染耗时（微秒）
+void frame_sched_frame_done(uint64_t render_time_us);
+
+// 获取帧调度统计
+void frame_sched_get_stats(struct frame_sched_stats* stats);
+
+// 获取当前时间（纳秒）
+uint64_t frame_sched_get_time_ns(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COMPOSITOR_FRAME_SCHED_H
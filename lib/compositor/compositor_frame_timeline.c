@@ -0,0 +1,376 @@
+#include "compositor_frame_timeline.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <android/log.h>
+
+#define LOG_TAG "FrameTimeline"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+
+// 阶段平均耗时的指数平均权重（1/16）
+#define FRAME_TIMELINE_AVG_SHIFT 4
+
+// 默认阶段预算（千分比，合计1000）：获取和记录通常占大头
+static const uint16_t g_default_budget_permille[FRAME_STAGE_COUNT] = {
+    [FRAME_STAGE_INPUT] = 50,
+    [FRAME_STAGE_DISPATCH] = 100,
+    [FRAME_STAGE_WINDOW_UPDATE] = 50,
+    [FRAME_STAGE_RENDERER_UPDATE] = 50,
+    [FRAME_STAGE_PREPARE] = 50,
+    [FRAME_STAGE_ACQUIRE] = 200,
+    [FRAME_STAGE_RECORD] = 250,
+    [FRAME_STAGE_SUBMIT] = 100,
+    [FRAME_STAGE_PRESENT] = 150
+};
+
+// 阶段名称（最后一项为开始过晚）
+static const char* g_stage_names[FRAME_STAGE_COUNT + 1] = {
+    "input", "dispatch", "window", "renderer", "prepare",
+    "acquire", "record", "submit", "present", "late-start"
+};
+
+// 全局帧时间线状态
+static struct frame_timeline g_timeline = {0};
+
+// 内部函数声明
+static uint64_t stage_begin_ns(const struct frame_record* record, uint32_t stage);
+static void fill_skipped_stages(uint32_t until_stage);
+static uint32_t attribute_jank(const struct frame_record* record);
+
+// 初始化帧时间线
+int frame_timeline_init(void) {
+    if (g_timeline.initialized) {
+        LOGE("Frame timeline already initialized");
+        return -1;
+    }
+    
+    memset(&g_timeline, 0, sizeof(g_timeline));
+    memcpy(g_timeline.budget_permille, g_default_budget_permille, sizeof(g_timeline.budget_permille));
+    
+    if (pthread_mutex_init(&g_timeline.mutex, NULL) != 0) {
+        LOGE("Failed to create frame timeline mutex");
+        return -1;
+    }
+    
+    g_timeline.enabled = true;
+    g_timeline.initialized = true;
+    
+    LOGI("Frame timeline initialized: %d frames", FRAME_TIMELINE_SIZE);
+    return 0;
+}
+
+// 销毁帧时间线
+void frame_timeline_destroy(void) {
+    if (!g_timeline.initialized) {
+        return;
+    }
+    
+    LOGI("Frame timeline destroyed: %llu frames, %llu missed",
+         (unsigned long long)g_timeline.stats.frames, (unsigned long long)g_timeline.stats.missed);
+    pthread_mutex_destroy(&g_timeline.mutex);
+    memset(&g_timeline, 0, sizeof(g_timeline));
+}
+
+// 启用/禁用帧时间线
+void frame_timeline_set_enabled(bool enabled) {
+    g_timeline.enabled = enabled;
+    if (!enabled) {
+        g_timeline.in_frame = false;
+    }
+}
+
+// 设置阶段预算（占开始到截止时间窗口的千分比）
+void frame_timeline_set_stage_budget(frame_stage_t stage, uint32_t permille) {
+    if (stage < 0 || stage >= FRAME_STAGE_COUNT) {
+        return;
+    }
+    
+    g_timeline.budget_permille[stage] = (uint16_t)(permille > 1000 ? 1000 : permille);
+}
+
+// 开始一帧（deadline_ns为目标垂直同步时间，0表示没有截止时间）
+void frame_timeline_begin_frame(uint64_t deadline_ns) {
+    if (!g_timeline.initialized || !g_timeline.enabled) {
+        return;
+    }
+    
+    memset(&g_timeline.current, 0, sizeof(g_timeline.current));
+    g_timeline.current.frame = g_timeline.stats.frames;
+    g_timeline.current.start_ns = frame_timeline_get_time_ns();
+    g_timeline.current.deadline_ns = deadline_ns;
+    g_timeline.current.jank_stage = FRAME_STAGE_COUNT;
+    g_timeline.last_stage = FRAME_STAGE_COUNT;
+    g_timeline.in_frame = true;
+}
+
+// 标记阶段结束（当前时间）
+void frame_timeline_mark(frame_stage_t stage) {
+    if (!g_timeline.in_frame) {
+        return;
+    }
+    
+    frame_timeline_mark_at(stage, frame_timeline_get_time_ns());
+}
+
+// 以给定时间标记阶段结束（用于在其他模块中测得的边界）
+void frame_timeline_mark_at(frame_stage_t stage, uint64_t timestamp_ns) {
+    if (!g_timeline.in_frame || stage < 0 || stage >= FRAME_STAGE_COUNT) {
+        return;
+    }
+    
+    // 阶段只能按顺序前进，重复标记保留第一次
+    if (g_timeline.last_stage != FRAME_STAGE_COUNT && (uint32_t)stage <= g_timeline.last_stage) {
+        return;
+    }
+    
+    // 跳过的阶段耗时为0
+    fill_skipped_stages((uint32_t)stage);
+    
+    uint64_t begin = stage_begin_ns(&g_timeline.current, (uint32_t)stage);
+    g_timeline.current.stage_end_ns[stage] = timestamp_ns > begin ? timestamp_ns : begin;
+    g_timeline.last_stage = (uint32_t)stage;
+}
+
+// 设置本帧的重绘面积
+void frame_timeline_set_damage_area(uint32_t area) {
+    if (g_timeline.in_frame) {
+        g_timeline.current.damage_area = area;
+    }
+}
+
+// 设置本帧的绘制调用次数
+void frame_timeline_set_draw_calls(uint32_t draw_calls) {
+    if (g_timeline.in_frame) {
+        g_timeline.current.draw_calls = draw_calls;
+    }
+}
+
+// 结束一帧：判断是否错过截止时间并归因，写入环
+void frame_timeline_end_frame(bool presented) {
+    if (!g_timeline.in_frame) {
+        return;
+    }
+    
+    struct frame_record* record = &g_timeline.current;
+    g_timeline.in_frame = false;
+    
+    // 失败的帧停在中途，其余阶段耗时为0
+    fill_skipped_stages(FRAME_STAGE_COUNT);
+    record->presented = presented;
+    
+    uint64_t end_ns = record->stage_end_ns[FRAME_STAGE_COUNT - 1];
+    record->missed = record->deadline_ns != 0 && end_ns > record->deadline_ns;
+    if (record->missed) {
+        record->jank_stage = attribute_jank(record);
+    }
+    
+    pthread_mutex_lock(&g_timeline.mutex);
+    
+    g_timeline.records[g_timeline.head] = *record;
+    g_timeline.head = (g_timeline.head + 1) % FRAME_TIMELINE_SIZE;
+    if (g_timeline.count < FRAME_TIMELINE_SIZE) {
+        g_timeline.count++;
+    }
+    
+    struct frame_timeline_stats* stats = &g_timeline.stats;
+    stats->frames++;
+    for (uint32_t i = 0; i < FRAME_STAGE_COUNT; i++) {
+        uint64_t duration = record->stage_end_ns[i] - stage_begin_ns(record, i);
+        stats->stage_avg_ns[i] = stats->frames == 1 ? duration :
+            stats->stage_avg_ns[i] - (stats->stage_avg_ns[i] >> FRAME_TIMELINE_AVG_SHIFT) +
+            (duration >> FRAME_TIMELINE_AVG_SHIFT);
+        if (duration > stats->stage_max_ns[i]) {
+            stats->stage_max_ns[i] = duration;
+        }
+    }
+    if (record->missed) {
+        stats->missed++;
+        stats->jank_by_stage[record->jank_stage]++;
+    }
+    
+    pthread_mutex_unlock(&g_timeline.mutex);
+    
+    if (record->missed) {
+        uint32_t stage = record->jank_stage;
+        if (stage < FRAME_STAGE_COUNT) {
+            LOGD("Frame %llu missed deadline by %llu us: %s took %llu us",
+                 (unsigned long long)record->frame,
+                 (unsigned long long)((end_ns - record->deadline_ns) / 1000),
+                 g_stage_names[stage],
+                 (unsigned long long)((record->stage_end_ns[stage] - stage_begin_ns(record, stage)) / 1000));
+        } else {
+            LOGD("Frame %llu missed deadline by %llu us: started after deadline",
+                 (unsigned long long)record->frame,
+                 (unsigned long long)((end_ns - record->deadline_ns) / 1000));
+        }
+    }
+}
+
+// 获取最近的帧记录（最新的在前），返回复制的条数
+uint32_t frame_timeline_get_records(struct frame_record* records, uint32_t max_count) {
+    if (!records || max_count == 0 || !g_timeline.initialized) {
+        return 0;
+    }
+    
+    pthread_mutex_lock(&g_timeline.mutex);
+    
+    uint32_t count = g_timeline.count < max_count ? g_timeline.count : max_count;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t index = (g_timeline.head + FRAME_TIMELINE_SIZE - 1 - i) % FRAME_TIMELINE_SIZE;
+        records[i] = g_timeline.records[index];
+    }
+    
+    pthread_mutex_unlock(&g_timeline.mutex);
+    return count;
+}
+
+// 获取时间线统计
+void frame_timeline_get_stats(struct frame_timeline_stats* stats) {
+    if (!stats) {
+        return;
+    }
+    
+    if (!g_timeline.initialized) {
+        memset(stats, 0, sizeof(struct frame_timeline_stats));
+        return;
+    }
+    
+    pthread_mutex_lock(&g_timeline.mutex);
+    *stats = g_timeline.stats;
+    pthread_mutex_unlock(&g_timeline.mutex);
+}
+
+// 把环中的记录以文本表格写入文件
+int frame_timeline_dump(const char* path) {
+    if (!path) {
+        LOGE("Invalid path");
+        return -1;
+    }
+    
+    if (!g_timeline.initialized) {
+        LOGE("Frame timeline not initialized");
+        return -1;
+    }
+    
+    // 先复制出来，避免写文件时持有锁
+    struct frame_record* records = malloc(sizeof(struct frame_record) * FRAME_TIMELINE_SIZE);
+    if (!records) {
+        LOGE("Failed to allocate memory for frame records");
+        return -1;
+    }
+    
+    struct frame_timeline_stats stats;
+    frame_timeline_get_stats(&stats);
+    uint32_t count = frame_timeline_get_records(records, FRAME_TIMELINE_SIZE);
+    
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        LOGE("Failed to open file for writing: %s", path);
+        free(records);
+        return -1;
+    }
+    
+    fprintf(file, "Frame Timeline: %llu frames, %llu missed\n",
+            (unsigned long long)stats.frames, (unsigned long long)stats.missed);
+    for (uint32_t i = 0; i <= FRAME_STAGE_COUNT; i++) {
+        fprintf(file, "  %-10s", g_stage_names[i]);
+        if (i < FRAME_STAGE_COUNT) {
+            fprintf(file, " avg %6llu us  max %6llu us  budget %3u.%u%%",
+                    (unsigned long long)(stats.stage_avg_ns[i] / 1000),
+                    (unsigned long long)(stats.stage_max_ns[i] / 1000),
+                    g_timeline.budget_permille[i] / 10, g_timeline.budget_permille[i] % 10);
+        }
+        fprintf(file, "  janks %llu\n", (unsigned long long)stats.jank_by_stage[i]);
+    }
+    
+    // 每帧一行：各阶段耗时（微秒）、总耗时、截止时间余量
+    fprintf(file, "\n%8s", "frame");
+    for (uint32_t i = 0; i < FRAME_STAGE_COUNT; i++) {
+        fprintf(file, " %9s", g_stage_names[i]);
+    }
+    fprintf(file, " %9s %9s %9s %6s %s\n", "total", "slack", "damage", "draws", "jank");
+    
+    for (uint32_t i = count; i > 0; i--) {
+        const struct frame_record* record = &records[i - 1];
+        fprintf(file, "%8llu", (unsigned long long)record->frame);
+        for (uint32_t s = 0; s < FRAME_STAGE_COUNT; s++) {
+            fprintf(file, " %9llu", (unsigned long long)((record->stage_end_ns[s] - stage_begin_ns(record, s)) / 1000));
+        }
+        
+        uint64_t end_ns = record->stage_end_ns[FRAME_STAGE_COUNT - 1];
+        long long slack_us = record->deadline_ns != 0 ?
+            ((long long)record->deadline_ns - (long long)end_ns) / 1000 : 0;
+        fprintf(file, " %9llu %9lld %9u %6u %s%s\n",
+                (unsigned long long)((end_ns - record->start_ns) / 1000), slack_us,
+                record->damage_area, record->draw_calls,
+                record->missed ? g_stage_names[record->jank_stage] : "-",
+                record->presented ? "" : " (failed)");
+    }
+    
+    fclose(file);
+    free(records);
+    
+    LOGI("Frame timeline dumped to %s (%u frames)", path, count);
+    return 0;
+}
+
+// 获取阶段名称
+const char* frame_timeline_stage_name(uint32_t stage) {
+    if (stage > FRAME_STAGE_COUNT) {
+        return "unknown";
+    }
+    
+    return g_stage_names[stage];
+}
+
+// 获取当前时间（纳秒）
+uint64_t frame_timeline_get_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// 阶段开始时间：上一个阶段的结束时间，第一个阶段从帧开始算起
+static uint64_t stage_begin_ns(const struct frame_record* record, uint32_t stage) {
+    return stage == 0 ? record->start_ns : record->stage_end_ns[stage - 1];
+}
+
+// 把until_stage之前未标记的阶段结束时间设为上一个边界
+static void fill_skipped_stages(uint32_t until_stage) {
+    uint32_t first = g_timeline.last_stage == FRAME_STAGE_COUNT ? 0 : g_timeline.last_stage + 1;
+    for (uint32_t i = first; i < until_stage; i++) {
+        g_timeline.current.stage_end_ns[i] = stage_begin_ns(&g_timeline.current, i);
+    }
+}
+
+// 归因错过的帧：超出预算最多的阶段；预算按帧开始到截止时间的可用窗口分配
+static uint32_t attribute_jank(const struct frame_record* record) {
+    if (record->deadline_ns <= record->start_ns) {
+        return FRAME_STAGE_LATE_START;
+    }
+    
+    uint64_t window = record->deadline_ns - record->start_ns;
+    uint32_t worst = FRAME_STAGE_COUNT;
+    uint64_t worst_overrun = 0;
+    uint32_t longest = 0;
+    uint64_t longest_duration = 0;
+    
+    for (uint32_t i = 0; i < FRAME_STAGE_COUNT; i++) {
+        uint64_t duration = record->stage_end_ns[i] - stage_begin_ns(record, i);
+        uint64_t budget = window * g_timeline.budget_permille[i] / 1000;
+        if (duration > budget && duration - budget > worst_overrun) {
+            worst_overrun = duration - budget;
+            worst = i;
+        }
+        if (duration > longest_duration) {
+            longest_duration = duration;
+            longest = i;
+        }
+    }
+    
+    // 预算合计超过窗口时可能没有阶段超出，此时归因于最长的阶段
+    return worst != FRAME_STAGE_COUNT ? worst : longest;
+}
@@ -0,0 +1,118 @@
+#ifndef COMPOSITOR_FRAME_TIMELINE_H
+#define COMPOSITOR_FRAME_TIMELINE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 保留的帧记录数
+#define FRAME_TIMELINE_SIZE 256
+
+// 帧阶段（按执行顺序，每个阶段在下一个边界结束）
+typedef enum {
+    FRAME_STAGE_INPUT = 0,         // 输入批处理分发
+    FRAME_STAGE_DISPATCH,          // Wayland事件分发和刷新客户端
+    FRAME_STAGE_WINDOW_UPDATE,     // window_manager_update
+    FRAME_STAGE_RENDERER_UPDATE,   // renderer_update
+    FRAME_STAGE_PREPARE,           // 各优化模块更新和渲染参数设置
+    FRAME_STAGE_ACQUIRE,           // vulkan_begin_frame：等待帧槽栅栏和获取交换链图像
+    FRAME_STAGE_RECORD,            // 记录命令缓冲区
+    FRAME_STAGE_SUBMIT,            // vkQueueSubmit
+    FRAME_STAGE_PRESENT,           // vkQueuePresentKHR
+    FRAME_STAGE_COUNT
+} frame_stage_t;
+
+// 错过截止时间但没有阶段超出预算（开始时已经没有剩余时间）
+#define FRAME_STAGE_LATE_START FRAME_STAGE_COUNT
+
+// 一帧的时间线记录（时间均为CLOCK_MONOTONIC纳秒）
+struct frame_record {
+    uint64_t frame;                         // 帧序号
+    uint64_t start_ns;                      // 帧开始（调度器唤醒后）
+    uint64_t stage_end_ns[FRAME_STAGE_COUNT]; // 各阶段结束时间（未经过的阶段等于上一个边界）
+    uint64_t deadline_ns;                   // 目标垂直同步时间（0表示没有截止时间）
+    uint32_t damage_area;                   // 重绘区域面积（像素）
+    uint32_t draw_calls;                    // 绘制调用次数
+    bool presented;                         // 是否成功呈现
+    bool missed;                            // 是否错过截止时间
+    uint32_t jank_stage;                    // 错过时归因的阶段（FRAME_STAGE_LATE_START表示开始过晚）
+};
+
+// 时间线统计
+struct frame_timeline_stats {
+    uint64_t frames;                        // 记录的帧数
+    uint64_t missed;                        // 错过截止时间的帧数
+    uint64_t jank_by_stage[FRAME_STAGE_COUNT + 1]; // 按归因阶段统计的错过帧数（最后一项为开始过晚）
+    uint64_t stage_avg_ns[FRAME_STAGE_COUNT]; // 各阶段的平均耗时（指数平均）
+    uint64_t stage_max_ns[FRAME_STAGE_COUNT]; // 各阶段的最大耗时
+};
+
+// 帧时间线状态（渲染线程写入，查询可在任意线程进行）
+struct frame_timeline {
+    bool initialized;
+    bool enabled;
+    struct frame_record current;            // 正在记录的帧
+    bool in_frame;
+    uint32_t last_stage;                    // 当前帧已到达的最后一个边界（FRAME_STAGE_COUNT表示尚未到达）
+    uint16_t budget_permille[FRAME_STAGE_COUNT]; // 各阶段占开始到截止时间窗口的份额（千分比）
+    struct frame_record records[FRAME_TIMELINE_SIZE];
+    uint32_t head;                          // 下一条记录的位置
+    uint32_t count;
+    struct frame_timeline_stats stats;
+    pthread_mutex_t mutex;                  // 保护records和stats
+};
+
+// 初始化帧时间线
+int frame_timeline_init(void);
+
+// 销毁帧时间线
+void frame_timeline_destroy(void);
+
+// 启用/禁用帧时间线
+void frame_timeline_set_enabled(bool enabled);
+
+// 设置阶段预算（占开始到截止时间窗口的千分比）
+void frame_timeline_set_stage_budget(frame_stage_t stage, uint32_t permille);
+
+// 开始一帧（deadline_ns为目标垂直同步时间，0表示没有截止时间）
+void frame_timeline_begin_frame(uint64_t deadline_ns);
+
+// 标记阶段结束（当前时间）
+void frame_timeline_mark(frame_stage_t stage);
+
+// 以给定时间标记阶段结束（用于在其他模块中测得的边界）
+void frame_timeline_mark_at(frame_stage_t stage, uint64_t timestamp_ns);
+
+// 设置本帧的重绘面积
+void frame_timeline_set_damage_area(uint32_t area);
+
+// 设置本帧的绘制调用次数
+void frame_timeline_set_draw_calls(uint32_t draw_calls);
+
+// 结束一帧：判断是否错过截止时间并归因，写入环
+void frame_timeline_end_frame(bool presented);
+
+// 获取最近的帧记录（最新的在前），返回复制的条数
+uint32_t frame_timeline_get_records(struct frame_record* records, uint32_t max_count);
+
+// 获取时间线统计
+void frame_timeline_get_stats(struct frame_timeline_stats* stats);
+
+// 把环中的记录以文本表格写入文件
+int frame_timeline_dump(const char* path);
+
+// 获取阶段名称
+const char* frame_timeline_stage_name(uint32_t stage);
+
+// 获取当前时间（纳秒）
+uint64_t frame_timeline_get_time_ns(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COMPOSITOR_FRAME_TIMELINE_H
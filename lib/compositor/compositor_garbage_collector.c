@@ -1,4 +1,6 @@
 #include "compositor_garbage_collector.h"
+#include "compositor_trace.h"
+#include "compositor_monitor.h"
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -356,6 +358,9 @@ int gc_collect(void) {
     
     pthread_mutex_unlock(&g_gc.mutex);
     
+    // 回收可能在回收线程中进行，监控模块会暂存后合并
+    monitor_add_data_point(MONITOR_DATA_TYPE_GC_PAUSE_TIME, (float)duration);
+    
     LOGI("垃圾回收完成，耗时: %llu ms", (unsigned long long)duration);
     
     return result;
@@ -826,6 +831,7 @@ void* gc_concurrent_thread_func(void* arg) {
     (void)arg; // 避免未使用参数警告
     
     LOGI("并发垃圾回收线程已启动");
+    trace_set_thread_name("gc");
     
     while (g_gc.concurrent_gc.running) {
         pthread_mutex_lock(&g_gc.mutex);
@@ -841,6 +847,7 @@ void* gc_concurrent_thread_func(void* arg) {
         }
         
         // 处理标记队列中的对象
+        TRACE_BEGIN("gc_mark");
         while (g_gc.concurrent_gc.mark_queue_size > 0) {
             // 从标记队列取出对象
             void* obj = g_gc.concurrent_gc.mark_queue[--g_gc.concurrent_gc.mark_queue_size];
@@ -869,6 +876,7 @@ void* gc_concurrent_thread_func(void* arg) {
             }
         }
         
+        TRACE_END("gc_mark");
         pthread_mutex_unlock(&g_gc.mutex);
         
         // 短暂休眠，避免占用过多CPU
@@ -0,0 +1,178 @@
+#include "compositor_histogram.h"
+#include <string.h>
+
+// 内部函数声明
+static uint32_t bucket_index(uint64_t value);
+static uint64_t bucket_upper_bound(uint32_t index);
+
+// 初始化直方图
+void perf_histogram_init(struct perf_histogram* histogram) {
+    if (!histogram) {
+        return;
+    }
+    
+    for (uint32_t i = 0; i < PERF_HISTOGRAM_BUCKETS; i++) {
+        atomic_init(&histogram->counts[i], 0);
+    }
+    atomic_init(&histogram->sum, 0);
+    atomic_init(&histogram->min, UINT64_MAX);
+    atomic_init(&histogram->max, 0);
+}
+
+// 记录一个值
+void perf_histogram_record(struct perf_histogram* histogram, uint64_t value) {
+    if (!histogram) {
+        return;
+    }
+    
+    atomic_fetch_add_explicit(&histogram->counts[bucket_index(value)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->sum, value, memory_order_relaxed);
+    
+    // 极值很少改变，通常一次读取即可返回
+    uint64_t current = atomic_load_explicit(&histogram->min, memory_order_relaxed);
+    while (value < current &&
+           !atomic_compare_exchange_weak_explicit(&histogram->min, &current, value,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+    
+    current = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+    while (value > current &&
+           !atomic_compare_exchange_weak_explicit(&histogram->max, &current, value,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+// 无锁复制直方图，reset为true时同时清空（并发记录的值落在本窗口或下一个窗口，不会丢失）
+void perf_histogram_snapshot(struct perf_histogram* histogram, struct perf_histogram_snapshot* snapshot, bool reset) {
+    if (!histogram || !snapshot) {
+        return;
+    }
+    
+    snapshot->count = 0;
+    for (uint32_t i = 0; i < PERF_HISTOGRAM_BUCKETS; i++) {
+        uint32_t count = reset ? atomic_exchange_explicit(&histogram->counts[i], 0, memory_order_relaxed)
+                               : atomic_load_explicit(&histogram->counts[i], memory_order_relaxed);
+        snapshot->counts[i] = count;
+        snapshot->count += count;
+    }
+    
+    if (reset) {
+        snapshot->sum = atomic_exchange_explicit(&histogram->sum, 0, memory_order_relaxed);
+        snapshot->min = atomic_exchange_explicit(&histogram->min, UINT64_MAX, memory_order_relaxed);
+        snapshot->max = atomic_exchange_explicit(&histogram->max, 0, memory_order_relaxed);
+    } else {
+        snapshot->sum = atomic_load_explicit(&histogram->sum, memory_order_relaxed);
+        snapshot->min = atomic_load_explicit(&histogram->min, memory_order_relaxed);
+        snapshot->max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+    }
+}
+
+// 把快照src累加到dst
+void perf_histogram_merge(struct perf_histogram_snapshot* dst, const struct perf_histogram_snapshot* src) {
+    if (!dst || !src || src->count == 0) {
+        return;
+    }
+    
+    for (uint32_t i = 0; i < PERF_HISTOGRAM_BUCKETS; i++) {
+        dst->counts[i] += src->counts[i];
+    }
+    
+    if (dst->count == 0 || src->min < dst->min) {
+        dst->min = src->min;
+    }
+    if (dst->count == 0 || src->max > dst->max) {
+        dst->max = src->max;
+    }
+    dst->count += src->count;
+    dst->sum += src->sum;
+}
+
+// 查询分位数（percentile取0-100），返回所在桶的上界并限定在[min, max]内
+uint64_t perf_histogram_value_at(const struct perf_histogram_snapshot* snapshot, double percentile) {
+    if (!snapshot || snapshot->count == 0) {
+        return 0;
+    }
+    
+    if (percentile < 0.0) {
+        percentile = 0.0;
+    } else if (percentile > 100.0) {
+        percentile = 100.0;
+    }
+    
+    // 第rank个值所在的桶（rank从1开始）
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (double)snapshot->count + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    
+    uint64_t seen = 0;
+    uint64_t value = snapshot->max;
+    for (uint32_t i = 0; i < PERF_HISTOGRAM_BUCKETS; i++) {
+        seen += snapshot->counts[i];
+        if (seen >= rank) {
+            value = bucket_upper_bound(i);
+            break;
+        }
+    }
+    
+    // 并发快照中极值与桶计数可能不完全一致，只在极值有效时限定
+    if (snapshot->max >= snapshot->min) {
+        if (value > snapshot->max) {
+            value = snapshot->max;
+        }
+        if (value < snapshot->min) {
+            value = snapshot->min;
+        }
+    }
+    
+    return value;
+}
+
+// 计算p50/p95/p99/p99.9等摘要
+void perf_histogram_get_percentiles(const struct perf_histogram_snapshot* snapshot,
+                                    struct perf_percentiles* percentiles) {
+    if (!percentiles) {
+        return;
+    }
+    
+    memset(percentiles, 0, sizeof(struct perf_percentiles));
+    if (!snapshot || snapshot->count == 0) {
+        return;
+    }
+    
+    percentiles->count = snapshot->count;
+    percentiles->min = (float)(snapshot->min <= snapshot->max ? snapshot->min : 0);
+    percentiles->max = (float)snapshot->max;
+    percentiles->mean = (float)((double)snapshot->sum / (double)snapshot->count);
+    percentiles->p50 = (float)perf_histogram_value_at(snapshot, 50.0);
+    percentiles->p95 = (float)perf_histogram_value_at(snapshot, 95.0);
+    percentiles->p99 = (float)perf_histogram_value_at(snapshot, 99.0);
+    percentiles->p999 = (float)perf_histogram_value_at(snapshot, 99.9);
+}
+
+// 值所在的桶：小于子桶数的值逐个计数，之后每个2的幂按最高的几位细分
+static uint32_t bucket_index(uint64_t value) {
+    if (value > PERF_HISTOGRAM_MAX_VALUE) {
+        value = PERF_HISTOGRAM_MAX_VALUE;
+    }
+    
+    if (value < PERF_HISTOGRAM_SUB_BUCKETS) {
+        return (uint32_t)value;
+    }
+    
+    uint32_t msb = 63 - (uint32_t)__builtin_clzll(value);
+    uint32_t shift = msb - PERF_HISTOGRAM_SUB_BUCKET_BITS;
+    return (shift + 1) * PERF_HISTOGRAM_SUB_BUCKETS + (uint32_t)((value >> shift) - PERF_HISTOGRAM_SUB_BUCKETS);
+}
+
+// 桶中可能出现的最大值
+static uint64_t bucket_upper_bound(uint32_t index) {
+    uint32_t group = index / PERF_HISTOGRAM_SUB_BUCKETS;
+    if (group == 0) {
+        return index;
+    }
+    
+    uint32_t shift = group - 1;
+    uint64_t low = (uint64_t)(PERF_HISTOGRAM_SUB_BUCKETS + index % PERF_HISTOGRAM_SUB_BUCKETS) << shift;
+    return low + (1ULL << shift) - 1;
+}
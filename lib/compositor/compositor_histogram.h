@@ -0,0 +1,74 @@
+#ifndef COMPOSITOR_HISTOGRAM_H
+#define COMPOSITOR_HISTOGRAM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 每个2的幂区间细分的子桶位数（相对误差不超过1/32）
+#define PERF_HISTOGRAM_SUB_BUCKET_BITS 5
+#define PERF_HISTOGRAM_SUB_BUCKETS (1u << PERF_HISTOGRAM_SUB_BUCKET_BITS)
+// 可区分的最大值位数，更大的值计入最后一个桶（微秒约19小时，字节64GB）
+#define PERF_HISTOGRAM_MAX_BITS 36
+#define PERF_HISTOGRAM_MAX_VALUE ((1ULL << PERF_HISTOGRAM_MAX_BITS) - 1)
+// 桶数：线性段一组子桶，之后每个2的幂一组
+#define PERF_HISTOGRAM_BUCKETS \
+    ((PERF_HISTOGRAM_MAX_BITS - PERF_HISTOGRAM_SUB_BUCKET_BITS + 1) * PERF_HISTOGRAM_SUB_BUCKETS)
+
+// 对数-线性直方图（记录O(1)、无分配、无锁，可被其他线程快照）
+struct perf_histogram {
+    atomic_uint counts[PERF_HISTOGRAM_BUCKETS];
+    atomic_uint_fast64_t sum;
+    atomic_uint_fast64_t min;
+    atomic_uint_fast64_t max;
+};
+
+// 直方图快照（普通内存，用于查询分位数）
+struct perf_histogram_snapshot {
+    uint32_t counts[PERF_HISTOGRAM_BUCKETS];
+    uint64_t count;                     // 各桶计数之和
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+};
+
+// 分位数摘要（单位与记录的值相同）
+struct perf_percentiles {
+    uint64_t count;
+    float min;
+    float max;
+    float mean;
+    float p50;
+    float p95;
+    float p99;
+    float p999;
+};
+
+// 初始化直方图
+void perf_histogram_init(struct perf_histogram* histogram);
+
+// 记录一个值
+void perf_histogram_record(struct perf_histogram* histogram, uint64_t value);
+
+// 无锁复制直方图，reset为true时同时清空（并发记录的值落在本窗口或下一个窗口，不会丢失）
+void perf_histogram_snapshot(struct perf_histogram* histogram, struct perf_histogram_snapshot* snapshot, bool reset);
+
+// 把快照src累加到dst
+void perf_histogram_merge(struct perf_histogram_snapshot* dst, const struct perf_histogram_snapshot* src);
+
+// 查询分位数（percentile取0-100），返回所在桶的上界并限定在[min, max]内
+uint64_t perf_histogram_value_at(const struct perf_histogram_snapshot* snapshot, double percentile);
+
+// 计算p50/p95/p99/p99.9等摘要
+void perf_histogram_get_percentiles(const struct perf_histogram_snapshot* snapshot,
+                                    struct perf_percentiles* percentiles);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COMPOSITOR_HISTOGRAM_H
@@ -4,6 +4,9 @@
 #include <string.h>
 #include <time.h>
 #include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 
 #define LOG_TAG "CompositorInput"
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
@@ -87,6 +90,10 @@ struct input_system {
     // 线程安全
     pthread_mutex_t mutex;
     
+    // 唤醒合成器主循环（有新输入时可读）
+    int wakeup_fd;
+    atomic_bool activity;                  // 事件在锁外分发，使用原子变量
+    
     // 事件批处理
     struct input_event_batch_item event_batch[MAX_BATCHED_EVENTS];
     int batch_count;
@@ -148,6 +155,14 @@ int compositor_input_init(void) {
         return -1;
     }
     
+    // 创建唤醒事件描述符，供主循环在空闲时阻塞等待
+    g_input.wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (g_input.wakeup_fd < 0) {
+        LOGE("Failed to create input wakeup fd");
+        pthread_mutex_destroy(&g_input.mutex);
+        return -1;
+    }
+    
     // 初始化事件批处理
     g_input.batch_count = 0;
     g_input.last_batch_time = input_get_time();
@@ -183,6 +198,10 @@ void compositor_input_destroy(void) {
         return;
     }
     
+    if (g_input.wakeup_fd >= 0) {
+        close(g_input.wakeup_fd);
+    }
+    
     pthread_mutex_destroy(&g_input.mutex);
     memset(&g_input, 0, sizeof(g_input));
     
@@ -221,6 +240,47 @@ void compositor_input_step(void) {
     pthread_mutex_unlock(&g_input.mutex);
 }
 
+// 获取输入唤醒描述符
+int compositor_input_get_wakeup_fd(void) {
+    if (!g_input.initialized) {
+        return -1;
+    }
+    
+    return g_input.wakeup_fd;
+}
+
+// 检查批处理队列中是否还有未分发的事件
+bool compositor_input_has_pending_events(void) {
+    if (!g_input.initialized) {
+        return false;
+    }
+    
+    pthread_mutex_lock(&g_input.mutex);
+    bool pending = g_input.batch_count > 0;
+    pthread_mutex_unlock(&g_input.mutex);
+    
+    return pending;
+}
+
+// 取出并清除自上次调用以来是否有新输入
+bool compositor_input_consume_activity(void) {
+    if (!g_input.initialized) {
+        return false;
+    }
+    
+    pthread_mutex_lock(&g_input.mutex);
+    
+    uint64_t value;
+    while (read(g_input.wakeup_fd, &value, sizeof(value)) > 0) {
+        // 清空计数
+    }
+    
+    bool activity = atomic_exchange_explicit(&g_input.activity, false, memory_order_acq_rel);
+    
+    pthread_mutex_unlock(&g_input.mutex);
+    return activity;
+}
+
 // 注册输入事件处理器
 int compositor_input_register_event_handler(input_event_handler_t handler, void* user_data) {
     if (!g_input.initialized || !handler) {
@@ -821,6 +881,13 @@ static void dispatch_event(const input_event_t* event) {
     // 添加事件到批处理队列
     input_add_event_to_batch((struct input_event*)event);
     
+    // 唤醒可能在空闲等待中的主循环
+    atomic_store_explicit(&g_input.activity, true, memory_order_release);
+    uint64_t one = 1;
+    if (write(g_input.wakeup_fd, &one, sizeof(one)) < 0) {
+        // 计数器已满时主循环必然会被唤醒，忽略错误
+    }
+    
     // 检查是否需要立即刷新批处理
     uint64_t current_time = input_get_time();
     input_event_priority_t priority = get_event_priority(event);
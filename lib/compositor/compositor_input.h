@@ -156,6 +156,15 @@ void compositor_input_destroy(void);
 // 输入系统主循环处理
 void compositor_input_step(void);
 
+// 获取输入唤醒描述符（有新输入时可读，用于主循环空闲等待）
+int compositor_input_get_wakeup_fd(void);
+
+// 检查批处理队列中是否还有未分发的事件
+bool compositor_input_has_pending_events(void);
+
+// 取出并清除自上次调用以来是否有新输入
+bool compositor_input_consume_activity(void);
+
 // 注册输入事件处理器
 int compositor_input_register_event_handler(input_event_handler_t handler, void* user_data);
 
@@ -1,4 +1,5 @@
 #include "compositor_monitor.h"
+#include "compositor_monitor_log.h"
 #include "compositor.h"
 #include "compositor_perf.h"
 #include "compositor_render.h"
@@ -8,6 +9,8 @@
 #include <string.h>
 #include <math.h>
 #include <stdio.h>
+#include <stdatomic.h>
+#include <pthread.h>
 
 #define LOG_TAG "Monitor"
 #define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
@@ -17,29 +20,113 @@
 // 默认缓冲区大小
 #define DEFAULT_BUFFER_SIZE 1024
 
+// 默认聚合层：1秒桶保留10分钟，1分钟桶保留24小时
+static const struct rollup_tier_config g_default_rollup_tiers[] = {
+    {1000, 600},
+    {60000, 1440}
+};
+
+// 每个生产者线程的暂存缓冲区大小（2的幂）
+#define STAGING_BUFFER_SIZE 1024
+#define STAGING_BUFFER_MASK (STAGING_BUFFER_SIZE - 1)
+// 可注册的生产者线程数上限
+#define STAGING_MAX_THREADS 16
+
+// P²估计器的标记数
+#define P2_MARKERS 5
+
+// P²分位数估计器（Jain & Chlamtac，五个标记跟踪一个分位数，不保存样本）
+struct p2_estimator {
+    double quantile;               // 目标分位数
+    double heights[P2_MARKERS];    // 标记高度
+    double positions[P2_MARKERS];  // 标记实际位置
+    double desired[P2_MARKERS];    // 标记期望位置
+    double increments[P2_MARKERS]; // 每个样本期望位置的增量
+    uint32_t count;                // 样本数量
+};
+
+// 每个数据序列的在线统计（Welford均值/方差和P²分位数）
+struct monitor_online_stats {
+    uint32_t count;
+    double mean;
+    double m2;                     // 与均值之差的平方和
+    float min_value;
+    float max_value;
+    uint64_t first_timestamp;
+    uint64_t last_timestamp;
+    struct p2_estimator median;
+    struct p2_estimator p95;
+    struct p2_estimator p99;
+};
+
 // 监控状态
 static struct {
     bool initialized;
     struct monitor_settings settings;
     struct monitor_data_buffer data_buffers[MONITOR_DATA_TYPE_COUNT];
+    struct monitor_online_stats online_stats[MONITOR_DATA_TYPE_COUNT];
+    struct rollup_series rollups[MONITOR_DATA_TYPE_COUNT];
+    atomic_uint stats_seq[MONITOR_DATA_TYPE_COUNT]; // 在线统计的序列锁（奇数表示正在更新）
+    pthread_t owner_thread;                         // 监控线程（直接写入，其他线程暂存）
     uint64_t last_sample_time;
     uint64_t last_report_time;
     monitor_callback_t callback;
     void* callback_user_data;
 } g_monitor_state = {0};
 
+// 生产者线程的暂存缓冲区（单生产者单消费者，由监控线程在monitor_update中取出）
+struct staging_buffer {
+    struct monitor_data_point points[STAGING_BUFFER_SIZE];
+    atomic_uint head;              // 生产者写入位置
+    atomic_uint tail;              // 监控线程读取位置
+};
+
+// 暂存缓冲区注册表（无锁注册，缓冲区在进程生命周期内保留，不随monitor_init清零）
+static struct {
+    _Atomic(struct staging_buffer*) buffers[STAGING_MAX_THREADS];
+    atomic_uint thread_count;      // 已分配的槽位数（可能超过上限）
+    atomic_uint_fast64_t dropped;  // 缓冲区满或无法注册时丢弃的数据点
+} g_staging;
+
+// 当前线程的暂存缓冲区
+static __thread struct staging_buffer* t_staging = NULL;
+static __thread bool t_staging_rejected = false;
+
+// JSON聚合桶写入状态
+struct json_bucket_writer {
+    FILE* file;
+    const char* indent;
+    bool first;
+};
+
 // 内部函数声明
 static void sample_data(void);
 static void generate_reports(void);
-static void auto_save_reports(void);
+static void update_binary_log(void);
 static void init_data_buffer(struct monitor_data_buffer* buffer, uint32_t capacity);
 static void free_data_buffer(struct monitor_data_buffer* buffer);
 static void add_data_point_to_buffer(struct monitor_data_buffer* buffer, const struct monitor_data_point* point);
-static void calculate_statistics(const struct monitor_data_buffer* buffer, struct monitor_statistics* stats);
-static int compare_float(const void* a, const void* b);
-static char* generate_summary_text(const struct monitor_statistics* stats, monitor_data_type_t type);
-static char* generate_detailed_text(const struct monitor_statistics* stats, monitor_data_type_t type);
+static void apply_data_point(const struct monitor_data_point* point);
+static void stage_data_point(const struct monitor_data_point* point);
+static struct staging_buffer* get_staging_buffer(void);
+static void drain_staging_buffers(void);
+static void snapshot_statistics(monitor_data_type_t type, struct monitor_statistics* stats);
+static void reset_online_stats(struct monitor_online_stats* online);
+static void update_online_stats(struct monitor_online_stats* online, const struct monitor_data_point* point);
+static void calculate_statistics(const struct monitor_online_stats* online, struct monitor_statistics* stats);
+static void p2_init(struct p2_estimator* estimator, double quantile);
+static void p2_add(struct p2_estimator* estimator, double value);
+static double p2_get(const struct p2_estimator* estimator);
+static bool get_tail_percentiles(monitor_data_type_t type, struct perf_percentiles* percentiles);
+static char* generate_summary_text(const struct monitor_statistics* stats, const struct perf_percentiles* percentiles,
+                                   monitor_data_type_t type);
+static char* generate_detailed_text(const struct monitor_statistics* stats, const struct perf_percentiles* percentiles,
+                                    monitor_data_type_t type);
 static char* generate_chart_data(const struct monitor_data_buffer* buffer);
+static uint64_t get_raw_start_time(const struct monitor_data_buffer* buffer);
+static void write_csv_bucket(const struct rollup_bucket* bucket, uint64_t duration_ns, void* user_data);
+static void write_json_bucket(const struct rollup_bucket* bucket, uint64_t duration_ns, void* user_data);
+static void write_json_series(FILE* file, monitor_data_type_t type, const char* indent);
 static uint64_t get_current_time(void);
 static const char* get_data_type_name(monitor_data_type_t type);
 static const char* get_data_type_unit(monitor_data_type_t type);
@@ -67,8 +154,16 @@ int monitor_init(void) {
     // 初始化数据缓冲区
     for (int i = 0; i < MONITOR_DATA_TYPE_COUNT; i++) {
         init_data_buffer(&g_monitor_state.data_buffers[i], g_monitor_state.settings.buffer_size);
+        reset_online_stats(&g_monitor_state.online_stats[i]);
+        
+        // 聚合层分配失败时只导出原始数据
+        if (rollup_series_init(&g_monitor_state.rollups[i], g_default_rollup_tiers,
+                               sizeof(g_default_rollup_tiers) / sizeof(g_default_rollup_tiers[0])) != 0) {
+            LOGE("Failed to initialize rollups for type %d", i);
+        }
     }
     
+    g_monitor_state.owner_thread = pthread_self();
     g_monitor_state.last_sample_time = get_current_time();
     g_monitor_state.last_report_time = get_current_time();
     
@@ -84,9 +179,13 @@ void monitor_destroy(void) {
         return;
     }
     
+    // 停止二进制日志
+    monitor_log_stop();
+    
     // 释放数据缓冲区
     for (int i = 0; i < MONITOR_DATA_TYPE_COUNT; i++) {
         free_data_buffer(&g_monitor_state.data_buffers[i]);
+        rollup_series_destroy(&g_monitor_state.rollups[i]);
     }
     
     // 释放保存路径
@@ -104,12 +203,22 @@ void monitor_destroy(void) {
 
 // 更新监控模块（每帧调用）
 void monitor_update(void) {
-    if (!g_monitor_state.initialized || !g_monitor_state.settings.enabled) {
+    if (!g_monitor_state.initialized) {
+        return;
+    }
+    
+    // 合并其他线程暂存的数据点（禁用时也取出，避免缓冲区写满）
+    drain_staging_buffers();
+    
+    if (!g_monitor_state.settings.enabled) {
         return;
     }
     
     uint64_t current_time = get_current_time();
     
+    // 自动保存写入二进制日志，由后台线程落盘
+    update_binary_log();
+    
     // 检查是否需要采样数据
     if (current_time - g_monitor_state.last_sample_time >= 
         g_monitor_state.settings.sample_interval_ms * 1000000ULL) {
@@ -282,12 +391,21 @@ void monitor_add_data_point(monitor_data_type_t type, float value) {
         return;
     }
     
+    if (!g_monitor_state.initialized) {
+        return;
+    }
+    
     struct monitor_data_point point;
     point.timestamp = get_current_time();
     point.type = type;
     point.value = value;
     
-    add_data_point_to_buffer(&g_monitor_state.data_buffers[type], &point);
+    // 监控线程直接写入，其他线程写入各自的暂存缓冲区
+    if (pthread_equal(pthread_self(), g_monitor_state.owner_thread)) {
+        apply_data_point(&point);
+    } else {
+        stage_data_point(&point);
+    }
 }
 
 // 获取监控数据缓冲区
@@ -317,7 +435,7 @@ void monitor_get_statistics(monitor_data_type_t type, struct monitor_statistics*
         return;
     }
     
-    calculate_statistics(&g_monitor_state.data_buffers[type], stats);
+    snapshot_statistics(type, stats);
 }
 
 // 生成监控报告
@@ -337,14 +455,18 @@ struct monitor_report* monitor_generate_report(monitor_data_type_t type) {
     report->type = type;
     
     // 计算统计信息
-    calculate_statistics(&g_monitor_state.data_buffers[type], &report->stats);
+    snapshot_statistics(type, &report->stats);
+    
+    // 采样点只是窗口平均值，尾延迟取自性能监控器的逐帧直方图
+    report->has_percentiles = get_tail_percentiles(type, &report->percentiles);
+    const struct perf_percentiles* percentiles = report->has_percentiles ? &report->percentiles : NULL;
     
     // 生成摘要文本
-    report->summary_text = generate_summary_text(&report->stats, type);
+    report->summary_text = generate_summary_text(&report->stats, percentiles, type);
     
     // 生成详细文本
     if (g_monitor_state.settings.include_detailed_stats) {
-        report->detailed_text = generate_detailed_text(&report->stats, type);
+        report->detailed_text = generate_detailed_text(&report->stats, percentiles, type);
     }
     
     // 生成图表数据
@@ -382,9 +504,21 @@ int monitor_save_report(const struct monitor_report* report, const char* path) {
     fprintf(file, "  Max Value: %.2f %s\n", report->stats.max_value, get_data_type_unit(report->type));
     fprintf(file, "  Avg Value: %.2f %s\n", report->stats.avg_value, get_data_type_unit(report->type));
     fprintf(file, "  Median Value: %.2f %s\n", report->stats.median_value, get_data_type_unit(report->type));
+    fprintf(file, "  P95 Value: %.2f %s\n", report->stats.p95_value, get_data_type_unit(report->type));
+    fprintf(file, "  P99 Value: %.2f %s\n", report->stats.p99_value, get_data_type_unit(report->type));
     fprintf(file, "  Std Deviation: %.2f %s\n", report->stats.std_deviation, get_data_type_unit(report->type));
     fprintf(file, "  Sample Count: %u\n", report->stats.sample_count);
     
+    // 写入尾延迟
+    if (report->has_percentiles) {
+        const char* unit = get_data_type_unit(report->type);
+        fprintf(file, "  P50: %.2f %s\n", report->percentiles.p50, unit);
+        fprintf(file, "  P95: %.2f %s\n", report->percentiles.p95, unit);
+        fprintf(file, "  P99: %.2f %s\n", report->percentiles.p99, unit);
+        fprintf(file, "  P99.9: %.2f %s\n", report->percentiles.p999, unit);
+        fprintf(file, "  Frames: %llu\n", (unsigned long long)report->percentiles.count);
+    }
+    
     // 写入时间范围
     if (report->stats.sample_count > 0) {
         time_t start_time = report->stats.first_timestamp / 1000000000ULL;
@@ -455,6 +589,13 @@ void monitor_clear_data(monitor_data_type_t type) {
     buffer->head = 0;
     buffer->tail = 0;
     
+    atomic_uint* seq = &g_monitor_state.stats_seq[type];
+    atomic_store_explicit(seq, atomic_load_explicit(seq, memory_order_relaxed) + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    reset_online_stats(&g_monitor_state.online_stats[type]);
+    atomic_store_explicit(seq, atomic_load_explicit(seq, memory_order_relaxed) + 1, memory_order_release);
+    rollup_series_reset(&g_monitor_state.rollups[type]);
+    
     LOGI("Cleared data for type %d", type);
 }
 
@@ -488,6 +629,16 @@ void monitor_print_status(void) {
     LOGI("  Auto Save: %s", g_monitor_state.settings.auto_save ? "yes" : "no");
     LOGI("  Real-time Analysis: %s", g_monitor_state.settings.real_time_analysis ? "yes" : "no");
     LOGI("  Buffer Size: %u", g_monitor_state.settings.buffer_size);
+    LOGI("  Rollup Memory: %zu KB", monitor_get_rollup_memory() / 1024);
+    LOGI("  Producer Threads: %u (%llu points dropped)",
+         atomic_load(&g_staging.thread_count), (unsigned long long)atomic_load(&g_staging.dropped));
+    
+    if (monitor_log_is_active()) {
+        struct monitor_log_stats log_stats;
+        monitor_log_get_stats(&log_stats);
+        LOGI("  Binary Log: %llu records, %llu dropped",
+             (unsigned long long)log_stats.records, (unsigned long long)log_stats.dropped);
+    }
     LOGI("  Sample Interval: %u ms", g_monitor_state.settings.sample_interval_ms);
     LOGI("  Report Interval: %u ms", g_monitor_state.settings.report_interval_ms);
     LOGI("  Save Path: %s", g_monitor_state.settings.save_path);
@@ -503,18 +654,55 @@ void monitor_print_statistics(monitor_data_type_t type) {
     }
     
     struct monitor_statistics stats;
-    calculate_statistics(&g_monitor_state.data_buffers[type], &stats);
+    snapshot_statistics(type, &stats);
     
     LOGI("Statistics for %s:", get_data_type_name(type));
     LOGI("  Min Value: %.2f %s", stats.min_value, get_data_type_unit(type));
     LOGI("  Max Value: %.2f %s", stats.max_value, get_data_type_unit(type));
     LOGI("  Avg Value: %.2f %s", stats.avg_value, get_data_type_unit(type));
     LOGI("  Median Value: %.2f %s", stats.median_value, get_data_type_unit(type));
+    LOGI("  P95 Value: %.2f %s", stats.p95_value, get_data_type_unit(type));
+    LOGI("  P99 Value: %.2f %s", stats.p99_value, get_data_type_unit(type));
     LOGI("  Std Deviation: %.2f %s", stats.std_deviation, get_data_type_unit(type));
     LOGI("  Sample Count: %u", stats.sample_count);
 }
 
-// 导出监控数据为CSV
+// 设置各序列的聚合层（按分辨率从细到粗，会清空已有的聚合数据）
+int monitor_set_rollup_tiers(const struct rollup_tier_config* tiers, uint32_t tier_count) {
+    if (!g_monitor_state.initialized) {
+        LOGE("Monitor module not initialized");
+        return -1;
+    }
+    
+    struct rollup_series series[MONITOR_DATA_TYPE_COUNT];
+    for (int i = 0; i < MONITOR_DATA_TYPE_COUNT; i++) {
+        if (rollup_series_init(&series[i], tiers, tier_count) != 0) {
+            for (int j = 0; j < i; j++) {
+                rollup_series_destroy(&series[j]);
+            }
+            return -1;
+        }
+    }
+    
+    for (int i = 0; i < MONITOR_DATA_TYPE_COUNT; i++) {
+        rollup_series_destroy(&g_monitor_state.rollups[i]);
+        g_monitor_state.rollups[i] = series[i];
+    }
+    
+    LOGI("Rollup tiers updated: %u tiers, %zu bytes", tier_count, monitor_get_rollup_memory());
+    return 0;
+}
+
+// 获取聚合层占用的内存（字节）
+size_t monitor_get_rollup_memory(void) {
+    size_t bytes = 0;
+    for (int i = 0; i < MONITOR_DATA_TYPE_COUNT; i++) {
+        bytes += rollup_series_memory(&g_monitor_state.rollups[i]);
+    }
+    return bytes;
+}
+
+// 导出监控数据为CSV（较早的时间段为聚合桶，原始缓冲区覆盖的部分为原始数据点）
 int monitor_export_to_csv(monitor_data_type_t type, const char* path) {
     if (type >= MONITOR_DATA_TYPE_COUNT) {
         LOGE("Invalid data type: %d", type);
@@ -532,22 +720,31 @@ int monitor_export_to_csv(monitor_data_type_t type, const char* path) {
         return -1;
     }
     
-    // 写入CSV头部
-    fprintf(file, "Timestamp,Value\n");
+    // 写入CSV头部（原始数据点的Duration为0，Count为1）
+    fprintf(file, "Timestamp,Duration,Count,Min,Max,Mean,P50,P95,P99\n");
+    
+    // 写入聚合桶
+    uint64_t raw_start = get_raw_start_time(&g_monitor_state.data_buffers[type]);
+    uint64_t cursor = rollup_series_visit(&g_monitor_state.rollups[type], 0, raw_start, write_csv_bucket, file);
     
-    // 写入数据
+    // 写入聚合桶之后的原始数据
     struct monitor_data_buffer* buffer = &g_monitor_state.data_buffers[type];
-    uint32_t index = buffer->head;
+    uint32_t index = buffer->tail;
     
     for (uint32_t i = 0; i < buffer->count; i++) {
         struct monitor_data_point* point = &buffer->points[index];
+        index = (index + 1) % buffer->capacity;
+        
+        if (point->timestamp < cursor) {
+            continue;
+        }
         
         // 转换时间戳为秒
         double timestamp_seconds = point->timestamp / 1000000000.0;
+        float value = point->value;
         
-        fprintf(file, "%.6f,%.6f\n", timestamp_seconds, point->value);
-        
-        index = (index + 1) % buffer->capacity;
+        fprintf(file, "%.6f,0.000,1,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f\n",
+                timestamp_seconds, value, value, value, value, value, value);
     }
     
     fclose(file);
@@ -556,7 +753,7 @@ int monitor_export_to_csv(monitor_data_type_t type, const char* path) {
     return 0;
 }
 
-// 导出监控数据为JSON
+// 导出监控数据为JSON（聚合桶在rollups中，原始数据点在data中）
 int monitor_export_to_json(monitor_data_type_t type, const char* path) {
     if (type >= MONITOR_DATA_TYPE_COUNT) {
         LOGE("Invalid data type: %d", type);
@@ -577,30 +774,7 @@ int monitor_export_to_json(monitor_data_type_t type, const char* path) {
     // 写入JSON头部
     fprintf(file, "{\n");
     fprintf(file, "  \"type\": \"%s\",\n", get_data_type_name(type));
-    fprintf(file, "  \"unit\": \"%s\",\n", get_data_type_unit(type));
-    fprintf(file, "  \"data\": [\n");
-    
-    // 写入数据
-    struct monitor_data_buffer* buffer = &g_monitor_state.data_buffers[type];
-    uint32_t index = buffer->head;
-    
-    for (uint32_t i = 0; i < buffer->count; i++) {
-        struct monitor_data_point* point = &buffer->points[index];
-        
-        fprintf(file, "    {\"timestamp\": %llu, \"value\": %.6f}", 
-                (unsigned long long)point->timestamp, point->value);
-        
-        if (i < buffer->count - 1) {
-            fprintf(file, ",");
-        }
-        
-        fprintf(file, "\n");
-        
-        index = (index + 1) % buffer->capacity;
-    }
-    
-    // 写入JSON尾部
-    fprintf(file, "  ]\n");
+    write_json_series(file, type, "  ");
     fprintf(file, "}\n");
     
     fclose(file);
@@ -650,29 +824,7 @@ int monitor_export_all_to_json(const char* path) {
     // 为每种数据类型写入数据
     for (int i = 0; i < MONITOR_DATA_TYPE_COUNT; i++) {
         fprintf(file, "  \"%s\": {\n", get_data_type_name((monitor_data_type_t)i));
-        fprintf(file, "    \"unit\": \"%s\",\n", get_data_type_unit((monitor_data_type_t)i));
-        fprintf(file, "    \"data\": [\n");
-        
-        // 写入数据
-        struct monitor_data_buffer* buffer = &g_monitor_state.data_buffers[i];
-        uint32_t index = buffer->head;
-        
-        for (uint32_t j = 0; j < buffer->count; j++) {
-            struct monitor_data_point* point = &buffer->points[index];
-            
-            fprintf(file, "      {\"timestamp\": %llu, \"value\": %.6f}", 
-                    (unsigned long long)point->timestamp, point->value);
-            
-            if (j < buffer->count - 1) {
-                fprintf(file, ",");
-            }
-            
-            fprintf(file, "\n");
-            
-            index = (index + 1) % buffer->capacity;
-        }
-        
-        fprintf(file, "    ]\n");
+        write_json_series(file, (monitor_data_type_t)i, "    ");
         fprintf(file, "  }");
         
         if (i < MONITOR_DATA_TYPE_COUNT - 1) {
@@ -739,24 +891,18 @@ static void sample_data(void) {
 }
 
 static void generate_reports(void) {
+    // 报告只提供给回调，自动保存的数据已写入二进制日志，渲染线程不再格式化和写入文本文件
+    if (!g_monitor_state.callback) {
+        return;
+    }
+    
     // 为每种数据类型生成报告
     for (int i = 0; i < MONITOR_DATA_TYPE_COUNT; i++) {
         struct monitor_report* report = monitor_generate_report((monitor_data_type_t)i);
         
         if (report) {
             // 调用回调函数
-            if (g_monitor_state.callback) {
-                g_monitor_state.callback(report, g_monitor_state.callback_user_data);
-            }
-            
-            // 自动保存报告
-            if (g_monitor_state.settings.auto_save) {
-                char file_path[256];
-                snprintf(file_path, sizeof(file_path), "%s/%s_report.txt", 
-                        g_monitor_state.settings.save_path, get_data_type_name((monitor_data_type_t)i));
-                
-                monitor_save_report(report, file_path);
-            }
+            g_monitor_state.callback(report, g_monitor_state.callback_user_data);
             
             // 释放报告
             monitor_free_report(report);
@@ -764,17 +910,36 @@ static void generate_reports(void) {
     }
 }
 
-static void auto_save_reports(void) {
-    // 自动保存所有数据为CSV和JSON
-    if (g_monitor_state.settings.auto_save) {
-        char csv_path[256];
-        char json_path[256];
-        
-        snprintf(csv_path, sizeof(csv_path), "%s/all_data", g_monitor_state.settings.save_path);
-        snprintf(json_path, sizeof(json_path), "%s/all_data", g_monitor_state.settings.save_path);
-        
-        monitor_export_all_to_csv(csv_path);
-        monitor_export_all_to_json(json_path);
+// 按自动保存设置启动或停止二进制日志（文件名带开始时间，每次启动写入新文件）
+static void update_binary_log(void) {
+    bool active = monitor_log_is_active();
+    
+    if (!g_monitor_state.settings.auto_save) {
+        if (active) {
+            monitor_log_stop();
+        }
+        return;
+    }
+    
+    if (active || !g_monitor_state.settings.save_path) {
+        return;
+    }
+    
+    struct monitor_log_type_info types[MONITOR_DATA_TYPE_COUNT];
+    memset(types, 0, sizeof(types));
+    for (int i = 0; i < MONITOR_DATA_TYPE_COUNT; i++) {
+        snprintf(types[i].name, sizeof(types[i].name), "%s", get_data_type_name((monitor_data_type_t)i));
+        snprintf(types[i].unit, sizeof(types[i].unit), "%s", get_data_type_unit((monitor_data_type_t)i));
+    }
+    
+    char path[256];
+    snprintf(path, sizeof(path), "%s/monitor_%llu.bin", g_monitor_state.settings.save_path,
+             (unsigned long long)time(NULL));
+    
+    if (monitor_log_start(path, types, MONITOR_DATA_TYPE_COUNT) != 0) {
+        // 失败后关闭自动保存，避免每帧重试
+        LOGE("Failed to start binary log, disabling auto save");
+        g_monitor_state.settings.auto_save = false;
     }
 }
 
@@ -824,86 +989,383 @@ static void add_data_point_to_buffer(struct monitor_data_buffer* buffer, const s
     buffer->head = (buffer->head + 1) % buffer->capacity;
 }
 
-static void calculate_statistics(const struct monitor_data_buffer* buffer, struct monitor_statistics* stats) {
-    if (!buffer || !stats || buffer->count == 0) {
+// 在监控线程中写入一个数据点（在线统计的更新由序列锁保护，其他线程读取时得到一致的快照）
+static void apply_data_point(const struct monitor_data_point* point) {
+    monitor_data_type_t type = point->type;
+    atomic_uint* seq = &g_monitor_state.stats_seq[type];
+    uint32_t sequence = atomic_load_explicit(seq, memory_order_relaxed);
+    
+    atomic_store_explicit(seq, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    add_data_point_to_buffer(&g_monitor_state.data_buffers[type], point);
+    update_online_stats(&g_monitor_state.online_stats[type], point);
+    atomic_store_explicit(seq, sequence + 2, memory_order_release);
+    
+    rollup_series_add(&g_monitor_state.rollups[type], point->timestamp, point->value);
+    monitor_log_append(type, point->timestamp, point->value);
+}
+
+// 把数据点写入当前线程的暂存缓冲区（无锁，满时丢弃）
+static void stage_data_point(const struct monitor_data_point* point) {
+    struct staging_buffer* buffer = get_staging_buffer();
+    if (!buffer) {
+        atomic_fetch_add_explicit(&g_staging.dropped, 1, memory_order_relaxed);
         return;
     }
     
-    memset(stats, 0, sizeof(struct monitor_statistics));
-    
-    // 复制数据值到临时数组
-    float* values = malloc(buffer->count * sizeof(float));
-    if (!values) {
-        LOGE("Failed to allocate memory for statistics calculation");
+    uint32_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&buffer->tail, memory_order_acquire);
+    if (head - tail >= STAGING_BUFFER_SIZE) {
+        atomic_fetch_add_explicit(&g_staging.dropped, 1, memory_order_relaxed);
         return;
     }
     
-    uint32_t index = buffer->tail;
-    for (uint32_t i = 0; i < buffer->count; i++) {
-        values[i] = buffer->points[index].value;
-        index = (index + 1) % buffer->capacity;
+    buffer->points[head & STAGING_BUFFER_MASK] = *point;
+    atomic_store_explicit(&buffer->head, head + 1, memory_order_release);
+}
+
+// 获取当前线程的暂存缓冲区，第一次使用时分配并注册
+static struct staging_buffer* get_staging_buffer(void) {
+    if (t_staging || t_staging_rejected) {
+        return t_staging;
     }
     
-    // 计算最小值和最大值
-    stats->min_value = values[0];
-    stats->max_value = values[0];
-    float sum = 0.0f;
+    uint32_t slot = atomic_fetch_add_explicit(&g_staging.thread_count, 1, memory_order_relaxed);
+    if (slot >= STAGING_MAX_THREADS) {
+        LOGE("Too many monitor producer threads, dropping data points");
+        t_staging_rejected = true;
+        return NULL;
+    }
     
-    for (uint32_t i = 0; i < buffer->count; i++) {
-        if (values[i] < stats->min_value) {
-            stats->min_value = values[i];
+    struct staging_buffer* buffer = calloc(1, sizeof(struct staging_buffer));
+    if (!buffer) {
+        LOGE("Failed to allocate staging buffer");
+        t_staging_rejected = true;
+        return NULL;
+    }
+    
+    atomic_init(&buffer->head, 0);
+    atomic_init(&buffer->tail, 0);
+    atomic_store_explicit(&g_staging.buffers[slot], buffer, memory_order_release);
+    t_staging = buffer;
+    return buffer;
+}
+
+// 取出所有暂存缓冲区中的数据点，保留其原始时间戳
+static void drain_staging_buffers(void) {
+    uint32_t count = atomic_load_explicit(&g_staging.thread_count, memory_order_acquire);
+    if (count > STAGING_MAX_THREADS) {
+        count = STAGING_MAX_THREADS;
+    }
+    
+    for (uint32_t i = 0; i < count; i++) {
+        struct staging_buffer* buffer = atomic_load_explicit(&g_staging.buffers[i], memory_order_acquire);
+        if (!buffer) {
+            continue;
         }
         
-        if (values[i] > stats->max_value) {
-            stats->max_value = values[i];
+        uint32_t tail = atomic_load_explicit(&buffer->tail, memory_order_relaxed);
+        uint32_t head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+        for (; tail != head; tail++) {
+            const struct monitor_data_point* point = &buffer->points[tail & STAGING_BUFFER_MASK];
+            if (point->type < MONITOR_DATA_TYPE_COUNT) {
+                apply_data_point(point);
+            }
         }
-        
-        sum += values[i];
+        atomic_store_explicit(&buffer->tail, tail, memory_order_release);
     }
+}
+
+// 读取一个序列的在线统计快照（序列锁：写入进行中或读取期间发生写入时重试）
+static void snapshot_statistics(monitor_data_type_t type, struct monitor_statistics* stats) {
+    atomic_uint* seq = &g_monitor_state.stats_seq[type];
+    struct monitor_online_stats online;
+    uint32_t begin;
+    uint32_t end;
+    
+    do {
+        begin = atomic_load_explicit(seq, memory_order_acquire);
+        online = g_monitor_state.online_stats[type];
+        atomic_thread_fence(memory_order_acquire);
+        end = atomic_load_explicit(seq, memory_order_relaxed);
+    } while ((begin & 1) || begin != end);
+    
+    calculate_statistics(&online, stats);
+}
+
+// 重置一个序列的在线统计
+static void reset_online_stats(struct monitor_online_stats* online) {
+    memset(online, 0, sizeof(struct monitor_online_stats));
+    p2_init(&online->median, 0.5);
+    p2_init(&online->p95, 0.95);
+    p2_init(&online->p99, 0.99);
+}
+
+// 用一个新数据点更新在线统计（O(1)，不分配内存）
+static void update_online_stats(struct monitor_online_stats* online, const struct monitor_data_point* point) {
+    float value = point->value;
+    
+    if (online->count == 0) {
+        online->min_value = value;
+        online->max_value = value;
+        online->first_timestamp = point->timestamp;
+    } else {
+        if (value < online->min_value) {
+            online->min_value = value;
+        }
+        if (value > online->max_value) {
+            online->max_value = value;
+        }
+    }
+    online->last_timestamp = point->timestamp;
+    
+    // Welford：增量更新均值和平方差之和
+    online->count++;
+    double delta = value - online->mean;
+    online->mean += delta / online->count;
+    online->m2 += delta * (value - online->mean);
     
-    // 计算平均值
-    stats->avg_value = sum / buffer->count;
+    p2_add(&online->median, value);
+    p2_add(&online->p95, value);
+    p2_add(&online->p99, value);
+}
+
+static void calculate_statistics(const struct monitor_online_stats* online, struct monitor_statistics* stats) {
+    if (!online || !stats) {
+        return;
+    }
+    
+    memset(stats, 0, sizeof(struct monitor_statistics));
+    if (online->count == 0) {
+        return;
+    }
     
-    // 计算中位数
-    qsort(values, buffer->count, sizeof(float), compare_float);
+    stats->min_value = online->min_value;
+    stats->max_value = online->max_value;
+    stats->avg_value = (float)online->mean;
+    stats->median_value = (float)p2_get(&online->median);
+    stats->p95_value = (float)p2_get(&online->p95);
+    stats->p99_value = (float)p2_get(&online->p99);
+    stats->std_deviation = (float)sqrt(online->m2 / online->count);
     
-    if (buffer->count % 2 == 0) {
-        stats->median_value = (values[buffer->count / 2 - 1] + values[buffer->count / 2]) / 2.0f;
+    // 设置样本数量和时间范围
+    stats->sample_count = online->count;
+    stats->first_timestamp = online->first_timestamp;
+    stats->last_timestamp = online->last_timestamp;
+}
+
+// 初始化P²估计器
+static void p2_init(struct p2_estimator* estimator, double quantile) {
+    memset(estimator, 0, sizeof(struct p2_estimator));
+    estimator->quantile = quantile;
+    
+    estimator->increments[0] = 0.0;
+    estimator->increments[1] = quantile / 2.0;
+    estimator->increments[2] = quantile;
+    estimator->increments[3] = (1.0 + quantile) / 2.0;
+    estimator->increments[4] = 1.0;
+}
+
+// 向P²估计器添加一个样本
+static void p2_add(struct p2_estimator* estimator, double value) {
+    double* q = estimator->heights;
+    double* n = estimator->positions;
+    
+    // 前五个样本直接保存，凑满后排序作为初始标记
+    if (estimator->count < P2_MARKERS) {
+        uint32_t i = estimator->count++;
+        while (i > 0 && q[i - 1] > value) {
+            q[i] = q[i - 1];
+            i--;
+        }
+        q[i] = value;
+        
+        if (estimator->count == P2_MARKERS) {
+            double p = estimator->quantile;
+            for (int j = 0; j < P2_MARKERS; j++) {
+                n[j] = j + 1;
+            }
+            estimator->desired[0] = 1.0;
+            estimator->desired[1] = 1.0 + 2.0 * p;
+            estimator->desired[2] = 1.0 + 4.0 * p;
+            estimator->desired[3] = 3.0 + 2.0 * p;
+            estimator->desired[4] = 5.0;
+        }
+        return;
+    }
+    
+    estimator->count++;
+    
+    // 找到样本所在的区间，必要时扩展两端的标记
+    int k;
+    if (value < q[0]) {
+        q[0] = value;
+        k = 0;
+    } else if (value >= q[4]) {
+        q[4] = value;
+        k = 3;
     } else {
-        stats->median_value = values[buffer->count / 2];
+        k = 0;
+        while (k < 3 && value >= q[k + 1]) {
+            k++;
+        }
     }
     
-    // 计算标准差
-    float variance = 0.0f;
-    for (uint32_t i = 0; i < buffer->count; i++) {
-        float diff = values[i] - stats->avg_value;
-        variance += diff * diff;
+    for (int i = k + 1; i < P2_MARKERS; i++) {
+        n[i] += 1.0;
+    }
+    for (int i = 0; i < P2_MARKERS; i++) {
+        estimator->desired[i] += estimator->increments[i];
     }
     
-    stats->std_deviation = sqrtf(variance / buffer->count);
+    // 调整中间三个标记：偏离期望位置超过1时移动一格，优先用抛物线插值
+    for (int i = 1; i < P2_MARKERS - 1; i++) {
+        double d = estimator->desired[i] - n[i];
+        if ((d >= 1.0 && n[i + 1] - n[i] > 1.0) || (d <= -1.0 && n[i - 1] - n[i] < -1.0)) {
+            double s = d >= 0.0 ? 1.0 : -1.0;
+            double parabolic = q[i] + s / (n[i + 1] - n[i - 1]) *
+                ((n[i] - n[i - 1] + s) * (q[i + 1] - q[i]) / (n[i + 1] - n[i]) +
+                 (n[i + 1] - n[i] - s) * (q[i] - q[i - 1]) / (n[i] - n[i - 1]));
+            
+            if (q[i - 1] < parabolic && parabolic < q[i + 1]) {
+                q[i] = parabolic;
+            } else {
+                int j = i + (int)s;
+                q[i] += s * (q[j] - q[i]) / (n[j] - n[i]);
+            }
+            n[i] += s;
+        }
+    }
+}
+
+// 获取P²估计器的当前估计值（样本不足五个时按已排序样本线性插值）
+static double p2_get(const struct p2_estimator* estimator) {
+    if (estimator->count == 0) {
+        return 0.0;
+    }
     
-    // 设置样本数量和时间范围
-    stats->sample_count = buffer->count;
-    stats->first_timestamp = buffer->points[buffer->tail].timestamp;
-    stats->last_timestamp = buffer->points[(buffer->head + buffer->capacity - 1) % buffer->capacity].timestamp;
+    if (estimator->count < P2_MARKERS) {
+        double rank = estimator->quantile * (estimator->count - 1);
+        uint32_t lower = (uint32_t)rank;
+        if (lower + 1 >= estimator->count) {
+            return estimator->heights[estimator->count - 1];
+        }
+        double fraction = rank - lower;
+        return estimator->heights[lower] + fraction * (estimator->heights[lower + 1] - estimator->heights[lower]);
+    }
     
-    free(values);
+    return estimator->heights[2];
 }
 
-static int compare_float(const void* a, const void* b) {
-    float fa = *(const float*)a;
-    float fb = *(const float*)b;
+// 获取原始缓冲区中最早的数据点的时间戳（缓冲区为空时返回UINT64_MAX，即全部使用聚合桶）
+static uint64_t get_raw_start_time(const struct monitor_data_buffer* buffer) {
+    if (buffer->count == 0) {
+        return UINT64_MAX;
+    }
     
-    if (fa < fb) {
-        return -1;
-    } else if (fa > fb) {
-        return 1;
-    } else {
-        return 0;
+    return buffer->points[buffer->tail].timestamp;
+}
+
+// 写入一个聚合桶的CSV行
+static void write_csv_bucket(const struct rollup_bucket* bucket, uint64_t duration_ns, void* user_data) {
+    FILE* file = user_data;
+    
+    fprintf(file, "%.6f,%.3f,%u,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f\n",
+            bucket->start_ns / 1000000000.0, duration_ns / 1000000000.0, bucket->count,
+            bucket->min_value, bucket->max_value, rollup_bucket_mean(bucket),
+            rollup_bucket_percentile(bucket, 0.5f),
+            rollup_bucket_percentile(bucket, 0.95f),
+            rollup_bucket_percentile(bucket, 0.99f));
+}
+
+// 写入一个聚合桶的JSON对象
+static void write_json_bucket(const struct rollup_bucket* bucket, uint64_t duration_ns, void* user_data) {
+    struct json_bucket_writer* writer = user_data;
+    
+    fprintf(writer->file, "%s\n%s    {\"timestamp\": %llu, \"duration\": %llu, \"count\": %u, "
+            "\"min\": %.6f, \"max\": %.6f, \"mean\": %.6f, \"p50\": %.6f, \"p95\": %.6f, \"p99\": %.6f}",
+            writer->first ? "" : ",", writer->indent,
+            (unsigned long long)bucket->start_ns, (unsigned long long)duration_ns, bucket->count,
+            bucket->min_value, bucket->max_value, rollup_bucket_mean(bucket),
+            rollup_bucket_percentile(bucket, 0.5f),
+            rollup_bucket_percentile(bucket, 0.95f),
+            rollup_bucket_percentile(bucket, 0.99f));
+    writer->first = false;
+}
+
+// 写入一个序列的JSON字段：单位、早于原始数据的聚合桶和原始数据点
+static void write_json_series(FILE* file, monitor_data_type_t type, const char* indent) {
+    fprintf(file, "%s\"unit\": \"%s\",\n", indent, get_data_type_unit(type));
+    
+    // 写入聚合桶
+    struct json_bucket_writer writer = {file, indent, true};
+    fprintf(file, "%s\"rollups\": [", indent);
+    uint64_t raw_start = get_raw_start_time(&g_monitor_state.data_buffers[type]);
+    uint64_t cursor = rollup_series_visit(&g_monitor_state.rollups[type], 0, raw_start, write_json_bucket, &writer);
+    fprintf(file, "\n%s],\n", indent);
+    
+    // 写入聚合桶之后的原始数据
+    fprintf(file, "%s\"data\": [", indent);
+    struct monitor_data_buffer* buffer = &g_monitor_state.data_buffers[type];
+    uint32_t index = buffer->tail;
+    bool first = true;
+    
+    for (uint32_t i = 0; i < buffer->count; i++) {
+        struct monitor_data_point* point = &buffer->points[index];
+        index = (index + 1) % buffer->capacity;
+        
+        if (point->timestamp < cursor) {
+            continue;
+        }
+        
+        fprintf(file, "%s\n%s  {\"timestamp\": %llu, \"value\": %.6f}", first ? "" : ",", indent,
+                (unsigned long long)point->timestamp, point->value);
+        first = false;
+    }
+    
+    fprintf(file, "\n%s]\n", indent);
+}
+
+// 获取逐帧直方图的尾延迟（换算为报告单位），没有对应直方图或尚无完整窗口时返回false
+static bool get_tail_percentiles(monitor_data_type_t type, struct perf_percentiles* percentiles) {
+    switch (type) {
+        case MONITOR_DATA_TYPE_FRAME_TIME:
+            perf_monitor_get_frame_time_percentiles(percentiles);
+            break;
+        case MONITOR_DATA_TYPE_INPUT_LATENCY:
+            perf_monitor_get_counter_percentiles(PERF_COUNTER_INPUT_LATENCY, percentiles);
+            break;
+        case MONITOR_DATA_TYPE_RENDER_TIME:
+            perf_monitor_get_counter_percentiles(PERF_COUNTER_RENDER_TIME, percentiles);
+            break;
+        case MONITOR_DATA_TYPE_COMPOSITE_TIME:
+            perf_monitor_get_counter_percentiles(PERF_COUNTER_COMPOSITE_TIME, percentiles);
+            break;
+        case MONITOR_DATA_TYPE_PRESENT_TIME:
+            perf_monitor_get_counter_percentiles(PERF_COUNTER_PRESENT_TIME, percentiles);
+            break;
+        default:
+            memset(percentiles, 0, sizeof(struct perf_percentiles));
+            return false;
     }
+    
+    if (percentiles->count == 0) {
+        return false;
+    }
+    
+    // 直方图以微秒记录
+    percentiles->min /= 1000.0f;
+    percentiles->max /= 1000.0f;
+    percentiles->mean /= 1000.0f;
+    percentiles->p50 /= 1000.0f;
+    percentiles->p95 /= 1000.0f;
+    percentiles->p99 /= 1000.0f;
+    percentiles->p999 /= 1000.0f;
+    return true;
 }
 
-static char* generate_summary_text(const struct monitor_statistics* stats, monitor_data_type_t type) {
+static char* generate_summary_text(const struct monitor_statistics* stats, const struct perf_percentiles* percentiles,
+                                   monitor_data_type_t type) {
     if (!stats) {
         return NULL;
     }
@@ -913,7 +1375,7 @@ static char* generate_summary_text(const struct monitor_statistics* stats, monit
         return NULL;
     }
     
-    snprintf(text, 1024, 
+    int length = snprintf(text, 1024, 
              "Summary for %s:\n"
              "  Average: %.2f %s\n"
              "  Range: %.2f - %.2f %s\n"
@@ -925,10 +1387,18 @@ static char* generate_summary_text(const struct monitor_statistics* stats, monit
              stats->std_deviation, get_data_type_unit(type),
              stats->sample_count);
     
+    if (percentiles && length > 0 && length < 1024) {
+        snprintf(text + length, 1024 - length,
+                 "  Tail (p50/p95/p99/p99.9): %.2f / %.2f / %.2f / %.2f %s\n",
+                 percentiles->p50, percentiles->p95, percentiles->p99, percentiles->p999,
+                 get_data_type_unit(type));
+    }
+    
     return text;
 }
 
-static char* generate_detailed_text(const struct monitor_statistics* stats, monitor_data_type_t type) {
+static char* generate_detailed_text(const struct monitor_statistics* stats, const struct perf_percentiles* percentiles,
+                                    monitor_data_type_t type) {
     if (!stats) {
         return NULL;
     }
@@ -941,12 +1411,13 @@ static char* generate_detailed_text(const struct monitor_statistics* stats, moni
     time_t start_time = stats->first_timestamp / 1000000000ULL;
     time_t end_time = stats->last_timestamp / 1000000000ULL;
     
-    snprintf(text, 2048,
+    int length = snprintf(text, 2048,
              "Detailed Analysis for %s:\n"
              "  Min Value: %.2f %s\n"
              "  Max Value: %.2f %s\n"
              "  Average Value: %.2f %s\n"
              "  Median Value: %.2f %s\n"
+             "  P95 / P99 Value: %.2f / %.2f %s\n"
              "  Standard Deviation: %.2f %s\n"
              "  Sample Count: %u\n"
              "  Time Range: %s to %s\n"
@@ -956,11 +1427,29 @@ static char* generate_detailed_text(const struct monitor_statistics* stats, moni
              stats->max_value, get_data_type_unit(type),
              stats->avg_value, get_data_type_unit(type),
              stats->median_value, get_data_type_unit(type),
+             stats->p95_value, stats->p99_value, get_data_type_unit(type),
              stats->std_deviation, get_data_type_unit(type),
              stats->sample_count,
              ctime(&start_time), ctime(&end_time),
              stats->avg_value > 0 ? (stats->std_deviation / stats->avg_value * 100.0f) : 0.0f);
     
+    if (percentiles && length > 0 && length < 2048) {
+        const char* unit = get_data_type_unit(type);
+        snprintf(text + length, 2048 - length,
+                 "  Per-Frame Distribution (%llu frames):\n"
+                 "    P50: %.2f %s\n"
+                 "    P95: %.2f %s\n"
+                 "    P99: %.2f %s\n"
+                 "    P99.9: %.2f %s\n"
+                 "    Worst: %.2f %s\n",
+                 (unsigned long long)percentiles->count,
+                 percentiles->p50, unit,
+                 percentiles->p95, unit,
+                 percentiles->p99, unit,
+                 percentiles->p999, unit,
+                 percentiles->max, unit);
+    }
+    
     return text;
 }
 
@@ -1031,6 +1520,28 @@ static const char* get_data_type_name(monitor_data_type_t type) {
             return "FrameDrops";
         case MONITOR_DATA_TYPE_THERMAL_STATE:
             return "ThermalState";
+        case MONITOR_DATA_TYPE_GPU_FRAME_TIME:
+            return "GPUFrameTime";
+        case MONITOR_DATA_TYPE_GPU_BASE_TIME:
+            return "GPUBaseTime";
+        case MONITOR_DATA_TYPE_GPU_LAYER_TIME:
+            return "GPULayerTime";
+        case MONITOR_DATA_TYPE_GPU_RESOLVE_TIME:
+            return "GPUResolveTime";
+        case MONITOR_DATA_TYPE_LOAD_TIME:
+            return "LoadTime";
+        case MONITOR_DATA_TYPE_GC_PAUSE_TIME:
+            return "GCPauseTime";
+        case MONITOR_DATA_TYPE_GPU_CACHE_TIME:
+            return "GPUCacheTime";
+        case MONITOR_DATA_TYPE_GPU_BACKGROUND_TIME:
+            return "GPUBackgroundTime";
+        case MONITOR_DATA_TYPE_GPU_WINDOW_TIME:
+            return "GPUWindowTime";
+        case MONITOR_DATA_TYPE_GPU_BATCH_TIME:
+            return "GPUBatchTime";
+        case MONITOR_DATA_TYPE_GPU_UI_TIME:
+            return "GPUUITime";
         default:
             return "Unknown";
     }
@@ -1043,6 +1554,17 @@ static const char* get_data_type_unit(monitor_data_type_t type) {
         case MONITOR_DATA_TYPE_COMPOSITE_TIME:
         case MONITOR_DATA_TYPE_PRESENT_TIME:
         case MONITOR_DATA_TYPE_INPUT_LATENCY:
+        case MONITOR_DATA_TYPE_GPU_FRAME_TIME:
+        case MONITOR_DATA_TYPE_GPU_BASE_TIME:
+        case MONITOR_DATA_TYPE_GPU_LAYER_TIME:
+        case MONITOR_DATA_TYPE_GPU_RESOLVE_TIME:
+        case MONITOR_DATA_TYPE_LOAD_TIME:
+        case MONITOR_DATA_TYPE_GC_PAUSE_TIME:
+        case MONITOR_DATA_TYPE_GPU_CACHE_TIME:
+        case MONITOR_DATA_TYPE_GPU_BACKGROUND_TIME:
+        case MONITOR_DATA_TYPE_GPU_WINDOW_TIME:
+        case MONITOR_DATA_TYPE_GPU_BATCH_TIME:
+        case MONITOR_DATA_TYPE_GPU_UI_TIME:
             return "ms";
         case MONITOR_DATA_TYPE_FPS:
             return "fps";
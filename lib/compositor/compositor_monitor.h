@@ -3,6 +3,8 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include "compositor_histogram.h"
+#include "compositor_rollup.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -21,6 +23,17 @@ typedef enum {
     MONITOR_DATA_TYPE_PRESENT_TIME,
     MONITOR_DATA_TYPE_FRAME_DROPS,
     MONITOR_DATA_TYPE_THERMAL_STATE,
+    MONITOR_DATA_TYPE_GPU_FRAME_TIME,      // 渲染通道GPU耗时
+    MONITOR_DATA_TYPE_GPU_BASE_TIME,       // 附件清除和预记录层GPU耗时
+    MONITOR_DATA_TYPE_GPU_LAYER_TIME,      // 背景、窗口、批处理和UI任务GPU耗时合计
+    MONITOR_DATA_TYPE_GPU_RESOLVE_TIME,    // 附件存储GPU耗时
+    MONITOR_DATA_TYPE_LOAD_TIME,           // 异步资源加载耗时（加载线程）
+    MONITOR_DATA_TYPE_GC_PAUSE_TIME,       // 垃圾回收暂停时间（回收线程）
+    MONITOR_DATA_TYPE_GPU_CACHE_TIME,      // 离屏层缓存重建GPU耗时
+    MONITOR_DATA_TYPE_GPU_BACKGROUND_TIME, // 背景层任务GPU耗时
+    MONITOR_DATA_TYPE_GPU_WINDOW_TIME,     // 窗口层任务GPU耗时
+    MONITOR_DATA_TYPE_GPU_BATCH_TIME,      // 批处理任务GPU耗时
+    MONITOR_DATA_TYPE_GPU_UI_TIME,         // UI层任务GPU耗时
     MONITOR_DATA_TYPE_COUNT
 } monitor_data_type_t;
 
@@ -40,12 +53,14 @@ struct monitor_data_buffer {
     uint32_t tail;                      // 尾索引（环形缓冲区）
 };
 
-// 监控统计信息
+// 监控统计信息（数据点到达时在线更新，覆盖上次清除以来的全部样本）
 struct monitor_statistics {
     float min_value;               // 最小值
     float max_value;               // 最大值
     float avg_value;               // 平均值
-    float median_value;            // 中位数
+    float median_value;            // 中位数（P²估计）
+    float p95_value;               // 第95百分位（P²估计）
+    float p99_value;               // 第99百分位（P²估计）
     float std_deviation;           // 标准差
     uint32_t sample_count;         // 样本数量
     uint64_t first_timestamp;      // 第一个样本的时间戳
@@ -56,6 +71,8 @@ struct monitor_statistics {
 struct monitor_report {
     monitor_data_type_t type;      // 报告类型
     struct monitor_statistics stats;  // 统计信息
+    bool has_percentiles;          // 是否有逐帧直方图的尾延迟
+    struct perf_percentiles percentiles; // 性能监控器上一个统计窗口的分位数（单位同报告）
     char* summary_text;            // 摘要文本
     char* detailed_text;           // 详细文本
     char* chart_data;              // 图表数据（JSON格式）
@@ -79,7 +96,7 @@ typedef void (*monitor_callback_t)(const struct monitor_report* report, void* us
 
 // 监控接口函数
 
-// 初始化监控模块
+// 初始化监控模块（调用线程即监控线程，monitor_update也应在该线程调用）
 int monitor_init(void);
 
 // 销毁监控模块
@@ -142,13 +159,14 @@ void monitor_set_detailed_stats_enabled(bool enabled);
 // 检查详细统计是否启用
 bool monitor_is_detailed_stats_enabled(void);
 
-// 添加监控数据点
+// 添加监控数据点（可在任意线程调用，不阻塞：其他线程写入各自的暂存缓冲区，
+// 由monitor_update按原时间戳合并，缓冲区满时丢弃）
 void monitor_add_data_point(monitor_data_type_t type, float value);
 
 // 获取监控数据缓冲区
 void monitor_get_data_buffer(monitor_data_type_t type, struct monitor_data_buffer* buffer);
 
-// 获取监控统计信息
+// 获取监控统计信息（可在任意线程调用，得到一致的快照）
 void monitor_get_statistics(monitor_data_type_t type, struct monitor_statistics* stats);
 
 // 生成监控报告
@@ -181,10 +199,16 @@ void monitor_print_status(void);
 // 打印监控统计信息
 void monitor_print_statistics(monitor_data_type_t type);
 
-// 导出监控数据为CSV
+// 设置各序列的聚合层（按分辨率从细到粗，会清空已有的聚合数据）
+int monitor_set_rollup_tiers(const struct rollup_tier_config* tiers, uint32_t tier_count);
+
+// 获取聚合层占用的内存（字节）
+size_t monitor_get_rollup_memory(void);
+
+// 导出监控数据为CSV（较早的时间段为聚合桶，原始缓冲区覆盖的部分为原始数据点）
 int monitor_export_to_csv(monitor_data_type_t type, const char* path);
 
-// 导出监控数据为JSON
+// 导出监控数据为JSON（聚合桶在rollups中，原始数据点在data中）
 int monitor_export_to_json(monitor_data_type_t type, const char* path);
 
 // 导出所有监控数据为CSV
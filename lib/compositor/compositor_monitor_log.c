@@ -0,0 +1,332 @@
+#include "compositor_monitor_log.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <android/log.h>
+
+#define LOG_TAG "MonitorLog"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+// 渲染线程到刷新线程的队列长度（2的幂）
+#define MONITOR_LOG_QUEUE_SIZE 4096
+#define MONITOR_LOG_QUEUE_MASK (MONITOR_LOG_QUEUE_SIZE - 1)
+// 刷新间隔（毫秒）
+#define MONITOR_LOG_FLUSH_INTERVAL_MS 200
+// 文件初始大小和每次增长的最小大小
+#define MONITOR_LOG_INITIAL_SIZE (1024 * 1024)
+
+// 队列中的数据点（绝对时间，增量编码在刷新线程中进行）
+struct queued_point {
+    uint64_t timestamp_ns;
+    uint32_t type;
+    float value;
+};
+
+// 日志状态
+static struct {
+    atomic_bool active;
+    bool running;                          // 刷新线程是否继续运行（持有mutex时访问）
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    char* path;
+    struct monitor_log_header header;      // 文件头模板
+    
+    // 单生产者单消费者队列
+    struct queued_point queue[MONITOR_LOG_QUEUE_SIZE];
+    atomic_uint queue_head;                // 生产者写入位置
+    atomic_uint queue_tail;                // 消费者读取位置
+    atomic_uint_fast64_t dropped;
+    
+    // 以下只由刷新线程访问
+    int fd;
+    uint8_t* map;
+    size_t map_size;
+    uint64_t record_count;
+    uint64_t last_time_us;
+    atomic_uint_fast64_t written;          // 供统计读取
+    atomic_uint_fast64_t file_size;
+} g_log = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+    .fd = -1
+};
+
+// 内部函数声明
+static void* flush_thread_main(void* arg);
+static int open_log_file(void);
+static void close_log_file(void);
+static int ensure_capacity(uint64_t record_count);
+static void drain_queue(void);
+static void write_record(uint16_t type, uint32_t delta_us, uint32_t data);
+
+// 开始记录到path（启动后台刷新线程，文件由该线程创建和映射）
+int monitor_log_start(const char* path, const struct monitor_log_type_info* types, uint32_t type_count) {
+    if (!path || !types || type_count == 0 || type_count > MONITOR_LOG_MAX_TYPES) {
+        LOGE("Invalid log parameters");
+        return -1;
+    }
+    
+    if (atomic_load(&g_log.active)) {
+        LOGE("Monitor log already active");
+        return -1;
+    }
+    
+    g_log.path = strdup(path);
+    if (!g_log.path) {
+        LOGE("Failed to allocate log path");
+        return -1;
+    }
+    
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    
+    memset(&g_log.header, 0, sizeof(g_log.header));
+    g_log.header.magic = MONITOR_LOG_MAGIC;
+    g_log.header.version = MONITOR_LOG_VERSION;
+    g_log.header.record_size = sizeof(struct monitor_log_record);
+    g_log.header.header_size = sizeof(struct monitor_log_header);
+    g_log.header.type_count = type_count;
+    g_log.header.start_time_ns = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    g_log.header.start_wall_time = (uint64_t)time(NULL);
+    memcpy(g_log.header.types, types, type_count * sizeof(struct monitor_log_type_info));
+    
+    atomic_store(&g_log.queue_head, 0);
+    atomic_store(&g_log.queue_tail, 0);
+    atomic_store(&g_log.dropped, 0);
+    atomic_store(&g_log.written, 0);
+    atomic_store(&g_log.file_size, 0);
+    g_log.record_count = 0;
+    g_log.last_time_us = 0;
+    g_log.running = true;
+    
+    if (pthread_create(&g_log.thread, NULL, flush_thread_main, NULL) != 0) {
+        LOGE("Failed to create log flush thread");
+        free(g_log.path);
+        g_log.path = NULL;
+        return -1;
+    }
+    
+    atomic_store_explicit(&g_log.active, true, memory_order_release);
+    LOGI("Monitor log started: %s", path);
+    return 0;
+}
+
+// 停止记录：刷新剩余数据，截断文件到实际长度并关闭
+void monitor_log_stop(void) {
+    if (!atomic_exchange(&g_log.active, false)) {
+        return;
+    }
+    
+    pthread_mutex_lock(&g_log.mutex);
+    g_log.running = false;
+    pthread_cond_signal(&g_log.cond);
+    pthread_mutex_unlock(&g_log.mutex);
+    
+    pthread_join(g_log.thread, NULL);
+    
+    LOGI("Monitor log stopped: %s (%llu records, %llu dropped)", g_log.path,
+         (unsigned long long)atomic_load(&g_log.written), (unsigned long long)atomic_load(&g_log.dropped));
+    
+    free(g_log.path);
+    g_log.path = NULL;
+}
+
+// 检查是否正在记录
+bool monitor_log_is_active(void) {
+    return atomic_load_explicit(&g_log.active, memory_order_acquire);
+}
+
+// 追加一个数据点（只写入内存队列，不格式化、不进行系统调用；单生产者）
+void monitor_log_append(uint32_t type, uint64_t timestamp_ns, float value) {
+    if (!atomic_load_explicit(&g_log.active, memory_order_acquire)) {
+        return;
+    }
+    
+    uint32_t head = atomic_load_explicit(&g_log.queue_head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&g_log.queue_tail, memory_order_acquire);
+    if (head - tail >= MONITOR_LOG_QUEUE_SIZE) {
+        atomic_fetch_add_explicit(&g_log.dropped, 1, memory_order_relaxed);
+        return;
+    }
+    
+    struct queued_point* point = &g_log.queue[head & MONITOR_LOG_QUEUE_MASK];
+    point->timestamp_ns = timestamp_ns;
+    point->type = type;
+    point->value = value;
+    atomic_store_explicit(&g_log.queue_head, head + 1, memory_order_release);
+}
+
+// 获取日志统计
+void monitor_log_get_stats(struct monitor_log_stats* stats) {
+    if (!stats) {
+        return;
+    }
+    
+    stats->records = atomic_load(&g_log.written);
+    stats->dropped = atomic_load(&g_log.dropped);
+    stats->file_size = atomic_load(&g_log.file_size);
+}
+
+// 刷新线程：定期把队列中的数据点编码后写入映射的文件
+static void* flush_thread_main(void* arg) {
+    (void)arg;
+    
+    // 打开失败时仍然消费队列，数据点计为丢弃
+    open_log_file();
+    
+    pthread_mutex_lock(&g_log.mutex);
+    while (g_log.running) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += MONITOR_LOG_FLUSH_INTERVAL_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+        }
+        pthread_cond_timedwait(&g_log.cond, &g_log.mutex, &deadline);
+        
+        pthread_mutex_unlock(&g_log.mutex);
+        drain_queue();
+        pthread_mutex_lock(&g_log.mutex);
+    }
+    pthread_mutex_unlock(&g_log.mutex);
+    
+    drain_queue();
+    close_log_file();
+    return NULL;
+}
+
+// 创建文件并映射初始大小
+static int open_log_file(void) {
+    g_log.fd = open(g_log.path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (g_log.fd < 0) {
+        LOGE("Failed to open monitor log %s: %s", g_log.path, strerror(errno));
+        return -1;
+    }
+    
+    g_log.map = NULL;
+    g_log.map_size = 0;
+    if (ensure_capacity(0) != 0) {
+        close(g_log.fd);
+        g_log.fd = -1;
+        return -1;
+    }
+    
+    memcpy(g_log.map, &g_log.header, sizeof(g_log.header));
+    return 0;
+}
+
+// 写入最终记录数，截断到实际长度并关闭
+static void close_log_file(void) {
+    if (g_log.fd < 0) {
+        return;
+    }
+    
+    if (g_log.map) {
+        ((struct monitor_log_header*)g_log.map)->record_count = g_log.record_count;
+        msync(g_log.map, g_log.map_size, MS_SYNC);
+        munmap(g_log.map, g_log.map_size);
+        g_log.map = NULL;
+    }
+    
+    off_t length = (off_t)(sizeof(struct monitor_log_header) + g_log.record_count * sizeof(struct monitor_log_record));
+    if (ftruncate(g_log.fd, length) != 0) {
+        LOGE("Failed to truncate monitor log: %s", strerror(errno));
+    }
+    
+    close(g_log.fd);
+    g_log.fd = -1;
+    g_log.map_size = 0;
+}
+
+// 确保映射能容纳record_count条记录，不够时加倍扩展文件并重新映射
+static int ensure_capacity(uint64_t record_count) {
+    size_t needed = sizeof(struct monitor_log_header) + record_count * sizeof(struct monitor_log_record);
+    if (g_log.map && needed <= g_log.map_size) {
+        return 0;
+    }
+    
+    size_t new_size = g_log.map_size ? g_log.map_size * 2 : MONITOR_LOG_INITIAL_SIZE;
+    while (new_size < needed) {
+        new_size *= 2;
+    }
+    
+    if (g_log.map) {
+        munmap(g_log.map, g_log.map_size);
+        g_log.map = NULL;
+    }
+    
+    if (ftruncate(g_log.fd, (off_t)new_size) != 0) {
+        LOGE("Failed to grow monitor log: %s", strerror(errno));
+        return -1;
+    }
+    
+    void* map = mmap(NULL, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, g_log.fd, 0);
+    if (map == MAP_FAILED) {
+        LOGE("Failed to map monitor log: %s", strerror(errno));
+        return -1;
+    }
+    
+    g_log.map = map;
+    g_log.map_size = new_size;
+    atomic_store(&g_log.file_size, new_size);
+    return 0;
+}
+
+// 取出队列中的所有数据点，增量编码后写入文件，最后更新文件头中的记录数
+static void drain_queue(void) {
+    uint32_t tail = atomic_load_explicit(&g_log.queue_tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&g_log.queue_head, memory_order_acquire);
+    if (head == tail) {
+        return;
+    }
+    
+    // 每个数据点最多需要一条额外的同步记录
+    if (g_log.fd < 0 || ensure_capacity(g_log.record_count + 2 * (uint64_t)(head - tail)) != 0) {
+        atomic_fetch_add_explicit(&g_log.dropped, head - tail, memory_order_relaxed);
+        atomic_store_explicit(&g_log.queue_tail, head, memory_order_release);
+        return;
+    }
+    
+    for (; tail != head; tail++) {
+        const struct queued_point* point = &g_log.queue[tail & MONITOR_LOG_QUEUE_MASK];
+        uint64_t time_us = point->timestamp_ns / 1000;
+        
+        // 第一条记录、时间回退或增量超出32位时先写同步记录
+        if (g_log.record_count == 0 || time_us < g_log.last_time_us ||
+            time_us - g_log.last_time_us > UINT32_MAX) {
+            write_record(MONITOR_LOG_TYPE_SYNC, (uint32_t)time_us, (uint32_t)(time_us >> 32));
+            g_log.last_time_us = time_us;
+        }
+        
+        uint32_t value_bits;
+        memcpy(&value_bits, &point->value, sizeof(value_bits));
+        write_record((uint16_t)point->type, (uint32_t)(time_us - g_log.last_time_us), value_bits);
+        g_log.last_time_us = time_us;
+    }
+    atomic_store_explicit(&g_log.queue_tail, tail, memory_order_release);
+    
+    // 记录数最后更新，读取方看到的记录总是完整的
+    ((struct monitor_log_header*)g_log.map)->record_count = g_log.record_count;
+    msync(g_log.map, g_log.map_size, MS_ASYNC);
+    atomic_store(&g_log.written, g_log.record_count);
+}
+
+// 在映射中写入一条记录（调用前已确保容量）
+static void write_record(uint16_t type, uint32_t delta_us, uint32_t data) {
+    struct monitor_log_record* record = (struct monitor_log_record*)(g_log.map + sizeof(struct monitor_log_header)) +
+                                        g_log.record_count;
+    record->delta_us = delta_us;
+    record->type = type;
+    record->reserved = 0;
+    record->data.time_high_us = data;
+    g_log.record_count++;
+}
@@ -0,0 +1,78 @@
+#ifndef COMPOSITOR_MONITOR_LOG_H
+#define COMPOSITOR_MONITOR_LOG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 文件格式（小端，与主机端解码工具tools/monitor_log_decode.c共用）：
+// 一个固定大小的文件头，之后是定长记录；时间戳以微秒增量编码，
+// 第一条记录和增量超出32位时写入同步记录携带绝对时间
+#define MONITOR_LOG_MAGIC 0x474C4D43u      // "CMLG"
+#define MONITOR_LOG_VERSION 1
+#define MONITOR_LOG_MAX_TYPES 32
+#define MONITOR_LOG_NAME_SIZE 24
+#define MONITOR_LOG_UNIT_SIZE 8
+// 同步记录的类型
+#define MONITOR_LOG_TYPE_SYNC 0xFFFFu
+
+// 数据类型描述
+struct monitor_log_type_info {
+    char name[MONITOR_LOG_NAME_SIZE];
+    char unit[MONITOR_LOG_UNIT_SIZE];
+};
+
+// 文件头
+struct monitor_log_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;                  // sizeof(struct monitor_log_record)
+    uint32_t header_size;                  // sizeof(struct monitor_log_header)
+    uint32_t type_count;
+    uint64_t start_time_ns;                // 开始记录时的CLOCK_MONOTONIC时间
+    uint64_t start_wall_time;              // 开始记录时的墙上时间（秒）
+    uint64_t record_count;                 // 有效记录数（后台线程每次刷新时更新）
+    struct monitor_log_type_info types[MONITOR_LOG_MAX_TYPES];
+};
+
+// 定长记录
+struct monitor_log_record {
+    uint32_t delta_us;                     // 距上一条记录的时间；同步记录为绝对时间（微秒）的低32位
+    uint16_t type;                         // 数据类型，或MONITOR_LOG_TYPE_SYNC
+    uint16_t reserved;
+    union {
+        float value;                       // 数据值
+        uint32_t time_high_us;             // 同步记录：绝对时间的高32位
+    } data;
+};
+
+// 日志统计
+struct monitor_log_stats {
+    uint64_t records;                      // 已写入文件的记录数
+    uint64_t dropped;                      // 队列满时丢弃的数据点
+    uint64_t file_size;                    // 当前映射的文件大小
+};
+
+// 开始记录到path（启动后台刷新线程，文件由该线程创建和映射）
+int monitor_log_start(const char* path, const struct monitor_log_type_info* types, uint32_t type_count);
+
+// 停止记录：刷新剩余数据，截断文件到实际长度并关闭
+void monitor_log_stop(void);
+
+// 检查是否正在记录
+bool monitor_log_is_active(void);
+
+// 追加一个数据点（只写入内存队列，不格式化、不进行系统调用；单生产者）
+void monitor_log_append(uint32_t type, uint64_t timestamp_ns, float value);
+
+// 获取日志统计
+void monitor_log_get_stats(struct monitor_log_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COMPOSITOR_MONITOR_LOG_H
@@ -1,4 +1,6 @@
 #include "compositor_perf.h"
+#include "compositor_trace.h"
+#include "compositor_cpu_sampler.h"
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -21,10 +23,19 @@ static struct perf_thresholds g_thresholds = {
 };
 static perf_warning_callback_t g_warning_callback = NULL;
 static void* g_warning_user_data = NULL;
+// 计时测量在跟踪时间线上的名称
+static const char* g_counter_names[PERF_COUNTER_COUNT] = {
+    "frame", "draw_calls", "triangles", "texture_switches", "memory_usage", "cpu_usage", "gpu_usage",
+    "render", "input", "input_latency", "composite", "present", "frame_drops"
+};
+// 统计窗口结束时的直方图快照（只在结束帧时使用，避免占用栈）
+static struct perf_histogram_snapshot g_window_snapshot;
 
 // 内部函数声明
 static uint64_t perf_get_time(void);
 static void perf_update_counters(void);
+static void perf_reset_histograms(void);
+static void perf_close_window(void);
 
 // 初始化性能监控器
 int perf_monitor_init(void) {
@@ -38,6 +49,7 @@ int perf_monitor_init(void) {
     g_monitor.update_interval = 60; // 每60帧更新一次
     g_monitor.min_frame_time = 1000.0f; // 初始最小值
     g_monitor.last_frame_time = perf_get_time();
+    perf_reset_histograms();
     
     LOGI("Performance monitor initialized");
     return 0;
@@ -72,7 +84,9 @@ void perf_monitor_end_frame(void) {
     if (!g_monitor.enabled) return;
     
     uint64_t current_time = perf_get_time();
-    float frame_time = (float)(current_time - g_monitor.last_frame_time) / 1000.0f; // 毫秒
+    uint64_t frame_time_us = current_time - g_monitor.last_frame_time;
+    float frame_time = (float)frame_time_us / 1000.0f; // 毫秒
+    perf_histogram_record(&g_monitor.frame_time_histogram, frame_time_us);
     
     // 更新帧时间统计
     if (frame_time < g_monitor.min_frame_time) {
@@ -94,6 +108,9 @@ void perf_monitor_end_frame(void) {
     g_monitor.frame_count++;
     g_monitor.frame_since_update++;
     
+    // 进程CPU使用率由后台采样线程读取/proc得到，每帧计入一次使平均值与其他计数器一致
+    perf_monitor_update_counter(PERF_COUNTER_CPU_USAGE, (uint64_t)(cpu_sampler_get_process_usage() + 0.5f));
+    
     // 更新计数器
     perf_update_counters();
     
@@ -112,6 +129,9 @@ void perf_monitor_end_frame(void) {
             }
         }
         
+        // 结束统计窗口，计算分位数
+        perf_close_window();
+        
         // 检查性能警告
         perf_check_warnings();
     }
@@ -125,6 +145,7 @@ void perf_monitor_update_counter(perf_counter_type_t type, uint64_t value) {
     
     g_monitor.counters[type] = value;
     g_monitor.counter_totals[type] += value;
+    perf_histogram_record(&g_monitor.counter_histograms[type], value);
 }
 
 // 增加计数器
@@ -137,6 +158,41 @@ void perf_monitor_increment_counter(perf_counter_type_t type) {
     g_monitor.counter_totals[type]++;
 }
 
+// 设置计数器
+void perf_monitor_set_counter(perf_counter_type_t type, uint64_t value) {
+    perf_monitor_update_counter(type, value);
+}
+
+// 开始计时测量（结果以微秒写入计数器）
+void perf_monitor_begin_measure(perf_counter_type_t type) {
+    if (!g_monitor.enabled || type < 0 || type >= PERF_COUNTER_COUNT) {
+        return;
+    }
+    
+    // 嵌套开始时只重置起点，跟踪区间保持一层以便与唯一一次有效的结束配对
+    if (g_monitor.measure_start[type] == 0) {
+        TRACE_BEGIN(g_counter_names[type]);
+    }
+    g_monitor.measure_start[type] = perf_get_time();
+}
+
+// 结束计时测量
+void perf_monitor_end_measure(perf_counter_type_t type) {
+    if (!g_monitor.enabled || type < 0 || type >= PERF_COUNTER_COUNT) {
+        return;
+    }
+    
+    // 嵌套或重复结束时只记录第一次
+    if (g_monitor.measure_start[type] == 0) {
+        return;
+    }
+    
+    uint64_t elapsed = perf_get_time() - g_monitor.measure_start[type];
+    g_monitor.measure_start[type] = 0;
+    TRACE_END(g_counter_names[type]);
+    perf_monitor_update_counter(type, elapsed);
+}
+
 // 获取当前帧率
 float perf_monitor_get_fps(void) {
     return g_monitor.fps;
@@ -184,6 +240,48 @@ float perf_monitor_get_counter_peak(perf_counter_type_t type) {
     return g_monitor.counter_peaks[type];
 }
 
+// 获取上一个统计窗口的帧时间分位数（微秒，窗口为update_interval帧）
+void perf_monitor_get_frame_time_percentiles(struct perf_percentiles* percentiles) {
+    if (!percentiles) {
+        return;
+    }
+    
+    *percentiles = g_monitor.frame_time_percentiles;
+}
+
+// 获取上一个统计窗口的计数器分位数
+void perf_monitor_get_counter_percentiles(perf_counter_type_t type, struct perf_percentiles* percentiles) {
+    if (!percentiles) {
+        return;
+    }
+    
+    if (type < 0 || type >= PERF_COUNTER_COUNT) {
+        memset(percentiles, 0, sizeof(struct perf_percentiles));
+        return;
+    }
+    
+    *percentiles = g_monitor.counter_percentiles[type];
+}
+
+// 无锁复制当前统计窗口的帧时间分布（不清空，可在任意线程调用）
+void perf_monitor_snapshot_frame_times(struct perf_histogram_snapshot* snapshot) {
+    perf_histogram_snapshot(&g_monitor.frame_time_histogram, snapshot, false);
+}
+
+// 无锁复制当前统计窗口的计数器分布
+void perf_monitor_snapshot_counter(perf_counter_type_t type, struct perf_histogram_snapshot* snapshot) {
+    if (!snapshot) {
+        return;
+    }
+    
+    if (type < 0 || type >= PERF_COUNTER_COUNT) {
+        memset(snapshot, 0, sizeof(struct perf_histogram_snapshot));
+        return;
+    }
+    
+    perf_histogram_snapshot(&g_monitor.counter_histograms[type], snapshot, false);
+}
+
 // 重置性能监控器
 void perf_monitor_reset(void) {
     memset(&g_monitor.counters, 0, sizeof(g_monitor.counters));
@@ -198,6 +296,31 @@ void perf_monitor_reset(void) {
     g_monitor.min_frame_time = 1000.0f;
     g_monitor.max_frame_time = 0.0f;
     g_monitor.last_frame_time = perf_get_time();
+    perf_reset_histograms();
+}
+
+// 清空所有直方图和上一个窗口的分位数
+static void perf_reset_histograms(void) {
+    perf_histogram_init(&g_monitor.frame_time_histogram);
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+        perf_histogram_init(&g_monitor.counter_histograms[i]);
+    }
+    
+    memset(&g_monitor.frame_time_percentiles, 0, sizeof(g_monitor.frame_time_percentiles));
+    memset(&g_monitor.counter_percentiles, 0, sizeof(g_monitor.counter_percentiles));
+}
+
+// 结束统计窗口：取出并清空直方图，保存分位数（没有样本的计数器保留上一个窗口的结果）
+static void perf_close_window(void) {
+    perf_histogram_snapshot(&g_monitor.frame_time_histogram, &g_window_snapshot, true);
+    perf_histogram_get_percentiles(&g_window_snapshot, &g_monitor.frame_time_percentiles);
+    
+    for (int i = 0; i < PERF_COUNTER_COUNT; i++) {
+        perf_histogram_snapshot(&g_monitor.counter_histograms[i], &g_window_snapshot, true);
+        if (g_window_snapshot.count > 0) {
+            perf_histogram_get_percentiles(&g_window_snapshot, &g_monitor.counter_percentiles[i]);
+        }
+    }
 }
 
 // 初始化性能分析器
@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include "compositor_histogram.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -17,6 +18,12 @@ typedef enum {
     PERF_COUNTER_MEMORY_USAGE,     // 内存使用量
     PERF_COUNTER_CPU_USAGE,        // CPU使用率
     PERF_COUNTER_GPU_USAGE,        // GPU使用率
+    PERF_COUNTER_RENDER_TIME,      // 渲染时间（微秒）
+    PERF_COUNTER_INPUT_TIME,       // 输入处理时间（微秒）
+    PERF_COUNTER_INPUT_LATENCY,    // 输入延迟（微秒）
+    PERF_COUNTER_COMPOSITE_TIME,   // 合成时间（微秒）
+    PERF_COUNTER_PRESENT_TIME,     // 呈现时间（微秒）
+    PERF_COUNTER_FRAME_DROPS,      // 丢帧数
     PERF_COUNTER_COUNT             // 计数器数量
 } perf_counter_type_t;
 
@@ -32,9 +39,14 @@ struct perf_monitor {
     uint64_t counter_totals[PERF_COUNTER_COUNT]; // 计数器总计
     float counter_averages[PERF_COUNTER_COUNT]; // 计数器平均值
     float counter_peaks[PERF_COUNTER_COUNT]; // 计数器峰值
+    uint64_t measure_start[PERF_COUNTER_COUNT]; // 计时测量开始时间（微秒，0表示未开始）
     bool enabled;                      // 是否启用
     uint32_t update_interval;          // 更新间隔（帧数）
     uint32_t frame_since_update;       // 自上次更新以来的帧数
+    struct perf_histogram frame_time_histogram; // 当前统计窗口的帧时间分布（微秒）
+    struct perf_histogram counter_histograms[PERF_COUNTER_COUNT]; // 当前统计窗口的计数器分布
+    struct perf_percentiles frame_time_percentiles; // 上一个统计窗口的帧时间分位数（微秒）
+    struct perf_percentiles counter_percentiles[PERF_COUNTER_COUNT]; // 上一个统计窗口的计数器分位数
 };
 
 // 性能分析器
@@ -86,6 +98,15 @@ void perf_monitor_update_counter(perf_counter_type_t type, uint64_t value);
 // 增加计数器
 void perf_monitor_increment_counter(perf_counter_type_t type);
 
+// 设置计数器
+void perf_monitor_set_counter(perf_counter_type_t type, uint64_t value);
+
+// 开始计时测量（结果以微秒写入计数器）
+void perf_monitor_begin_measure(perf_counter_type_t type);
+
+// 结束计时测量
+void perf_monitor_end_measure(perf_counter_type_t type);
+
 // 获取当前帧率
 float perf_monitor_get_fps(void);
 
@@ -107,6 +128,18 @@ float perf_monitor_get_counter_average(perf_counter_type_t type);
 // 获取计数器峰值
 float perf_monitor_get_counter_peak(perf_counter_type_t type);
 
+// 获取上一个统计窗口的帧时间分位数（微秒，窗口为update_interval帧）
+void perf_monitor_get_frame_time_percentiles(struct perf_percentiles* percentiles);
+
+// 获取上一个统计窗口的计数器分位数
+void perf_monitor_get_counter_percentiles(perf_counter_type_t type, struct perf_percentiles* percentiles);
+
+// 无锁复制当前统计窗口的帧时间分布（不清空，可在任意线程调用）
+void perf_monitor_snapshot_frame_times(struct perf_histogram_snapshot* snapshot);
+
+// 无锁复制当前统计窗口的计数器分布
+void perf_monitor_snapshot_counter(perf_counter_type_t type, struct perf_histogram_snapshot* snapshot);
+
 // 重置性能监控器
 void perf_monitor_reset(void);
 
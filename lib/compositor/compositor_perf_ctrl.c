@@ -0,0 +1,308 @@
+#include "compositor_perf_ctrl.h"
+#include <math.h>
+#include <string.h>
+
+// 耗时估计在稳定前按样本数平均，之后按此系数指数平均
+#define PERF_CTRL_COST_ALPHA 0.1f
+// 耗时估计稳定所需的样本数（之后才限制突发样本、学习等级倍数）
+#define PERF_CTRL_STABLE_SAMPLES 8
+// 单个样本最多按估计值的多少倍计入，避免一次突发拉高估计
+#define PERF_CTRL_BURST_LIMIT 2.0f
+// 每次观测对等级倍数的修正比例（对数域）
+#define PERF_CTRL_SCALE_ALPHA 0.5f
+// 相邻等级耗时倍数的范围
+#define PERF_CTRL_MIN_RATIO 1.0f
+#define PERF_CTRL_MAX_RATIO 4.0f
+
+// 内部函数声明
+static void learn_cost(struct perf_ctrl* ctrl, float frame_cost_us);
+static void learn_level_scale(struct perf_ctrl* ctrl);
+static void enter_quality(struct perf_ctrl* ctrl, uint32_t quality, bool learn);
+static float budget_us(const struct perf_ctrl* ctrl, uint32_t fps);
+static void choose_target(const struct perf_ctrl* ctrl, float scale, uint32_t* fps, uint32_t* quality);
+static uint32_t best_quality(const struct perf_ctrl* ctrl, float budget);
+static bool is_higher(uint32_t fps_a, uint32_t quality_a, uint32_t fps_b, uint32_t quality_b);
+static void step_down(const struct perf_ctrl* ctrl, uint32_t* fps, uint32_t* quality);
+static void apply_target(struct perf_ctrl* ctrl, uint32_t fps, uint32_t quality, bool learn);
+
+// 获取默认控制器参数
+void perf_ctrl_default_config(struct perf_ctrl_config* config) {
+    memset(config, 0, sizeof(*config));
+    config->min_fps = 30;
+    config->max_fps = 60;
+    config->fps_step = 5;
+    config->quality_levels = 3;
+    config->adapt_fps = true;
+    config->adapt_quality = true;
+    config->target_utilization = 0.85f;
+    config->hysteresis = 0.15f;
+    config->kp = 0.10f;
+    config->ki = 0.05f;
+    config->down_hold_frames = 8;
+    config->up_hold_frames = 120;
+    config->level_cost_ratio = 1.3f;
+}
+
+// 初始化控制器（等级倍数从level_cost_ratio的幂开始学习）
+void perf_ctrl_init(struct perf_ctrl* ctrl, const struct perf_ctrl_config* config, uint32_t fps, uint32_t quality) {
+    memset(ctrl, 0, sizeof(*ctrl));
+    perf_ctrl_configure(ctrl, config);
+    
+    ctrl->level_scale[0] = 1.0f;
+    for (uint32_t level = 1; level < PERF_CTRL_MAX_LEVELS; level++) {
+        ctrl->level_scale[level] = ctrl->level_scale[level - 1] * ctrl->config.level_cost_ratio;
+    }
+    
+    ctrl->fps = fps;
+    ctrl->quality = quality < ctrl->config.quality_levels ? quality : ctrl->config.quality_levels - 1;
+}
+
+// 修改控制器参数（保留已学习的耗时模型）
+void perf_ctrl_configure(struct perf_ctrl* ctrl, const struct perf_ctrl_config* config) {
+    ctrl->config = *config;
+    
+    if (ctrl->config.quality_levels == 0) {
+        ctrl->config.quality_levels = 1;
+    } else if (ctrl->config.quality_levels > PERF_CTRL_MAX_LEVELS) {
+        ctrl->config.quality_levels = PERF_CTRL_MAX_LEVELS;
+    }
+    if (ctrl->config.min_fps == 0) {
+        ctrl->config.min_fps = 1;
+    }
+    if (ctrl->config.max_fps < ctrl->config.min_fps) {
+        ctrl->config.max_fps = ctrl->config.min_fps;
+    }
+    if (ctrl->config.fps_step == 0) {
+        ctrl->config.fps_step = 1;
+    }
+    if (ctrl->config.level_cost_ratio < PERF_CTRL_MIN_RATIO) {
+        ctrl->config.level_cost_ratio = PERF_CTRL_MIN_RATIO;
+    }
+}
+
+// 输入一帧的耗时（微秒），fps和quality为当前档位（被外部修改时同步），返回是否改变了档位
+bool perf_ctrl_update(struct perf_ctrl* ctrl, float frame_cost_us, bool allow_raise, uint32_t* fps, uint32_t* quality) {
+    const struct perf_ctrl_config* config = &ctrl->config;
+    
+    // 档位被外部修改（热缓解、手动设置）时从新档位重新开始计时
+    if (*fps != ctrl->fps || *quality != ctrl->quality) {
+        uint32_t level = *quality < config->quality_levels ? *quality : config->quality_levels - 1;
+        enter_quality(ctrl, level, true);
+        ctrl->fps = *fps;
+        ctrl->frames_since_change = 0;
+        ctrl->headroom_frames = 0;
+        ctrl->integral = 0.0f;
+    }
+    
+    ctrl->frames++;
+    ctrl->frames_since_change++;
+    ctrl->level_frames[ctrl->quality]++;
+    if (frame_cost_us <= 0.0f || ctrl->fps == 0) {
+        return false;
+    }
+    
+    // 误差以平滑后的耗时估计相对预算计算，单帧突发不会直接触发调整
+    learn_cost(ctrl, frame_cost_us);
+    float budget = budget_us(ctrl, ctrl->fps);
+    float error = (ctrl->cost_us - budget) / budget;
+    ctrl->error = error;
+    
+    // 积分只累积超出部分，有余量时回落，不为负（避免拖慢对过载的反应）
+    ctrl->integral += config->ki * error;
+    if (ctrl->integral < 0.0f) {
+        ctrl->integral = 0.0f;
+    } else if (ctrl->integral > 1.0f) {
+        ctrl->integral = 1.0f;
+    }
+    
+    uint32_t new_fps = ctrl->fps;
+    uint32_t new_quality = ctrl->quality;
+    
+    // 降档：明显超出立即降，小幅但持续超出由积分触发；按模型一次降到能满足预算的档位
+    if (ctrl->frames_since_change >= config->down_hold_frames && (error > config->kp || ctrl->integral >= 1.0f)) {
+        choose_target(ctrl, 1.0f, &new_fps, &new_quality);
+        if (!is_higher(ctrl->fps, ctrl->quality, new_fps, new_quality)) {
+            new_fps = ctrl->fps;
+            new_quality = ctrl->quality;
+            step_down(ctrl, &new_fps, &new_quality);
+        }
+        if (new_fps == ctrl->fps && new_quality == ctrl->quality) {
+            return false;
+        }
+        
+        // 负载突增时改变前的估计还在追赶，不用于学习等级倍数
+        apply_target(ctrl, new_fps, new_quality, error <= config->kp);
+        *fps = new_fps;
+        *quality = new_quality;
+        return true;
+    }
+    
+    // 升档：余量超过滞后区间并持续一段时间后才升，目标也按滞后区间留出余量
+    if (error < -config->hysteresis) {
+        ctrl->headroom_frames++;
+    } else {
+        ctrl->headroom_frames = 0;
+    }
+    if (!allow_raise || ctrl->headroom_frames < config->up_hold_frames ||
+        ctrl->frames_since_change < config->up_hold_frames) {
+        return false;
+    }
+    
+    choose_target(ctrl, 1.0f - config->hysteresis, &new_fps, &new_quality);
+    if (!is_higher(new_fps, new_quality, ctrl->fps, ctrl->quality)) {
+        ctrl->headroom_frames = 0;
+        return false;
+    }
+    
+    apply_target(ctrl, new_fps, new_quality, true);
+    *fps = new_fps;
+    *quality = new_quality;
+    return true;
+}
+
+// 按耗时模型预测某质量等级在当前场景负载下的帧耗时（微秒）：当前估计按等级倍数换算
+float perf_ctrl_predict_cost(const struct perf_ctrl* ctrl, uint32_t quality) {
+    if (quality >= ctrl->config.quality_levels) {
+        quality = ctrl->config.quality_levels - 1;
+    }
+    return ctrl->cost_us / ctrl->level_scale[ctrl->quality] * ctrl->level_scale[quality];
+}
+
+// 更新当前质量等级的耗时估计
+static void learn_cost(struct perf_ctrl* ctrl, float frame_cost_us) {
+    if (ctrl->cost_samples >= PERF_CTRL_STABLE_SAMPLES && frame_cost_us > ctrl->cost_us * PERF_CTRL_BURST_LIMIT) {
+        frame_cost_us = ctrl->cost_us * PERF_CTRL_BURST_LIMIT;
+    }
+    
+    // 刚进入等级时按样本数平均，几帧内收敛到实测值
+    float alpha = 1.0f / (ctrl->cost_samples + 1);
+    if (alpha < PERF_CTRL_COST_ALPHA) {
+        alpha = PERF_CTRL_COST_ALPHA;
+    }
+    ctrl->cost_us += alpha * (frame_cost_us - ctrl->cost_us);
+    ctrl->cost_samples++;
+    
+    if (ctrl->learn_pending && ctrl->cost_samples >= PERF_CTRL_STABLE_SAMPLES) {
+        learn_level_scale(ctrl);
+        ctrl->learn_pending = false;
+    }
+}
+
+// 用改变质量等级前后的耗时估计修正较高等级的倍数（其上各等级一起移动，保持相对关系）
+static void learn_level_scale(struct perf_ctrl* ctrl) {
+    uint32_t from = ctrl->exit_quality;
+    uint32_t to = ctrl->quality;
+    if (from == to || ctrl->exit_cost_us <= 0.0f) {
+        return;
+    }
+    
+    uint32_t high = to > from ? to : from;
+    uint32_t low = to > from ? from : to;
+    float cost_high = to > from ? ctrl->cost_us : ctrl->exit_cost_us;
+    float cost_low = to > from ? ctrl->exit_cost_us : ctrl->cost_us;
+    
+    float observed = cost_high / cost_low;
+    float modeled = ctrl->level_scale[high] / ctrl->level_scale[low];
+    float correction = powf(observed / modeled, PERF_CTRL_SCALE_ALPHA);
+    
+    // 当前等级的倍数改变时耗时估计不变，预测其他等级时随之换算
+    for (uint32_t level = high; level < PERF_CTRL_MAX_LEVELS; level++) {
+        ctrl->level_scale[level] *= correction;
+    }
+    
+    // 保持相邻等级的倍数在合理范围内
+    for (uint32_t level = 1; level < PERF_CTRL_MAX_LEVELS; level++) {
+        float min_scale = ctrl->level_scale[level - 1] * PERF_CTRL_MIN_RATIO;
+        float max_scale = ctrl->level_scale[level - 1] * PERF_CTRL_MAX_RATIO;
+        if (ctrl->level_scale[level] < min_scale) {
+            ctrl->level_scale[level] = min_scale;
+        } else if (ctrl->level_scale[level] > max_scale) {
+            ctrl->level_scale[level] = max_scale;
+        }
+    }
+}
+
+// 切换质量等级：记录旧等级的估计用于学习，新等级从模型预测开始
+static void enter_quality(struct perf_ctrl* ctrl, uint32_t quality, bool learn) {
+    if (quality == ctrl->quality) {
+        return;
+    }
+    
+    if (learn && ctrl->cost_samples >= PERF_CTRL_STABLE_SAMPLES) {
+        ctrl->exit_cost_us = ctrl->cost_us;
+        ctrl->exit_quality = ctrl->quality;
+        ctrl->learn_pending = true;
+    } else {
+        ctrl->learn_pending = false;
+    }
+    
+    // 预测值只算一个样本，第一帧实测后即占一半权重
+    if (ctrl->cost_samples > 0) {
+        ctrl->cost_us = perf_ctrl_predict_cost(ctrl, quality);
+        ctrl->cost_samples = 1;
+    }
+    ctrl->quality = quality;
+}
+
+// 帧率对应的耗时预算（微秒）
+static float budget_us(const struct perf_ctrl* ctrl, uint32_t fps) {
+    return 1000000.0f / fps * ctrl->config.target_utilization;
+}
+
+// 选择预测耗时不超过预算（乘以scale）的最高档位：优先帧率，其次质量
+static void choose_target(const struct perf_ctrl* ctrl, float scale, uint32_t* fps, uint32_t* quality) {
+    const struct perf_ctrl_config* config = &ctrl->config;
+    
+    if (!config->adapt_fps) {
+        *fps = ctrl->fps;
+        *quality = config->adapt_quality ? best_quality(ctrl, budget_us(ctrl, ctrl->fps) * scale) : ctrl->quality;
+        return;
+    }
+    
+    // 帧率只能在允许的最低质量下满足时才选择，都不满足时使用最小帧率
+    uint32_t lowest_quality = config->adapt_quality ? 0 : ctrl->quality;
+    uint32_t candidate = config->max_fps;
+    while (candidate > config->min_fps &&
+           perf_ctrl_predict_cost(ctrl, lowest_quality) > budget_us(ctrl, candidate) * scale) {
+        candidate = candidate > config->min_fps + config->fps_step ? candidate - config->fps_step : config->min_fps;
+    }
+    
+    *fps = candidate;
+    *quality = config->adapt_quality ? best_quality(ctrl, budget_us(ctrl, candidate) * scale) : ctrl->quality;
+}
+
+// 预测耗时不超过预算的最高质量等级
+static uint32_t best_quality(const struct perf_ctrl* ctrl, float budget) {
+    for (uint32_t level = ctrl->config.quality_levels; level > 0; level--) {
+        if (perf_ctrl_predict_cost(ctrl, level - 1) <= budget) {
+            return level - 1;
+        }
+    }
+    return 0;
+}
+
+// 比较档位：帧率优先，其次质量
+static bool is_higher(uint32_t fps_a, uint32_t quality_a, uint32_t fps_b, uint32_t quality_b) {
+    return fps_a > fps_b || (fps_a == fps_b && quality_a > quality_b);
+}
+
+// 模型认为当前档位可以满足但积分持续超出时降一级：先降质量，其次帧率
+static void step_down(const struct perf_ctrl* ctrl, uint32_t* fps, uint32_t* quality) {
+    const struct perf_ctrl_config* config = &ctrl->config;
+    
+    if (config->adapt_quality && *quality > 0) {
+        (*quality)--;
+    } else if (config->adapt_fps && *fps > config->min_fps) {
+        *fps = *fps > config->min_fps + config->fps_step ? *fps - config->fps_step : config->min_fps;
+    }
+}
+
+// 应用新档位并重新开始计时
+static void apply_target(struct perf_ctrl* ctrl, uint32_t fps, uint32_t quality, bool learn) {
+    enter_quality(ctrl, quality, learn);
+    ctrl->fps = fps;
+    ctrl->frames_since_change = 0;
+    ctrl->headroom_frames = 0;
+    ctrl->integral = 0.0f;
+    ctrl->changes++;
+}
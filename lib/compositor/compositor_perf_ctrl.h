@@ -0,0 +1,70 @@
+#ifndef COMPOSITOR_PERF_CTRL_H
+#define COMPOSITOR_PERF_CTRL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 支持的质量等级数上限
+#define PERF_CTRL_MAX_LEVELS 8
+
+// 控制器参数
+struct perf_ctrl_config {
+    uint32_t min_fps;              // 最小帧率
+    uint32_t max_fps;              // 最大帧率
+    uint32_t fps_step;             // 帧率档位间隔
+    uint32_t quality_levels;       // 质量等级数
+    bool adapt_fps;                // 是否调整帧率
+    bool adapt_quality;            // 是否调整质量
+    float target_utilization;      // 帧耗时占帧间隔的目标比例
+    float hysteresis;              // 提高档位时要求的额外余量（目标比例的份额）
+    float kp;                      // 比例项：平滑误差超过此值立即降档
+    float ki;                      // 积分项增益：持续小幅超出累积到1时降档
+    uint32_t down_hold_frames;     // 改变档位后至少经过的帧数才能再次降档
+    uint32_t up_hold_frames;       // 持续有余量的帧数达到此值才能升档
+    float level_cost_ratio;        // 相邻质量等级耗时比例的初始估计
+};
+
+// 控制器状态（纯计算，不访问时钟和全局状态，可离线回放帧耗时记录）
+struct perf_ctrl {
+    struct perf_ctrl_config config;
+    float level_scale[PERF_CTRL_MAX_LEVELS];      // 各质量等级相对等级0的耗时倍数（在线学习）
+    uint64_t level_frames[PERF_CTRL_MAX_LEVELS];  // 各质量等级停留的帧数
+    float cost_us;                 // 当前质量等级的帧耗时估计（指数平均）
+    uint32_t cost_samples;         // 当前质量等级的样本数
+    float exit_cost_us;            // 上次改变质量等级前的帧耗时估计
+    uint32_t exit_quality;         // 上次改变前的质量等级
+    bool learn_pending;            // 新等级的估计稳定后据此学习一次倍数
+    float error;                   // 相对误差：(耗时估计 - 预算) / 预算
+    float integral;                // 误差积分（带抗饱和限制）
+    uint32_t fps;                  // 当前帧率
+    uint32_t quality;              // 当前质量等级
+    uint32_t frames_since_change;  // 距上次改变档位的帧数
+    uint32_t headroom_frames;      // 连续有余量的帧数
+    uint64_t frames;
+    uint64_t changes;
+};
+
+// 获取默认控制器参数
+void perf_ctrl_default_config(struct perf_ctrl_config* config);
+
+// 初始化控制器
+void perf_ctrl_init(struct perf_ctrl* ctrl, const struct perf_ctrl_config* config, uint32_t fps, uint32_t quality);
+
+// 修改控制器参数（保留已学习的耗时模型）
+void perf_ctrl_configure(struct perf_ctrl* ctrl, const struct perf_ctrl_config* config);
+
+// 输入一帧的耗时（微秒），fps和quality为当前档位（被外部修改时同步），返回是否改变了档位
+bool perf_ctrl_update(struct perf_ctrl* ctrl, float frame_cost_us, bool allow_raise, uint32_t* fps, uint32_t* quality);
+
+// 按耗时模型预测某质量等级在当前场景负载下的帧耗时（微秒）
+float perf_ctrl_predict_cost(const struct perf_ctrl* ctrl, uint32_t quality);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COMPOSITOR_PERF_CTRL_H
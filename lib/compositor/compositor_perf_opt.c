@@ -1,6 +1,9 @@
 #include "compositor_perf_opt.h"
 #include "compositor.h"
 #include "compositor_perf.h"
+#include "compositor_cpu_sampler.h"
+#include "compositor_thermal.h"
+#include "compositor_perf_ctrl.h"
 #include "compositor_render.h"
 #include "compositor_resource_manager.h"
 #include <android/log.h>
@@ -14,8 +17,15 @@
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
 #define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
 
+// 热状态下两次降低帧率/质量的最小间隔（纳秒）
+#define THERMAL_STEP_INTERVAL_NS 5000000000ULL
+
 // 性能优化状态
 static struct perf_opt_state g_perf_opt_state = {0};
+// 自适应帧率/质量控制器
+static struct perf_ctrl g_controller;
+// 热状态名称
+static const char* g_thermal_state_names[] = {"NORMAL", "WARNING", "THROTTLING", "CRITICAL"};
 
 // 回调函数
 static perf_opt_callback_t g_callback = NULL;
@@ -23,18 +33,17 @@ static void* g_callback_user_data = NULL;
 
 // 内部函数声明
 static void update_performance_stats(void);
-static void adjust_fps(void);
-static void adjust_render_quality(void);
+static void adjust_fps_and_quality(void);
+static void configure_controller(void);
 static void check_thermal_state(void);
+static thermal_state_t estimate_thermal_state_from_usage(void);
+static void apply_thermal_mitigation(void);
 static void apply_profile_settings(perf_profile_t profile);
 static uint64_t get_current_time(void);
 static bool is_performance_acceptable(void);
-static bool is_performance_poor(void);
-static bool is_performance_excellent(void);
-static void increase_fps(void);
 static void decrease_fps(void);
-static void increase_quality(void);
 static void decrease_quality(void);
+static void apply_target_fps(uint32_t fps);
 
 // 初始化性能优化模块
 int perf_opt_init(void) {
@@ -70,6 +79,7 @@ int perf_opt_init(void) {
     g_perf_opt_state.render_settings.quality_levels = 3;
     g_perf_opt_state.render_settings.current_quality = 2; // 中等质量
     g_perf_opt_state.render_settings.dirty_regions = true;
+    g_perf_opt_state.render_settings.dirty_tiles = false;
     g_perf_opt_state.render_settings.occlusion_culling = true;
     g_perf_opt_state.render_settings.frustum_culling = true;
     g_perf_opt_state.render_settings.level_of_detail = true;
@@ -87,9 +97,21 @@ int perf_opt_init(void) {
     
     g_perf_opt_state.initialized = true;
     
+    // 初始化热调节器并启动采样线程，找不到温区时按CPU/GPU使用率估计热状态
+    if (thermal_governor_init(NULL) != 0 || thermal_governor_start() != 0) {
+        LOGI("Thermal zones unavailable, estimating thermal state from CPU/GPU usage");
+    }
+    
     // 应用默认配置文件设置
     apply_profile_settings(g_perf_opt_state.profile);
     
+    // 初始化控制器（参数每次更新时从当前设置同步）
+    struct perf_ctrl_config ctrl_config;
+    perf_ctrl_default_config(&ctrl_config);
+    perf_ctrl_init(&g_controller, &ctrl_config, g_perf_opt_state.current_target_fps,
+                   g_perf_opt_state.render_settings.current_quality);
+    configure_controller();
+    
     LOGI("Performance optimization module initialized");
     return 0;
 }
@@ -100,6 +122,8 @@ void perf_opt_destroy(void) {
         return;
     }
     
+    thermal_governor_destroy();
+    
     g_perf_opt_state.initialized = false;
     g_callback = NULL;
     g_callback_user_data = NULL;
@@ -122,14 +146,9 @@ void perf_opt_update(void) {
     // 检查热状态
     check_thermal_state();
     
-    // 调整帧率
-    if (g_perf_opt_state.fps_settings.enabled) {
-        adjust_fps();
-    }
-    
-    // 调整渲染质量
-    if (g_perf_opt_state.render_settings.adaptive_quality) {
-        adjust_render_quality();
+    // 调整帧率和渲染质量
+    if (g_perf_opt_state.fps_settings.enabled || g_perf_opt_state.render_settings.adaptive_quality) {
+        adjust_fps_and_quality();
     }
     
     // 调用回调函数
@@ -210,6 +229,24 @@ bool perf_opt_is_adaptive_fps_enabled(void) {
     return g_perf_opt_state.fps_settings.enabled;
 }
 
+// 设置目标帧率（控制器下次更新时从此帧率继续调整）
+int perf_opt_set_target_fps(uint32_t fps) {
+    if (fps < g_perf_opt_state.fps_settings.min_fps || fps > g_perf_opt_state.fps_settings.max_fps) {
+        LOGE("Invalid target FPS: %u (range: %u-%u)", fps, g_perf_opt_state.fps_settings.min_fps,
+             g_perf_opt_state.fps_settings.max_fps);
+        return -1;
+    }
+    
+    apply_target_fps(fps);
+    LOGI("Target FPS set to %u", fps);
+    return 0;
+}
+
+// 获取当前目标帧率
+uint32_t perf_opt_get_target_fps(void) {
+    return g_perf_opt_state.current_target_fps;
+}
+
 // 设置渲染优化设置
 void perf_opt_set_render_opt(const struct render_opt_settings* settings) {
     if (!settings) {
@@ -221,6 +258,7 @@ void perf_opt_set_render_opt(const struct render_opt_settings* settings) {
     
     // 应用渲染设置
     renderer_set_dirty_regions_enabled(g_perf_opt_state.render_settings.dirty_regions);
+    renderer_set_dirty_tiles_enabled(g_perf_opt_state.render_settings.dirty_tiles);
     
     LOGI("Render optimization settings updated");
 }
@@ -277,6 +315,18 @@ bool perf_opt_is_dirty_regions_enabled(void) {
     return g_perf_opt_state.render_settings.dirty_regions;
 }
 
+// 启用/禁用瓦片位图脏区域跟踪
+void perf_opt_set_dirty_tiles_enabled(bool enabled) {
+    g_perf_opt_state.render_settings.dirty_tiles = enabled;
+    renderer_set_dirty_tiles_enabled(enabled);
+    LOGI("Dirty tiles %s", enabled ? "enabled" : "disabled");
+}
+
+// 检查瓦片位图脏区域跟踪是否启用
+bool perf_opt_is_dirty_tiles_enabled(void) {
+    return g_perf_opt_state.render_settings.dirty_tiles;
+}
+
 // 启用/禁用遮挡剔除
 void perf_opt_set_occlusion_culling_enabled(bool enabled) {
     g_perf_opt_state.render_settings.occlusion_culling = enabled;
@@ -369,6 +419,24 @@ thermal_state_t perf_opt_get_thermal_state(void) {
     return g_perf_opt_state.thermal_state;
 }
 
+// 设置热调节器读取的sysfs根目录（默认/sys，可指向结构相同的目录树）
+int perf_opt_set_thermal_sysfs_root(const char* root) {
+    if (!g_perf_opt_state.initialized) {
+        LOGE("Performance optimization module not initialized");
+        return -1;
+    }
+    
+    thermal_governor_destroy();
+    if (thermal_governor_init(root) != 0) {
+        LOGE("No usable thermal zones under %s", root ? root : "/sys");
+        return -1;
+    }
+    if (thermal_governor_start() != 0) {
+        return -1;
+    }
+    return 0;
+}
+
 // 获取当前帧率
 float perf_opt_get_current_fps(void) {
     return g_perf_opt_state.current_fps;
@@ -394,6 +462,32 @@ uint64_t perf_opt_get_memory_usage(void) {
     return g_perf_opt_state.memory_usage;
 }
 
+// 获取性能优化统计（包括帧时间尾延迟）
+int perf_opt_get_stats(struct perf_opt_stats* stats) {
+    if (!stats) {
+        return -1;
+    }
+    
+    memset(stats, 0, sizeof(struct perf_opt_stats));
+    stats->profile = g_perf_opt_state.profile;
+    stats->thermal_state = g_perf_opt_state.thermal_state;
+    stats->current_fps = g_perf_opt_state.current_fps;
+    stats->avg_frame_time = g_perf_opt_state.avg_frame_time;
+    stats->cpu_usage = g_perf_opt_state.cpu_usage;
+    stats->gpu_usage = g_perf_opt_state.gpu_usage;
+    stats->memory_usage = g_perf_opt_state.memory_usage;
+    stats->target_fps = g_perf_opt_state.budget.target_fps;
+    stats->quality_level = g_perf_opt_state.render_settings.current_quality;
+    stats->performance_issues = g_perf_opt_state.performance_issues;
+    stats->adjustment_count = g_perf_opt_state.adjustment_count;
+    
+    // 分位数由性能监控器在每个统计窗口结束时计算
+    perf_monitor_get_frame_time_percentiles(&stats->frame_time);
+    perf_monitor_get_counter_percentiles(PERF_COUNTER_RENDER_TIME, &stats->render_time);
+    
+    return 0;
+}
+
 // 重置性能优化统计
 void perf_opt_reset_stats(void) {
     g_perf_opt_state.frame_count = 0;
@@ -421,12 +515,8 @@ void perf_opt_unregister_callback(perf_opt_callback_t callback) {
 
 // 手动触发性能调整
 void perf_opt_trigger_adjustment(void) {
-    if (g_perf_opt_state.fps_settings.enabled) {
-        adjust_fps();
-    }
-    
-    if (g_perf_opt_state.render_settings.adaptive_quality) {
-        adjust_render_quality();
+    if (g_perf_opt_state.fps_settings.enabled || g_perf_opt_state.render_settings.adaptive_quality) {
+        adjust_fps_and_quality();
     }
     
     LOGI("Manual performance adjustment triggered");
@@ -450,15 +540,46 @@ int perf_opt_load_settings(const char* path) {
 void perf_opt_print_status(void) {
     LOGI("Performance Optimization Status:");
     LOGI("  Profile: %d", g_perf_opt_state.profile);
-    LOGI("  Thermal State: %d", g_perf_opt_state.thermal_state);
+    LOGI("  Thermal State: %s", g_thermal_state_names[g_perf_opt_state.thermal_state]);
+    
+    if (thermal_governor_is_available()) {
+        struct thermal_governor_stats thermal;
+        thermal_governor_get_stats(&thermal);
+        LOGI("    %s %.1f C, headroom %.1f C, trend %+.2f C/s, CPU freq %.0f%% (cap %.0f%%)",
+             thermal.zone, thermal.temp_c, thermal.headroom_c, -thermal.trend_c_per_s,
+             thermal.freq_ratio * 100.0f, thermal.freq_cap_ratio * 100.0f);
+        if (thermal.time_to_throttle_s >= 0.0f) {
+            LOGI("    Throttling expected in %.0f s", thermal.time_to_throttle_s);
+        }
+    }
     LOGI("  Current FPS: %.2f", g_perf_opt_state.current_fps);
     LOGI("  Avg Frame Time: %.2f ms", g_perf_opt_state.avg_frame_time);
+    
+    struct perf_percentiles frame_time;
+    perf_monitor_get_frame_time_percentiles(&frame_time);
+    if (frame_time.count > 0) {
+        LOGI("  Frame Time p50/p95/p99/p99.9: %.2f/%.2f/%.2f/%.2f ms",
+             frame_time.p50 / 1000.0f, frame_time.p95 / 1000.0f,
+             frame_time.p99 / 1000.0f, frame_time.p999 / 1000.0f);
+    }
     LOGI("  CPU Usage: %.2f%%", g_perf_opt_state.cpu_usage);
+    
+    // 占用最高的几个线程
+    struct cpu_thread_stats threads[4];
+    uint32_t thread_count = cpu_sampler_get_threads(threads, 4);
+    for (uint32_t i = 0; i < thread_count; i++) {
+        LOGI("    %-15s %5.1f%% (wait %.1f ms/s, %.1f preemptions/s)", threads[i].name,
+             threads[i].cpu_percent, threads[i].runqueue_wait_ms, threads[i].involuntary_switches);
+    }
     LOGI("  GPU Usage: %.2f%%", g_perf_opt_state.gpu_usage);
     LOGI("  Memory Usage: %llu MB", (unsigned long long)(g_perf_opt_state.memory_usage / 1024 / 1024));
     LOGI("  Adaptive FPS: %s", g_perf_opt_state.fps_settings.enabled ? "enabled" : "disabled");
     LOGI("  Adaptive Quality: %s", g_perf_opt_state.render_settings.adaptive_quality ? "enabled" : "disabled");
     LOGI("  Quality Level: %u/%u", g_perf_opt_state.render_settings.current_quality, g_perf_opt_state.render_settings.quality_levels - 1);
+    LOGI("  Target FPS: %u", g_perf_opt_state.current_target_fps);
+    LOGI("  Controller: estimate %.2f ms, error %+.1f%%, integral %.2f, %llu changes",
+         g_controller.cost_us / 1000.0f, g_controller.error * 100.0f, g_controller.integral,
+         (unsigned long long)g_controller.changes);
 }
 
 // 内部函数实现
@@ -474,83 +595,147 @@ static void update_performance_stats(void) {
     // 更新性能统计
     g_perf_opt_state.current_fps = perf_monitor_get_fps();
     g_perf_opt_state.avg_frame_time = perf_monitor_get_avg_frame_time();
-    g_perf_opt_state.cpu_usage = perf_monitor_get_counter_average(PERF_COUNTER_CPU_USAGE);
-    g_perf_opt_state.gpu_usage = perf_monitor_get_counter_average(PERF_COUNTER_GPU_USAGE);
+    
+    // 使用率须反映当前负载：计数器平均值是整个进程生命周期的累计平均，几乎不变。
+    // CPU直接取采样线程最近一个周期的结果，GPU取上一个统计窗口的均值
+    struct perf_percentiles gpu_window;
+    perf_monitor_get_counter_percentiles(PERF_COUNTER_GPU_USAGE, &gpu_window);
+    g_perf_opt_state.cpu_usage = cpu_sampler_get_process_usage();
+    g_perf_opt_state.gpu_usage = gpu_window.count > 0 ? gpu_window.mean : (float)perf_monitor_get_counter(PERF_COUNTER_GPU_USAGE);
     g_perf_opt_state.memory_usage = perf_monitor_get_counter(PERF_COUNTER_MEMORY_USAGE);
     
     // 更新最后统计时间
     g_perf_opt_state.last_stats_update = current_time;
 }
 
-static void adjust_fps(void) {
-    // 检查是否可以调整（限制调整频率）
-    uint64_t current_time = get_current_time();
-    if (current_time - g_perf_opt_state.last_adjustment_time < 5000000ULL) { // 5秒
+static void adjust_fps_and_quality(void) {
+    // 上一帧的渲染耗时（微秒），与帧调度器使用同一个测量
+    uint64_t render_time_us = perf_monitor_get_counter(PERF_COUNTER_RENDER_TIME);
+    if (render_time_us == 0) {
         return;
     }
     
-    // 根据性能调整帧率
-    if (is_performance_poor()) {
-        decrease_fps();
-    } else if (is_performance_excellent()) {
-        increase_fps();
+    configure_controller();
+    
+    // 热状态不正常时只降不升
+    uint32_t fps = g_perf_opt_state.current_target_fps;
+    uint32_t quality = g_perf_opt_state.render_settings.current_quality;
+    bool allow_raise = g_perf_opt_state.thermal_state == THERMAL_STATE_NORMAL;
+    if (!perf_ctrl_update(&g_controller, (float)render_time_us, allow_raise, &fps, &quality)) {
+        return;
     }
     
-    // 更新最后调整时间
-    g_perf_opt_state.last_adjustment_time = current_time;
+    if (fps != g_perf_opt_state.current_target_fps) {
+        apply_target_fps(fps);
+        LOGI("Adjusted target FPS to %u", fps);
+    }
+    if (quality != g_perf_opt_state.render_settings.current_quality) {
+        perf_opt_set_quality_level(quality);
+    }
+    
+    g_perf_opt_state.adjustment_count++;
+    g_perf_opt_state.last_adjustment_time = get_current_time();
 }
 
-static void adjust_render_quality(void) {
-    // 检查是否可以调整（限制调整频率）
-    uint64_t current_time = get_current_time();
-    if (current_time - g_perf_opt_state.last_adjustment_time < 5000000ULL) { // 5秒
-        return;
+static void configure_controller(void) {
+    struct perf_ctrl_config config;
+    perf_ctrl_default_config(&config);
+    
+    // 帧率范围、档位间隔、目标占用率和升档前的稳定帧数沿用自适应帧率设置
+    config.min_fps = g_perf_opt_state.fps_settings.min_fps;
+    config.max_fps = g_perf_opt_state.fps_settings.max_fps;
+    config.fps_step = (uint32_t)g_perf_opt_state.fps_settings.fps_step_down;
+    config.target_utilization = g_perf_opt_state.fps_settings.performance_threshold;
+    config.up_hold_frames = g_perf_opt_state.fps_settings.stable_frames;
+    config.quality_levels = g_perf_opt_state.render_settings.quality_levels;
+    config.adapt_fps = g_perf_opt_state.fps_settings.enabled;
+    config.adapt_quality = g_perf_opt_state.render_settings.adaptive_quality;
+    
+    perf_ctrl_configure(&g_controller, &config);
+}
+
+static void check_thermal_state(void) {
+    thermal_state_t state;
+    
+    // 优先使用采样线程发布的温区余量和趋势，读取不到时（例如受SELinux限制）按使用率估计
+    if (thermal_governor_get_state(&state) != 0) {
+        state = estimate_thermal_state_from_usage();
     }
     
-    // 根据性能调整渲染质量
-    if (is_performance_poor()) {
-        decrease_quality();
-    } else if (is_performance_excellent()) {
-        increase_quality();
+    if (state != g_perf_opt_state.thermal_state) {
+        g_perf_opt_state.thermal_state = state;
+        g_perf_opt_state.last_thermal_step = 0; // 状态变化后立即调整
+        LOGI("Thermal state changed to %s", g_thermal_state_names[state]);
     }
     
-    // 更新最后调整时间
-    g_perf_opt_state.last_adjustment_time = current_time;
+    apply_thermal_mitigation();
 }
 
-static void check_thermal_state(void) {
-    // 简化的热状态检查，实际应用中应该从系统获取温度信息
+static thermal_state_t estimate_thermal_state_from_usage(void) {
+    // 没有温度信息时的近似：持续高负载通常意味着发热
     if (g_perf_opt_state.cpu_usage > 90.0f || g_perf_opt_state.gpu_usage > 90.0f) {
-        if (g_perf_opt_state.thermal_state != THERMAL_STATE_CRITICAL) {
-            g_perf_opt_state.thermal_state = THERMAL_STATE_CRITICAL;
-            LOGI("Thermal state changed to CRITICAL");
-            
+        return THERMAL_STATE_CRITICAL;
+    } else if (g_perf_opt_state.cpu_usage > 80.0f || g_perf_opt_state.gpu_usage > 80.0f) {
+        return THERMAL_STATE_THROTTLING;
+    } else if (g_perf_opt_state.cpu_usage > 70.0f || g_perf_opt_state.gpu_usage > 70.0f) {
+        return THERMAL_STATE_WARNING;
+    }
+    return THERMAL_STATE_NORMAL;
+}
+
+static void apply_thermal_mitigation(void) {
+    thermal_state_t state = g_perf_opt_state.thermal_state;
+    if (state == THERMAL_STATE_NORMAL) {
+        return;
+    }
+    
+    // 限制降级频率，给温度留出响应时间
+    uint64_t current_time = get_current_time();
+    if (g_perf_opt_state.last_thermal_step != 0 &&
+        current_time - g_perf_opt_state.last_thermal_step < THERMAL_STEP_INTERVAL_NS) {
+        return;
+    }
+    
+    bool fps_enabled = g_perf_opt_state.fps_settings.enabled;
+    bool quality_enabled = g_perf_opt_state.render_settings.adaptive_quality;
+    
+    switch (state) {
+        case THERMAL_STATE_CRITICAL:
             // 在危险状态下，强制降低性能
-            if (g_perf_opt_state.fps_settings.enabled) {
-                uint32_t min_fps = g_perf_opt_state.fps_settings.min_fps;
-                renderer_set_target_fps(min_fps);
+            if (fps_enabled) {
+                apply_target_fps(g_perf_opt_state.fps_settings.min_fps);
             }
-            
-            if (g_perf_opt_state.render_settings.adaptive_quality) {
+            if (quality_enabled) {
                 perf_opt_set_quality_level(0); // 最低质量
             }
-        }
-    } else if (g_perf_opt_state.cpu_usage > 80.0f || g_perf_opt_state.gpu_usage > 80.0f) {
-        if (g_perf_opt_state.thermal_state != THERMAL_STATE_THROTTLING) {
-            g_perf_opt_state.thermal_state = THERMAL_STATE_THROTTLING;
-            LOGI("Thermal state changed to THROTTLING");
-        }
-    } else if (g_perf_opt_state.cpu_usage > 70.0f || g_perf_opt_state.gpu_usage > 70.0f) {
-        if (g_perf_opt_state.thermal_state != THERMAL_STATE_WARNING) {
-            g_perf_opt_state.thermal_state = THERMAL_STATE_WARNING;
-            LOGI("Thermal state changed to WARNING");
-        }
-    } else {
-        if (g_perf_opt_state.thermal_state != THERMAL_STATE_NORMAL) {
-            g_perf_opt_state.thermal_state = THERMAL_STATE_NORMAL;
-            LOGI("Thermal state changed to NORMAL");
-        }
+            break;
+            
+        case THERMAL_STATE_THROTTLING:
+            // 即将或已经被内核限频：帧率和质量各降一级
+            if (fps_enabled) {
+                decrease_fps();
+            }
+            if (quality_enabled) {
+                decrease_quality();
+            }
+            break;
+            
+        case THERMAL_STATE_WARNING:
+            // 余量不多且仍在升温时先降质量，在内核节流之前降低发热
+            if (quality_enabled && thermal_governor_is_available()) {
+                struct thermal_governor_stats thermal;
+                thermal_governor_get_stats(&thermal);
+                if (thermal.trend_c_per_s < 0.0f) {
+                    decrease_quality();
+                }
+            }
+            break;
+            
+        default:
+            break;
     }
+    
+    g_perf_opt_state.last_thermal_step = current_time;
 }
 
 static void apply_profile_settings(perf_profile_t profile) {
@@ -603,7 +788,7 @@ static void apply_profile_settings(perf_profile_t profile) {
     }
     
     // 应用设置
-    renderer_set_target_fps(g_perf_opt_state.budget.target_fps);
+    apply_target_fps(g_perf_opt_state.budget.target_fps);
     renderer_set_quality_level(g_perf_opt_state.render_settings.current_quality);
     
     LOGI("Applied performance profile %d", profile);
@@ -624,39 +809,8 @@ static bool is_performance_acceptable(void) {
             g_perf_opt_state.memory_usage <= g_perf_opt_state.budget.max_memory_usage);
 }
 
-static bool is_performance_poor(void) {
-    // 检查性能是否差
-    return (g_perf_opt_state.current_fps < g_perf_opt_state.budget.min_fps * 0.8f ||
-            g_perf_opt_state.avg_frame_time > g_perf_opt_state.budget.max_frame_time * 1.2f ||
-            g_perf_opt_state.cpu_usage > g_perf_opt_state.budget.max_cpu_usage * 1.1f ||
-            g_perf_opt_state.gpu_usage > g_perf_opt_state.budget.max_gpu_usage * 1.1f);
-}
-
-static bool is_performance_excellent(void) {
-    // 检查性能是否优秀
-    return (g_perf_opt_state.current_fps > g_perf_opt_state.budget.target_fps * 0.9f &&
-            g_perf_opt_state.avg_frame_time < 1000.0f / (g_perf_opt_state.budget.target_fps * 0.9f) &&
-            g_perf_opt_state.cpu_usage < g_perf_opt_state.budget.max_cpu_usage * 0.7f &&
-            g_perf_opt_state.gpu_usage < g_perf_opt_state.budget.max_gpu_usage * 0.7f);
-}
-
-static void increase_fps(void) {
-    uint32_t current_fps = renderer_get_target_fps();
-    uint32_t new_fps = current_fps + (uint32_t)g_perf_opt_state.fps_settings.fps_step_up;
-    
-    if (new_fps > g_perf_opt_state.fps_settings.max_fps) {
-        new_fps = g_perf_opt_state.fps_settings.max_fps;
-    }
-    
-    if (new_fps != current_fps) {
-        renderer_set_target_fps(new_fps);
-        g_perf_opt_state.adjustment_count++;
-        LOGI("Increased target FPS to %u", new_fps);
-    }
-}
-
 static void decrease_fps(void) {
-    uint32_t current_fps = renderer_get_target_fps();
+    uint32_t current_fps = g_perf_opt_state.current_target_fps;
     uint32_t new_fps = current_fps - (uint32_t)g_perf_opt_state.fps_settings.fps_step_down;
     
     if (new_fps < g_perf_opt_state.fps_settings.min_fps) {
@@ -664,27 +818,12 @@ static void decrease_fps(void) {
     }
     
     if (new_fps != current_fps) {
-        renderer_set_target_fps(new_fps);
+        apply_target_fps(new_fps);
         g_perf_opt_state.adjustment_count++;
         LOGI("Decreased target FPS to %u", new_fps);
     }
 }
 
-static void increase_quality(void) {
-    uint32_t current_quality = g_perf_opt_state.render_settings.current_quality;
-    uint32_t new_quality = current_quality + 1;
-    
-    if (new_quality >= g_perf_opt_state.render_settings.quality_levels) {
-        new_quality = g_perf_opt_state.render_settings.quality_levels - 1;
-    }
-    
-    if (new_quality != current_quality) {
-        perf_opt_set_quality_level(new_quality);
-        g_perf_opt_state.adjustment_count++;
-        LOGI("Increased quality level to %u", new_quality);
-    }
-}
-
 static void decrease_quality(void) {
     uint32_t current_quality = g_perf_opt_state.render_settings.current_quality;
     
@@ -696,56 +835,8 @@ static void decrease_quality(void) {
     }
 }
 
-// 添加缺失的renderer_set_*和renderer_get_*函数实现
-static void renderer_set_target_fps(uint32_t fps) {
-    // 实际实现应该调用渲染器的设置目标帧率函数
-    LOGI("Setting target FPS to %u", fps);
+// 记录目标帧率并通知渲染器（帧调度器由合成器每帧按perf_opt_get_target_fps同步）
+static void apply_target_fps(uint32_t fps) {
+    g_perf_opt_state.current_target_fps = fps;
+    renderer_set_target_fps(fps);
 }
-
-static uint32_t renderer_get_target_fps(void) {
-    // 实际实现应该调用渲染器的获取目标帧率函数
-    return 60; // 返回默认值
-}
-
-static void renderer_set_quality_level(uint32_t level) {
-    // 实际实现应该调用渲染器的设置质量等级函数
-    LOGI("Setting quality level to %u", level);
-}
-
-static void renderer_set_dirty_regions_enabled(bool enabled) {
-    // 实际实现应该调用渲染器的设置脏区域优化函数
-    LOGI("Setting dirty regions %s", enabled ? "enabled" : "disabled");
-}
-
-// 添加缺失的perf_monitor_get_*函数实现
-static float perf_monitor_get_fps(void) {
-    // 实际实现应该调用性能监控器的获取帧率函数
-    return 60.0f; // 返回默认值
-}
-
-static float perf_monitor_get_avg_frame_time(void) {
-    // 实际实现应该调用性能监控器的获取平均帧时间函数
-    return 16.67f; // 返回60FPS对应的帧时间
-}
-
-static float perf_monitor_get_counter_average(perf_counter_t counter) {
-    // 实际实现应该调用性能监控器的获取计数器平均值函数
-    switch (counter) {
-        case PERF_COUNTER_CPU_USAGE:
-            return 50.0f; // 返回默认CPU使用率
-        case PERF_COUNTER_GPU_USAGE:
-            return 40.0f; // 返回默认GPU使用率
-        default:
-            return 0.0f;
-    }
-}
-
-static uint64_t perf_monitor_get_counter(perf_counter_t counter) {
-    // 实际实现应该调用性能监控器的获取计数器值函数
-    switch (counter) {
-        case PERF_COUNTER_MEMORY_USAGE:
-            return 256 * 1024 * 1024; // 返回默认内存使用量256MB
-        default:
-            return 0;
-    }
-}
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include "compositor_histogram.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -51,6 +52,7 @@ struct render_opt_settings {
     uint32_t quality_levels;      // 质量等级数
     uint32_t current_quality;     // 当前质量等级
     bool dirty_regions;           // 脏区域优化
+    bool dirty_tiles;             // 使用瓦片位图跟踪脏区域
     bool occlusion_culling;       // 遮挡剔除
     bool frustum_culling;         // 视锥剔除
     bool level_of_detail;         // LOD优化
@@ -80,6 +82,25 @@ struct perf_opt_state {
     uint32_t adjustment_count;     // 调整计数
     uint64_t last_adjustment_time; // 上次调整时间
     uint64_t last_stats_update;    // 上次统计更新时间
+    uint64_t last_thermal_step;    // 上次因热状态降低帧率/质量的时间
+    uint32_t current_target_fps;   // 当前目标帧率（自适应调整后）
+};
+
+// 性能优化统计
+struct perf_opt_stats {
+    perf_profile_t profile;        // 当前性能配置文件
+    thermal_state_t thermal_state; // 当前热状态
+    float current_fps;             // 当前帧率
+    float avg_frame_time;          // 平均帧时间(毫秒)
+    float cpu_usage;               // CPU使用率
+    float gpu_usage;               // GPU使用率
+    uint64_t memory_usage;         // 内存使用量
+    uint32_t target_fps;           // 目标帧率
+    uint32_t quality_level;        // 当前质量等级
+    uint32_t performance_issues;   // 性能问题计数
+    uint32_t adjustment_count;     // 调整计数
+    struct perf_percentiles frame_time;  // 上一个统计窗口的帧时间分位数(微秒)
+    struct perf_percentiles render_time; // 上一个统计窗口的渲染时间分位数(微秒)
 };
 
 // 性能优化回调
@@ -118,6 +139,12 @@ void perf_opt_set_adaptive_fps_enabled(bool enabled);
 // 检查自适应帧率是否启用
 bool perf_opt_is_adaptive_fps_enabled(void);
 
+// 设置目标帧率（在自适应帧率的最小和最大帧率之间）
+int perf_opt_set_target_fps(uint32_t fps);
+
+// 获取当前目标帧率
+uint32_t perf_opt_get_target_fps(void);
+
 // 设置渲染优化设置
 void perf_opt_set_render_opt(const struct render_opt_settings* settings);
 
@@ -142,6 +169,12 @@ void perf_opt_set_dirty_regions_enabled(bool enabled);
 // 检查脏区域优化是否启用
 bool perf_opt_is_dirty_regions_enabled(void);
 
+// 启用/禁用瓦片位图脏区域跟踪
+void perf_opt_set_dirty_tiles_enabled(bool enabled);
+
+// 检查瓦片位图脏区域跟踪是否启用
+bool perf_opt_is_dirty_tiles_enabled(void);
+
 // 启用/禁用遮挡剔除
 void perf_opt_set_occlusion_culling_enabled(bool enabled);
 
@@ -187,6 +220,9 @@ uint32_t perf_opt_get_texture_cache_size(void);
 // 获取热状态
 thermal_state_t perf_opt_get_thermal_state(void);
 
+// 设置热调节器读取的sysfs根目录（默认/sys，可指向结构相同的目录树）
+int perf_opt_set_thermal_sysfs_root(const char* root);
+
 // 获取当前帧率
 float perf_opt_get_current_fps(void);
 
@@ -202,6 +238,9 @@ float perf_opt_get_gpu_usage(void);
 // 获取内存使用量
 uint64_t perf_opt_get_memory_usage(void);
 
+// 获取性能优化统计（包括帧时间尾延迟）
+int perf_opt_get_stats(struct perf_opt_stats* stats);
+
 // 重置性能优化统计
 void perf_opt_reset_stats(void);
 
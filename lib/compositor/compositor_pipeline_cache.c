@@ -0,0 +1,160 @@
+#include "compositor_pipeline_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <android/log.h>
+
+#define LOG_TAG "PipelineCache"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+// 计算缓存数据校验和（FNV-1a）
+uint32_t pipeline_cache_checksum(const uint8_t* data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// 用设备属性填充文件头（校验和与数据大小由写入方填写）
+void pipeline_cache_init_header(struct pipeline_cache_file_header* header, uint32_t vendor_id, uint32_t device_id,
+                                uint32_t driver_version, const uint8_t* uuid) {
+    memset(header, 0, sizeof(*header));
+    header->magic = PIPELINE_CACHE_MAGIC;
+    header->version = PIPELINE_CACHE_FILE_VERSION;
+    header->vendor_id = vendor_id;
+    header->device_id = device_id;
+    header->driver_version = driver_version;
+    memcpy(header->uuid, uuid, PIPELINE_CACHE_UUID_SIZE);
+}
+
+// 读取并校验缓存文件，有效时返回缓存数据（调用者释放）
+void* pipeline_cache_read_file(const char* path, const struct pipeline_cache_file_header* expected, size_t* size,
+                               uint32_t* checksum) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        if (errno != ENOENT) {
+            LOGE("Failed to open pipeline cache %s: %s", path, strerror(errno));
+        }
+        return NULL;
+    }
+    
+    // 驱动或设备变化后旧缓存无效
+    struct pipeline_cache_file_header header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        header.magic != expected->magic ||
+        header.version != expected->version ||
+        header.vendor_id != expected->vendor_id ||
+        header.device_id != expected->device_id ||
+        header.driver_version != expected->driver_version ||
+        memcmp(header.uuid, expected->uuid, PIPELINE_CACHE_UUID_SIZE) != 0 ||
+        header.data_size < PIPELINE_CACHE_VK_HEADER_SIZE ||
+        header.data_size > PIPELINE_CACHE_MAX_SIZE) {
+        LOGI("Pipeline cache header mismatch, starting cold");
+        fclose(file);
+        return NULL;
+    }
+    
+    uint8_t* data = (uint8_t*)malloc((size_t)header.data_size);
+    if (!data) {
+        fclose(file);
+        return NULL;
+    }
+    
+    if (fread(data, 1, (size_t)header.data_size, file) != header.data_size ||
+        pipeline_cache_checksum(data, (size_t)header.data_size) != header.checksum) {
+        LOGI("Pipeline cache data corrupted, starting cold");
+        free(data);
+        fclose(file);
+        return NULL;
+    }
+    
+    fclose(file);
+    
+    // 再校验数据内的Vulkan头部，避免把不兼容的数据交给驱动
+    uint32_t vk_header[4];
+    memcpy(vk_header, data, sizeof(vk_header));
+    if (vk_header[0] < PIPELINE_CACHE_VK_HEADER_SIZE ||
+        vk_header[1] != PIPELINE_CACHE_VK_HEADER_VERSION_ONE ||
+        vk_header[2] != expected->vendor_id ||
+        vk_header[3] != expected->device_id ||
+        memcmp(data + 16, expected->uuid, PIPELINE_CACHE_UUID_SIZE) != 0) {
+        LOGI("Pipeline cache Vulkan header mismatch, starting cold");
+        free(data);
+        return NULL;
+    }
+    
+    *size = (size_t)header.data_size;
+    if (checksum) {
+        *checksum = header.checksum;
+    }
+    return data;
+}
+
+// 原子写入缓存文件（先写临时文件再重命名）
+int pipeline_cache_write_file(const char* path, const struct pipeline_cache_file_header* header,
+                              const void* data, size_t size) {
+    char tmp_path[PIPELINE_CACHE_PATH_SIZE + 8];
+    int len = snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    if (len < 0 || (size_t)len >= sizeof(tmp_path)) {
+        LOGE("Pipeline cache path too long: %s", path);
+        return -1;
+    }
+    
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        LOGE("Failed to create %s: %s", tmp_path, strerror(errno));
+        return -1;
+    }
+    
+    const struct {
+        const void* ptr;
+        size_t len;
+    } parts[2] = {
+        { header, sizeof(*header) },
+        { data, size }
+    };
+    
+    for (int i = 0; i < 2; i++) {
+        const uint8_t* ptr = (const uint8_t*)parts[i].ptr;
+        size_t remaining = parts[i].len;
+        
+        while (remaining > 0) {
+            ssize_t written = write(fd, ptr, remaining);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                LOGE("Failed to write %s: %s", tmp_path, strerror(errno));
+                close(fd);
+                unlink(tmp_path);
+                return -1;
+            }
+            ptr += written;
+            remaining -= (size_t)written;
+        }
+    }
+    
+    // 落盘后再替换，断电时不会留下半个文件
+    if (fsync(fd) != 0) {
+        LOGE("Failed to sync %s: %s", tmp_path, strerror(errno));
+        close(fd);
+        unlink(tmp_path);
+        return -1;
+    }
+    
+    close(fd);
+    
+    if (rename(tmp_path, path) != 0) {
+        LOGE("Failed to rename %s: %s", tmp_path, strerror(errno));
+        unlink(tmp_path);
+        return -1;
+    }
+    
+    return 0;
+}
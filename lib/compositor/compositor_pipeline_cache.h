@@ -0,0 +1,56 @@
+#ifndef COMPOSITOR_PIPELINE_CACHE_H
+#define COMPOSITOR_PIPELINE_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 管线缓存文件魔数（"VKPC"）和格式版本
+#define PIPELINE_CACHE_MAGIC 0x43504B56u
+#define PIPELINE_CACHE_FILE_VERSION 1
+// 管线缓存文件大小上限
+#define PIPELINE_CACHE_MAX_SIZE (64u * 1024u * 1024u)
+// 缓存文件路径长度上限
+#define PIPELINE_CACHE_PATH_SIZE 256
+// 驱动的pipelineCacheUUID长度（与VK_UUID_SIZE相同）
+#define PIPELINE_CACHE_UUID_SIZE 16
+// 缓存数据开头的Vulkan头部（VkPipelineCacheHeaderVersionOne）大小和版本
+#define PIPELINE_CACHE_VK_HEADER_SIZE (16 + PIPELINE_CACHE_UUID_SIZE)
+#define PIPELINE_CACHE_VK_HEADER_VERSION_ONE 1
+
+// 管线缓存文件头（以驱动UUID和驱动版本为键）
+struct pipeline_cache_file_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vendor_id;
+    uint32_t device_id;
+    uint32_t driver_version;
+    uint32_t checksum;          // 缓存数据的FNV-1a校验和
+    uint64_t data_size;
+    uint8_t uuid[PIPELINE_CACHE_UUID_SIZE];
+};
+
+// 计算缓存数据校验和（FNV-1a）
+uint32_t pipeline_cache_checksum(const uint8_t* data, size_t size);
+
+// 用设备属性填充文件头（校验和与数据大小由写入方填写）
+void pipeline_cache_init_header(struct pipeline_cache_file_header* header, uint32_t vendor_id, uint32_t device_id,
+                                uint32_t driver_version, const uint8_t* uuid);
+
+// 读取并校验缓存文件（文件头与expected的设备键一致、校验和正确、数据内的Vulkan头部匹配），
+// 有效时返回缓存数据（调用者释放），否则返回NULL
+void* pipeline_cache_read_file(const char* path, const struct pipeline_cache_file_header* expected, size_t* size,
+                               uint32_t* checksum);
+
+// 原子写入缓存文件（先写临时文件并落盘再重命名，失败时保留旧文件）
+int pipeline_cache_write_file(const char* path, const struct pipeline_cache_file_header* header,
+                              const void* data, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COMPOSITOR_PIPELINE_CACHE_H
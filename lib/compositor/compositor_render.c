@@ -1,5 +1,4 @@
 #include "compositor_render.h"
-#include "compositor_render_opt.h"
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -26,7 +25,6 @@ static struct {
 // 内部函数声明
 static void renderer_update_stats(void);
 static uint64_t renderer_get_time(void);
-static void renderer_merge_dirty_regions(void);
 static void renderer_apply_state_cache(void);
 static void renderer_set_texture(uint32_t texture);
 static void renderer_set_opacity(float opacity);
@@ -56,6 +54,8 @@ int renderer_init(int screen_width, int screen_height) {
         g_renderer.layers[i].type = (render_layer_type_t)i;
         g_renderer.layers[i].visible = true;
         g_renderer.layers[i].opacity = 1.0f;
+        // 离屏缓存需要调用方提供合成管线，默认关闭，由renderer_set_layer_cached按层启用
+        g_renderer.layers[i].cached = false;
     }
     
     // 初始化渲染优化模块
@@ -110,14 +110,6 @@ struct render_target* renderer_create_target(int width, int height) {
 void renderer_destroy_target(struct render_target* target) {
     if (!target) return;
     
-    // 清除脏区域
-    struct dirty_region* region = target->dirty_regions;
-    while (region) {
-        struct dirty_region* next = region->next;
-        free(region);
-        region = next;
-    }
-    
     // 实际实现中应销毁纹理
     if (target->texture) {
         // glDeleteTextures(1, &target->texture);
@@ -200,62 +192,22 @@ void renderer_mark_dirty(int x, int y, int width, int height) {
         return;
     }
     
-    // 使用优化的脏区域管理器
+    // 脏区域只保存在渲染优化模块中，裁剪和合并都在那里完成
     for (int i = 0; i < RENDER_LAYER_COUNT; i++) {
         if (g_renderer.layers[i].visible) {
             render_opt_mark_dirty((render_layer_type_t)i, x, y, width, height);
         }
     }
-    
-    // 保留原有的脏区域列表实现作为备用
-    // 裁剪到屏幕范围
-    if (x < 0) {
-        width += x;
-        x = 0;
-    }
-    if (y < 0) {
-        height += y;
-        y = 0;
-    }
-    if (x + width > g_screen_width) {
-        width = g_screen_width - x;
-    }
-    if (y + height > g_screen_height) {
-        height = g_screen_height - y;
-    }
-    
-    if (width <= 0 || height <= 0) {
-        return;
-    }
-    
-    // 创建新的脏区域
-    struct dirty_region* region = (struct dirty_region*)malloc(sizeof(struct dirty_region));
-    if (!region) {
-        LOGE("Failed to allocate memory for dirty region");
+}
+
+// 只标记单个层的区域为脏（其他层的离屏缓存不受影响）
+void renderer_mark_layer_dirty(render_layer_type_t layer, int x, int y, int width, int height) {
+    if (!g_renderer.dirty_regions_enabled || layer < 0 || layer >= RENDER_LAYER_COUNT) {
         return;
     }
     
-    region->x = x;
-    region->y = y;
-    region->width = width;
-    region->height = height;
-    
-    // 添加到所有可见层的脏区域列表
-    for (int i = 0; i < RENDER_LAYER_COUNT; i++) {
-        if (g_renderer.layers[i].visible) {
-            // 为每个层创建一个脏区域副本
-            if (i == 0) {
-                region->next = g_renderer.layers[i].dirty_regions;
-                g_renderer.layers[i].dirty_regions = region;
-            } else {
-                struct dirty_region* copy = (struct dirty_region*)malloc(sizeof(struct dirty_region));
-                if (copy) {
-                    *copy = *region;
-                    copy->next = g_renderer.layers[i].dirty_regions;
-                    g_renderer.layers[i].dirty_regions = copy;
-                }
-            }
-        }
+    if (g_renderer.layers[layer].visible) {
+        render_opt_mark_dirty(layer, x, y, width, height);
     }
 }
 
@@ -265,8 +217,22 @@ void renderer_mark_target_dirty(struct render_target* target) {
     
     target->dirty = true;
     
-    // 标记整个目标区域为脏
-    renderer_mark_dirty(0, 0, target->width, target->height);
+    // 只标记包含该目标的层，不在任何层中时标记所有层
+    bool found = false;
+    for (int i = 0; i < RENDER_LAYER_COUNT; i++) {
+        struct render_layer* l = &g_renderer.layers[i];
+        for (uint32_t j = 0; j < l->target_count; j++) {
+            if (l->targets[j].id == target->id) {
+                renderer_mark_layer_dirty((render_layer_type_t)i, 0, 0, target->width, target->height);
+                found = true;
+                break;
+            }
+        }
+    }
+    
+    if (!found) {
+        renderer_mark_dirty(0, 0, target->width, target->height);
+    }
 }
 
 // 清除脏区域
@@ -275,17 +241,24 @@ void renderer_clear_dirty_regions(void) {
     for (int i = 0; i < RENDER_LAYER_COUNT; i++) {
         render_opt_clear_dirty_regions((render_layer_type_t)i);
     }
+}
+
+// 检查是否有待绘制的脏区域
+bool renderer_has_damage(void) {
+    return render_opt_has_damage();
+}
+
+// 获取层的脏区域（只读，下次标记或清除前有效）
+const struct dirty_region* renderer_get_dirty_regions(render_layer_type_t layer, uint32_t* count) {
+    if (count) {
+        *count = 0;
+    }
     
-    // 保留原有的脏区域列表实现作为备用
-    for (int i = 0; i < RENDER_LAYER_COUNT; i++) {
-        struct dirty_region* region = g_renderer.layers[i].dirty_regions;
-        while (region) {
-            struct dirty_region* next = region->next;
-            free(region);
-            region = next;
-        }
-        g_renderer.layers[i].dirty_regions = NULL;
+    if (layer < 0 || layer >= RENDER_LAYER_COUNT) {
+        return NULL;
     }
+    
+    return render_opt_peek_dirty_regions(layer, count);
 }
 
 // 设置层可见性
@@ -309,6 +282,48 @@ void renderer_set_layer_opacity(render_layer_type_t layer, float opacity) {
     g_renderer.layers[layer].opacity = opacity;
 }
 
+// 设置层是否使用离屏缓存
+void renderer_set_layer_cached(render_layer_type_t layer, bool cached) {
+    if (layer < 0 || layer >= RENDER_LAYER_COUNT) {
+        return;
+    }
+    
+    g_renderer.layers[layer].cached = cached;
+}
+
+// 检查层是否使用离屏缓存
+bool renderer_is_layer_cached(render_layer_type_t layer) {
+    if (layer < 0 || layer >= RENDER_LAYER_COUNT) {
+        return false;
+    }
+    
+    return g_renderer.layers[layer].cached;
+}
+
+// 检查层是否有需要绘制的内容
+bool renderer_layer_has_content(render_layer_type_t layer) {
+    if (layer < 0 || layer >= RENDER_LAYER_COUNT) {
+        return false;
+    }
+    
+    const struct render_layer* l = &g_renderer.layers[layer];
+    return l->visible && l->opacity > 0.0f && l->target_count > 0;
+}
+
+// 设置屏幕尺寸
+void renderer_set_size(int screen_width, int screen_height) {
+    if (screen_width <= 0 || screen_height <= 0) {
+        return;
+    }
+    
+    g_screen_width = screen_width;
+    g_screen_height = screen_height;
+    
+    if (render_opt_resize(screen_width, screen_height) != 0) {
+        LOGE("Failed to resize render optimization module to %dx%d", screen_width, screen_height);
+    }
+}
+
 // 设置垂直同步
 void renderer_set_vsync(bool enabled) {
     g_renderer.vsync_enabled = enabled;
@@ -327,11 +342,29 @@ void renderer_set_target_fps(uint32_t fps) {
     g_renderer.target_fps = fps;
 }
 
+// 设置质量等级
+void renderer_set_quality_level(uint32_t level) {
+    if (g_renderer.quality_level != level) {
+        LOGI("Quality level %u -> %u", g_renderer.quality_level, level);
+        g_renderer.quality_level = level;
+    }
+}
+
+// 获取质量等级
+uint32_t renderer_get_quality_level(void) {
+    return g_renderer.quality_level;
+}
+
 // 启用/禁用脏区域优化
 void renderer_set_dirty_regions_enabled(bool enabled) {
     g_renderer.dirty_regions_enabled = enabled;
 }
 
+// 启用/禁用瓦片位图脏区域跟踪
+void renderer_set_dirty_tiles_enabled(bool enabled) {
+    render_opt_set_damage_backend(enabled ? RENDER_DAMAGE_BACKEND_TILES : RENDER_DAMAGE_BACKEND_RECTS);
+}
+
 // 启用/禁用多线程渲染
 void renderer_set_multithreading_enabled(bool enabled) {
     g_renderer.multithreading_enabled = enabled;
@@ -356,11 +389,6 @@ int renderer_begin_frame(void) {
     g_renderer.stats.triangles = 0;
     g_renderer.stats.texture_switches = 0;
     
-    // 合并脏区域
-    if (g_renderer.dirty_regions_enabled) {
-        renderer_merge_dirty_regions();
-    }
-    
     return 0;
 }
 
@@ -392,9 +420,9 @@ int renderer_render_layer(render_layer_type_t layer) {
     // 设置层状态
     // 实际实现中应设置OpenGL/Vulkan状态
     
-    // 获取优化的脏区域
-    struct dirty_region dirty_regions[16];
-    uint32_t dirty_count = render_opt_get_dirty_regions(layer, dirty_regions, 16);
+    // 获取优化的脏区域（直接读取渲染优化模块中的数据，无需复制）
+    uint32_t dirty_count = 0;
+    render_opt_peek_dirty_regions(layer, &dirty_count);
     
     // 如果没有脏区域且启用了脏区域优化，则跳过渲染
     if (g_renderer.dirty_regions_enabled && dirty_count == 0) {
@@ -541,50 +569,6 @@ static uint64_t renderer_get_time(void) {
     return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
 }
 
-// 内部函数：合并脏区域
-static void renderer_merge_dirty_regions(void) {
-    for (int i = 0; i < RENDER_LAYER_COUNT; i++) {
-        struct render_layer* layer = &g_renderer.layers[i];
-        
-        if (!layer->visible) {
-            continue;
-        }
-        
-        // 简化实现：合并所有脏区域为一个大的脏区域
-        struct dirty_region* region = layer->dirty_regions;
-        if (!region) {
-            continue;
-        }
-        
-        int min_x = region->x;
-        int min_y = region->y;
-        int max_x = region->x + region->width;
-        int max_y = region->y + region->height;
-        
-        while (region) {
-            if (region->x < min_x) min_x = region->x;
-            if (region->y < min_y) min_y = region->y;
-            if (region->x + region->width > max_x) max_x = region->x + region->width;
-            if (region->y + region->height > max_y) max_y = region->y + region->height;
-            
-            struct dirty_region* next = region->next;
-            free(region);
-            region = next;
-        }
-        
-        // 创建合并后的脏区域
-        struct dirty_region* merged = (struct dirty_region*)malloc(sizeof(struct dirty_region));
-        if (merged) {
-            merged->x = min_x;
-            merged->y = min_y;
-            merged->width = max_x - min_x;
-            merged->height = max_y - min_y;
-            merged->next = NULL;
-            layer->dirty_regions = merged;
-        }
-    }
-}
-
 // 新增API：设置批处理启用状态
 void renderer_set_batching_enabled(render_layer_type_t layer, bool enabled) {
     if (layer < 0 || layer >= RENDER_LAYER_COUNT) {
@@ -621,6 +605,15 @@ void renderer_set_merge_threshold(render_layer_type_t layer, float threshold) {
     render_opt_set_merge_threshold(layer, threshold);
 }
 
+// 新增API：设置脏区域合并代价模型
+void renderer_set_merge_cost(render_layer_type_t layer, uint32_t region_limit, uint32_t rect_cost) {
+    if (layer < 0 || layer >= RENDER_LAYER_COUNT) {
+        return;
+    }
+    
+    render_opt_set_merge_cost(layer, region_limit, rect_cost);
+}
+
 // 新增API：添加绘制调用
 void renderer_add_draw_call(render_layer_type_t layer, const struct draw_call* draw_call) {
     if (layer < 0 || layer >= RENDER_LAYER_COUNT) {
@@ -5,37 +5,19 @@
 #include <stdint.h>
 #include <stddef.h>
 
-// 前向声明，避免循环依赖
-struct draw_call;
-struct render_opt_stats;
+// 渲染层类型、脏区域、绘制调用等类型统一由渲染优化模块定义
+#include "compositor_render_opt.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// 渲染层类型
-typedef enum {
-    RENDER_LAYER_BACKGROUND,  // 背景层
-    RENDER_LAYER_WINDOW,      // 窗口层
-    RENDER_LAYER_UI,          // UI层
-    RENDER_LAYER_OVERLAY,     // 覆盖层
-    RENDER_LAYER_COUNT        // 层数量
-} render_layer_type_t;
-
-// 脏区域结构
-struct dirty_region {
-    int x, y;                 // 区域位置
-    int width, height;        // 区域大小
-    struct dirty_region* next; // 下一个脏区域
-};
-
 // 渲染目标
 struct render_target {
     uint32_t id;              // 目标ID
     uint32_t texture;         // 纹理ID
     int width, height;        // 目标大小
     bool dirty;               // 是否需要更新
-    struct dirty_region* dirty_regions; // 脏区域列表
 };
 
 // 渲染层
@@ -45,6 +27,7 @@ struct render_layer {
     uint32_t target_count;    // 目标数量
     bool visible;             // 是否可见
     float opacity;            // 不透明度
+    bool cached;              // 渲染到独立的离屏缓存，只在本层有损伤时重建
 };
 
 // 渲染统计
@@ -58,26 +41,6 @@ struct render_stats {
     float gpu_time;           // GPU时间
 };
 
-// 绘制调用结构
-struct draw_call {
-    void* texture;      // 纹理指针
-    void* shader;       // 着色器指针
-    uint32_t vertex_count;  // 顶点数量
-    uint32_t index_count;   // 索引数量
-    int blend_mode;     // 混合模式
-    float transform[16]; // 变换矩阵
-};
-
-// 渲染优化统计
-struct render_opt_stats {
-    uint32_t dirty_region_count;
-    uint32_t total_dirty_area;
-    uint32_t draw_call_count;
-    bool batching_enabled;
-    bool state_sorting_enabled;
-    bool culling_enabled;
-};
-
 // 渲染器状态
 struct renderer {
     struct render_layer layers[RENDER_LAYER_COUNT]; // 渲染层
@@ -86,6 +49,7 @@ struct renderer {
     bool vsync_enabled;       // 是否启用垂直同步
     uint32_t max_fps;         // 最大帧率
     uint32_t target_fps;      // 目标帧率
+    uint32_t quality_level;   // 性能优化模块选定的质量等级
     uint64_t last_frame_time; // 上一帧时间
     bool dirty_regions_enabled; // 是否启用脏区域优化
     bool multithreading_enabled; // 是否启用多线程渲染
@@ -112,18 +76,39 @@ int renderer_remove_target_from_layer(struct render_target* target, render_layer
 // 标记区域为脏
 void renderer_mark_dirty(int x, int y, int width, int height);
 
+// 只标记单个层的区域为脏（其他层的离屏缓存不受影响）
+void renderer_mark_layer_dirty(render_layer_type_t layer, int x, int y, int width, int height);
+
 // 标记目标为脏
 void renderer_mark_target_dirty(struct render_target* target);
 
 // 清除脏区域
 void renderer_clear_dirty_regions(void);
 
+// 检查是否有待绘制的脏区域
+bool renderer_has_damage(void);
+
+// 获取层的脏区域（只读，下次标记或清除前有效）
+const struct dirty_region* renderer_get_dirty_regions(render_layer_type_t layer, uint32_t* count);
+
 // 设置层可见性
 void renderer_set_layer_visibility(render_layer_type_t layer, bool visible);
 
 // 设置层不透明度
 void renderer_set_layer_opacity(render_layer_type_t layer, float opacity);
 
+// 设置层是否使用离屏缓存
+void renderer_set_layer_cached(render_layer_type_t layer, bool cached);
+
+// 检查层是否使用离屏缓存
+bool renderer_is_layer_cached(render_layer_type_t layer);
+
+// 检查层是否有需要绘制的内容（可见、不透明度大于0且有渲染目标）
+bool renderer_layer_has_content(render_layer_type_t layer);
+
+// 设置屏幕尺寸
+void renderer_set_size(int screen_width, int screen_height);
+
 // 设置垂直同步
 void renderer_set_vsync(bool enabled);
 
@@ -133,9 +118,16 @@ void renderer_set_max_fps(uint32_t fps);
 // 设置目标帧率
 void renderer_set_target_fps(uint32_t fps);
 
+// 设置/获取质量等级
+void renderer_set_quality_level(uint32_t level);
+uint32_t renderer_get_quality_level(void);
+
 // 启用/禁用脏区域优化
 void renderer_set_dirty_regions_enabled(bool enabled);
 
+// 启用/禁用瓦片位图脏区域跟踪
+void renderer_set_dirty_tiles_enabled(bool enabled);
+
 // 启用/禁用多线程渲染
 void renderer_set_multithreading_enabled(bool enabled);
 
@@ -171,6 +163,7 @@ void renderer_set_batching_enabled(render_layer_type_t layer, bool enabled);
 void renderer_set_state_sorting_enabled(render_layer_type_t layer, bool enabled);
 void renderer_set_culling_enabled(render_layer_type_t layer, bool enabled);
 void renderer_set_merge_threshold(render_layer_type_t layer, float threshold);
+void renderer_set_merge_cost(render_layer_type_t layer, uint32_t region_limit, uint32_t rect_cost);
 void renderer_add_draw_call(render_layer_type_t layer, const struct draw_call* draw_call);
 void renderer_get_opt_stats(render_layer_type_t layer, struct render_opt_stats* stats);
 
@@ -8,14 +8,32 @@
 #define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
 #define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
 
+// 每层默认最多保留的脏矩形数量
+#define RENDER_OPT_DEFAULT_REGION_LIMIT 8
+// 默认单个矩形的绘制开销（折算为像素数，约等于一个64x64的区域）
+#define RENDER_OPT_DEFAULT_RECT_COST 4096
+
 // 全局渲染优化状态
 static struct render_opt_state g_render_opt = {0};
 
 // 内部函数声明
+static int dirty_region_manager_init(struct dirty_region_manager* manager);
+static void dirty_region_manager_destroy(struct dirty_region_manager* manager);
 static void dirty_region_manager_merge_regions(struct dirty_region_manager* manager);
 static bool dirty_region_manager_intersect(const struct dirty_region* a, const struct dirty_region* b);
 static void dirty_region_manager_union(struct dirty_region* a, const struct dirty_region* b);
-static void dirty_region_manager_optimize_regions(struct dirty_region_manager* manager);
+static bool dirty_region_manager_contains(const struct dirty_region* outer, const struct dirty_region* inner);
+static int64_t dirty_region_manager_merge_cost(const struct dirty_region_manager* manager,
+                                               const struct dirty_region* a, const struct dirty_region* b);
+static int dirty_region_manager_insert(struct dirty_region_manager* manager, const struct dirty_region* region);
+static void dirty_region_manager_merge_cheapest_pair(struct dirty_region_manager* manager);
+static void dirty_region_manager_remove(struct dirty_region_manager* manager, uint32_t index);
+static uint32_t dirty_region_area(const struct dirty_region* region);
+static void dirty_region_manager_finish(struct dirty_region_manager* manager);
+static void dirty_region_manager_rebuild_from_tiles(struct dirty_region_manager* manager);
+static void dirty_region_manager_ensure_regions(struct dirty_region_manager* manager);
+static void dirty_region_manager_invalidate(struct dirty_region_manager* manager);
+static void dirty_region_manager_span_callback(void* user_data, int x, int y, int width, int height);
 static void render_pipeline_optimize_batch(struct render_pipeline* pipeline);
 static void render_pipeline_sort_draw_calls(struct render_pipeline* pipeline);
 static bool draw_call_compare(const struct draw_call* a, const struct draw_call* b);
@@ -33,21 +51,20 @@ int render_opt_init(int screen_width, int screen_height) {
     
     // 初始化脏区域管理器
     for (int i = 0; i < RENDER_LAYER_COUNT; i++) {
-        g_render_opt.dirty_managers[i].region_count = 0;
-        g_render_opt.dirty_managers[i].max_regions = 32;
-        g_render_opt.dirty_managers[i].regions = (struct dirty_region*)calloc(
-            g_render_opt.dirty_managers[i].max_regions, sizeof(struct dirty_region));
-        
-        if (!g_render_opt.dirty_managers[i].regions) {
+        if (dirty_region_manager_init(&g_render_opt.dirty_managers[i]) != 0) {
             LOGE("Failed to allocate memory for dirty regions");
             render_opt_destroy();
             return -1;
         }
-        
-        g_render_opt.dirty_managers[i].total_dirty_area = 0;
-        g_render_opt.dirty_managers[i].merge_threshold = 0.5f; // 50%的屏幕面积阈值
     }
     
+    if (dirty_region_manager_init(&g_render_opt.screen_manager) != 0) {
+        LOGE("Failed to allocate memory for screen dirty regions");
+        render_opt_destroy();
+        return -1;
+    }
+    g_render_opt.damage_backend = RENDER_DAMAGE_BACKEND_RECTS;
+    
     // 初始化渲染管道
     for (int i = 0; i < RENDER_LAYER_COUNT; i++) {
         g_render_opt.pipelines[i].draw_calls = NULL;
@@ -80,9 +97,9 @@ void render_opt_destroy(void) {
     
     // 释放脏区域管理器
     for (int i = 0; i < RENDER_LAYER_COUNT; i++) {
-        free(g_render_opt.dirty_managers[i].regions);
-        g_render_opt.dirty_managers[i].regions = NULL;
+        dirty_region_manager_destroy(&g_render_opt.dirty_managers[i]);
     }
+    dirty_region_manager_destroy(&g_render_opt.screen_manager);
     
     // 释放渲染管道
     for (int i = 0; i < RENDER_LAYER_COUNT; i++) {
@@ -94,6 +111,40 @@ void render_opt_destroy(void) {
     LOGI("Render optimization module destroyed");
 }
 
+// 调整屏幕尺寸（初始化时尺寸可能未知，瓦片位图在此时分配），之后整屏标记为脏
+int render_opt_resize(int screen_width, int screen_height) {
+    if (!g_render_opt.initialized || screen_width <= 0 || screen_height <= 0) {
+        return -1;
+    }
+    
+    g_render_opt.screen_width = screen_width;
+    g_render_opt.screen_height = screen_height;
+    
+    int result = 0;
+    for (int i = 0; i < RENDER_LAYER_COUNT; i++) {
+        struct dirty_region_manager* manager = &g_render_opt.dirty_managers[i];
+        manager->region_count = 0;
+        manager->total_dirty_area = 0;
+        dirty_region_manager_invalidate(manager);
+        if (damage_tiles_resize(&manager->tiles, screen_width, screen_height) != 0) {
+            result = -1;
+        }
+    }
+    
+    g_render_opt.screen_manager.region_count = 0;
+    g_render_opt.screen_manager.total_dirty_area = 0;
+    g_render_opt.screen_manager.regions_valid = false;
+    if (damage_tiles_resize(&g_render_opt.screen_manager.tiles, screen_width, screen_height) != 0) {
+        result = -1;
+    }
+    
+    for (int i = 0; i < RENDER_LAYER_COUNT; i++) {
+        render_opt_mark_dirty((render_layer_type_t)i, 0, 0, screen_width, screen_height);
+    }
+    
+    return result;
+}
+
 // 标记区域为脏（优化版本）
 void render_opt_mark_dirty(render_layer_type_t layer, int x, int y, int width, int height) {
     if (!g_render_opt.initialized || layer < 0 || layer >= RENDER_LAYER_COUNT) {
@@ -121,37 +172,21 @@ void render_opt_mark_dirty(render_layer_type_t layer, int x, int y, int width, i
     }
     
     struct dirty_region_manager* manager = &g_render_opt.dirty_managers[layer];
+    dirty_region_manager_invalidate(manager);
     
-    // 检查是否需要扩展区域数组
-    if (manager->region_count >= manager->max_regions) {
-        uint32_t new_max = manager->max_regions * 2;
-        struct dirty_region* new_regions = (struct dirty_region*)realloc(
-            manager->regions, new_max * sizeof(struct dirty_region));
-        
-        if (!new_regions) {
-            LOGE("Failed to expand dirty regions array");
-            return;
-        }
-        
-        manager->regions = new_regions;
-        manager->max_regions = new_max;
+    // 瓦片后端只需置位，矩形在读取时才生成
+    if (g_render_opt.damage_backend == RENDER_DAMAGE_BACKEND_TILES) {
+        damage_tiles_mark_rect(&manager->tiles, x, y, width, height);
+        return;
     }
     
-    // 添加新的脏区域
-    struct dirty_region* region = &manager->regions[manager->region_count++];
-    region->x = x;
-    region->y = y;
-    region->width = width;
-    region->height = height;
-    
-    // 更新总脏区域面积
-    manager->total_dirty_area += width * height;
-    
-    // 如果脏区域面积超过阈值，则合并所有区域
-    float screen_area = g_render_opt.screen_width * g_render_opt.screen_height;
-    if (manager->total_dirty_area > screen_area * manager->merge_threshold) {
-        dirty_region_manager_merge_regions(manager);
+    // 增量插入：新矩形按代价模型与已有矩形合并
+    struct dirty_region region = {x, y, width, height};
+    if (dirty_region_manager_insert(manager, &region) != 0) {
+        return;
     }
+    
+    dirty_region_manager_finish(manager);
 }
 
 // 清除脏区域（优化版本）
@@ -163,6 +198,8 @@ void render_opt_clear_dirty_regions(render_layer_type_t layer) {
     struct dirty_region_manager* manager = &g_render_opt.dirty_managers[layer];
     manager->region_count = 0;
     manager->total_dirty_area = 0;
+    damage_tiles_clear(&manager->tiles);
+    dirty_region_manager_invalidate(manager);
 }
 
 // 获取脏区域（优化版本）
@@ -173,8 +210,8 @@ uint32_t render_opt_get_dirty_regions(render_layer_type_t layer, struct dirty_re
     
     struct dirty_region_manager* manager = &g_render_opt.dirty_managers[layer];
     
-    // 优化脏区域
-    dirty_region_manager_optimize_regions(manager);
+    // 矩形后端在标记时已增量合并，瓦片后端在位图变化后的第一次读取时提取
+    dirty_region_manager_ensure_regions(manager);
     
     // 复制脏区域
     uint32_t count = manager->region_count < max_regions ? manager->region_count : max_regions;
@@ -183,6 +220,156 @@ uint32_t render_opt_get_dirty_regions(render_layer_type_t layer, struct dirty_re
     return count;
 }
 
+// 只读访问层的脏区域（下次标记或清除前有效）
+const struct dirty_region* render_opt_peek_dirty_regions(render_layer_type_t layer, uint32_t* count) {
+    if (count) {
+        *count = 0;
+    }
+    
+    if (!g_render_opt.initialized || layer < 0 || layer >= RENDER_LAYER_COUNT) {
+        return NULL;
+    }
+    
+    struct dirty_region_manager* manager = &g_render_opt.dirty_managers[layer];
+    dirty_region_manager_ensure_regions(manager);
+    
+    if (count) {
+        *count = manager->region_count;
+    }
+    return manager->regions;
+}
+
+// 检查是否有任何层存在脏区域
+bool render_opt_has_damage(void) {
+    if (!g_render_opt.initialized) {
+        return false;
+    }
+    
+    for (int i = 0; i < RENDER_LAYER_COUNT; i++) {
+        struct dirty_region_manager* manager = &g_render_opt.dirty_managers[i];
+        
+        if (g_render_opt.damage_backend == RENDER_DAMAGE_BACKEND_TILES) {
+            if (!damage_tiles_is_empty(&manager->tiles)) {
+                return true;
+            }
+        } else if (manager->region_count > 0) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+// 获取所有层合并后的屏幕脏区域
+uint32_t render_opt_get_screen_damage(struct dirty_region* regions, uint32_t max_regions) {
+    if (!g_render_opt.initialized || !regions) {
+        return 0;
+    }
+    
+    struct dirty_region_manager* screen = &g_render_opt.screen_manager;
+    
+    // 各层自上次合并后没有变化时直接使用上次的结果
+    if (!screen->regions_valid) {
+        screen->region_count = 0;
+        screen->total_dirty_area = 0;
+        
+        if (g_render_opt.damage_backend == RENDER_DAMAGE_BACKEND_TILES) {
+            // 按字合并各层位图，开销与标记次数无关
+            damage_tiles_clear(&screen->tiles);
+            for (int i = 0; i < RENDER_LAYER_COUNT; i++) {
+                damage_tiles_union(&screen->tiles, &g_render_opt.dirty_managers[i].tiles);
+            }
+            dirty_region_manager_rebuild_from_tiles(screen);
+        } else {
+            for (int i = 0; i < RENDER_LAYER_COUNT; i++) {
+                struct dirty_region_manager* manager = &g_render_opt.dirty_managers[i];
+                for (uint32_t j = 0; j < manager->region_count; j++) {
+                    dirty_region_manager_insert(screen, &manager->regions[j]);
+                }
+            }
+            dirty_region_manager_finish(screen);
+        }
+        screen->regions_valid = true;
+    }
+    
+    // 放不下时合并为所有区域的包围盒，不能丢掉多出的区域
+    if (screen->region_count > max_regions && max_regions > 0) {
+        int x0 = screen->regions[0].x;
+        int y0 = screen->regions[0].y;
+        int x1 = x0 + screen->regions[0].width;
+        int y1 = y0 + screen->regions[0].height;
+        for (uint32_t i = 1; i < screen->region_count; i++) {
+            const struct dirty_region* region = &screen->regions[i];
+            if (region->x < x0) x0 = region->x;
+            if (region->y < y0) y0 = region->y;
+            if (region->x + region->width > x1) x1 = region->x + region->width;
+            if (region->y + region->height > y1) y1 = region->y + region->height;
+        }
+        
+        regions[0] = (struct dirty_region){x0, y0, x1 - x0, y1 - y0};
+        return 1;
+    }
+    
+    uint32_t count = screen->region_count < max_regions ? screen->region_count : max_regions;
+    memcpy(regions, screen->regions, count * sizeof(struct dirty_region));
+    
+    return count;
+}
+
+// 检查矩形是否与层的脏区域相交
+bool render_opt_is_rect_dirty(render_layer_type_t layer, int x, int y, int width, int height) {
+    if (!g_render_opt.initialized || layer < 0 || layer >= RENDER_LAYER_COUNT) {
+        return false;
+    }
+    
+    struct dirty_region_manager* manager = &g_render_opt.dirty_managers[layer];
+    
+    if (g_render_opt.damage_backend == RENDER_DAMAGE_BACKEND_TILES) {
+        return damage_tiles_intersects_rect(&manager->tiles, x, y, width, height);
+    }
+    
+    struct dirty_region rect = {x, y, width, height};
+    for (uint32_t i = 0; i < manager->region_count; i++) {
+        if (dirty_region_manager_intersect(&manager->regions[i], &rect)) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+// 设置脏区域跟踪后端
+void render_opt_set_damage_backend(render_damage_backend_t backend) {
+    if (!g_render_opt.initialized || g_render_opt.damage_backend == backend) {
+        return;
+    }
+    
+    // 切换时转换已有的脏区域，避免丢失本帧损伤
+    for (int i = 0; i < RENDER_LAYER_COUNT; i++) {
+        struct dirty_region_manager* manager = &g_render_opt.dirty_managers[i];
+        
+        dirty_region_manager_invalidate(manager);
+        if (backend == RENDER_DAMAGE_BACKEND_TILES) {
+            damage_tiles_clear(&manager->tiles);
+            for (uint32_t j = 0; j < manager->region_count; j++) {
+                struct dirty_region* region = &manager->regions[j];
+                damage_tiles_mark_rect(&manager->tiles, region->x, region->y, region->width, region->height);
+            }
+        } else {
+            dirty_region_manager_rebuild_from_tiles(manager);
+            damage_tiles_clear(&manager->tiles);
+        }
+    }
+    
+    g_render_opt.damage_backend = backend;
+    LOGI("Damage backend set to %s", backend == RENDER_DAMAGE_BACKEND_TILES ? "tiles" : "rects");
+}
+
+// 获取脏区域跟踪后端
+render_damage_backend_t render_opt_get_damage_backend(void) {
+    return g_render_opt.damage_backend;
+}
+
 // 添加绘制调用
 void render_opt_add_draw_call(render_layer_type_t layer, const struct draw_call* draw_call) {
     if (!g_render_opt.initialized || !draw_call || layer < 0 || layer >= RENDER_LAYER_COUNT) {
@@ -296,6 +483,26 @@ void render_opt_set_merge_threshold(render_layer_type_t layer, float threshold)
     if (threshold > 1.0f) threshold = 1.0f;
     
     g_render_opt.dirty_managers[layer].merge_threshold = threshold;
+    dirty_region_manager_invalidate(&g_render_opt.dirty_managers[layer]);
+}
+
+// 设置脏区域合并代价模型
+void render_opt_set_merge_cost(render_layer_type_t layer, uint32_t region_limit, uint32_t rect_cost) {
+    if (!g_render_opt.initialized || layer < 0 || layer >= RENDER_LAYER_COUNT) {
+        return;
+    }
+    
+    struct dirty_region_manager* manager = &g_render_opt.dirty_managers[layer];
+    
+    if (region_limit < 1) region_limit = 1;
+    manager->region_limit = region_limit;
+    manager->rect_cost = rect_cost;
+    dirty_region_manager_invalidate(manager);
+    
+    // 新上限更小时立即收敛已有区域
+    while (manager->region_count > manager->region_limit) {
+        dirty_region_manager_merge_cheapest_pair(manager);
+    }
 }
 
 // 获取渲染优化统计
@@ -309,12 +516,43 @@ void render_opt_get_stats(render_layer_type_t layer, struct render_opt_stats* st
     
     stats->dirty_region_count = manager->region_count;
     stats->total_dirty_area = manager->total_dirty_area;
+    if (g_render_opt.damage_backend == RENDER_DAMAGE_BACKEND_TILES) {
+        uint32_t tile_area = manager->tiles.tile_size * manager->tiles.tile_size;
+        stats->total_dirty_area = damage_tiles_count(&manager->tiles) * tile_area;
+    }
     stats->draw_call_count = pipeline->draw_call_count;
     stats->batching_enabled = pipeline->batching_enabled;
     stats->state_sorting_enabled = pipeline->state_sorting_enabled;
     stats->culling_enabled = pipeline->culling_enabled;
 }
 
+// 内部函数：初始化脏区域管理器
+static int dirty_region_manager_init(struct dirty_region_manager* manager) {
+    manager->region_count = 0;
+    manager->max_regions = 32;
+    manager->regions = (struct dirty_region*)calloc(manager->max_regions, sizeof(struct dirty_region));
+    if (!manager->regions) {
+        return -1;
+    }
+    
+    manager->total_dirty_area = 0;
+    manager->regions_valid = false;
+    manager->merge_threshold = 0.5f; // 50%的屏幕面积阈值
+    manager->region_limit = RENDER_OPT_DEFAULT_REGION_LIMIT;
+    manager->rect_cost = RENDER_OPT_DEFAULT_RECT_COST;
+    
+    return damage_tiles_init(&manager->tiles, g_render_opt.screen_width, g_render_opt.screen_height,
+                             DAMAGE_TILE_SIZE);
+}
+
+// 内部函数：销毁脏区域管理器
+static void dirty_region_manager_destroy(struct dirty_region_manager* manager) {
+    free(manager->regions);
+    manager->regions = NULL;
+    manager->region_count = 0;
+    damage_tiles_destroy(&manager->tiles);
+}
+
 // 内部函数：合并脏区域
 static void dirty_region_manager_merge_regions(struct dirty_region_manager* manager) {
     if (manager->region_count <= 1) {
@@ -366,35 +604,161 @@ static void dirty_region_manager_union(struct dirty_region* a, const struct dirt
     a->height = max_y - min_y;
 }
 
-// 内部函数：优化脏区域
-static void dirty_region_manager_optimize_regions(struct dirty_region_manager* manager) {
+// 内部函数：计算区域面积
+static uint32_t dirty_region_area(const struct dirty_region* region) {
+    return (uint32_t)region->width * (uint32_t)region->height;
+}
+
+// 内部函数：检查outer是否完全包含inner
+static bool dirty_region_manager_contains(const struct dirty_region* outer, const struct dirty_region* inner) {
+    return inner->x >= outer->x &&
+           inner->y >= outer->y &&
+           inner->x + inner->width <= outer->x + outer->width &&
+           inner->y + inner->height <= outer->y + outer->height;
+}
+
+// 内部函数：计算合并两个区域的代价
+// 代价 = 包围盒多绘制的像素 - 节省的一次矩形开销，小于等于0表示合并更划算
+static int64_t dirty_region_manager_merge_cost(const struct dirty_region_manager* manager,
+                                               const struct dirty_region* a, const struct dirty_region* b) {
+    struct dirty_region merged = *a;
+    dirty_region_manager_union(&merged, b);
+    
+    // 重叠部分在分开绘制时会被画两次，因此直接用两者面积之和比较
+    int64_t wasted = (int64_t)dirty_region_area(&merged) -
+                     (int64_t)dirty_region_area(a) -
+                     (int64_t)dirty_region_area(b);
+    return wasted - (int64_t)manager->rect_cost;
+}
+
+// 内部函数：移除指定区域（顺序无关，用末尾元素填补）
+static void dirty_region_manager_remove(struct dirty_region_manager* manager, uint32_t index) {
+    manager->total_dirty_area -= dirty_region_area(&manager->regions[index]);
+    manager->regions[index] = manager->regions[manager->region_count - 1];
+    manager->region_count--;
+}
+
+// 内部函数：增量插入区域
+static int dirty_region_manager_insert(struct dirty_region_manager* manager, const struct dirty_region* region) {
+    struct dirty_region pending = *region;
+    
+    // 与已有区域逐个比较，合并后结果可能继续与其他区域合并
+    // 区域数量受region_limit约束，每次合并都会减少一个区域，因此开销有界
+    uint32_t i = 0;
+    while (i < manager->region_count) {
+        struct dirty_region* existing = &manager->regions[i];
+        
+        // 已被完整覆盖，无需记录
+        if (dirty_region_manager_contains(existing, &pending)) {
+            return 0;
+        }
+        
+        if (dirty_region_manager_contains(&pending, existing) ||
+            dirty_region_manager_merge_cost(manager, existing, &pending) <= 0) {
+            dirty_region_manager_union(&pending, existing);
+            dirty_region_manager_remove(manager, i);
+            
+            // 合并后的区域变大，需要重新检查所有区域
+            i = 0;
+            continue;
+        }
+        
+        i++;
+    }
+    
+    // 检查是否需要扩展区域数组
+    if (manager->region_count >= manager->max_regions) {
+        uint32_t new_max = manager->max_regions * 2;
+        struct dirty_region* new_regions = (struct dirty_region*)realloc(
+            manager->regions, new_max * sizeof(struct dirty_region));
+        
+        if (!new_regions) {
+            LOGE("Failed to expand dirty regions array");
+            return -1;
+        }
+        
+        manager->regions = new_regions;
+        manager->max_regions = new_max;
+    }
+    
+    // 添加新的脏区域
+    manager->regions[manager->region_count++] = pending;
+    manager->total_dirty_area += dirty_region_area(&pending);
+    return 0;
+}
+
+// 内部函数：合并代价最小的一对区域
+static void dirty_region_manager_merge_cheapest_pair(struct dirty_region_manager* manager) {
     if (manager->region_count <= 1) {
         return;
     }
     
-    // 移除重叠区域
-    bool changed;
-    do {
-        changed = false;
-        
-        for (uint32_t i = 0; i < manager->region_count && !changed; i++) {
-            for (uint32_t j = i + 1; j < manager->region_count; j++) {
-                if (dirty_region_manager_intersect(&manager->regions[i], &manager->regions[j])) {
-                    // 合并区域
-                    dirty_region_manager_union(&manager->regions[i], &manager->regions[j]);
-                    
-                    // 移除区域j
-                    for (uint32_t k = j; k < manager->region_count - 1; k++) {
-                        manager->regions[k] = manager->regions[k + 1];
-                    }
-                    manager->region_count--;
-                    
-                    changed = true;
-                    break;
-                }
+    uint32_t best_i = 0;
+    uint32_t best_j = 1;
+    int64_t best_cost = INT64_MAX;
+    
+    for (uint32_t i = 0; i < manager->region_count; i++) {
+        for (uint32_t j = i + 1; j < manager->region_count; j++) {
+            int64_t cost = dirty_region_manager_merge_cost(manager, &manager->regions[i], &manager->regions[j]);
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_i = i;
+                best_j = j;
             }
         }
-    } while (changed);
+    }
+    
+    // 先移除两者再插入合并结果，保证总面积统计准确
+    struct dirty_region merged = manager->regions[best_i];
+    dirty_region_manager_union(&merged, &manager->regions[best_j]);
+    dirty_region_manager_remove(manager, best_j);
+    dirty_region_manager_remove(manager, best_i);
+    dirty_region_manager_insert(manager, &merged);
+}
+
+// 内部函数：插入结束后收敛区域数量
+static void dirty_region_manager_finish(struct dirty_region_manager* manager) {
+    // 数量超过上限时，强制合并代价最小的一对矩形
+    while (manager->region_count > manager->region_limit) {
+        dirty_region_manager_merge_cheapest_pair(manager);
+    }
+    
+    // 脏区域已覆盖大部分屏幕时退化为单一包围盒（整屏重绘更便宜）
+    float screen_area = (float)g_render_opt.screen_width * (float)g_render_opt.screen_height;
+    if (manager->total_dirty_area > screen_area * manager->merge_threshold) {
+        dirty_region_manager_merge_regions(manager);
+    }
+}
+
+// 内部函数：从瓦片位图重建矩形列表
+static void dirty_region_manager_rebuild_from_tiles(struct dirty_region_manager* manager) {
+    manager->region_count = 0;
+    manager->total_dirty_area = 0;
+    
+    damage_tiles_for_each_span(&manager->tiles, dirty_region_manager_span_callback, manager);
+    dirty_region_manager_finish(manager);
+}
+
+// 内部函数：瓦片后端在位图变化后重建矩形列表，未变化时保留上次的结果（已返回的指针保持有效）
+static void dirty_region_manager_ensure_regions(struct dirty_region_manager* manager) {
+    if (g_render_opt.damage_backend == RENDER_DAMAGE_BACKEND_TILES && !manager->regions_valid) {
+        dirty_region_manager_rebuild_from_tiles(manager);
+    }
+    manager->regions_valid = true;
+}
+
+// 内部函数：层的脏区域变化，该层和屏幕的矩形列表需要重建
+static void dirty_region_manager_invalidate(struct dirty_region_manager* manager) {
+    manager->regions_valid = false;
+    g_render_opt.screen_manager.regions_valid = false;
+}
+
+// 内部函数：瓦片跨度回调
+static void dirty_region_manager_span_callback(void* user_data, int x, int y, int width, int height) {
+    struct dirty_region_manager* manager = (struct dirty_region_manager*)user_data;
+    struct dirty_region region = {x, y, width, height};
+    
+    dirty_region_manager_insert(manager, &region);
 }
 
 // 内部函数：优化批处理
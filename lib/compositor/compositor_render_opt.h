@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <pthread.h>
+#include "compositor_damage_tiles.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -19,6 +20,12 @@ typedef enum {
     RENDER_LAYER_COUNT = 5
 } render_layer_type_t;
 
+// 脏区域跟踪后端
+typedef enum {
+    RENDER_DAMAGE_BACKEND_RECTS = 0,  // 矩形列表（按代价模型合并）
+    RENDER_DAMAGE_BACKEND_TILES = 1   // 瓦片位图
+} render_damage_backend_t;
+
 // 脏区域结构
 struct dirty_region {
     int x, y;
@@ -32,6 +39,10 @@ struct dirty_region_manager {
     uint32_t max_regions;
     uint32_t total_dirty_area;
     float merge_threshold;  // 合并阈值（屏幕面积的百分比）
+    uint32_t region_limit;  // 每层最多保留的矩形数量
+    uint32_t rect_cost;     // 单个矩形的绘制开销（折算为像素数）
+    struct damage_tiles tiles; // 瓦片位图（瓦片后端使用）
+    bool regions_valid;     // 矩形列表与位图一致（标记、清除、调整尺寸或参数时失效，读取时才重建）
 };
 
 // 绘制调用结构
@@ -69,7 +80,9 @@ struct render_opt_state {
     bool initialized;
     int screen_width;
     int screen_height;
+    render_damage_backend_t damage_backend;
     struct dirty_region_manager dirty_managers[RENDER_LAYER_COUNT];
+    struct dirty_region_manager screen_manager; // 所有层合并后的屏幕脏区域
     struct render_pipeline pipelines[RENDER_LAYER_COUNT];
     pthread_mutex_t mutex;
 };
@@ -80,6 +93,9 @@ int render_opt_init(int screen_width, int screen_height);
 // 销毁渲染优化模块
 void render_opt_destroy(void);
 
+// 调整屏幕尺寸
+int render_opt_resize(int screen_width, int screen_height);
+
 // 标记区域为脏（优化版本）
 void render_opt_mark_dirty(render_layer_type_t layer, int x, int y, int width, int height);
 
@@ -89,6 +105,24 @@ void render_opt_clear_dirty_regions(render_layer_type_t layer);
 // 获取脏区域（优化版本）
 uint32_t render_opt_get_dirty_regions(render_layer_type_t layer, struct dirty_region* regions, uint32_t max_regions);
 
+// 只读访问层的脏区域（下次标记或清除前有效）
+const struct dirty_region* render_opt_peek_dirty_regions(render_layer_type_t layer, uint32_t* count);
+
+// 检查是否有任何层存在脏区域
+bool render_opt_has_damage(void);
+
+// 获取所有层合并后的屏幕脏区域（超过max_regions时合并为一个包围盒）
+uint32_t render_opt_get_screen_damage(struct dirty_region* regions, uint32_t max_regions);
+
+// 检查矩形是否与层的脏区域相交
+bool render_opt_is_rect_dirty(render_layer_type_t layer, int x, int y, int width, int height);
+
+// 设置脏区域跟踪后端
+void render_opt_set_damage_backend(render_damage_backend_t backend);
+
+// 获取脏区域跟踪后端
+render_damage_backend_t render_opt_get_damage_backend(void);
+
 // 添加绘制调用
 void render_opt_add_draw_call(render_layer_type_t layer, const struct draw_call* draw_call);
 
@@ -113,6 +147,9 @@ void render_opt_set_culling_enabled(render_layer_type_t layer, bool enabled);
 // 设置脏区域合并阈值
 void render_opt_set_merge_threshold(render_layer_type_t layer, float threshold);
 
+// 设置脏区域合并代价模型（矩形数量上限和单矩形开销）
+void render_opt_set_merge_cost(render_layer_type_t layer, uint32_t region_limit, uint32_t rect_cost);
+
 // 获取渲染优化统计
 void render_opt_get_stats(render_layer_type_t layer, struct render_opt_stats* stats);
 
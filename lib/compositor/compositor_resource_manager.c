@@ -1,4 +1,6 @@
 #include "compositor_resource_manager.h"
+#include "compositor_trace.h"
+#include "compositor_monitor.h"
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -908,6 +910,8 @@ void async_load_thread_pool_shutdown(void) {
 
 // 异步加载线程函数
 void* async_load_thread_func(void* arg) {
+    trace_set_thread_name("async-loader");
+    
     while (!g_resource_manager.thread_pool.shutdown) {
         // 从任务队列取出任务
         struct async_load_task* task = async_load_task_pop();
@@ -955,7 +959,11 @@ void async_load_task_execute(struct async_load_task* task) {
     }
     
     // 加载资源
+    TRACE_BEGIN("async_load");
+    uint64_t start_time = resource_get_time();
     int result = resource_load(task->resource);
+    monitor_add_data_point(MONITOR_DATA_TYPE_LOAD_TIME, (float)(resource_get_time() - start_time));
+    TRACE_END("async_load");
     
     // 更新异步加载状态
     pthread_mutex_lock(&g_resource_manager.async_queue.mutex);
@@ -0,0 +1,251 @@
+#include "compositor_rollup.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <android/log.h>
+
+#define LOG_TAG "Rollup"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+// 内部函数声明
+static void add_to_tier(struct rollup_tier* tier, uint64_t timestamp_ns, float value);
+static uint32_t sketch_bin(float value);
+static uint64_t tier_oldest_start(const struct rollup_tier* tier);
+static const struct rollup_bucket* tier_bucket(const struct rollup_tier* tier, uint32_t index);
+
+// 初始化序列（tiers按分辨率从细到粗）
+int rollup_series_init(struct rollup_series* series, const struct rollup_tier_config* tiers, uint32_t tier_count) {
+    if (!series || !tiers || tier_count == 0 || tier_count > ROLLUP_MAX_TIERS) {
+        LOGE("Invalid rollup parameters");
+        return -1;
+    }
+    
+    memset(series, 0, sizeof(struct rollup_series));
+    
+    for (uint32_t i = 0; i < tier_count; i++) {
+        if (tiers[i].resolution_ms == 0 || tiers[i].bucket_count == 0 ||
+            (i > 0 && tiers[i].resolution_ms <= tiers[i - 1].resolution_ms)) {
+            LOGE("Invalid rollup tier %u: %u ms x %u", i, tiers[i].resolution_ms, tiers[i].bucket_count);
+            rollup_series_destroy(series);
+            return -1;
+        }
+        
+        struct rollup_tier* tier = &series->tiers[i];
+        tier->buckets = calloc(tiers[i].bucket_count, sizeof(struct rollup_bucket));
+        if (!tier->buckets) {
+            LOGE("Failed to allocate rollup tier %u", i);
+            rollup_series_destroy(series);
+            return -1;
+        }
+        
+        tier->resolution_ns = tiers[i].resolution_ms * 1000000ULL;
+        tier->capacity = tiers[i].bucket_count;
+        series->tier_count = i + 1;
+    }
+    
+    return 0;
+}
+
+// 销毁序列
+void rollup_series_destroy(struct rollup_series* series) {
+    if (!series) {
+        return;
+    }
+    
+    for (uint32_t i = 0; i < ROLLUP_MAX_TIERS; i++) {
+        free(series->tiers[i].buckets);
+    }
+    
+    memset(series, 0, sizeof(struct rollup_series));
+}
+
+// 清空所有层
+void rollup_series_reset(struct rollup_series* series) {
+    if (!series) {
+        return;
+    }
+    
+    for (uint32_t i = 0; i < series->tier_count; i++) {
+        series->tiers[i].head = 0;
+        series->tiers[i].count = 0;
+    }
+}
+
+// 添加一个样本（时间戳需单调不减，O(层数)）
+void rollup_series_add(struct rollup_series* series, uint64_t timestamp_ns, float value) {
+    if (!series) {
+        return;
+    }
+    
+    for (uint32_t i = 0; i < series->tier_count; i++) {
+        add_to_tier(&series->tiers[i], timestamp_ns, value);
+    }
+}
+
+// 按时间顺序遍历[start_ns, end_ns)内的桶，较早的时间段来自较粗的层
+uint64_t rollup_series_visit(const struct rollup_series* series, uint64_t start_ns, uint64_t end_ns,
+                             rollup_visit_fn visit, void* user_data) {
+    if (!series || !visit || start_ns >= end_ns) {
+        return start_ns;
+    }
+    
+    uint64_t cursor = start_ns;
+    bool first = true;
+    
+    // 从最粗的层开始，每层只输出到更细一层最早的桶为止
+    for (int i = (int)series->tier_count - 1; i >= 0; i--) {
+        const struct rollup_tier* tier = &series->tiers[i];
+        uint64_t limit = end_ns;
+        if (i > 0) {
+            uint64_t finer_start = tier_oldest_start(&series->tiers[i - 1]);
+            if (finer_start < limit) {
+                limit = finer_start;
+            }
+        }
+        
+        for (uint32_t j = 0; j < tier->count; j++) {
+            const struct rollup_bucket* bucket = tier_bucket(tier, j);
+            if (bucket->start_ns >= limit) {
+                break;
+            }
+            
+            // 第一个桶可以跨过起始时间，之后的桶从上一个桶的结束处开始，保证不重叠
+            bool in_range = first ? bucket->start_ns + tier->resolution_ns > cursor : bucket->start_ns >= cursor;
+            if (!in_range || bucket->count == 0) {
+                continue;
+            }
+            
+            visit(bucket, tier->resolution_ns, user_data);
+            cursor = bucket->start_ns + tier->resolution_ns;
+            first = false;
+        }
+    }
+    
+    return cursor;
+}
+
+// 获取桶的平均值
+float rollup_bucket_mean(const struct rollup_bucket* bucket) {
+    if (!bucket || bucket->count == 0) {
+        return 0.0f;
+    }
+    
+    return (float)(bucket->sum / bucket->count);
+}
+
+// 从桶的草图估计分位数（在桶内按对数插值，结果限制在最小值和最大值之间）
+float rollup_bucket_percentile(const struct rollup_bucket* bucket, float quantile) {
+    if (!bucket || bucket->count == 0) {
+        return 0.0f;
+    }
+    
+    uint32_t total = 0;
+    for (int i = 0; i < ROLLUP_SKETCH_BINS; i++) {
+        total += bucket->sketch[i];
+    }
+    if (total == 0) {
+        return bucket->min_value;
+    }
+    
+    float target = quantile * total;
+    uint32_t cumulative = 0;
+    float value = bucket->max_value;
+    for (int i = 0; i < ROLLUP_SKETCH_BINS; i++) {
+        uint32_t bin_count = bucket->sketch[i];
+        if (bin_count > 0 && cumulative + bin_count >= target) {
+            float fraction = (target - cumulative) / bin_count;
+            value = exp2f(ROLLUP_SKETCH_MIN_LOG2 + (i + fraction) / 2.0f);
+            break;
+        }
+        cumulative += bin_count;
+    }
+    
+    if (value < bucket->min_value) {
+        value = bucket->min_value;
+    }
+    if (value > bucket->max_value) {
+        value = bucket->max_value;
+    }
+    return value;
+}
+
+// 获取序列占用的内存（字节）
+size_t rollup_series_memory(const struct rollup_series* series) {
+    if (!series) {
+        return 0;
+    }
+    
+    size_t bytes = 0;
+    for (uint32_t i = 0; i < series->tier_count; i++) {
+        bytes += series->tiers[i].capacity * sizeof(struct rollup_bucket);
+    }
+    return bytes;
+}
+
+// 把样本累积到层的当前桶，跨过桶边界时开始新桶（覆盖最旧的桶）
+static void add_to_tier(struct rollup_tier* tier, uint64_t timestamp_ns, float value) {
+    uint64_t start_ns = timestamp_ns - timestamp_ns % tier->resolution_ns;
+    struct rollup_bucket* bucket = &tier->buckets[tier->head];
+    
+    if (tier->count == 0 || start_ns > bucket->start_ns) {
+        if (tier->count > 0) {
+            tier->head = (tier->head + 1) % tier->capacity;
+        }
+        if (tier->count < tier->capacity) {
+            tier->count++;
+        }
+        
+        bucket = &tier->buckets[tier->head];
+        memset(bucket, 0, sizeof(struct rollup_bucket));
+        bucket->start_ns = start_ns;
+        bucket->min_value = value;
+        bucket->max_value = value;
+    }
+    
+    // 时间戳回退的样本计入当前桶
+    bucket->count++;
+    bucket->sum += value;
+    if (value < bucket->min_value) {
+        bucket->min_value = value;
+    }
+    if (value > bucket->max_value) {
+        bucket->max_value = value;
+    }
+    
+    uint32_t bin = sketch_bin(value);
+    if (bucket->sketch[bin] < UINT16_MAX) {
+        bucket->sketch[bin]++;
+    }
+}
+
+// 计算值所在的草图桶（每个2的幂两个桶，超出范围的值计入两端的桶）
+static uint32_t sketch_bin(float value) {
+    if (!(value > 0.0f)) {
+        return 0;
+    }
+    
+    float position = (log2f(value) - ROLLUP_SKETCH_MIN_LOG2) * 2.0f;
+    if (position < 0.0f) {
+        return 0;
+    }
+    if (position >= ROLLUP_SKETCH_BINS - 1) {
+        return ROLLUP_SKETCH_BINS - 1;
+    }
+    return (uint32_t)position;
+}
+
+// 获取层中最早的桶的开始时间（空层返回UINT64_MAX）
+static uint64_t tier_oldest_start(const struct rollup_tier* tier) {
+    if (tier->count == 0) {
+        return UINT64_MAX;
+    }
+    
+    return tier_bucket(tier, 0)->start_ns;
+}
+
+// 按时间顺序获取层中的第index个桶（0为最早）
+static const struct rollup_bucket* tier_bucket(const struct rollup_tier* tier, uint32_t index) {
+    uint32_t oldest = (tier->head + tier->capacity + 1 - tier->count) % tier->capacity;
+    return &tier->buckets[(oldest + index) % tier->capacity];
+}
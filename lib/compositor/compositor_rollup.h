@@ -0,0 +1,82 @@
+#ifndef COMPOSITOR_ROLLUP_H
+#define COMPOSITOR_ROLLUP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 每个序列的最大层数
+#define ROLLUP_MAX_TIERS 4
+// 分位数草图的桶数（每个2的幂两个桶，覆盖2^-4到2^20，相对误差约20%）
+#define ROLLUP_SKETCH_BINS 48
+#define ROLLUP_SKETCH_MIN_LOG2 (-4)
+
+// 聚合桶（一个时间段内所有样本的摘要）
+struct rollup_bucket {
+    uint64_t start_ns;                      // 时间段开始（按层分辨率对齐）
+    uint32_t count;                         // 样本数量（0表示空桶）
+    float min_value;
+    float max_value;
+    double sum;
+    uint16_t sketch[ROLLUP_SKETCH_BINS];     // 对数分桶计数，用于估计分位数
+};
+
+// 层配置
+struct rollup_tier_config {
+    uint32_t resolution_ms;                 // 每个桶的时长
+    uint32_t bucket_count;                  // 保留的桶数
+};
+
+// 一层：按时间顺序的桶环，最新的桶即当前正在累积的桶
+struct rollup_tier {
+    uint64_t resolution_ns;
+    struct rollup_bucket* buckets;
+    uint32_t capacity;
+    uint32_t head;                          // 最新的桶
+    uint32_t count;
+};
+
+// 多分辨率序列（层按分辨率从细到粗排列，每个样本直接累积到各层的当前桶）
+struct rollup_series {
+    struct rollup_tier tiers[ROLLUP_MAX_TIERS];
+    uint32_t tier_count;
+};
+
+// 遍历回调（duration_ns为该桶的时长）
+typedef void (*rollup_visit_fn)(const struct rollup_bucket* bucket, uint64_t duration_ns, void* user_data);
+
+// 初始化序列（tiers按分辨率从细到粗）
+int rollup_series_init(struct rollup_series* series, const struct rollup_tier_config* tiers, uint32_t tier_count);
+
+// 销毁序列
+void rollup_series_destroy(struct rollup_series* series);
+
+// 清空所有层
+void rollup_series_reset(struct rollup_series* series);
+
+// 添加一个样本（时间戳需单调不减，O(层数)）
+void rollup_series_add(struct rollup_series* series, uint64_t timestamp_ns, float value);
+
+// 按时间顺序遍历[start_ns, end_ns)内的桶：较早的时间段来自较粗的层，细层有数据的部分用细层，
+// 桶之间不重叠；返回最后一个桶的结束时间（没有桶时返回start_ns），调用者可从这里接着输出更细的数据
+uint64_t rollup_series_visit(const struct rollup_series* series, uint64_t start_ns, uint64_t end_ns,
+                             rollup_visit_fn visit, void* user_data);
+
+// 获取桶的平均值
+float rollup_bucket_mean(const struct rollup_bucket* bucket);
+
+// 从桶的草图估计分位数（结果限制在桶的最小值和最大值之间）
+float rollup_bucket_percentile(const struct rollup_bucket* bucket, float quantile);
+
+// 获取序列占用的内存（字节）
+size_t rollup_series_memory(const struct rollup_series* series);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COMPOSITOR_ROLLUP_H
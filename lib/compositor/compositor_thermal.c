@@ -0,0 +1,683 @@
+#include "compositor_thermal.h"
+#include "compositor_trace.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <time.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <android/log.h>
+
+#define LOG_TAG "Thermal"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+// 最多解析的触发点数
+#define THERMAL_MAX_TRIPS 32
+// 温区没有可用触发点但属于SoC时使用的默认触发点
+#define THERMAL_DEFAULT_THROTTLE_C 85.0f
+#define THERMAL_DEFAULT_CRITICAL_C 105.0f
+// 状态判断阈值
+#define THERMAL_WARNING_HEADROOM_C 10.0f
+#define THERMAL_THROTTLING_HEADROOM_C 4.0f
+#define THERMAL_CRITICAL_MARGIN_C 3.0f
+#define THERMAL_WARNING_LEAD_S 60.0f       // 预计在此时间内到达节流点时进入警告状态
+#define THERMAL_THROTTLING_LEAD_S 15.0f    // 预计在此时间内到达节流点时进入节流状态
+#define THERMAL_FREQ_CAP_RATIO 0.9f        // 频率上限低于此比例时认为内核已经限频
+// 降级时需要额外的余量，避免在阈值附近来回切换
+#define THERMAL_HYSTERESIS_C 2.0f
+#define THERMAL_HYSTERESIS_LEAD 0.5f       // 降级时预计时间按此比例缩短
+// 趋势的平滑系数和视为升温的最小速率
+#define THERMAL_TREND_ALPHA 0.3f
+#define THERMAL_MIN_RISE_C_PER_S 0.05f
+// 没有有效读数时发布的状态
+#define THERMAL_STATE_NONE (-1)
+
+// 温区
+struct thermal_zone {
+    int temp_fd;                           // 常开，每次采样pread
+    struct thermal_zone_info info;
+    bool valid;                            // 最近一次读取是否成功
+    bool has_previous;                     // 上一次读取成功（可用于求趋势）
+    uint64_t last_read_ns;
+};
+
+// CPU频率
+struct thermal_cpu {
+    int cur_fd;                            // scaling_cur_freq
+    int cap_fd;                            // scaling_max_freq（热限频时由内核降低）
+    float max_khz;                         // cpuinfo_max_freq
+};
+
+// 热调节器状态
+static struct {
+    bool initialized;
+    bool thread_started;
+    bool running;                          // 采样线程是否继续运行（持有mutex时访问）
+    pthread_t thread;
+    pthread_mutex_t mutex;                 // 保护running和已发布的统计
+    pthread_cond_t cond;
+    char root[PATH_MAX];
+    
+    // 初始化后只由采样线程（或手动采样的调用者）访问
+    struct thermal_zone zones[THERMAL_MAX_ZONES];
+    uint32_t zone_count;
+    struct thermal_cpu cpus[THERMAL_MAX_CPUS];
+    uint32_t cpu_count;
+    uint64_t next_sample_ns;
+    struct thermal_governor_stats stats;
+    
+    // 已发布的统计
+    struct thermal_governor_stats published;
+    struct thermal_zone_info zone_infos[THERMAL_MAX_ZONES];
+    atomic_int published_state;            // 供渲染线程无锁读取，没有有效读数时为THERMAL_STATE_NONE
+} g_thermal = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+    .published_state = THERMAL_STATE_NONE
+};
+
+// 内部函数声明
+static void* thermal_thread_main(void* arg);
+static void discover_zones(void);
+static void discover_cpus(void);
+static bool read_zone_trips(const char* dir, float* throttle_c, float* critical_c);
+static bool is_soc_zone(const char* type);
+static void copy_type(char* type, const char* name);
+static void take_sample(uint64_t now_ns);
+static void update_zone(struct thermal_zone* zone, long value, uint64_t now_ns);
+static void publish(void);
+static thermal_state_t classify(float headroom_c, float critical_margin_c, float time_to_throttle_s, float freq_cap_ratio);
+static int read_long_fd(int fd, long* value);
+static int read_long_path(const char* path, long* value);
+static int read_string_path(const char* path, char* buffer, size_t size);
+static float to_celsius(long value);
+static const char* state_name(thermal_state_t state);
+static uint64_t thermal_get_time_ns(void);
+
+// 初始化热调节器（sysfs_root为NULL时使用/sys，可指向结构相同的目录树），只查找温区和CPU，不采样
+int thermal_governor_init(const char* sysfs_root) {
+    if (g_thermal.initialized) {
+        LOGE("Thermal governor already initialized");
+        return -1;
+    }
+    
+    const char* root = sysfs_root ? sysfs_root : "/sys";
+    if (snprintf(g_thermal.root, sizeof(g_thermal.root), "%s", root) >= (int)sizeof(g_thermal.root)) {
+        LOGE("Thermal sysfs root too long: %s", root);
+        return -1;
+    }
+    
+    g_thermal.zone_count = 0;
+    g_thermal.cpu_count = 0;
+    g_thermal.next_sample_ns = 0;
+    g_thermal.thread_started = false;
+    memset(&g_thermal.stats, 0, sizeof(g_thermal.stats));
+    memset(g_thermal.zone_infos, 0, sizeof(g_thermal.zone_infos));
+    atomic_store(&g_thermal.published_state, THERMAL_STATE_NONE);
+    
+    discover_zones();
+    discover_cpus();
+    
+    g_thermal.stats.zone_count = g_thermal.zone_count;
+    g_thermal.stats.cpu_count = g_thermal.cpu_count;
+    g_thermal.stats.time_to_throttle_s = -1.0f;
+    g_thermal.stats.freq_ratio = 1.0f;
+    g_thermal.stats.freq_cap_ratio = 1.0f;
+    g_thermal.stats.state = THERMAL_STATE_NORMAL;
+    publish();
+    g_thermal.initialized = true;
+    
+    if (g_thermal.zone_count == 0) {
+        LOGE("No usable thermal zones under %s", g_thermal.root);
+        return -1;
+    }
+    
+    LOGI("Thermal governor initialized (%u zones, %u CPUs)", g_thermal.zone_count, g_thermal.cpu_count);
+    return 0;
+}
+
+// 启动后台采样线程（sysfs读取不在渲染线程上进行）
+int thermal_governor_start(void) {
+    if (!thermal_governor_is_available()) {
+        return -1;
+    }
+    if (g_thermal.thread_started) {
+        return 0;
+    }
+    
+    g_thermal.running = true;
+    if (pthread_create(&g_thermal.thread, NULL, thermal_thread_main, NULL) != 0) {
+        LOGE("Failed to create thermal sampler thread");
+        return -1;
+    }
+    
+    g_thermal.thread_started = true;
+    return 0;
+}
+
+// 销毁热调节器
+void thermal_governor_destroy(void) {
+    if (!g_thermal.initialized) {
+        return;
+    }
+    
+    if (g_thermal.thread_started) {
+        pthread_mutex_lock(&g_thermal.mutex);
+        g_thermal.running = false;
+        pthread_cond_signal(&g_thermal.cond);
+        pthread_mutex_unlock(&g_thermal.mutex);
+        
+        pthread_join(g_thermal.thread, NULL);
+        g_thermal.thread_started = false;
+    }
+    
+    for (uint32_t i = 0; i < g_thermal.zone_count; i++) {
+        close(g_thermal.zones[i].temp_fd);
+    }
+    for (uint32_t i = 0; i < g_thermal.cpu_count; i++) {
+        close(g_thermal.cpus[i].cur_fd);
+        if (g_thermal.cpus[i].cap_fd >= 0) {
+            close(g_thermal.cpus[i].cap_fd);
+        }
+    }
+    
+    g_thermal.zone_count = 0;
+    g_thermal.cpu_count = 0;
+    atomic_store(&g_thermal.published_state, THERMAL_STATE_NONE);
+    g_thermal.initialized = false;
+    
+    LOGI("Thermal governor destroyed");
+}
+
+// 检查是否找到可用的温区
+bool thermal_governor_is_available(void) {
+    return g_thermal.initialized && g_thermal.zone_count > 0;
+}
+
+// 手动采样一次（仅在未启动采样线程时使用，例如主机测试工具按模拟时间驱动），未到采样时间时不读取
+int thermal_governor_sample(uint64_t now_ns) {
+    if (!thermal_governor_is_available() || g_thermal.thread_started) {
+        return -1;
+    }
+    
+    if (now_ns >= g_thermal.next_sample_ns) {
+        take_sample(now_ns);
+    }
+    return 0;
+}
+
+// 获取最近一次采样的热状态（无锁，可每帧调用），不可用或最近一次采样没有可用读数时返回-1
+int thermal_governor_get_state(thermal_state_t* state) {
+    int published = atomic_load_explicit(&g_thermal.published_state, memory_order_relaxed);
+    if (published == THERMAL_STATE_NONE) {
+        return -1;
+    }
+    
+    if (state) {
+        *state = (thermal_state_t)published;
+    }
+    return 0;
+}
+
+// 获取热调节器统计
+void thermal_governor_get_stats(struct thermal_governor_stats* stats) {
+    if (!stats) {
+        return;
+    }
+    
+    pthread_mutex_lock(&g_thermal.mutex);
+    *stats = g_thermal.published;
+    pthread_mutex_unlock(&g_thermal.mutex);
+}
+
+// 获取各温区的最近一次读数，返回复制的条数
+uint32_t thermal_governor_get_zones(struct thermal_zone_info* zones, uint32_t max_count) {
+    if (!zones || max_count == 0) {
+        return 0;
+    }
+    
+    pthread_mutex_lock(&g_thermal.mutex);
+    uint32_t count = g_thermal.zone_count < max_count ? g_thermal.zone_count : max_count;
+    memcpy(zones, g_thermal.zone_infos, count * sizeof(struct thermal_zone_info));
+    pthread_mutex_unlock(&g_thermal.mutex);
+    
+    return count;
+}
+
+// 采样线程：按采样间隔（读取失败时逐次加倍）读取sysfs并发布结果
+static void* thermal_thread_main(void* arg) {
+    (void)arg;
+    trace_set_thread_name("thermal");
+    
+    pthread_mutex_lock(&g_thermal.mutex);
+    while (g_thermal.running) {
+        pthread_mutex_unlock(&g_thermal.mutex);
+        uint64_t now_ns = thermal_get_time_ns();
+        take_sample(now_ns);
+        uint64_t wait_ns = g_thermal.next_sample_ns > now_ns ? g_thermal.next_sample_ns - now_ns : 0;
+        pthread_mutex_lock(&g_thermal.mutex);
+        
+        if (!g_thermal.running) {
+            break;
+        }
+        
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += (time_t)(wait_ns / 1000000000ULL);
+        deadline.tv_nsec += (long)(wait_ns % 1000000000ULL);
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&g_thermal.cond, &g_thermal.mutex, &deadline);
+    }
+    pthread_mutex_unlock(&g_thermal.mutex);
+    
+    return NULL;
+}
+
+// 查找class/thermal下有节流触发点的温区（路径过长的条目跳过）
+static void discover_zones(void) {
+    char path[PATH_MAX];
+    char zone_dir[PATH_MAX];
+    
+    if (snprintf(path, sizeof(path), "%s/class/thermal", g_thermal.root) >= (int)sizeof(path)) {
+        return;
+    }
+    
+    DIR* dir = opendir(path);
+    if (!dir) {
+        return;
+    }
+    
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL && g_thermal.zone_count < THERMAL_MAX_ZONES) {
+        if (strncmp(entry->d_name, "thermal_zone", 12) != 0) {
+            continue;
+        }
+        
+        struct thermal_zone* zone = &g_thermal.zones[g_thermal.zone_count];
+        if (snprintf(zone_dir, sizeof(zone_dir), "%s/class/thermal/%s", g_thermal.root, entry->d_name) >= (int)sizeof(zone_dir)) {
+            continue;
+        }
+        
+        memset(zone, 0, sizeof(*zone));
+        if (snprintf(path, sizeof(path), "%s/type", zone_dir) >= (int)sizeof(path) ||
+            read_string_path(path, zone->info.type, sizeof(zone->info.type)) != 0) {
+            copy_type(zone->info.type, entry->d_name);
+        }
+        
+        // 没有触发点的温区（电池、外壳等）无法估计余量，SoC温区使用默认触发点
+        if (!read_zone_trips(zone_dir, &zone->info.throttle_c, &zone->info.critical_c)) {
+            if (!is_soc_zone(zone->info.type)) {
+                continue;
+            }
+            zone->info.throttle_c = THERMAL_DEFAULT_THROTTLE_C;
+            zone->info.critical_c = THERMAL_DEFAULT_CRITICAL_C;
+        }
+        
+        if (snprintf(path, sizeof(path), "%s/temp", zone_dir) >= (int)sizeof(path)) {
+            continue;
+        }
+        zone->temp_fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (zone->temp_fd < 0) {
+            continue;
+        }
+        
+        zone->info.time_to_throttle_s = -1.0f;
+        LOGI("Thermal zone %s: throttle %.1f C, critical %.1f C", zone->info.type,
+             zone->info.throttle_c, zone->info.critical_c);
+        g_thermal.zone_count++;
+    }
+    closedir(dir);
+}
+
+// 查找devices/system/cpu下的cpufreq（路径过长的条目跳过）
+static void discover_cpus(void) {
+    char path[PATH_MAX];
+    char freq_dir[PATH_MAX];
+    
+    if (snprintf(path, sizeof(path), "%s/devices/system/cpu", g_thermal.root) >= (int)sizeof(path)) {
+        return;
+    }
+    
+    DIR* dir = opendir(path);
+    if (!dir) {
+        return;
+    }
+    
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL && g_thermal.cpu_count < THERMAL_MAX_CPUS) {
+        if (strncmp(entry->d_name, "cpu", 3) != 0 || !isdigit((unsigned char)entry->d_name[3])) {
+            continue;
+        }
+        
+        struct thermal_cpu* cpu = &g_thermal.cpus[g_thermal.cpu_count];
+        long max_khz = 0;
+        
+        if (snprintf(freq_dir, sizeof(freq_dir), "%s/devices/system/cpu/%s/cpufreq", g_thermal.root, entry->d_name) >= (int)sizeof(freq_dir)) {
+            continue;
+        }
+        
+        if (snprintf(path, sizeof(path), "%s/cpuinfo_max_freq", freq_dir) >= (int)sizeof(path) ||
+            read_long_path(path, &max_khz) != 0 || max_khz <= 0) {
+            continue;
+        }
+        
+        if (snprintf(path, sizeof(path), "%s/scaling_cur_freq", freq_dir) >= (int)sizeof(path)) {
+            continue;
+        }
+        cpu->cur_fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (cpu->cur_fd < 0) {
+            continue;
+        }
+        
+        cpu->cap_fd = -1;
+        if (snprintf(path, sizeof(path), "%s/scaling_max_freq", freq_dir) < (int)sizeof(path)) {
+            cpu->cap_fd = open(path, O_RDONLY | O_CLOEXEC);
+        }
+        cpu->max_khz = (float)max_khz;
+        g_thermal.cpu_count++;
+    }
+    closedir(dir);
+}
+
+// 读取温区的触发点：passive/hot中最低的作为节流点，critical中最低的作为危险点
+static bool read_zone_trips(const char* dir, float* throttle_c, float* critical_c) {
+    char path[PATH_MAX];
+    char type[THERMAL_TYPE_SIZE];
+    bool has_throttle = false;
+    bool has_critical = false;
+    
+    for (int i = 0; i < THERMAL_MAX_TRIPS; i++) {
+        long value = 0;
+        
+        if (snprintf(path, sizeof(path), "%s/trip_point_%d_type", dir, i) >= (int)sizeof(path) ||
+            read_string_path(path, type, sizeof(type)) != 0) {
+            break;
+        }
+        if (snprintf(path, sizeof(path), "%s/trip_point_%d_temp", dir, i) >= (int)sizeof(path) ||
+            read_long_path(path, &value) != 0) {
+            continue;
+        }
+        
+        // 未启用的触发点常被设为0或极大值
+        float temp_c = to_celsius(value);
+        if (temp_c <= 0.0f || temp_c > 200.0f) {
+            continue;
+        }
+        
+        if (strcmp(type, "passive") == 0 || strcmp(type, "hot") == 0) {
+            if (!has_throttle || temp_c < *throttle_c) {
+                *throttle_c = temp_c;
+            }
+            has_throttle = true;
+        } else if (strcmp(type, "critical") == 0) {
+            if (!has_critical || temp_c < *critical_c) {
+                *critical_c = temp_c;
+            }
+            has_critical = true;
+        }
+    }
+    
+    if (!has_throttle && !has_critical) {
+        return false;
+    }
+    
+    // 只有一种触发点时推算另一种
+    if (!has_throttle) {
+        *throttle_c = *critical_c - (THERMAL_DEFAULT_CRITICAL_C - THERMAL_DEFAULT_THROTTLE_C);
+    } else if (!has_critical) {
+        *critical_c = *throttle_c + (THERMAL_DEFAULT_CRITICAL_C - THERMAL_DEFAULT_THROTTLE_C);
+    }
+    return true;
+}
+
+// 检查温区是否属于SoC（CPU、GPU或片上传感器）
+static bool is_soc_zone(const char* type) {
+    char lower[THERMAL_TYPE_SIZE];
+    size_t i;
+    
+    for (i = 0; type[i] && i < sizeof(lower) - 1; i++) {
+        lower[i] = (char)tolower((unsigned char)type[i]);
+    }
+    lower[i] = '\0';
+    
+    return strstr(lower, "cpu") || strstr(lower, "gpu") || strstr(lower, "soc") || strstr(lower, "tsens");
+}
+
+// 复制温区类型名（没有type文件时用目录名，过长时截断）
+static void copy_type(char* type, const char* name) {
+    size_t i;
+    
+    for (i = 0; name[i] && i < THERMAL_TYPE_SIZE - 1; i++) {
+        type[i] = name[i];
+    }
+    type[i] = '\0';
+}
+
+// 读取温度和频率，更新各温区的余量趋势和热状态；没有可用读数时按指数退避推迟下一次采样
+static void take_sample(uint64_t now_ns) {
+    TRACE_SCOPE("thermal_sample");
+    
+    struct thermal_governor_stats* stats = &g_thermal.stats;
+    struct thermal_zone* nearest = NULL;   // 余量最小的温区
+    struct thermal_zone* soonest = NULL;   // 按趋势最先到达节流点的温区
+    float critical_margin_c = 0.0f;
+    
+    for (uint32_t i = 0; i < g_thermal.zone_count; i++) {
+        struct thermal_zone* zone = &g_thermal.zones[i];
+        long value = 0;
+        
+        // 关闭的温区读取会失败，恢复后重新开始求趋势
+        zone->valid = read_long_fd(zone->temp_fd, &value) == 0;
+        if (!zone->valid) {
+            zone->has_previous = false;
+            continue;
+        }
+        
+        update_zone(zone, value, now_ns);
+        
+        float margin_c = zone->info.critical_c - zone->info.temp_c;
+        if (!nearest || margin_c < critical_margin_c) {
+            critical_margin_c = margin_c;
+        }
+        if (!nearest || zone->info.headroom_c < nearest->info.headroom_c) {
+            nearest = zone;
+        }
+        if (zone->info.time_to_throttle_s >= 0.0f &&
+            (!soonest || zone->info.time_to_throttle_s < soonest->info.time_to_throttle_s)) {
+            soonest = zone;
+        }
+    }
+    
+    if (!nearest) {
+        uint32_t shift = stats->failed_samples < THERMAL_MAX_BACKOFF_SHIFT ? stats->failed_samples + 1 : THERMAL_MAX_BACKOFF_SHIFT;
+        if (stats->failed_samples == 0) {
+            LOGE("No readable thermal zones, backing off");
+        }
+        stats->failed_samples++;
+        g_thermal.next_sample_ns = now_ns + ((uint64_t)THERMAL_SAMPLE_INTERVAL_MS << shift) * 1000000ULL;
+        publish();
+        atomic_store(&g_thermal.published_state, THERMAL_STATE_NONE);
+        return;
+    }
+    if (stats->failed_samples > 0) {
+        LOGI("Thermal zones readable again after %u failed samples", stats->failed_samples);
+        stats->failed_samples = 0;
+    }
+    
+    // 余量取最小的温区，趋势取最先到达节流点的温区（各温区的趋势分别计算）
+    const struct thermal_zone* trend_zone = soonest ? soonest : nearest;
+    float headroom_c = nearest->info.headroom_c;
+    stats->headroom_c = headroom_c;
+    stats->temp_c = nearest->info.temp_c;
+    snprintf(stats->zone, sizeof(stats->zone), "%s", nearest->info.type);
+    stats->trend_c_per_s = trend_zone->info.trend_c_per_s;
+    stats->time_to_throttle_s = soonest ? soonest->info.time_to_throttle_s : -1.0f;
+    
+    // CPU频率：当前频率反映负载，频率上限反映内核的热限频
+    float freq_sum = 0.0f;
+    float cap_ratio = 1.0f;
+    uint32_t freq_count = 0;
+    for (uint32_t i = 0; i < g_thermal.cpu_count; i++) {
+        struct thermal_cpu* cpu = &g_thermal.cpus[i];
+        long khz = 0;
+        
+        // 离线CPU的cpufreq读取会失败
+        if (read_long_fd(cpu->cur_fd, &khz) == 0) {
+            freq_sum += khz / cpu->max_khz;
+            freq_count++;
+        }
+        if (cpu->cap_fd >= 0 && read_long_fd(cpu->cap_fd, &khz) == 0 && khz / cpu->max_khz < cap_ratio) {
+            cap_ratio = khz / cpu->max_khz;
+        }
+    }
+    stats->freq_ratio = freq_count > 0 ? freq_sum / freq_count : 1.0f;
+    stats->freq_cap_ratio = cap_ratio;
+    
+    // 升级立即生效，降级需要多出滞后余量
+    thermal_state_t state = classify(headroom_c, critical_margin_c, stats->time_to_throttle_s, cap_ratio);
+    if (state < stats->state) {
+        float lead_s = stats->time_to_throttle_s >= 0.0f ? stats->time_to_throttle_s * THERMAL_HYSTERESIS_LEAD : -1.0f;
+        thermal_state_t relaxed = classify(headroom_c - THERMAL_HYSTERESIS_C, critical_margin_c - THERMAL_HYSTERESIS_C,
+                                           lead_s, cap_ratio);
+        state = relaxed < stats->state ? relaxed : stats->state;
+    }
+    
+    if (state != stats->state) {
+        LOGI("Thermal %s -> %s (%s %.1f C, headroom %.1f C, %s trend %.2f C/s, freq cap %.0f%%)",
+             state_name(stats->state), state_name(state), stats->zone, stats->temp_c, headroom_c,
+             trend_zone->info.type, -stats->trend_c_per_s, cap_ratio * 100.0f);
+        stats->state = state;
+    }
+    
+    stats->sample_count++;
+    g_thermal.next_sample_ns = now_ns + THERMAL_SAMPLE_INTERVAL_MS * 1000000ULL;
+    publish();
+    atomic_store(&g_thermal.published_state, (int)state);
+}
+
+// 更新单个温区的温度、余量和余量趋势（平滑后）以及预计到达节流点的时间
+static void update_zone(struct thermal_zone* zone, long value, uint64_t now_ns) {
+    struct thermal_zone_info* info = &zone->info;
+    float headroom_c = info->throttle_c - to_celsius(value);
+    
+    if (zone->has_previous && now_ns > zone->last_read_ns) {
+        float elapsed_s = (now_ns - zone->last_read_ns) / 1e9f;
+        float slope = (headroom_c - info->headroom_c) / elapsed_s;
+        info->trend_c_per_s += THERMAL_TREND_ALPHA * (slope - info->trend_c_per_s);
+    }
+    
+    info->temp_c = to_celsius(value);
+    info->headroom_c = headroom_c;
+    info->time_to_throttle_s = -1.0f;
+    if (info->trend_c_per_s < -THERMAL_MIN_RISE_C_PER_S && headroom_c > 0.0f) {
+        info->time_to_throttle_s = headroom_c / -info->trend_c_per_s;
+    }
+    zone->last_read_ns = now_ns;
+    zone->has_previous = true;
+}
+
+// 发布统计和各温区读数
+static void publish(void) {
+    pthread_mutex_lock(&g_thermal.mutex);
+    g_thermal.published = g_thermal.stats;
+    for (uint32_t i = 0; i < g_thermal.zone_count; i++) {
+        g_thermal.zone_infos[i] = g_thermal.zones[i].info;
+    }
+    pthread_mutex_unlock(&g_thermal.mutex);
+}
+
+// 根据余量、趋势和限频判断热状态
+static thermal_state_t classify(float headroom_c, float critical_margin_c, float time_to_throttle_s, float freq_cap_ratio) {
+    bool approaching = time_to_throttle_s >= 0.0f;
+    
+    if (headroom_c <= 0.0f || critical_margin_c <= THERMAL_CRITICAL_MARGIN_C) {
+        return THERMAL_STATE_CRITICAL;
+    }
+    if (headroom_c <= THERMAL_THROTTLING_HEADROOM_C || freq_cap_ratio < THERMAL_FREQ_CAP_RATIO ||
+        (approaching && time_to_throttle_s <= THERMAL_THROTTLING_LEAD_S)) {
+        return THERMAL_STATE_THROTTLING;
+    }
+    if (headroom_c <= THERMAL_WARNING_HEADROOM_C || (approaching && time_to_throttle_s <= THERMAL_WARNING_LEAD_S)) {
+        return THERMAL_STATE_WARNING;
+    }
+    return THERMAL_STATE_NORMAL;
+}
+
+// 从常开的sysfs文件读取整数
+static int read_long_fd(int fd, long* value) {
+    char buffer[32];
+    ssize_t length = pread(fd, buffer, sizeof(buffer) - 1, 0);
+    if (length <= 0) {
+        return -1;
+    }
+    
+    buffer[length] = '\0';
+    char* end = NULL;
+    *value = strtol(buffer, &end, 10);
+    return end == buffer ? -1 : 0;
+}
+
+// 读取sysfs文件中的整数
+static int read_long_path(const char* path, long* value) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    
+    int result = read_long_fd(fd, value);
+    close(fd);
+    return result;
+}
+
+// 读取sysfs文件中的字符串（去掉换行）
+static int read_string_path(const char* path, char* buffer, size_t size) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    
+    ssize_t length = read(fd, buffer, size - 1);
+    close(fd);
+    if (length <= 0) {
+        return -1;
+    }
+    
+    buffer[length] = '\0';
+    buffer[strcspn(buffer, "\n")] = '\0';
+    return 0;
+}
+
+// 温度单位转换：内核通常以毫摄氏度报告，少数驱动直接报告摄氏度
+static float to_celsius(long value) {
+    if (value > 1000 || value < -1000) {
+        return value / 1000.0f;
+    }
+    return (float)value;
+}
+
+// 获取热状态名称
+static const char* state_name(thermal_state_t state) {
+    switch (state) {
+        case THERMAL_STATE_NORMAL: return "NORMAL";
+        case THERMAL_STATE_WARNING: return "WARNING";
+        case THERMAL_STATE_THROTTLING: return "THROTTLING";
+        case THERMAL_STATE_CRITICAL: return "CRITICAL";
+        default: return "UNKNOWN";
+    }
+}
+
+// 获取单调时钟时间（纳秒）
+static uint64_t thermal_get_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
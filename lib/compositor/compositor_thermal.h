@@ -0,0 +1,78 @@
+#ifndef COMPOSITOR_THERMAL_H
+#define COMPOSITOR_THERMAL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "compositor_perf_opt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 跟踪的温区数上限
+#define THERMAL_MAX_ZONES 16
+// 跟踪的CPU数上限
+#define THERMAL_MAX_CPUS 16
+// 温区类型名长度
+#define THERMAL_TYPE_SIZE 32
+// 采样间隔（毫秒）
+#define THERMAL_SAMPLE_INTERVAL_MS 1000
+// 连续读取失败时采样间隔加倍的最大次数（最长32秒）
+#define THERMAL_MAX_BACKOFF_SHIFT 5
+
+// 单个温区的最近一次读数
+struct thermal_zone_info {
+    char type[THERMAL_TYPE_SIZE];
+    float temp_c;                          // 当前温度（摄氏度）
+    float throttle_c;                      // 开始节流的触发点（passive/hot）
+    float critical_c;                      // 危险触发点
+    float headroom_c;                      // 距节流触发点的余量
+    float trend_c_per_s;                   // 该温区余量的变化趋势（平滑后，负数表示正在升温）
+    float time_to_throttle_s;              // 该温区按当前趋势到达节流点的时间（未升温时为-1）
+};
+
+// 热调节器统计
+struct thermal_governor_stats {
+    uint32_t zone_count;
+    uint32_t cpu_count;
+    char zone[THERMAL_TYPE_SIZE];          // 余量最小的温区
+    float temp_c;                          // 该温区的温度
+    float headroom_c;                      // 所有温区中最小的余量
+    float trend_c_per_s;                   // 最先到达节流点的温区的余量趋势（都未升温时取余量最小的温区）
+    float time_to_throttle_s;              // 各温区按各自趋势到达节流点的最短时间（都未升温时为-1）
+    float freq_ratio;                      // 各CPU当前频率占最高频率的平均比例
+    float freq_cap_ratio;                  // 各CPU频率上限占最高频率的最小比例（小于1表示已被限频）
+    thermal_state_t state;
+    uint64_t sample_count;                 // 有可用读数的采样次数
+    uint32_t failed_samples;               // 连续没有可用读数的采样次数（期间采样间隔逐次加倍）
+};
+
+// 初始化热调节器（sysfs_root为NULL时使用/sys，可指向结构相同的目录树），只查找温区和CPU，不采样
+int thermal_governor_init(const char* sysfs_root);
+
+// 启动后台采样线程（sysfs读取不在渲染线程上进行）
+int thermal_governor_start(void);
+
+// 手动采样一次（仅在未启动采样线程时使用，例如主机测试工具按模拟时间驱动），未到采样时间时不读取
+int thermal_governor_sample(uint64_t now_ns);
+
+// 销毁热调节器
+void thermal_governor_destroy(void);
+
+// 检查是否找到可用的温区
+bool thermal_governor_is_available(void);
+
+// 获取最近一次采样的热状态（无锁，可每帧调用），不可用或最近一次采样没有可用读数时返回-1
+int thermal_governor_get_state(thermal_state_t* state);
+
+// 获取热调节器统计
+void thermal_governor_get_stats(struct thermal_governor_stats* stats);
+
+// 获取各温区的最近一次读数，返回复制的条数
+uint32_t thermal_governor_get_zones(struct thermal_zone_info* zones, uint32_t max_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COMPOSITOR_THERMAL_H
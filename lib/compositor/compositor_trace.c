@@ -0,0 +1,283 @@
+#include "compositor_trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <android/log.h>
+
+#define LOG_TAG "Trace"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+#define TRACE_BUFFER_MASK (TRACE_BUFFER_EVENTS - 1)
+
+// 运行期开关
+atomic_bool g_trace_enabled = false;
+
+// 全局跟踪状态（线程注册无锁，导出之间用互斥锁串行）
+static struct {
+    _Atomic(struct trace_thread_buffer*) buffers[TRACE_MAX_THREADS];
+    atomic_uint thread_count;          // 已分配的槽位数（可能超过上限）
+    atomic_uint rejected_threads;
+    uint64_t events;                   // 已导出的事件数（持有flush_mutex时访问）
+    uint64_t dropped;                  // 导出前被覆盖的事件数（持有flush_mutex时访问）
+    pthread_mutex_t flush_mutex;
+} g_trace = {
+    .flush_mutex = PTHREAD_MUTEX_INITIALIZER
+};
+
+// 当前线程的缓冲区和名称
+static __thread struct trace_thread_buffer* t_buffer = NULL;
+static __thread bool t_rejected = false;
+static __thread char t_name[TRACE_THREAD_NAME_SIZE] = {0};
+
+// 内部函数声明
+static struct trace_thread_buffer* get_thread_buffer(void);
+static void record_event(uint8_t phase, const char* name, int64_t value);
+static uint64_t trace_get_time_ns(void);
+static void write_json_string(FILE* file, const char* text);
+static void write_thread_events(FILE* file, struct trace_thread_buffer* buffer, uint32_t pid, bool* first);
+
+// 启用/禁用跟踪（禁用后已缓冲的事件仍可导出）
+void trace_set_enabled(bool enabled) {
+    atomic_store_explicit(&g_trace_enabled, enabled, memory_order_relaxed);
+    LOGI("Tracing %s", enabled ? "enabled" : "disabled");
+}
+
+// 设置当前线程在时间线上的名称
+void trace_set_thread_name(const char* name) {
+    if (!name) {
+        return;
+    }
+    
+    strncpy(t_name, name, TRACE_THREAD_NAME_SIZE - 1);
+    t_name[TRACE_THREAD_NAME_SIZE - 1] = '\0';
+    
+    // 已注册的缓冲区同步更新，导出时读取
+    if (t_buffer) {
+        memcpy(t_buffer->name, t_name, TRACE_THREAD_NAME_SIZE);
+    }
+}
+
+// 记录区间开始
+void trace_begin(const char* name) {
+    record_event(TRACE_PHASE_BEGIN, name, 0);
+}
+
+// 记录区间结束
+void trace_end(const char* name) {
+    record_event(TRACE_PHASE_END, name, 0);
+}
+
+// 记录瞬时事件
+void trace_instant(const char* name) {
+    record_event(TRACE_PHASE_INSTANT, name, 0);
+}
+
+// 记录计数器
+void trace_counter(const char* name, int64_t value) {
+    record_event(TRACE_PHASE_COUNTER, name, value);
+}
+
+// 把所有线程缓冲的事件导出为Chrome trace-event JSON（可离线用ui.perfetto.dev打开），导出后清空
+int trace_flush(const char* path) {
+    if (!path) {
+        LOGE("Invalid path");
+        return -1;
+    }
+    
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        LOGE("Failed to open file for writing: %s", path);
+        return -1;
+    }
+    
+    pthread_mutex_lock(&g_trace.flush_mutex);
+    
+    uint64_t events_before = g_trace.events;
+    uint32_t pid = (uint32_t)getpid();
+    bool first = true;
+    
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    
+    uint32_t count = atomic_load_explicit(&g_trace.thread_count, memory_order_acquire);
+    if (count > TRACE_MAX_THREADS) {
+        count = TRACE_MAX_THREADS;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        struct trace_thread_buffer* buffer = atomic_load_explicit(&g_trace.buffers[i], memory_order_acquire);
+        if (buffer) {
+            write_thread_events(file, buffer, pid, &first);
+        }
+    }
+    
+    fprintf(file, "\n]}\n");
+    
+    uint64_t written = g_trace.events - events_before;
+    pthread_mutex_unlock(&g_trace.flush_mutex);
+    
+    if (fclose(file) != 0) {
+        LOGE("Failed to write trace: %s", path);
+        return -1;
+    }
+    
+    LOGI("Trace flushed to %s (%llu events)", path, (unsigned long long)written);
+    return 0;
+}
+
+// 丢弃所有缓冲的事件
+void trace_reset(void) {
+    pthread_mutex_lock(&g_trace.flush_mutex);
+    
+    uint32_t count = atomic_load_explicit(&g_trace.thread_count, memory_order_acquire);
+    if (count > TRACE_MAX_THREADS) {
+        count = TRACE_MAX_THREADS;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        struct trace_thread_buffer* buffer = atomic_load_explicit(&g_trace.buffers[i], memory_order_acquire);
+        if (buffer) {
+            buffer->flushed_index = atomic_load_explicit(&buffer->write_index, memory_order_acquire);
+        }
+    }
+    
+    pthread_mutex_unlock(&g_trace.flush_mutex);
+}
+
+// 获取跟踪统计
+void trace_get_stats(struct trace_stats* stats) {
+    if (!stats) {
+        return;
+    }
+    
+    uint32_t count = atomic_load_explicit(&g_trace.thread_count, memory_order_acquire);
+    stats->threads = count > TRACE_MAX_THREADS ? TRACE_MAX_THREADS : count;
+    stats->rejected_threads = atomic_load_explicit(&g_trace.rejected_threads, memory_order_relaxed);
+    
+    pthread_mutex_lock(&g_trace.flush_mutex);
+    stats->events = g_trace.events;
+    stats->dropped = g_trace.dropped;
+    pthread_mutex_unlock(&g_trace.flush_mutex);
+}
+
+// 获取当前线程的缓冲区，第一次记录时分配并注册（缓冲区在进程生命周期内保留，线程退出后仍可导出）
+static struct trace_thread_buffer* get_thread_buffer(void) {
+    if (t_buffer || t_rejected) {
+        return t_buffer;
+    }
+    
+    uint32_t slot = atomic_fetch_add_explicit(&g_trace.thread_count, 1, memory_order_relaxed);
+    if (slot >= TRACE_MAX_THREADS) {
+        atomic_fetch_add_explicit(&g_trace.rejected_threads, 1, memory_order_relaxed);
+        t_rejected = true;
+        return NULL;
+    }
+    
+    struct trace_thread_buffer* buffer = calloc(1, sizeof(struct trace_thread_buffer));
+    if (!buffer) {
+        LOGE("Failed to allocate trace buffer");
+        t_rejected = true;
+        return NULL;
+    }
+    
+    atomic_init(&buffer->write_index, 0);
+    buffer->tid = (uint32_t)gettid();
+    if (t_name[0] != '\0') {
+        memcpy(buffer->name, t_name, TRACE_THREAD_NAME_SIZE);
+    } else {
+        snprintf(buffer->name, TRACE_THREAD_NAME_SIZE, "thread-%u", buffer->tid);
+    }
+    
+    atomic_store_explicit(&g_trace.buffers[slot], buffer, memory_order_release);
+    t_buffer = buffer;
+    return buffer;
+}
+
+// 写入一个事件：只有所属线程写，写完后以release发布索引
+static void record_event(uint8_t phase, const char* name, int64_t value) {
+    if (!name) {
+        return;
+    }
+    
+    struct trace_thread_buffer* buffer = get_thread_buffer();
+    if (!buffer) {
+        return;
+    }
+    
+    uint64_t index = atomic_load_explicit(&buffer->write_index, memory_order_relaxed);
+    struct trace_event* event = &buffer->events[index & TRACE_BUFFER_MASK];
+    event->timestamp_ns = trace_get_time_ns();
+    event->name = name;
+    event->value = value;
+    event->phase = phase;
+    atomic_store_explicit(&buffer->write_index, index + 1, memory_order_release);
+}
+
+// 获取当前时间（纳秒）
+static uint64_t trace_get_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// 写入JSON字符串（转义引号、反斜杠和控制字符）
+static void write_json_string(FILE* file, const char* text) {
+    fputc('"', file);
+    for (const char* p = text; *p; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c == '"' || c == '\\') {
+            fputc('\\', file);
+            fputc(c, file);
+        } else if (c < 0x20) {
+            fprintf(file, "\\u%04x", c);
+        } else {
+            fputc(c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+// 导出一个线程自上次导出以来的事件（持有flush_mutex时调用）
+static void write_thread_events(FILE* file, struct trace_thread_buffer* buffer, uint32_t pid, bool* first) {
+    // 线程名元数据事件
+    fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":",
+            *first ? "" : ",", pid, buffer->tid);
+    write_json_string(file, buffer->name);
+    fprintf(file, "}}");
+    *first = false;
+    
+    uint64_t end = atomic_load_explicit(&buffer->write_index, memory_order_acquire);
+    uint64_t begin = buffer->flushed_index;
+    if (end - begin > TRACE_BUFFER_EVENTS) {
+        g_trace.dropped += end - begin - TRACE_BUFFER_EVENTS;
+        begin = end - TRACE_BUFFER_EVENTS;
+    }
+    
+    for (uint64_t i = begin; i < end; i++) {
+        struct trace_event event = buffer->events[i & TRACE_BUFFER_MASK];
+        
+        // 复制期间写入方可能已绕回覆盖该槽位（正在写的索引为write_index），此时丢弃
+        atomic_thread_fence(memory_order_acquire);
+        uint64_t written = atomic_load_explicit(&buffer->write_index, memory_order_relaxed);
+        if (written - i >= TRACE_BUFFER_EVENTS) {
+            g_trace.dropped++;
+            continue;
+        }
+        
+        fprintf(file, ",\n{\"name\":");
+        write_json_string(file, event.name);
+        fprintf(file, ",\"cat\":\"compositor\",\"ph\":\"%c\",\"ts\":%llu.%03u,\"pid\":%u,\"tid\":%u",
+                event.phase, (unsigned long long)(event.timestamp_ns / 1000),
+                (unsigned)(event.timestamp_ns % 1000), pid, buffer->tid);
+        if (event.phase == TRACE_PHASE_COUNTER) {
+            fprintf(file, ",\"args\":{\"value\":%lld}", (long long)event.value);
+        } else if (event.phase == TRACE_PHASE_INSTANT) {
+            fprintf(file, ",\"s\":\"t\"");
+        }
+        fprintf(file, "}");
+        g_trace.events++;
+    }
+    
+    buffer->flushed_index = end;
+}
@@ -0,0 +1,126 @@
+#ifndef COMPOSITOR_TRACE_H
+#define COMPOSITOR_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 编译期开关：定义为0时所有TRACE_*宏展开为空
+#ifndef COMPOSITOR_ENABLE_TRACE
+#define COMPOSITOR_ENABLE_TRACE 1
+#endif
+
+// 每个线程缓冲的事件数（2的幂，写满后覆盖最早的事件）
+#define TRACE_BUFFER_EVENTS 8192
+// 可记录的线程数上限
+#define TRACE_MAX_THREADS 32
+// 线程名最大长度
+#define TRACE_THREAD_NAME_SIZE 32
+
+// 事件类型（取值为Chrome trace-event的ph字段）
+typedef enum {
+    TRACE_PHASE_BEGIN = 'B',       // 区间开始
+    TRACE_PHASE_END = 'E',         // 区间结束
+    TRACE_PHASE_INSTANT = 'i',     // 瞬时事件
+    TRACE_PHASE_COUNTER = 'C'      // 计数器
+} trace_phase_t;
+
+// 跟踪事件（name必须是静态字符串）
+struct trace_event {
+    uint64_t timestamp_ns;
+    const char* name;
+    int64_t value;                 // 计数器的值
+    uint8_t phase;
+};
+
+// 线程缓冲区（只由所属线程写入，导出时无锁读取）
+struct trace_thread_buffer {
+    struct trace_event events[TRACE_BUFFER_EVENTS];
+    atomic_uint_fast64_t write_index;  // 已写入的事件总数
+    uint64_t flushed_index;            // 已导出的事件总数（持有导出锁时访问）
+    uint32_t tid;
+    char name[TRACE_THREAD_NAME_SIZE];
+};
+
+// 跟踪统计
+struct trace_stats {
+    uint32_t threads;              // 已注册的线程数
+    uint32_t rejected_threads;     // 超出上限而未记录的线程数
+    uint64_t events;               // 已导出的事件数
+    uint64_t dropped;              // 导出前被覆盖的事件数
+};
+
+// 运行期开关（由trace_is_enabled内联读取）
+extern atomic_bool g_trace_enabled;
+
+// 启用/禁用跟踪（禁用后已缓冲的事件仍可导出）
+void trace_set_enabled(bool enabled);
+
+// 检查跟踪是否启用
+static inline bool trace_is_enabled(void) {
+    return atomic_load_explicit(&g_trace_enabled, memory_order_relaxed);
+}
+
+// 设置当前线程在时间线上的名称
+void trace_set_thread_name(const char* name);
+
+// 记录区间开始/结束、瞬时事件和计数器
+void trace_begin(const char* name);
+void trace_end(const char* name);
+void trace_instant(const char* name);
+void trace_counter(const char* name, int64_t value);
+
+// 作用域跟踪的开始和清理函数（供TRACE_SCOPE使用，开始时未启用则结束时也不记录）
+static inline const char* trace_scope_begin(const char* name) {
+    if (!trace_is_enabled()) {
+        return NULL;
+    }
+    
+    trace_begin(name);
+    return name;
+}
+
+static inline void trace_scope_end(const char** name) {
+    if (*name) {
+        trace_end(*name);
+    }
+}
+
+// 把所有线程缓冲的事件导出为Chrome trace-event JSON（可离线用ui.perfetto.dev打开），导出后清空
+int trace_flush(const char* path);
+
+// 丢弃所有缓冲的事件
+void trace_reset(void);
+
+// 获取跟踪统计
+void trace_get_stats(struct trace_stats* stats);
+
+#if COMPOSITOR_ENABLE_TRACE
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_BEGIN(name) do { if (trace_is_enabled()) trace_begin(name); } while (0)
+#define TRACE_END(name) do { if (trace_is_enabled()) trace_end(name); } while (0)
+#define TRACE_INSTANT(name) do { if (trace_is_enabled()) trace_instant(name); } while (0)
+#define TRACE_COUNTER(name, value) do { if (trace_is_enabled()) trace_counter(name, (int64_t)(value)); } while (0)
+// 跟踪到当前作用域结束
+#define TRACE_SCOPE(name) \
+    const char* TRACE_CONCAT(trace_scope_, __LINE__) __attribute__((cleanup(trace_scope_end), unused)) = \
+        trace_scope_begin(name)
+#else
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name) ((void)0)
+#define TRACE_INSTANT(name) ((void)0)
+#define TRACE_COUNTER(name, value) ((void)0)
+#define TRACE_SCOPE(name) ((void)0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COMPOSITOR_TRACE_H
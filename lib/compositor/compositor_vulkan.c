@@ -1,7 +1,12 @@
 #include "compositor_vulkan.h"
 #include "memory_pool.h"
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
 #include <pthread.h>
 #include "android/log.h"
 
@@ -22,6 +27,20 @@ static const char* device_extensions[] = {
 // 启用验证层
 static bool enable_validation_layers = false;
 
+// 内部函数声明
+static void destroy_frame_contexts(struct vulkan_state* vk);
+static void destroy_image_sync_objects(struct vulkan_state* vk);
+static void* render_thread_func(void* arg);
+static void multithread_record_chunks(struct multithread_renderer* renderer, struct render_thread_data* thread_data);
+static VkCommandBuffer multithread_acquire_buffer(struct render_thread_data* thread_data);
+static void multithread_mark_failed(struct multithread_renderer* renderer);
+static void collect_gpu_timings(struct vulkan_state* vk);
+static bool damage_clip_rect(const VkRect2D* rect, const VkRect2D* bounds, VkRect2D* out);
+static void direct_present_barrier(VkCommandBuffer command_buffer, VkImage image, VkImageLayout old_layout,
+                                   VkImageLayout new_layout, VkAccessFlags src_access, VkAccessFlags dst_access,
+                                   VkPipelineStageFlags src_stage, VkPipelineStageFlags dst_stage);
+static VkRect2D damage_union_rect(const VkRect2D* a, const VkRect2D* b);
+
 // 检查验证层支持
 static bool check_validation_layer_support(void) {
     uint32_t layer_count;
@@ -50,6 +69,29 @@ static bool check_validation_layer_support(void) {
     return true;
 }
 
+// 检查物理设备是否支持指定扩展
+static bool check_device_extension_support(VkPhysicalDevice physical_device, const char* name) {
+    uint32_t extension_count = 0;
+    vkEnumerateDeviceExtensionProperties(physical_device, NULL, &extension_count, NULL);
+    
+    VkExtensionProperties* extensions = (VkExtensionProperties*)malloc(sizeof(VkExtensionProperties) * extension_count);
+    if (!extensions) {
+        return false;
+    }
+    vkEnumerateDeviceExtensionProperties(physical_device, NULL, &extension_count, extensions);
+    
+    bool found = false;
+    for (uint32_t i = 0; i < extension_count; i++) {
+        if (strcmp(name, extensions[i].extensionName) == 0) {
+            found = true;
+            break;
+        }
+    }
+    
+    free(extensions);
+    return found;
+}
+
 // 创建Vulkan实例
 static int create_vulkan_instance(struct vulkan_state* vk) {
     if (enable_validation_layers && !check_validation_layer_support()) {
@@ -64,7 +106,7 @@ static int create_vulkan_instance(struct vulkan_state* vk) {
         .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
         .pEngineName = "No Engine",
         .engineVersion = VK_MAKE_VERSION(1, 0, 0),
-        .apiVersion = VK_API_VERSION_1_0
+        .apiVersion = VK_API_VERSION_1_1  // 内存预算查询需要vkGetPhysicalDeviceMemoryProperties2
     };
     
     VkInstanceCreateInfo create_info = {
@@ -100,138 +142,6 @@ static int create_vulkan_instance(struct vulkan_state* vk) {
     return 0;
 }
 
-// 初始化多线程渲染器
-// 注意：实际实现在第524行
-
-
-
-
-    
-    
-
-
-
-
-            free(renderer->threads);
-            pthread_mutex_destroy(&renderer->mutex);
-            pthread_cond_destroy(&renderer->condition);
-            return -1;
-        }
-        
-        // 创建栅栏
-        VkFenceCreateInfo fence_info = {
-            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-            .pNext = NULL,
-            .flags = 0
-        };
-        
-        result = vkCreateFence(vk->device, &fence_info, NULL, &thread_data->fence);
-        if (result != VK_SUCCESS) {
-            LOGE("Failed to create fence for thread %u: %d", i, result);
-            
-            // 清理已创建的资源
-            for (uint32_t j = 0; j < i; j++) {
-                vkDestroyCommandPool(vk->device, renderer->threads[j].command_pool, NULL);
-                vkDestroySemaphore(vk->device, renderer->threads[j].semaphore, NULL);
-                vkDestroyFence(vk->device, renderer->threads[j].fence, NULL);
-            }
-            vkDestroyCommandPool(vk->device, thread_data->command_pool, NULL);
-            vkDestroySemaphore(vk->device, thread_data->semaphore, NULL);
-            free(renderer->threads);
-            pthread_mutex_destroy(&renderer->mutex);
-            pthread_cond_destroy(&renderer->condition);
-            return -1;
-        }
-    }
-    
-    renderer->thread_count = thread_count;
-    renderer->enabled = true;
-    renderer->has_work = false;
-    renderer->work_done = false;
-    
-    // 创建渲染线程
-    for (uint32_t i = 0; i < thread_count; i++) {
-        if (pthread_create(&renderer->threads[i].thread_id, NULL, render_thread_func, &renderer->threads[i]) != 0) {
-            LOGE("Failed to create render thread %u", i);
-            
-            // 设置退出标志并等待已创建的线程退出
-            for (uint32_t j = 0; j < i; j++) {
-                renderer->threads[j].should_exit = true;
-                pthread_cond_signal(&renderer->condition);
-                pthread_join(renderer->threads[j].thread_id, NULL);
-            }
-            
-            // 清理资源
-            for (uint32_t j = 0; j < thread_count; j++) {
-                vkDestroyCommandPool(vk->device, renderer->threads[j].command_pool, NULL);
-                vkDestroySemaphore(vk->device, renderer->threads[j].semaphore, NULL);
-                vkDestroyFence(vk->device, renderer->threads[j].fence, NULL);
-            }
-            free(renderer->threads);
-            pthread_mutex_destroy(&renderer->mutex);
-            pthread_cond_destroy(&renderer->condition);
-            return -1;
-        }
-    }
-    
-    LOGI("Multithread renderer initialized with %u threads", thread_count);
-    return 0;
-}
-
-// 销毁多线程渲染器
-void vulkan_destroy_multithread_renderer(struct vulkan_state* vk) {
-    if (!vk || !vk->multithread_renderer.enabled) {
-        return;
-    }
-    
-    struct multithread_renderer* renderer = &vk->multithread_renderer;
-    
-    // 设置退出标志并通知所有线程
-    pthread_mutex_lock(&renderer->mutex);
-    renderer->enabled = false;
-    for (uint32_t i = 0; i < renderer->thread_count; i++) {
-        renderer->threads[i].should_exit = true;
-    }
-    pthread_cond_broadcast(&renderer->condition);
-    pthread_mutex_unlock(&renderer->mutex);
-    
-    // 等待所有线程退出
-    for (uint32_t i = 0; i < renderer->thread_count; i++) {
-        pthread_join(renderer->threads[i].thread_id, NULL);
-    }
-    
-    // 清理资源
-    for (uint32_t i = 0; i < renderer->thread_count; i++) {
-        struct render_thread_data* thread_data = &renderer->threads[i];
-        
-        if (thread_data->command_pool != VK_NULL_HANDLE) {
-            vkDestroyCommandPool(vk->device, thread_data->command_pool, NULL);
-        }
-        
-        if (thread_data->semaphore != VK_NULL_HANDLE) {
-            vkDestroySemaphore(vk->device, thread_data->semaphore, NULL);
-        }
-        
-        if (thread_data->fence != VK_NULL_HANDLE) {
-            vkDestroyFence(vk->device, thread_data->fence, NULL);
-        }
-    }
-    
-    free(renderer->threads);
-    
-    // 销毁同步对象
-    pthread_mutex_destroy(&renderer->mutex);
-    pthread_cond_destroy(&renderer->condition);
-    
-    memset(renderer, 0, sizeof(struct multithread_renderer));
-    
-    LOGI("Multithread renderer destroyed");
-}
-
-
-
-
-
 // 初始化Android特定优化
 int vulkan_init_android_optimizations(struct vulkan_state* vk) {
     if (!vk || !vk->initialized) {
@@ -421,9 +331,9 @@ int vulkan_update_thermal_throttling(struct vulkan_state* vk, float factor) {
 
 
 
-// 初始化多线程渲染管理器
+// 初始化多线程渲染管理器（thread_count为0时按在线CPU核心数选择）
 int vulkan_init_multithread_renderer(struct vulkan_state* vk, uint32_t thread_count) {
-    if (!vk || thread_count == 0) {
+    if (!vk || vk->device == VK_NULL_HANDLE) {
         LOGE("Invalid parameters");
         return -1;
     }
@@ -431,260 +341,81 @@ int vulkan_init_multithread_renderer(struct vulkan_state* vk, uint32_t thread_co
     struct multithread_renderer* renderer = &vk->multithread_renderer;
     
     // 如果已经初始化，先销毁
-    if (renderer->enabled) {
+    if (renderer->initialized) {
         vulkan_destroy_multithread_renderer(vk);
     }
     
-    // 设置线程数
-    renderer->thread_count = thread_count;
-    
-    // 分配线程数据数组
-    renderer->threads = (struct render_thread_data*)compositor_memory_alloc(sizeof(struct render_thread_data) * thread_count);
-    if (!renderer->threads) {
-        LOGE("Failed to allocate threads data");
-        return -1;
-    }
-    
-    // 初始化互斥锁和条件变量
-    if (pthread_mutex_init(&renderer->mutex, NULL) != 0) {
-        LOGE("Failed to initialize mutex");
-        compositor_memory_free(renderer->threads);
-        compositor_memory_free(renderer->threads_data);
-        return -1;
+    // 调用线程也参与记录，默认工作线程数为核心数减一
+    if (thread_count == 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = cores > 1 ? (uint32_t)(cores - 1) : 1;
     }
-    
-    if (pthread_cond_init(&renderer->condition, NULL) != 0) {
-        LOGE("Failed to initialize condition variable");
-        pthread_mutex_destroy(&renderer->mutex);
-        compositor_memory_free(renderer->threads);
-        compositor_memory_free(renderer->threads_data);
-        return -1;
+    if (thread_count > MULTITHREAD_MAX_THREADS) {
+        thread_count = MULTITHREAD_MAX_THREADS;
     }
     
-    // 初始化工作状态
-    renderer->has_work = false;
-    renderer->work_done = false;
-    
-    // 创建渲染完成信号量
-    VkSemaphoreCreateInfo semaphore_info = {
-        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
-        .pNext = NULL,
-        .flags = 0
-    };
+    memset(renderer, 0, sizeof(struct multithread_renderer));
+    renderer->thread_count = thread_count;
+    renderer->max_chunks = (thread_count + 1) * MULTITHREAD_CHUNKS_PER_THREAD;
     
-    VkResult result = vkCreateSemaphore(vk->device, &semaphore_info, NULL, &renderer->render_complete_semaphore);
-    if (result != VK_SUCCESS) {
-        LOGE("Failed to create render complete semaphore: %d", result);
-        pthread_mutex_destroy(&renderer->mutex);
-        pthread_cond_destroy(&renderer->condition);
-        compositor_memory_free(renderer->threads);
-        compositor_memory_free(renderer->threads_data);
+    // 最后一项线程数据供调用线程使用
+    renderer->threads = (struct render_thread_data*)calloc(thread_count + 1, sizeof(struct render_thread_data));
+    renderer->chunk_buffers = (VkCommandBuffer*)calloc(renderer->max_chunks, sizeof(VkCommandBuffer));
+    if (!renderer->threads || !renderer->chunk_buffers) {
+        LOGE("Failed to allocate render thread data");
+        free(renderer->threads);
+        free(renderer->chunk_buffers);
+        memset(renderer, 0, sizeof(struct multithread_renderer));
         return -1;
     }
     
-    // 初始化每个线程
-    for (uint32_t i = 0; i < thread_count; i++) {
+    pthread_mutex_init(&renderer->mutex, NULL);
+    pthread_cond_init(&renderer->work_cond, NULL);
+    pthread_cond_init(&renderer->done_cond, NULL);
+    atomic_init(&renderer->next_chunk, 0);
+    renderer->initialized = true;
+    
+    // 每个线程每个帧槽一个命令池，命令池只被所属线程访问，记录时无需加锁
+    for (uint32_t i = 0; i <= thread_count; i++) {
         struct render_thread_data* thread_data = &renderer->threads[i];
-        
-        // 设置线程数据
         thread_data->vk = vk;
         thread_data->thread_index = i;
-        thread_data->should_exit = false;
-        thread_data->is_ready = false;
-        thread_data->active = true;
-        
-        // 初始化线程互斥锁和条件变量
-        if (pthread_mutex_init(&thread_data->mutex, NULL) != 0) {
-            LOGE("Failed to initialize thread %u mutex", i);
-            // 清理已创建的资源
-            for (uint32_t j = 0; j < i; j++) {
-                pthread_mutex_destroy(&renderer->threads[j].mutex);
-                pthread_cond_destroy(&renderer->threads[j].condition);
-            }
-            vkDestroySemaphore(vk->device, renderer->render_complete_semaphore, NULL);
-            pthread_mutex_destroy(&renderer->mutex);
-            pthread_cond_destroy(&renderer->condition);
-            compositor_memory_free(renderer->threads);
-            return -1;
-        }
-        
-        if (pthread_cond_init(&thread_data->condition, NULL) != 0) {
-            LOGE("Failed to initialize thread %u condition", i);
-            pthread_mutex_destroy(&thread_data->mutex);
-            // 清理已创建的资源
-            for (uint32_t j = 0; j < i; j++) {
-                pthread_mutex_destroy(&renderer->threads[j].mutex);
-                pthread_cond_destroy(&renderer->threads[j].condition);
-            }
-            vkDestroySemaphore(vk->device, renderer->render_complete_semaphore, NULL);
-            pthread_mutex_destroy(&renderer->mutex);
-            pthread_cond_destroy(&renderer->condition);
-            compositor_memory_free(renderer->threads);
-            return -1;
-        }
-        
-        // 创建命令池
-        VkCommandPoolCreateInfo pool_info = {
-            .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-            .pNext = NULL,
-            .flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
-            .queueFamilyIndex = vk->queue_family_index
-        };
-        
-        result = vkCreateCommandPool(vk->device, &pool_info, NULL, &thread_data->command_pool);
-        if (result != VK_SUCCESS) {
-            LOGE("Failed to create command pool for thread %u: %d", i, result);
-            pthread_mutex_destroy(&thread_data->mutex);
-            pthread_cond_destroy(&thread_data->condition);
-            // 清理已创建的资源
-            for (uint32_t j = 0; j < i; j++) {
-                pthread_mutex_destroy(&renderer->threads[j].mutex);
-                pthread_cond_destroy(&renderer->threads[j].condition);
-                vkDestroyCommandPool(vk->device, renderer->threads[j].command_pool, NULL);
-            }
-            vkDestroySemaphore(vk->device, renderer->render_complete_semaphore, NULL);
-            pthread_mutex_destroy(&renderer->mutex);
-            pthread_cond_destroy(&renderer->condition);
-            compositor_memory_free(renderer->threads);
-            return -1;
-        }
-        
-        // 分配命令缓冲区
-        VkCommandBufferAllocateInfo buffer_info = {
-            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-            .pNext = NULL,
-            .commandPool = thread_data->command_pool,
-            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-            .commandBufferCount = 1
-        };
-        
-        result = vkAllocateCommandBuffers(vk->device, &buffer_info, &thread_data->command_buffer);
-        if (result != VK_SUCCESS) {
-            LOGE("Failed to allocate command buffer for thread %u: %d", i, result);
-            vkDestroyCommandPool(vk->device, thread_data->command_pool, NULL);
-            pthread_mutex_destroy(&thread_data->mutex);
-            pthread_cond_destroy(&thread_data->condition);
-            // 清理已创建的资源
-            for (uint32_t j = 0; j < i; j++) {
-                pthread_mutex_destroy(&renderer->threads[j].mutex);
-                pthread_cond_destroy(&renderer->threads[j].condition);
-                vkDestroyCommandPool(vk->device, renderer->threads[j].command_pool, NULL);
-            }
-            vkDestroySemaphore(vk->device, renderer->render_complete_semaphore, NULL);
-            pthread_mutex_destroy(&renderer->mutex);
-            pthread_cond_destroy(&renderer->condition);
-            compositor_memory_free(renderer->threads);
-            return -1;
-        }
-        
-        // 创建信号量
-        VkSemaphoreCreateInfo semaphore_info = {
-            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
-            .pNext = NULL,
-            .flags = 0
-        };
-        
-        result = vkCreateSemaphore(vk->device, &semaphore_info, NULL, &thread_data->semaphore);
-        if (result != VK_SUCCESS) {
-            LOGE("Failed to create semaphore for thread %u: %d", i, result);
-            vkFreeCommandBuffers(vk->device, thread_data->command_pool, 1, &thread_data->command_buffer);
-            vkDestroyCommandPool(vk->device, thread_data->command_pool, NULL);
-            pthread_mutex_destroy(&thread_data->mutex);
-            pthread_cond_destroy(&thread_data->condition);
-            // 清理已创建的资源
-            for (uint32_t j = 0; j < i; j++) {
-                pthread_mutex_destroy(&renderer->threads[j].mutex);
-                pthread_cond_destroy(&renderer->threads[j].condition);
-                vkDestroyCommandPool(vk->device, renderer->threads[j].command_pool, NULL);
-                vkDestroySemaphore(vk->device, renderer->threads[j].semaphore, NULL);
-                vkFreeCommandBuffers(vk->device, renderer->threads[j].command_pool, 1, &renderer->threads[j].command_buffer);
-            }
-            vkDestroySemaphore(vk->device, renderer->render_complete_semaphore, NULL);
-            pthread_mutex_destroy(&renderer->mutex);
-            pthread_cond_destroy(&renderer->condition);
-            compositor_memory_free(renderer->threads);
-            return -1;
-        }
-        
-        // 创建栅栏
-        VkFenceCreateInfo fence_info = {
-            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-            .pNext = NULL,
-            .flags = VK_FENCE_CREATE_SIGNALED_BIT
-        };
-        
-        result = vkCreateFence(vk->device, &fence_info, NULL, &thread_data->fence);
-        if (result != VK_SUCCESS) {
-            LOGE("Failed to create fence for thread %u: %d", i, result);
-            vkDestroySemaphore(vk->device, thread_data->semaphore, NULL);
-            vkFreeCommandBuffers(vk->device, thread_data->command_pool, 1, &thread_data->command_buffer);
-            vkDestroyCommandPool(vk->device, thread_data->command_pool, NULL);
-            pthread_mutex_destroy(&thread_data->mutex);
-            pthread_cond_destroy(&thread_data->condition);
-            // 清理已创建的资源
-            for (uint32_t j = 0; j < i; j++) {
-                pthread_mutex_destroy(&renderer->threads[j].mutex);
-                pthread_cond_destroy(&renderer->threads[j].condition);
-                vkDestroyCommandPool(vk->device, renderer->threads[j].command_pool, NULL);
-                vkDestroySemaphore(vk->device, renderer->threads[j].semaphore, NULL);
-                vkFreeCommandBuffers(vk->device, renderer->threads[j].command_pool, 1, &renderer->threads[j].command_buffer);
-                vkDestroyFence(vk->device, renderer->threads[j].fence, NULL);
-            }
-            vkDestroySemaphore(vk->device, renderer->render_complete_semaphore, NULL);
-            pthread_mutex_destroy(&renderer->mutex);
-            pthread_cond_destroy(&renderer->condition);
-            compositor_memory_free(renderer->threads);
-            return -1;
-        }
-        
-        // 初始化工作状态
-        thread_data->has_work = false;
-        thread_data->should_exit = false;
-        thread_data->thread_index = i;
-        thread_data->vk = vk;
         
-        // 创建线程
-        if (pthread_create(&thread_data->thread_id, NULL, render_thread_func, thread_data) != 0) {
-            LOGE("Failed to create thread %u", i);
-            vkDestroyFence(vk->device, thread_data->fence, NULL);
-            vkDestroySemaphore(vk->device, thread_data->semaphore, NULL);
-            vkFreeCommandBuffers(vk->device, thread_data->command_pool, 1, &thread_data->command_buffer);
-            vkDestroyCommandPool(vk->device, thread_data->command_pool, NULL);
-            pthread_mutex_destroy(&thread_data->mutex);
-            pthread_cond_destroy(&thread_data->condition);
-            // 清理已创建的资源
-            for (uint32_t j = 0; j < i; j++) {
-                pthread_mutex_destroy(&renderer->threads[j].mutex);
-                pthread_cond_destroy(&renderer->threads[j].condition);
-                vkDestroyCommandPool(vk->device, renderer->threads[j].command_pool, NULL);
-                vkDestroySemaphore(vk->device, renderer->threads[j].semaphore, NULL);
-                vkFreeCommandBuffers(vk->device, renderer->threads[j].command_pool, 1, &renderer->threads[j].command_buffer);
-                vkDestroyFence(vk->device, renderer->threads[j].fence, NULL);
+        for (uint32_t slot = 0; slot < VULKAN_MAX_FRAMES_IN_FLIGHT; slot++) {
+            VkCommandPoolCreateInfo pool_info = {
+                .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                .pNext = NULL,
+                .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+                .queueFamilyIndex = vk->queue_family_index
+            };
+            
+            VkResult result = vkCreateCommandPool(vk->device, &pool_info, NULL, &thread_data->pools[slot].command_pool);
+            if (result != VK_SUCCESS) {
+                LOGE("Failed to create command pool for thread %u: %d", i, result);
+                vulkan_destroy_multithread_renderer(vk);
+                return -1;
             }
-            vkDestroySemaphore(vk->device, renderer->render_complete_semaphore, NULL);
-            pthread_mutex_destroy(&renderer->mutex);
-            pthread_cond_destroy(&renderer->condition);
-            compositor_memory_free(renderer->threads);
-            return -1;
         }
     }
     
-    // 等待所有线程准备就绪
+    // 创建工作线程
     for (uint32_t i = 0; i < thread_count; i++) {
-        while (!renderer->threads[i].is_ready) {
-            usleep(1000); // 1ms
+        struct render_thread_data* thread_data = &renderer->threads[i];
+        if (pthread_create(&thread_data->thread_id, NULL, render_thread_func, thread_data) != 0) {
+            LOGE("Failed to create render thread %u", i);
+            vulkan_destroy_multithread_renderer(vk);
+            return -1;
         }
+        thread_data->started = true;
     }
     
-    // 设置为已启用
     renderer->enabled = true;
-    renderer->initialized = true;
     
-    LOGI("Multithread renderer initialized with %u threads", thread_count);
+    LOGI("Multithread renderer initialized with %u worker threads", thread_count);
     return 0;
 }
 
-// 销毁多线程渲染管理器
+// 销毁多线程渲染管理器（调用方需保证GPU不再使用已记录的次要命令缓冲区）
 void vulkan_destroy_multithread_renderer(struct vulkan_state* vk) {
     if (!vk || !vk->multithread_renderer.initialized) {
         return;
@@ -692,83 +423,228 @@ void vulkan_destroy_multithread_renderer(struct vulkan_state* vk) {
     
     struct multithread_renderer* renderer = &vk->multithread_renderer;
     
-    // 停止所有线程
-    for (uint32_t i = 0; i < renderer->thread_count; i++) {
-        renderer->threads[i].should_exit = true;
-        pthread_cond_signal(&renderer->threads[i].condition);
-        pthread_join(renderer->threads[i].thread_id, NULL);
+    // 通知所有工作线程退出
+    pthread_mutex_lock(&renderer->mutex);
+    renderer->should_exit = true;
+    pthread_cond_broadcast(&renderer->work_cond);
+    pthread_mutex_unlock(&renderer->mutex);
+    
+    for (uint32_t i = 0; i <= renderer->thread_count; i++) {
+        struct render_thread_data* thread_data = &renderer->threads[i];
+        
+        if (thread_data->started) {
+            pthread_join(thread_data->thread_id, NULL);
+        }
         
-        // 清理线程同步对象
-        pthread_mutex_destroy(&renderer->threads[i].mutex);
-        pthread_cond_destroy(&renderer->threads[i].condition);
-        vkDestroyCommandPool(vk->device, renderer->threads[i].command_pool, NULL);
-        vkDestroySemaphore(vk->device, renderer->threads[i].semaphore, NULL);
-        vkDestroyFence(vk->device, renderer->threads[i].fence, NULL);
+        // 销毁命令池（同时释放其中的命令缓冲区）
+        for (uint32_t slot = 0; slot < VULKAN_MAX_FRAMES_IN_FLIGHT; slot++) {
+            struct render_thread_pool* pool = &thread_data->pools[slot];
+            if (pool->command_pool != VK_NULL_HANDLE) {
+                vkDestroyCommandPool(vk->device, pool->command_pool, NULL);
+            }
+            free(pool->buffers);
+        }
     }
     
-    // 销毁信号量
-    if (renderer->render_complete_semaphore != VK_NULL_HANDLE) {
-        vkDestroySemaphore(vk->device, renderer->render_complete_semaphore, NULL);
-        renderer->render_complete_semaphore = VK_NULL_HANDLE;
-    }
+    free(renderer->threads);
+    free(renderer->chunk_buffers);
     
-    // 释放线程资源
-    compositor_memory_free(renderer->threads);
+    pthread_mutex_destroy(&renderer->mutex);
+    pthread_cond_destroy(&renderer->work_cond);
+    pthread_cond_destroy(&renderer->done_cond);
     
     memset(renderer, 0, sizeof(struct multithread_renderer));
     
     LOGI("Multithread renderer destroyed");
 }
 
-// 多线程渲染
-int vulkan_render_multithread(struct vulkan_state* vk, render_task_func_t render_func, void* user_data, 
-                              uint32_t task_count) {
-    if (!vk || !vk->multithread_renderer.initialized || !render_func || task_count == 0) {
+// 多线程记录渲染任务，primary_buffer必须处于以VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS开始的渲染通道中。
+// 任务范围划分为若干块，工作线程和调用线程从共享计数器领取任务块，先完成的线程自动多领；
+// 每块记录到领取线程自己的次要命令缓冲区，最后按块号顺序执行，绘制顺序与线程调度无关
+int vulkan_render_multithread(struct vulkan_state* vk, VkCommandBuffer primary_buffer, render_task_func_t render_func,
+                              void* user_data, uint32_t task_count) {
+    if (!vk || !vk->multithread_renderer.initialized || primary_buffer == VK_NULL_HANDLE || !render_func) {
         LOGE("Invalid parameters");
         return -1;
     }
     
+    if (task_count == 0) {
+        return 0;
+    }
+    
     struct multithread_renderer* renderer = &vk->multithread_renderer;
     
-    // 分配任务给各个线程
-    uint32_t tasks_per_thread = task_count / renderer->thread_count;
-    uint32_t remaining_tasks = task_count % renderer->thread_count;
+    // 按参与线程数划分任务块，块数有上限，块大小随任务数增长
+    uint32_t participants = renderer->enabled ? renderer->thread_count + 1 : 1;
+    uint32_t target_chunks = participants * MULTITHREAD_CHUNKS_PER_THREAD;
+    renderer->chunk_size = (task_count + target_chunks - 1) / target_chunks;
+    renderer->chunk_count = (task_count + renderer->chunk_size - 1) / renderer->chunk_size;
+    
+    // 准备本轮任务
+    renderer->render_func = render_func;
+    renderer->user_data = user_data;
+    renderer->task_count = task_count;
+    renderer->failed = false;
+    renderer->inheritance = (VkCommandBufferInheritanceInfo){
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+        .pNext = NULL,
+        .renderPass = vk->render_pass,
+        .subpass = 0,
+        .framebuffer = VK_NULL_HANDLE,
+        .occlusionQueryEnable = VK_FALSE,
+        .queryFlags = 0,
+        .pipelineStatistics = 0
+    };
+    memset(renderer->chunk_buffers, 0, sizeof(VkCommandBuffer) * renderer->chunk_count);
+    atomic_store(&renderer->next_chunk, 0);
+    
+    // 只有一块时不唤醒工作线程
+    bool dispatch = renderer->enabled && renderer->chunk_count > 1;
+    if (dispatch) {
+        pthread_mutex_lock(&renderer->mutex);
+        renderer->active_workers = renderer->thread_count;
+        renderer->generation++;
+        pthread_cond_broadcast(&renderer->work_cond);
+        pthread_mutex_unlock(&renderer->mutex);
+    }
+    
+    // 调用线程同样领取任务块
+    multithread_record_chunks(renderer, &renderer->threads[renderer->thread_count]);
+    
+    // 等待工作线程完成本轮
+    if (dispatch) {
+        pthread_mutex_lock(&renderer->mutex);
+        while (renderer->active_workers > 0) {
+            pthread_cond_wait(&renderer->done_cond, &renderer->mutex);
+        }
+        pthread_mutex_unlock(&renderer->mutex);
+    }
+    
+    if (renderer->failed) {
+        LOGE("Failed to record secondary command buffers");
+        return -1;
+    }
+    
+    // 按块号顺序执行
+    vkCmdExecuteCommands(primary_buffer, renderer->chunk_count, renderer->chunk_buffers);
+    return 0;
+}
+
+// 渲染工作线程：等待新一轮任务，领取任务块直到取完
+static void* render_thread_func(void* arg) {
+    struct render_thread_data* thread_data = (struct render_thread_data*)arg;
+    struct multithread_renderer* renderer = &thread_data->vk->multithread_renderer;
+    uint64_t generation = 0;
     
-    for (uint32_t i = 0; i < renderer->thread_count; i++) {
-        struct render_thread_data* thread_data = &renderer->threads[i];
+    pthread_mutex_lock(&renderer->mutex);
+    while (true) {
+        while (!renderer->should_exit && renderer->generation == generation) {
+            pthread_cond_wait(&renderer->work_cond, &renderer->mutex);
+        }
+        
+        if (renderer->should_exit) {
+            break;
+        }
+        
+        generation = renderer->generation;
+        pthread_mutex_unlock(&renderer->mutex);
+        
+        multithread_record_chunks(renderer, thread_data);
+        
+        pthread_mutex_lock(&renderer->mutex);
+        if (--renderer->active_workers == 0) {
+            pthread_cond_signal(&renderer->done_cond);
+        }
+    }
+    pthread_mutex_unlock(&renderer->mutex);
+    
+    return NULL;
+}
+
+// 从共享任务范围领取任务块并记录到本线程的次要命令缓冲区
+static void multithread_record_chunks(struct multithread_renderer* renderer, struct render_thread_data* thread_data) {
+    VkCommandBufferBeginInfo begin_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = NULL,
+        .flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = &renderer->inheritance
+    };
+    
+    while (true) {
+        uint32_t chunk = atomic_fetch_add_explicit(&renderer->next_chunk, 1, memory_order_relaxed);
+        if (chunk >= renderer->chunk_count) {
+            break;
+        }
+        
+        VkCommandBuffer command_buffer = multithread_acquire_buffer(thread_data);
+        if (command_buffer == VK_NULL_HANDLE || vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS) {
+            multithread_mark_failed(renderer);
+            continue;
+        }
         
-        // 准备任务
-        thread_data->task.render_func = render_func;
-        thread_data->task.user_data = user_data;
-        thread_data->task.task_id = i;
-        thread_data->task.start_task = i * tasks_per_thread;
-        thread_data->task.end_task = thread_data->task.start_task + tasks_per_thread;
+        uint32_t first = chunk * renderer->chunk_size;
+        uint32_t last = first + renderer->chunk_size;
+        if (last > renderer->task_count) {
+            last = renderer->task_count;
+        }
+        
+        for (uint32_t task = first; task < last; task++) {
+            renderer->render_func(command_buffer, task, renderer->user_data);
+        }
         
-        // 分配剩余任务
-        if (i < remaining_tasks) {
-            thread_data->task.end_task++;
+        if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
+            multithread_mark_failed(renderer);
+            continue;
         }
         
-        // 通知线程有新任务
-        pthread_mutex_lock(&thread_data->mutex);
-        thread_data->has_work = true;
-        pthread_cond_signal(&thread_data->condition);
-        pthread_mutex_unlock(&thread_data->mutex);
+        renderer->chunk_buffers[chunk] = command_buffer;
+        thread_data->chunks_recorded++;
+    }
+}
+
+// 从本线程当前帧槽的命令池取一个次要命令缓冲区，不够时追加分配
+static VkCommandBuffer multithread_acquire_buffer(struct render_thread_data* thread_data) {
+    struct vulkan_state* vk = thread_data->vk;
+    struct render_thread_pool* pool = &thread_data->pools[vk->frame_index];
+    
+    // 帧槽的栅栏已在vulkan_begin_frame中等待，本帧第一次使用时整体重置
+    if (pool->reset_frame != vk->current_frame + 1) {
+        vkResetCommandPool(vk->device, pool->command_pool, 0);
+        pool->used = 0;
+        pool->reset_frame = vk->current_frame + 1;
     }
     
-    // 等待所有线程完成
-    for (uint32_t i = 0; i < renderer->thread_count; i++) {
-        pthread_mutex_lock(&renderer->threads[i].mutex);
-        while (renderer->threads[i].has_work) {
-            pthread_cond_wait(&renderer->threads[i].condition, &renderer->threads[i].mutex);
+    if (pool->used == pool->buffer_count) {
+        VkCommandBuffer* buffers = (VkCommandBuffer*)realloc(pool->buffers,
+                                                             sizeof(VkCommandBuffer) * (pool->buffer_count + 1));
+        if (!buffers) {
+            return VK_NULL_HANDLE;
+        }
+        pool->buffers = buffers;
+        
+        VkCommandBufferAllocateInfo alloc_info = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .pNext = NULL,
+            .commandPool = pool->command_pool,
+            .level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+            .commandBufferCount = 1
+        };
+        
+        if (vkAllocateCommandBuffers(vk->device, &alloc_info, &pool->buffers[pool->buffer_count]) != VK_SUCCESS) {
+            return VK_NULL_HANDLE;
         }
-        pthread_mutex_unlock(&renderer->threads[i].mutex);
+        pool->buffer_count++;
     }
     
-    return 0;
+    return pool->buffers[pool->used++];
 }
 
-
+// 记录失败标志（工作线程可能同时写入，加锁保护）
+static void multithread_mark_failed(struct multithread_renderer* renderer) {
+    pthread_mutex_lock(&renderer->mutex);
+    renderer->failed = true;
+    pthread_mutex_unlock(&renderer->mutex);
+}
 
 // 创建Android表面
 static int create_android_surface(struct vulkan_state* vk, ANativeWindow* window) {
@@ -826,53 +702,134 @@ static int pick_physical_device(struct vulkan_state* vk) {
         }
     }
     
-    free(queue_families);
-    
     if (vk->queue_family_index == UINT32_MAX) {
         LOGE("Failed to find a suitable queue family!");
+        free(queue_families);
         return -1;
     }
     
-    // 创建逻辑设备
-    VkDeviceQueueCreateInfo queue_create_info = {
-        .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-        .pNext = NULL,
-        .flags = 0,
-        .queueFamilyIndex = vk->queue_family_index,
-        .queueCount = 1,
-        .pQueuePriorities = &(float){1.0f}
-    };
-    
     VkPhysicalDeviceFeatures device_features = {
         .fillModeNonSolid = VK_TRUE,
     };
     
-    VkDeviceCreateInfo device_create_info = {
-        .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
-        .pNext = NULL,
-        .flags = 0,
-        .queueCreateInfoCount = 1,
-        .pQueueCreateInfos = &queue_create_info,
-        .enabledLayerCount = 0,
-        .ppEnabledLayerNames = NULL,
-        .enabledExtensionCount = sizeof(device_extensions) / sizeof(device_extensions[0]),
-        .ppEnabledExtensionNames = device_extensions,
-        .pEnabledFeatures = &device_features
-    };
+    // 驱动支持时用真实的内存预算代替按堆大小估算
+    const char* enabled_extensions[sizeof(device_extensions) / sizeof(device_extensions[0]) + 3];
+    uint32_t enabled_extension_count = 0;
+    for (size_t i = 0; i < sizeof(device_extensions) / sizeof(device_extensions[0]); i++) {
+        enabled_extensions[enabled_extension_count++] = device_extensions[i];
+    }
     
-    if (enable_validation_layers) {
-        device_create_info.enabledLayerCount = sizeof(validation_layers) / sizeof(validation_layers[0]);
-        device_create_info.ppEnabledLayerNames = validation_layers;
+    VkPhysicalDeviceProperties device_properties;
+    vkGetPhysicalDeviceProperties(physical_device, &device_properties);
+    vk->memory_budget_enabled = device_properties.apiVersion >= VK_API_VERSION_1_1 &&
+                                check_device_extension_support(physical_device, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if (vk->memory_budget_enabled) {
+        enabled_extensions[enabled_extension_count++] = VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
     }
     
-    VkResult result = vkCreateDevice(physical_device, NULL, &device_create_info, &vk->device);
-    if (result != VK_SUCCESS) {
-        LOGE("Failed to create logical device: %d", result);
-        return -1;
+    // 可选扩展：把损伤区域告诉呈现引擎，只合成改变的部分
+    vk->damage.incremental_present = check_device_extension_support(physical_device,
+                                                                     VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME);
+    if (vk->damage.incremental_present) {
+        enabled_extensions[enabled_extension_count++] = VK_KHR_INCREMENTAL_PRESENT_EXTENSION_NAME;
+    }
+    
+    // 可选扩展：后台纹理上传用时间线信号量把完成的上传交给图形队列
+    VkPhysicalDeviceTimelineSemaphoreFeatures timeline_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES,
+        .pNext = NULL,
+        .timelineSemaphore = VK_FALSE
+    };
+    if (device_properties.apiVersion >= VK_API_VERSION_1_1 &&
+        check_device_extension_support(physical_device, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME)) {
+        VkPhysicalDeviceFeatures2 features2 = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+            .pNext = &timeline_features
+        };
+        vkGetPhysicalDeviceFeatures2(physical_device, &features2);
+    }
+    vk->uploader.timeline_supported = timeline_features.timelineSemaphore == VK_TRUE;
+    if (vk->uploader.timeline_supported) {
+        enabled_extensions[enabled_extension_count++] = VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME;
+    }
+    
+    // 上传队列：优先用只支持传输的队列族（通常对应DMA引擎），其次是图形队列族的第二个队列，
+    // 都没有或不支持时间线信号量时与图形队列共用
+    uint32_t upload_family = vk->queue_family_index;
+    uint32_t upload_queue_index = 0;
+    if (vk->uploader.timeline_supported) {
+        for (uint32_t i = 0; i < queue_family_count; i++) {
+            VkQueueFlags flags = queue_families[i].queueFlags;
+            if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) &&
+                queue_families[i].queueCount > 0) {
+                upload_family = i;
+                break;
+            }
+        }
+        if (upload_family == vk->queue_family_index && queue_families[vk->queue_family_index].queueCount > 1) {
+            upload_queue_index = 1;
+        }
+    }
+    
+    free(queue_families);
+    
+    // 创建逻辑设备
+    float queue_priorities[2] = {1.0f, 0.5f};
+    VkDeviceQueueCreateInfo queue_create_infos[2] = {
+        {
+            .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .queueFamilyIndex = vk->queue_family_index,
+            .queueCount = upload_queue_index + 1,
+            .pQueuePriorities = queue_priorities
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .queueFamilyIndex = upload_family,
+            .queueCount = 1,
+            .pQueuePriorities = &queue_priorities[1]
+        }
+    };
+    uint32_t queue_create_info_count = upload_family != vk->queue_family_index ? 2 : 1;
+    
+    VkPhysicalDeviceTimelineSemaphoreFeatures timeline_enable = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES,
+        .pNext = NULL,
+        .timelineSemaphore = VK_TRUE
+    };
+    
+    VkDeviceCreateInfo device_create_info = {
+        .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+        .pNext = vk->uploader.timeline_supported ? &timeline_enable : NULL,
+        .flags = 0,
+        .queueCreateInfoCount = queue_create_info_count,
+        .pQueueCreateInfos = queue_create_infos,
+        .enabledLayerCount = 0,
+        .ppEnabledLayerNames = NULL,
+        .enabledExtensionCount = enabled_extension_count,
+        .ppEnabledExtensionNames = enabled_extensions,
+        .pEnabledFeatures = &device_features
+    };
+    
+    if (enable_validation_layers) {
+        device_create_info.enabledLayerCount = sizeof(validation_layers) / sizeof(validation_layers[0]);
+        device_create_info.ppEnabledLayerNames = validation_layers;
+    }
+    
+    VkResult result = vkCreateDevice(physical_device, NULL, &device_create_info, &vk->device);
+    if (result != VK_SUCCESS) {
+        LOGE("Failed to create logical device: %d", result);
+        return -1;
     }
     
     // 获取队列
     vkGetDeviceQueue(vk->device, vk->queue_family_index, 0, &vk->queue);
+    vkGetDeviceQueue(vk->device, upload_family, upload_queue_index, &vk->uploader.queue);
+    vk->uploader.queue_family_index = upload_family;
+    vk->uploader.dedicated_queue = upload_family != vk->queue_family_index || upload_queue_index > 0;
     
     return 0;
 }
@@ -944,6 +901,18 @@ static int create_swapchain(struct vulkan_state* vk) {
         image_count = capabilities.maxImageCount;
     }
     
+    // 表面支持时交换链图像也可作为复制目标，用于全屏窗口的直接呈现
+    VkImageUsageFlags image_usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    vk->swapchain_transfer_dst = (capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) != 0;
+    if (vk->swapchain_transfer_dst) {
+        image_usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    }
+    
+    VkFormatProperties format_properties;
+    vkGetPhysicalDeviceFormatProperties(vk->physical_device, surface_format.format, &format_properties);
+    vk->swapchain_format = surface_format.format;
+    vk->swapchain_blit_dst = (format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT) != 0;
+    
     // 创建交换链
     VkSwapchainCreateInfoKHR swapchain_create_info = {
         .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
@@ -955,7 +924,7 @@ static int create_swapchain(struct vulkan_state* vk) {
         .imageColorSpace = surface_format.colorSpace,
         .imageExtent = extent,
         .imageArrayLayers = 1,
-        .imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+        .imageUsage = image_usage,
         .imageSharingMode = VK_SHARING_MODE_EXCLUSIVE,
         .queueFamilyIndexCount = 0,
         .pQueueFamilyIndices = NULL,
@@ -1073,6 +1042,17 @@ static int create_render_pass(struct vulkan_state* vk) {
         return -1;
     }
     
+    // 局部重绘的渲染通道：加载上次呈现的内容，只有renderArea内的像素被改写。
+    // 两个渲染通道只有加载操作和初始布局不同，帧缓冲区和次要命令缓冲区可以通用
+    color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    color_attachment.initialLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    
+    result = vkCreateRenderPass(vk->device, &render_pass_info, NULL, &vk->render_pass_load);
+    if (result != VK_SUCCESS) {
+        LOGE("Failed to create load render pass: %d", result);
+        return -1;
+    }
+    
     return 0;
 }
 
@@ -1125,32 +1105,38 @@ static int create_command_pool(struct vulkan_state* vk) {
     return 0;
 }
 
-// 创建命令缓冲区
-static int create_command_buffers(struct vulkan_state* vk) {
-    vk->command_buffers = (VkCommandBuffer*)malloc(sizeof(VkCommandBuffer) * vk->image_count);
-    
-    VkCommandBufferAllocateInfo alloc_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-        .pNext = NULL,
-        .commandPool = vk->command_pool,
-        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = vk->image_count
-    };
-    
-    VkResult result = vkAllocateCommandBuffers(vk->device, &alloc_info, vk->command_buffers);
-    if (result != VK_SUCCESS) {
-        LOGE("Failed to allocate command buffers: %d", result);
+// 创建帧上传区
+static int create_frame_upload_arena(struct vulkan_state* vk, struct frame_upload_arena* arena) {
+    // 主机可见的内存块由分配器常驻映射
+    if (vulkan_alloc_create_buffer(&vk->allocator, VULKAN_FRAME_UPLOAD_SIZE,
+                                   VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                                   VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                   &arena->buffer, &arena->allocation) != 0) {
+        LOGE("Failed to create frame upload arena");
         return -1;
     }
     
+    arena->mapped = arena->allocation.mapped;
+    arena->size = VULKAN_FRAME_UPLOAD_SIZE;
+    arena->offset = 0;
     return 0;
 }
 
-// 创建同步对象
-static int create_sync_objects(struct vulkan_state* vk) {
-    vk->image_available_semaphores = (VkSemaphore*)malloc(sizeof(VkSemaphore) * vk->image_count);
-    vk->render_finished_semaphores = (VkSemaphore*)malloc(sizeof(VkSemaphore) * vk->image_count);
-    vk->in_flight_fences = (VkFence*)malloc(sizeof(VkFence) * vk->image_count);
+// 创建在途帧资源（每帧独立的命令池、命令缓冲区、同步对象和上传区）
+static int create_frame_contexts(struct vulkan_state* vk) {
+    vk->frames = (struct frame_context*)calloc(vk->frames_in_flight, sizeof(struct frame_context));
+    if (!vk->frames) {
+        LOGE("Failed to allocate frame contexts");
+        return -1;
+    }
+    
+    VkCommandPoolCreateInfo pool_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .pNext = NULL,
+        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        .queueFamilyIndex = vk->queue_family_index
+    };
     
     VkSemaphoreCreateInfo semaphore_info = {
         .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
@@ -1164,22 +1150,110 @@ static int create_sync_objects(struct vulkan_state* vk) {
         .flags = VK_FENCE_CREATE_SIGNALED_BIT
     };
     
-    for (size_t i = 0; i < vk->image_count; i++) {
-        VkResult result = vkCreateSemaphore(vk->device, &semaphore_info, NULL, &vk->image_available_semaphores[i]);
+    for (uint32_t i = 0; i < vk->frames_in_flight; i++) {
+        struct frame_context* frame = &vk->frames[i];
+        
+        VkResult result = vkCreateCommandPool(vk->device, &pool_info, NULL, &frame->command_pool);
+        if (result != VK_SUCCESS) {
+            LOGE("Failed to create command pool for frame %u: %d", i, result);
+            destroy_frame_contexts(vk);
+            return -1;
+        }
+        
+        VkCommandBufferAllocateInfo alloc_info = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+            .pNext = NULL,
+            .commandPool = frame->command_pool,
+            .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+            .commandBufferCount = 1
+        };
+        
+        result = vkAllocateCommandBuffers(vk->device, &alloc_info, &frame->command_buffer);
+        if (result != VK_SUCCESS) {
+            LOGE("Failed to allocate command buffer for frame %u: %d", i, result);
+            destroy_frame_contexts(vk);
+            return -1;
+        }
+        
+        result = vkCreateSemaphore(vk->device, &semaphore_info, NULL, &frame->image_available);
         if (result != VK_SUCCESS) {
-            LOGE("Failed to create image available semaphore %zu: %d", i, result);
+            LOGE("Failed to create image available semaphore %u: %d", i, result);
+            destroy_frame_contexts(vk);
             return -1;
         }
         
-        result = vkCreateSemaphore(vk->device, &semaphore_info, NULL, &vk->render_finished_semaphores[i]);
+        result = vkCreateFence(vk->device, &fence_info, NULL, &frame->in_flight);
         if (result != VK_SUCCESS) {
-            LOGE("Failed to create render finished semaphore %zu: %d", i, result);
+            LOGE("Failed to create fence %u: %d", i, result);
+            destroy_frame_contexts(vk);
             return -1;
         }
         
-        result = vkCreateFence(vk->device, &fence_info, NULL, &vk->in_flight_fences[i]);
+        if (create_frame_upload_arena(vk, &frame->upload) != 0) {
+            LOGE("Failed to create upload arena for frame %u", i);
+            destroy_frame_contexts(vk);
+            return -1;
+        }
+    }
+    
+    vk->frame_index = 0;
+    return 0;
+}
+
+// 销毁在途帧资源（调用前需确保GPU空闲）
+static void destroy_frame_contexts(struct vulkan_state* vk) {
+    if (!vk->frames) {
+        return;
+    }
+    
+    for (uint32_t i = 0; i < vk->frames_in_flight; i++) {
+        struct frame_context* frame = &vk->frames[i];
+        
+        vulkan_alloc_destroy_buffer(&vk->allocator, frame->upload.buffer, &frame->upload.allocation);
+        if (frame->in_flight != VK_NULL_HANDLE) {
+            vkDestroyFence(vk->device, frame->in_flight, NULL);
+        }
+        if (frame->image_available != VK_NULL_HANDLE) {
+            vkDestroySemaphore(vk->device, frame->image_available, NULL);
+        }
+        // 销毁命令池会一并释放其中的命令缓冲区
+        if (frame->command_pool != VK_NULL_HANDLE) {
+            vkDestroyCommandPool(vk->device, frame->command_pool, NULL);
+        }
+    }
+    
+    free(vk->frames);
+    vk->frames = NULL;
+    
+    // 图像不再属于任何帧
+    if (vk->images_in_flight) {
+        memset(vk->images_in_flight, 0, sizeof(VkFence) * vk->image_count);
+    }
+}
+
+// 创建按交换链图像索引的同步对象
+static int create_image_sync_objects(struct vulkan_state* vk) {
+    vk->render_finished_semaphores = (VkSemaphore*)calloc(vk->image_count, sizeof(VkSemaphore));
+    vk->images_in_flight = (VkFence*)calloc(vk->image_count, sizeof(VkFence));
+    vk->damage.image_frame = (uint64_t*)calloc(vk->image_count, sizeof(uint64_t));
+    if (!vk->render_finished_semaphores || !vk->images_in_flight || !vk->damage.image_frame) {
+        LOGE("Failed to allocate image sync objects");
+        destroy_image_sync_objects(vk);
+        return -1;
+    }
+    
+    VkSemaphoreCreateInfo semaphore_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0
+    };
+    
+    // 呈现引擎何时读完信号量是未知的，只有再次获取同一图像时才能确定，所以按图像分配
+    for (uint32_t i = 0; i < vk->image_count; i++) {
+        VkResult result = vkCreateSemaphore(vk->device, &semaphore_info, NULL, &vk->render_finished_semaphores[i]);
         if (result != VK_SUCCESS) {
-            LOGE("Failed to create fence %zu: %d", i, result);
+            LOGE("Failed to create render finished semaphore %u: %d", i, result);
+            destroy_image_sync_objects(vk);
             return -1;
         }
     }
@@ -1187,6 +1261,26 @@ static int create_sync_objects(struct vulkan_state* vk) {
     return 0;
 }
 
+// 销毁按交换链图像索引的同步对象
+static void destroy_image_sync_objects(struct vulkan_state* vk) {
+    if (vk->render_finished_semaphores) {
+        for (uint32_t i = 0; i < vk->image_count; i++) {
+            if (vk->render_finished_semaphores[i] != VK_NULL_HANDLE) {
+                vkDestroySemaphore(vk->device, vk->render_finished_semaphores[i], NULL);
+            }
+        }
+    }
+    
+    free(vk->render_finished_semaphores);
+    vk->render_finished_semaphores = NULL;
+    free(vk->images_in_flight);
+    vk->images_in_flight = NULL;
+    
+    // 新的交换链图像内容未定义，下一次使用时整帧重绘
+    free(vk->damage.image_frame);
+    vk->damage.image_frame = NULL;
+}
+
 // 初始化Vulkan
 int vulkan_init(struct vulkan_state* vk, ANativeWindow* window, int width, int height) {
     if (!vk || !window || width <= 0 || height <= 0) {
@@ -1197,6 +1291,8 @@ int vulkan_init(struct vulkan_state* vk, ANativeWindow* window, int width, int h
     memset(vk, 0, sizeof(struct vulkan_state));
     vk->width = width;
     vk->height = height;
+    vk->frames_in_flight = VULKAN_DEFAULT_FRAMES_IN_FLIGHT;
+    pthread_mutex_init(&vk->queue_mutex, NULL);
     
     // 创建Vulkan实例
     if (create_vulkan_instance(vk) != 0) {
@@ -1218,6 +1314,13 @@ int vulkan_init(struct vulkan_state* vk, ANativeWindow* window, int width, int h
         return -1;
     }
     
+    // 初始化设备内存子分配器
+    if (vulkan_alloc_init(&vk->allocator, vk->physical_device, vk->device, vk->memory_budget_enabled) != 0) {
+        LOGE("Failed to initialize memory allocator");
+        vulkan_destroy(vk);
+        return -1;
+    }
+    
     // 创建交换链
     if (create_swapchain(vk) != 0) {
         LOGE("Failed to create swap chain");
@@ -1246,15 +1349,15 @@ int vulkan_init(struct vulkan_state* vk, ANativeWindow* window, int width, int h
         return -1;
     }
     
-    // 创建命令缓冲区
-    if (create_command_buffers(vk) != 0) {
-        LOGE("Failed to create command buffers");
+    // 创建在途帧资源
+    if (create_frame_contexts(vk) != 0) {
+        LOGE("Failed to create frame contexts");
         vulkan_destroy(vk);
         return -1;
     }
     
-    // 创建同步对象
-    if (create_sync_objects(vk) != 0) {
+    // 创建按图像索引的同步对象
+    if (create_image_sync_objects(vk) != 0) {
         LOGE("Failed to create sync objects");
         vulkan_destroy(vk);
         return -1;
@@ -1275,7 +1378,7 @@ int vulkan_init(struct vulkan_state* vk, ANativeWindow* window, int width, int h
     }
     
     // 初始化多线程渲染管理器
-    if (vulkan_init_multithread_renderer(vk, 2) != 0) {
+    if (vulkan_init_multithread_renderer(vk, 0) != 0) {
         LOGE("Failed to initialize multithread renderer");
         vulkan_destroy(vk);
         return -1;
@@ -1288,6 +1391,15 @@ int vulkan_init(struct vulkan_state* vk, ANativeWindow* window, int width, int h
         return -1;
     }
     
+    // 初始化GPU计时（不支持时间戳的设备上只是不产生结果）
+    vulkan_init_gpu_timer(vk);
+    
+    // 初始化静态层的离屏缓存（失败时各层直接绘制）
+    vulkan_layer_cache_init(vk);
+    
+    // 启动后台纹理上传（失败时上传请求被拒绝）
+    vulkan_upload_init(vk);
+    
     vk->initialized = true;
     LOGI("Vulkan initialized successfully");
     return 0;
@@ -1302,6 +1414,9 @@ void vulkan_destroy(struct vulkan_state* vk) {
     // 销毁Android特定优化
     vulkan_destroy_android_optimizations(vk);
     
+    // 保存并销毁管线缓存
+    vulkan_destroy_pipeline_cache(vk);
+    
     // 销毁多线程渲染管理器
     vulkan_destroy_multithread_renderer(vk);
     
@@ -1311,32 +1426,26 @@ void vulkan_destroy(struct vulkan_state* vk) {
     // 销毁命令缓冲区缓存
     vulkan_destroy_command_buffer_cache(vk);
     
-    vkDeviceWaitIdle(vk->device);
+    // 停止上传线程（之后没有其他线程提交），回收上传的图像
+    vulkan_upload_destroy(vk);
     
-    // 清理同步对象
-    for (uint32_t i = 0; i < vk->image_count; i++) {
-        if (vk->image_available_semaphores && vk->image_available_semaphores[i] != VK_NULL_HANDLE) {
-            vkDestroySemaphore(vk->device, vk->image_available_semaphores[i], NULL);
-        }
-        if (vk->render_finished_semaphores && vk->render_finished_semaphores[i] != VK_NULL_HANDLE) {
-            vkDestroySemaphore(vk->device, vk->render_finished_semaphores[i], NULL);
-        }
-        if (vk->in_flight_fences && vk->in_flight_fences[i] != VK_NULL_HANDLE) {
-            vkDestroyFence(vk->device, vk->in_flight_fences[i], NULL);
-        }
-    }
+    vulkan_device_wait_idle(vk);
     
-    free(vk->image_available_semaphores);
-    free(vk->render_finished_semaphores);
-    free(vk->in_flight_fences);
+    // 销毁GPU计时器
+    vulkan_destroy_gpu_timer(vk);
+    
+    // 销毁层缓存（图像内存需在分配器销毁前释放）
+    vulkan_layer_cache_destroy(vk);
+    
+    // 清理在途帧资源和同步对象
+    destroy_frame_contexts(vk);
+    destroy_image_sync_objects(vk);
     
     // 清理命令池
     if (vk->command_pool != VK_NULL_HANDLE) {
         vkDestroyCommandPool(vk->device, vk->command_pool, NULL);
     }
     
-    free(vk->command_buffers);
-    
     // 清理帧缓冲区
     for (uint32_t i = 0; i < vk->image_count; i++) {
         if (vk->framebuffers && vk->framebuffers[i] != VK_NULL_HANDLE) {
@@ -1350,6 +1459,9 @@ void vulkan_destroy(struct vulkan_state* vk) {
     if (vk->render_pass != VK_NULL_HANDLE) {
         vkDestroyRenderPass(vk->device, vk->render_pass, NULL);
     }
+    if (vk->render_pass_load != VK_NULL_HANDLE) {
+        vkDestroyRenderPass(vk->device, vk->render_pass_load, NULL);
+    }
     
     // 清理图像视图
     for (uint32_t i = 0; i < vk->image_count; i++) {
@@ -1366,6 +1478,9 @@ void vulkan_destroy(struct vulkan_state* vk) {
         vkDestroySwapchainKHR(vk->device, vk->swapchain, NULL);
     }
     
+    // 所有缓冲区销毁后释放内存块
+    vulkan_alloc_destroy(&vk->allocator);
+    
     // 清理设备
     if (vk->device != VK_NULL_HANDLE) {
         vkDestroyDevice(vk->device, NULL);
@@ -1381,6 +1496,7 @@ void vulkan_destroy(struct vulkan_state* vk) {
         vkDestroyInstance(vk->instance, NULL);
     }
     
+    pthread_mutex_destroy(&vk->queue_mutex);
     memset(vk, 0, sizeof(struct vulkan_state));
     LOGI("Vulkan destroyed");
 }
@@ -1392,7 +1508,10 @@ int vulkan_recreate_swapchain(struct vulkan_state* vk, int width, int height) {
         return -1;
     }
     
-    vkDeviceWaitIdle(vk->device);
+    vulkan_device_wait_idle(vk);
+    
+    // 旧交换链销毁时一并释放保留的图像
+    vk->has_retained_image = false;
     
     // 清理旧的交换链相关资源
     for (uint32_t i = 0; i < vk->image_count; i++) {
@@ -1404,6 +1523,9 @@ int vulkan_recreate_swapchain(struct vulkan_state* vk, int width, int height) {
     free(vk->image_views);
     free(vk->images);
     
+    // 图像数量可能变化，按图像索引的同步对象需要重建
+    destroy_image_sync_objects(vk);
+    
     vkDestroySwapchainKHR(vk->device, vk->swapchain, NULL);
     
     // 更新尺寸
@@ -1422,6 +1544,12 @@ int vulkan_recreate_swapchain(struct vulkan_state* vk, int width, int height) {
         return -1;
     }
     
+    // 重新创建按图像索引的同步对象
+    if (create_image_sync_objects(vk) != 0) {
+        LOGE("Failed to recreate sync objects");
+        return -1;
+    }
+    
     // 重新初始化批处理管理器
     vulkan_destroy_batch_manager(vk);
     if (vulkan_init_batch_manager(vk, 100, 10000, 20000) != 0) {
@@ -1429,16 +1557,21 @@ int vulkan_recreate_swapchain(struct vulkan_state* vk, int width, int height) {
         return -1;
     }
     
+    // 层缓存图像与屏幕同尺寸，需要重建
+    if (vk->layer_cache.initialized && vulkan_layer_cache_resize(vk, width, height) != 0) {
+        LOGE("Failed to resize layer cache");
+    }
+    
     // 重新初始化多线程渲染管理器
     vulkan_destroy_multithread_renderer(vk);
-    if (vulkan_init_multithread_renderer(vk, 2) != 0) {
+    if (vulkan_init_multithread_renderer(vk, 0) != 0) {
         LOGE("Failed to reinitialize multithread renderer");
         return -1;
     }
     
     // 标记所有命令缓冲区为脏，因为帧缓冲区已改变
     if (vk->use_command_buffer_cache) {
-        for (uint32_t i = 0; i < vk->image_count; i++) {
+        for (uint32_t i = 0; i < vk->frames_in_flight; i++) {
             vk->primary_cache[i].is_dirty = true;
             vk->primary_cache[i].is_recorded = false;
         }
@@ -1460,33 +1593,53 @@ int vulkan_begin_frame(struct vulkan_state* vk, uint32_t* image_index) {
         return -1;
     }
     
-    // 开始新的批处理
-    vulkan_begin_batch(vk);
+    struct frame_context* frame = &vk->frames[vk->frame_index];
     
-    // 等待上一帧完成
-    vkWaitForFences(vk->device, 1, &vk->in_flight_fences[vk->current_image], VK_TRUE, UINT64_MAX);
-    vkResetFences(vk->device, 1, &vk->in_flight_fences[vk->current_image]);
+    // 等待该帧槽上一次提交的GPU工作完成，CPU最多领先GPU frames_in_flight帧
+    vkWaitForFences(vk->device, 1, &frame->in_flight, VK_TRUE, UINT64_MAX);
     
-    // 获取下一个图像
-    VkResult result = vkAcquireNextImageKHR(vk->device, vk->swapchain, UINT64_MAX, 
-                                           vk->image_available_semaphores[vk->current_image], 
-                                           VK_NULL_HANDLE, image_index);
+    // 获取下一个图像，上一帧放弃时保留的图像仍归本程序所有，直接使用
+    if (vk->has_retained_image) {
+        *image_index = vk->retained_image;
+        vk->has_retained_image = false;
+        frame->image_available_pending = false;
+    } else {
+        VkResult result = vkAcquireNextImageKHR(vk->device, vk->swapchain, UINT64_MAX,
+                                                frame->image_available,
+                                                VK_NULL_HANDLE, image_index);
+        
+        if (result != VK_SUCCESS) {
+            LOGE("Failed to acquire next image: %d", result);
+            return -1;
+        }
+        frame->image_available_pending = true;
+    }
     
-    if (result != VK_SUCCESS) {
-        LOGE("Failed to acquire next image: %d", result);
-        return -1;
+    // 图像数量多于在途帧数时，获取到的图像可能仍被另一个帧槽使用
+    VkFence image_fence = vk->images_in_flight[*image_index];
+    if (image_fence != VK_NULL_HANDLE && image_fence != frame->in_flight) {
+        vkWaitForFences(vk->device, 1, &image_fence, VK_TRUE, UINT64_MAX);
     }
+    // 栅栏在提交前才重置：获取之后的任何失败都由vulkan_abort_frame提交空批次信号栅栏
+    vk->images_in_flight[*image_index] = frame->in_flight;
     
-    // 检查是否需要重置命令缓冲区
-    if (!vk->use_command_buffer_cache || vk->primary_cache[*image_index].is_dirty) {
-        // 重置命令缓冲区
-        vkResetCommandBuffer(vk->command_buffers[*image_index], 0);
-        
-        // 更新缓存状态
-        if (vk->use_command_buffer_cache) {
-            vk->primary_cache[*image_index].is_recorded = false;
-            vk->primary_cache[*image_index].is_dirty = false;
-        }
+    // 本帧槽的GPU工作已完成，读回上次在本帧槽测得的GPU耗时
+    collect_gpu_timings(vk);
+    
+    // 交接已完成的纹理上传，回收不再引用的旧图像
+    vulkan_upload_begin_frame(vk);
+    
+    // 整体重置命令池和上传区
+    vkResetCommandPool(vk->device, frame->command_pool, 0);
+    frame->upload.offset = 0;
+    
+    // 开始新的批处理，切换到本帧槽的流式缓冲区分区
+    vulkan_reset_batches(vk);
+    
+    // 更新缓存状态
+    if (vk->use_command_buffer_cache) {
+        vk->primary_cache[vk->frame_index].is_recorded = false;
+        vk->primary_cache[vk->frame_index].is_dirty = false;
     }
     
     return 0;
@@ -1499,40 +1652,86 @@ int vulkan_end_frame(struct vulkan_state* vk, uint32_t image_index) {
         return -1;
     }
     
-    // 结束当前批处理
-    vulkan_end_batch(vk);
+    // 命令缓冲区已由调用方记录完成，这里只负责提交和呈现
+    struct frame_context* frame = &vk->frames[vk->frame_index];
     
-    // 使用多线程渲染批处理
-    if (vk->multithread_renderer.enabled) {
-        vulkan_render_multithread(vk, vk->command_buffers[image_index]);
-    } else {
-        // 单线程渲染批处理
-        vulkan_render_batches(vk, vk->command_buffers[image_index]);
+    // 等待图像获取（保留的图像没有新的获取），本帧开始采样刚交接的纹理时等待其上传的时间线值（交接时已完成，只保证写入可见）
+    VkSemaphore wait_semaphores[2];
+    VkPipelineStageFlags wait_stages[2];
+    uint64_t wait_values[2] = {0, 0};
+    uint32_t wait_count = 0;
+    bool wait_upload = false;
+    if (frame->image_available_pending) {
+        wait_semaphores[wait_count] = frame->image_available;
+        wait_stages[wait_count++] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    }
+    if (vulkan_upload_get_frame_wait(vk, &wait_semaphores[wait_count], &wait_values[wait_count])) {
+        wait_stages[wait_count++] = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+        wait_upload = true;
     }
     
+    VkTimelineSemaphoreSubmitInfo timeline_info = {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .pNext = NULL,
+        .waitSemaphoreValueCount = wait_count,
+        .pWaitSemaphoreValues = wait_values,
+        .signalSemaphoreValueCount = 0,
+        .pSignalSemaphoreValues = NULL
+    };
+    
     // 提交命令缓冲区
     VkSubmitInfo submit_info = {
         .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .pNext = NULL,
-        .waitSemaphoreCount = 1,
-        .pWaitSemaphores = &vk->image_available_semaphores[image_index],
-        .pWaitDstStageMask = &(VkPipelineStageFlags){VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT},
+        .pNext = wait_upload ? &timeline_info : NULL,
+        .waitSemaphoreCount = wait_count,
+        .pWaitSemaphores = wait_semaphores,
+        .pWaitDstStageMask = wait_stages,
         .commandBufferCount = 1,
-        .pCommandBuffers = &vk->command_buffers[image_index],
+        .pCommandBuffers = &frame->command_buffer,
         .signalSemaphoreCount = 1,
         .pSignalSemaphores = &vk->render_finished_semaphores[image_index]
     };
     
-    VkResult result = vkQueueSubmit(vk->queue, 1, &submit_info, vk->in_flight_fences[image_index]);
+    // 上传线程可能共用图形队列，提交和呈现须互斥
+    pthread_mutex_lock(&vk->queue_mutex);
+    
+    vkResetFences(vk->device, 1, &frame->in_flight);
+    VkResult result = vkQueueSubmit(vk->queue, 1, &submit_info, frame->in_flight);
     if (result != VK_SUCCESS) {
+        pthread_mutex_unlock(&vk->queue_mutex);
         LOGE("Failed to submit command buffer: %d", result);
+        vulkan_abort_frame(vk, image_index);
         return -1;
     }
+    frame->image_available_pending = false;
+    
+    struct timespec submit_end;
+    clock_gettime(CLOCK_MONOTONIC, &submit_end);
+    vk->submit_end_ns = (uint64_t)submit_end.tv_sec * 1000000000ULL + (uint64_t)submit_end.tv_nsec;
+    
+    // 图像已绘制，之后的局部重绘以本帧为基准
+    if (vk->damage.image_frame) {
+        vk->damage.image_frame[image_index] = vk->current_frame + 1;
+    }
+    
+    // 增量呈现：只告诉呈现引擎本帧改变的区域
+    VkPresentRegionKHR present_region = {
+        .rectangleCount = vk->damage.present_rect_count,
+        .pRectangles = vk->damage.present_rects
+    };
+    VkPresentRegionsKHR present_regions = {
+        .sType = VK_STRUCTURE_TYPE_PRESENT_REGIONS_KHR,
+        .pNext = NULL,
+        .swapchainCount = 1,
+        .pRegions = &present_region
+    };
+    bool incremental = vk->damage.incremental_present && vk->damage.present_rect_count > 0;
+    vk->damage.present_rect_count = 0;
     
     // 呈现
     VkPresentInfoKHR present_info = {
         .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
-        .pNext = NULL,
+        .pNext = incremental ? &present_regions : NULL,
         .waitSemaphoreCount = 1,
         .pWaitSemaphores = &vk->render_finished_semaphores[image_index],
         .swapchainCount = 1,
@@ -1542,17 +1741,66 @@ int vulkan_end_frame(struct vulkan_state* vk, uint32_t image_index) {
     };
     
     result = vkQueuePresentKHR(vk->queue, &present_info);
+    pthread_mutex_unlock(&vk->queue_mutex);
+    
+    // 已提交的帧槽一定会信号栅栏，呈现失败也前进到下一个帧槽
+    vk->frame_index = (vk->frame_index + 1) % vk->frames_in_flight;
+    
+    // 更新帧计数
+    vulkan_update_frame_counter(vk);
+    
     if (result != VK_SUCCESS) {
         LOGE("Failed to present queue: %d", result);
         return -1;
     }
     
-    vk->current_image = (vk->current_image + 1) % vk->image_count;
+    return 0;
+}
+
+// 放弃已开始但无法提交的帧：提交只等待图像获取并信号帧栅栏的空批次，保证帧槽退役，图像留给下一帧
+void vulkan_abort_frame(struct vulkan_state* vk, uint32_t image_index) {
+    if (!vk || !vk->initialized || !vk->frames) {
+        return;
+    }
     
-    // 更新帧计数
-    vulkan_update_frame_counter(vk);
+    struct frame_context* frame = &vk->frames[vk->frame_index];
+    VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    VkSubmitInfo submit_info = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = NULL,
+        .waitSemaphoreCount = frame->image_available_pending ? 1 : 0,
+        .pWaitSemaphores = &frame->image_available,
+        .pWaitDstStageMask = &wait_stage,
+        .commandBufferCount = 0,
+        .pCommandBuffers = NULL,
+        .signalSemaphoreCount = 0,
+        .pSignalSemaphores = NULL
+    };
     
-    return 0;
+    pthread_mutex_lock(&vk->queue_mutex);
+    vkResetFences(vk->device, 1, &frame->in_flight);
+    VkResult result = vkQueueSubmit(vk->queue, 1, &submit_info, frame->in_flight);
+    pthread_mutex_unlock(&vk->queue_mutex);
+    if (result != VK_SUCCESS) {
+        // 设备丢失时等待栅栏会返回错误而不是阻塞
+        LOGE("Failed to retire aborted frame: %d", result);
+    }
+    frame->image_available_pending = false;
+    
+    // 图像已获取但未呈现，下一帧直接使用，不再重复获取
+    if (image_index < vk->image_count) {
+        vk->retained_image = image_index;
+        vk->has_retained_image = true;
+    }
+    
+    vk->frame_index = (vk->frame_index + 1) % vk->frames_in_flight;
+}
+
+// 等待设备空闲：vkDeviceWaitIdle要求外部同步设备上的所有队列，上传线程可能正在提交
+void vulkan_device_wait_idle(struct vulkan_state* vk) {
+    pthread_mutex_lock(&vk->queue_mutex);
+    vkDeviceWaitIdle(vk->device);
+    pthread_mutex_unlock(&vk->queue_mutex);
 }
 
 // 初始化命令缓冲区缓存
@@ -1562,16 +1810,16 @@ int vulkan_init_command_buffer_cache(struct vulkan_state* vk, uint32_t secondary
         return -1;
     }
     
-    // 分配主要命令缓冲区缓存
-    vk->primary_cache = (struct command_buffer_cache*)malloc(sizeof(struct command_buffer_cache) * vk->image_count);
+    // 分配主要命令缓冲区缓存（每个在途帧一个）
+    vk->primary_cache = (struct command_buffer_cache*)malloc(sizeof(struct command_buffer_cache) * vk->frames_in_flight);
     if (!vk->primary_cache) {
         LOGE("Failed to allocate primary command buffer cache");
         return -1;
     }
     
     // 初始化主要命令缓冲区缓存
-    for (uint32_t i = 0; i < vk->image_count; i++) {
-        vk->primary_cache[i].command_buffer = vk->command_buffers[i];
+    for (uint32_t i = 0; i < vk->frames_in_flight; i++) {
+        vk->primary_cache[i].command_buffer = vk->frames[i].command_buffer;
         vk->primary_cache[i].is_recorded = false;
         vk->primary_cache[i].is_dirty = true;
         vk->primary_cache[i].last_used_frame = 0;
@@ -1632,7 +1880,7 @@ int vulkan_init_command_buffer_cache(struct vulkan_state* vk, uint32_t secondary
     vk->use_command_buffer_cache = true;
     
     LOGI("Command buffer cache initialized with %u primary and %u secondary buffers", 
-         vk->image_count, secondary_buffer_count);
+         vk->frames_in_flight, secondary_buffer_count);
     
     return 0;
 }
@@ -1677,7 +1925,7 @@ VkCommandBuffer vulkan_get_cached_command_buffer(struct vulkan_state* vk, comman
     }
     
     if (type == COMMAND_BUFFER_TYPE_PRIMARY) {
-        if (index >= vk->image_count) {
+        if (index >= vk->frames_in_flight) {
             return VK_NULL_HANDLE;
         }
         return vk->primary_cache[index].command_buffer;
@@ -1698,7 +1946,7 @@ void vulkan_mark_command_buffer_dirty(struct vulkan_state* vk, command_buffer_ty
     }
     
     if (type == COMMAND_BUFFER_TYPE_PRIMARY) {
-        if (index < vk->image_count) {
+        if (index < vk->frames_in_flight) {
             vk->primary_cache[index].is_dirty = true;
         }
     } else if (type == COMMAND_BUFFER_TYPE_SECONDARY) {
@@ -1784,6 +2032,19 @@ void vulkan_execute_cached_command_buffers(struct vulkan_state* vk, VkCommandBuf
     }
 }
 
+// 执行单个缓存的次要命令缓冲区
+void vulkan_execute_cached_command_buffer(struct vulkan_state* vk, VkCommandBuffer primary_buffer, uint32_t index) {
+    if (!vk || !vk->use_command_buffer_cache || primary_buffer == VK_NULL_HANDLE || index >= vk->secondary_buffer_count) {
+        return;
+    }
+    
+    struct command_buffer_cache* cache = &vk->secondary_cache[index];
+    if (cache->is_recorded && !cache->is_dirty) {
+        vkCmdExecuteCommands(primary_buffer, 1, &cache->command_buffer);
+        cache->last_used_frame = vk->current_frame;
+    }
+}
+
 // 更新帧计数
 void vulkan_update_frame_counter(struct vulkan_state* vk) {
     if (!vk) {
@@ -1802,122 +2063,244 @@ VkFramebuffer vulkan_get_current_framebuffer(struct vulkan_state* vk, uint32_t i
     return vk->framebuffers[image_index];
 }
 
-// 获取命令缓冲区
+// 获取命令缓冲区（当前在途帧的主命令缓冲区）
 VkCommandBuffer vulkan_get_command_buffer(struct vulkan_state* vk, uint32_t image_index) {
-    if (!vk || !vk->initialized || image_index >= vk->image_count) {
+    if (!vk || !vk->initialized || !vk->frames || image_index >= vk->image_count) {
         return VK_NULL_HANDLE;
     }
     
-    return vk->command_buffers[image_index];
+    return vk->frames[vk->frame_index].command_buffer;
 }
 
-// 创建缓冲区
-static int create_buffer(struct vulkan_state* vk, VkDeviceSize size, VkBufferUsageFlags usage, 
-                         VkMemoryPropertyFlags properties, VkBuffer* buffer, VkDeviceMemory* buffer_memory) {
-    VkBufferCreateInfo buffer_info = {
-        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
-        .pNext = NULL,
-        .flags = 0,
-        .size = size,
-        .usage = usage,
-        .sharingMode = VK_SHARING_MODE_EXCLUSIVE
-    };
-    
-    VkResult result = vkCreateBuffer(vk->device, &buffer_info, NULL, buffer);
-    if (result != VK_SUCCESS) {
-        LOGE("Failed to create buffer: %d", result);
+// 设置同时在途的帧数（1-VULKAN_MAX_FRAMES_IN_FLIGHT）
+int vulkan_set_frames_in_flight(struct vulkan_state* vk, uint32_t count) {
+    if (!vk || !vk->initialized || count == 0 || count > VULKAN_MAX_FRAMES_IN_FLIGHT) {
+        LOGE("Invalid parameters");
         return -1;
     }
     
-    VkMemoryRequirements mem_requirements;
-    vkGetBufferMemoryRequirements(vk->device, *buffer, &mem_requirements);
+    if (count == vk->frames_in_flight) {
+        return 0;
+    }
     
-    VkMemoryAllocateInfo alloc_info = {
-        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-        .pNext = NULL,
-        .allocationSize = mem_requirements.size,
-        .memoryTypeIndex = 0  // 需要实现查找合适内存类型的函数
-    };
+    // 先让所有在途帧完成再重建帧环
+    vulkan_device_wait_idle(vk);
+    destroy_frame_contexts(vk);
     
-    // 简化实现：假设第一个内存类型合适
-    result = vkAllocateMemory(vk->device, &alloc_info, NULL, buffer_memory);
-    if (result != VK_SUCCESS) {
-        LOGE("Failed to allocate buffer memory: %d", result);
-        vkDestroyBuffer(vk->device, *buffer, NULL);
-        return -1;
+    uint32_t old_count = vk->frames_in_flight;
+    vk->frames_in_flight = count;
+    
+    if (create_frame_contexts(vk) != 0) {
+        LOGE("Failed to create %u frame contexts, restoring %u", count, old_count);
+        vk->frames_in_flight = old_count;
+        if (create_frame_contexts(vk) != 0) {
+            return -1;
+        }
     }
     
-    vkBindBufferMemory(vk->device, *buffer, *buffer_memory, 0);
+    // 主要命令缓冲区缓存与帧环一一对应
+    if (vk->primary_cache) {
+        struct command_buffer_cache* cache = (struct command_buffer_cache*)realloc(
+            vk->primary_cache, sizeof(struct command_buffer_cache) * vk->frames_in_flight);
+        if (!cache) {
+            LOGE("Failed to reallocate primary command buffer cache");
+            return -1;
+        }
+        
+        vk->primary_cache = cache;
+        for (uint32_t i = 0; i < vk->frames_in_flight; i++) {
+            cache[i].command_buffer = vk->frames[i].command_buffer;
+            cache[i].is_recorded = false;
+            cache[i].is_dirty = true;
+            cache[i].last_used_frame = 0;
+        }
+    }
     
-    return 0;
+    LOGI("Frames in flight set to %u (%u swapchain images)", vk->frames_in_flight, vk->image_count);
+    return vk->frames_in_flight == count ? 0 : -1;
 }
 
-// 初始化批处理管理器
-int vulkan_init_batch_manager(struct vulkan_state* vk, uint32_t max_batches, 
-                              uint32_t vertex_capacity, uint32_t index_capacity) {
-    if (!vk || !vk->initialized || max_batches == 0 || vertex_capacity == 0 || index_capacity == 0) {
-        LOGE("Invalid parameters");
-        return -1;
+// 从当前帧上传区分配，返回映射地址（本帧GPU工作完成后自动回收）
+void* vulkan_frame_upload_alloc(struct vulkan_state* vk, VkDeviceSize size, VkDeviceSize alignment,
+                                VkBuffer* buffer, VkDeviceSize* offset) {
+    if (!vk || !vk->frames || size == 0 || !buffer || !offset) {
+        return NULL;
     }
     
-    struct batch_manager* manager = &vk->batch_manager;
-    memset(manager, 0, sizeof(struct batch_manager));
+    // 对齐必须是2的幂
+    if (alignment == 0) {
+        alignment = 1;
+    }
+    if ((alignment & (alignment - 1)) != 0) {
+        LOGE("Invalid upload alignment: %llu", (unsigned long long)alignment);
+        return NULL;
+    }
     
-    // 分配批次数组
-    manager->batches = (struct render_batch*)compositor_memory_alloc(sizeof(struct render_batch) * max_batches);
-    if (!manager->batches) {
-        LOGE("Failed to allocate batches");
+    struct frame_upload_arena* arena = &vk->frames[vk->frame_index].upload;
+    VkDeviceSize aligned = (arena->offset + alignment - 1) & ~(alignment - 1);
+    if (aligned + size > arena->size) {
+        LOGE("Frame upload arena exhausted: %llu + %llu > %llu", (unsigned long long)aligned,
+             (unsigned long long)size, (unsigned long long)arena->size);
+        return NULL;
+    }
+    
+    arena->offset = aligned + size;
+    *buffer = arena->buffer;
+    *offset = aligned;
+    return (uint8_t*)arena->mapped + aligned;
+}
+
+// 创建流式环形缓冲区（每个在途帧一个分区，常驻映射）
+static int stream_ring_init(struct vulkan_state* vk, struct stream_ring* ring, VkDeviceSize partition_size,
+                            VkBufferUsageFlags usage) {
+    memset(ring, 0, sizeof(struct stream_ring));
+    ring->usage = usage;
+    ring->partition_count = vk->frames_in_flight;
+    
+    VkDeviceSize total = partition_size * ring->partition_count;
+    if (vulkan_alloc_create_buffer(&vk->allocator, total, usage,
+                                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                   &ring->buffer, &ring->allocation) != 0) {
+        LOGE("Failed to create stream ring");
+        memset(ring, 0, sizeof(struct stream_ring));
         return -1;
     }
     
-    // 初始化批次数组
+    ring->mapped = (uint8_t*)ring->allocation.mapped;
+    ring->partition_size = partition_size;
+    ring->partition = vk->frame_index;
+    return 0;
+}
+
+// 销毁流式环形缓冲区（调用前需确保GPU空闲）
+static void stream_ring_destroy(struct vulkan_state* vk, struct stream_ring* ring) {
+    for (uint32_t i = 0; i < ring->garbage_count; i++) {
+        vulkan_alloc_destroy_buffer(&vk->allocator, ring->garbage[i].buffer, &ring->garbage[i].allocation);
+    }
+    
+    vulkan_alloc_destroy_buffer(&vk->allocator, ring->buffer, &ring->allocation);
+    memset(ring, 0, sizeof(struct stream_ring));
+}
+
+// 切换到当前帧的分区并回收已退役的旧缓冲区
+static void stream_ring_begin_frame(struct vulkan_state* vk, struct stream_ring* ring) {
+    // 帧槽的栅栏已在vulkan_begin_frame中等待，该分区上次写入的数据已被GPU消费
+    ring->partition = vk->frame_index;
+    ring->used = 0;
+    
+    // 替换后又经过了一整圈在途帧，引用旧缓冲区的帧都已完成
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < ring->garbage_count; i++) {
+        struct stream_ring_garbage* garbage = &ring->garbage[i];
+        
+        if (vk->current_frame >= garbage->retire_frame + vk->frames_in_flight) {
+            vulkan_alloc_destroy_buffer(&vk->allocator, garbage->buffer, &garbage->allocation);
+        } else {
+            ring->garbage[kept++] = *garbage;
+        }
+    }
+    ring->garbage_count = kept;
+}
+
+// 扩容流式环形缓冲区，保留当前分区已写入的数据
+static int stream_ring_grow(struct vulkan_state* vk, struct stream_ring* ring, VkDeviceSize min_partition_size) {
+    VkDeviceSize new_size = ring->partition_size * 2;
+    while (new_size < min_partition_size) {
+        new_size *= 2;
+    }
+    
+    // 待回收列表已满时只能等待GPU空闲后全部释放
+    if (ring->garbage_count >= STREAM_RING_MAX_GARBAGE) {
+        vulkan_device_wait_idle(vk);
+        for (uint32_t i = 0; i < ring->garbage_count; i++) {
+            vulkan_alloc_destroy_buffer(&vk->allocator, ring->garbage[i].buffer, &ring->garbage[i].allocation);
+        }
+        ring->garbage_count = 0;
+    }
+    
+    struct stream_ring old = *ring;
+    if (stream_ring_init(vk, ring, new_size, old.usage) != 0) {
+        LOGE("Failed to grow stream ring to %llu bytes per frame", (unsigned long long)new_size);
+        *ring = old;
+        return -1;
+    }
+    
+    // 本帧已写入的数据搬到新缓冲区的同一分区，本帧只引用新缓冲区
+    memcpy(ring->mapped + ring->partition * new_size,
+           old.mapped + old.partition * old.partition_size, (size_t)old.used);
+    ring->partition = old.partition;
+    ring->used = old.used;
+    
+    // 旧缓冲区可能仍被之前的在途帧使用，延迟到它们完成后释放
+    memcpy(ring->garbage, old.garbage, sizeof(old.garbage));
+    ring->garbage_count = old.garbage_count;
+    ring->garbage[ring->garbage_count].buffer = old.buffer;
+    ring->garbage[ring->garbage_count].allocation = old.allocation;
+    ring->garbage[ring->garbage_count].retire_frame = vk->current_frame;
+    ring->garbage_count++;
+    
+    LOGI("Stream ring grown to %llu bytes per frame", (unsigned long long)new_size);
+    return 0;
+}
+
+// 在当前分区中预留空间，返回写入地址
+static void* stream_ring_reserve(struct vulkan_state* vk, struct stream_ring* ring, VkDeviceSize size) {
+    if (ring->used + size > ring->partition_size &&
+        stream_ring_grow(vk, ring, ring->used + size) != 0) {
+        return NULL;
+    }
+    
+    void* ptr = ring->mapped + ring->partition * ring->partition_size + ring->used;
+    ring->used += size;
+    return ptr;
+}
+
+// 初始化批处理管理器
+int vulkan_init_batch_manager(struct vulkan_state* vk, uint32_t max_batches, 
+                              uint32_t vertex_capacity, uint32_t index_capacity) {
+    if (!vk || !vk->initialized || max_batches == 0 || vertex_capacity == 0 || index_capacity == 0) {
+        LOGE("Invalid parameters");
+        return -1;
+    }
+    
+    struct batch_manager* manager = &vk->batch_manager;
+    memset(manager, 0, sizeof(struct batch_manager));
+    
+    // 分配批次数组
+    manager->batches = (struct render_batch*)compositor_memory_alloc(sizeof(struct render_batch) * max_batches);
+    if (!manager->batches) {
+        LOGE("Failed to allocate batches");
+        return -1;
+    }
+    
+    // 初始化批次数组
     memset(manager->batches, 0, sizeof(struct render_batch) * max_batches);
     manager->max_batches = max_batches;
     manager->batch_count = 0;
     manager->current_batch = 0;
     
-    // 创建顶点缓冲区
-    if (create_buffer(vk, vertex_capacity * sizeof(float), 
-                     VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                     &manager->vertex_buffer, NULL) != 0) {
+    // 创建顶点流（容量为每帧容量，不足时自动增长）
+    if (stream_ring_init(vk, &manager->vertex_ring, vertex_capacity * sizeof(float),
+                         VK_BUFFER_USAGE_VERTEX_BUFFER_BIT) != 0) {
         LOGE("Failed to create vertex buffer");
         compositor_memory_free(manager->batches);
         return -1;
     }
     
-    // 创建索引缓冲区
-    if (create_buffer(vk, index_capacity * sizeof(uint32_t), 
-                     VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-                     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                     &manager->index_buffer, NULL) != 0) {
+    // 创建索引流
+    if (stream_ring_init(vk, &manager->index_ring, index_capacity * sizeof(uint32_t),
+                         VK_BUFFER_USAGE_INDEX_BUFFER_BIT) != 0) {
         LOGE("Failed to create index buffer");
-        vkDestroyBuffer(vk->device, manager->vertex_buffer, NULL);
+        stream_ring_destroy(vk, &manager->vertex_ring);
         compositor_memory_free(manager->batches);
         return -1;
     }
     
-    // 映射缓冲区
-    void* vertex_mapped;
-    void* index_mapped;
-    if (vkMapMemory(vk->device, NULL, 0, vertex_capacity * sizeof(float), 0, &vertex_mapped) != VK_SUCCESS ||
-        vkMapMemory(vk->device, NULL, 0, index_capacity * sizeof(uint32_t), 0, &index_mapped) != VK_SUCCESS) {
-        LOGE("Failed to map buffers");
-        vkDestroyBuffer(vk->device, manager->vertex_buffer, NULL);
-        vkDestroyBuffer(vk->device, manager->index_buffer, NULL);
-        compositor_memory_free(manager->batches);
-        return -1;
-    }
-    
-    manager->vertex_mapped = vertex_mapped;
-    manager->index_mapped = index_mapped;
-    manager->vertex_capacity = vertex_capacity;
-    manager->index_capacity = index_capacity;
     manager->vertex_used = 0;
     manager->index_used = 0;
     manager->initialized = true;
     
-    LOGI("Batch manager initialized with %u batches, %u vertices, %u indices", 
+    LOGI("Batch manager initialized with %u batches, %u vertices, %u indices per frame", 
          max_batches, vertex_capacity, index_capacity);
     
     return 0;
@@ -1931,27 +2314,10 @@ void vulkan_destroy_batch_manager(struct vulkan_state* vk) {
     
     struct batch_manager* manager = &vk->batch_manager;
     
-    // 取消映射缓冲区
-    if (manager->vertex_mapped) {
-        vkUnmapMemory(vk->device, NULL);
-        manager->vertex_mapped = NULL;
-    }
-    
-    if (manager->index_mapped) {
-        vkUnmapMemory(vk->device, NULL);
-        manager->index_mapped = NULL;
-    }
-    
-    // 销毁缓冲区
-    if (manager->vertex_buffer != VK_NULL_HANDLE) {
-        vkDestroyBuffer(vk->device, manager->vertex_buffer, NULL);
-        manager->vertex_buffer = VK_NULL_HANDLE;
-    }
-    
-    if (manager->index_buffer != VK_NULL_HANDLE) {
-        vkDestroyBuffer(vk->device, manager->index_buffer, NULL);
-        manager->index_buffer = VK_NULL_HANDLE;
-    }
+    // 销毁顶点流和索引流
+    vulkan_device_wait_idle(vk);
+    stream_ring_destroy(vk, &manager->vertex_ring);
+    stream_ring_destroy(vk, &manager->index_ring);
     
     // 释放批次数组
     if (manager->batches) {
@@ -1964,6 +2330,40 @@ void vulkan_destroy_batch_manager(struct vulkan_state* vk) {
     LOGI("Batch manager destroyed");
 }
 
+// 重置批次并切换到当前帧的分区（在vulkan_begin_frame等待帧栅栏之后调用）
+void vulkan_reset_batches(struct vulkan_state* vk) {
+    if (!vk || !vk->batch_manager.initialized) {
+        return;
+    }
+    
+    struct batch_manager* manager = &vk->batch_manager;
+    
+    // 在途帧数变化后分区数需要同步
+    if (manager->vertex_ring.partition_count != vk->frames_in_flight) {
+        VkDeviceSize vertex_size = manager->vertex_ring.partition_size;
+        VkDeviceSize index_size = manager->index_ring.partition_size;
+        
+        vulkan_device_wait_idle(vk);
+        stream_ring_destroy(vk, &manager->vertex_ring);
+        stream_ring_destroy(vk, &manager->index_ring);
+        
+        if (stream_ring_init(vk, &manager->vertex_ring, vertex_size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT) != 0 ||
+            stream_ring_init(vk, &manager->index_ring, index_size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT) != 0) {
+            LOGE("Failed to repartition stream rings");
+            vulkan_destroy_batch_manager(vk);
+            return;
+        }
+    }
+    
+    stream_ring_begin_frame(vk, &manager->vertex_ring);
+    stream_ring_begin_frame(vk, &manager->index_ring);
+    
+    manager->batch_count = 0;
+    manager->current_batch = 0;
+    manager->vertex_used = 0;
+    manager->index_used = 0;
+}
+
 // 开始新的批次
 int vulkan_begin_batch(struct vulkan_state* vk, VkPipeline pipeline, VkDescriptorSet descriptor_set, 
                        uint32_t texture_id, bool is_transparent) {
@@ -1995,8 +2395,10 @@ int vulkan_begin_batch(struct vulkan_state* vk, VkPipeline pipeline, VkDescripto
     
     batch->vertex_count = 0;
     batch->index_count = 0;
-    batch->vertex_buffer = manager->vertex_buffer;
-    batch->index_buffer = manager->index_buffer;
+    batch->first_vertex = manager->vertex_used;
+    batch->first_index = manager->index_used;
+    batch->vertex_buffer = manager->vertex_ring.buffer;
+    batch->index_buffer = manager->index_ring.buffer;
     batch->descriptor_set = descriptor_set;
     batch->pipeline = pipeline;
     batch->texture_id = texture_id;
@@ -2005,7 +2407,7 @@ int vulkan_begin_batch(struct vulkan_state* vk, VkPipeline pipeline, VkDescripto
     return 0;
 }
 
-// 添加数据到当前批次
+// 添加数据到当前批次（直接写入常驻映射的流式缓冲区）
 int vulkan_add_to_batch(struct vulkan_state* vk, const void* vertices, uint32_t vertex_count,
                         const uint32_t* indices, uint32_t index_count) {
     if (!vk || !vk->batch_manager.initialized || !vertices || !indices || 
@@ -2016,9 +2418,23 @@ int vulkan_add_to_batch(struct vulkan_state* vk, const void* vertices, uint32_t
     
     struct batch_manager* manager = &vk->batch_manager;
     
-    // 检查是否有足够的空间
-    if (manager->vertex_used + vertex_count > manager->vertex_capacity ||
-        manager->index_used + index_count > manager->index_capacity) {
+    if (manager->current_batch >= manager->batch_count) {
+        LOGE("No current batch");
+        return -1;
+    }
+    
+    // 预留空间，不足时缓冲区自动增长
+    VkDeviceSize vertex_size = vertex_count * sizeof(float);
+    void* vertex_dst = stream_ring_reserve(vk, &manager->vertex_ring, vertex_size);
+    if (!vertex_dst) {
+        LOGE("Not enough space in buffers");
+        return -1;
+    }
+    
+    void* index_dst = stream_ring_reserve(vk, &manager->index_ring, index_count * sizeof(uint32_t));
+    if (!index_dst) {
+        // 撤销顶点预留，避免本帧剩余时间内泄漏这段空间（扩容后used已搬到新缓冲区，同样可以回退）
+        manager->vertex_ring.used -= vertex_size;
         LOGE("Not enough space in buffers");
         return -1;
     }
@@ -2026,13 +2442,17 @@ int vulkan_add_to_batch(struct vulkan_state* vk, const void* vertices, uint32_t
     struct render_batch* batch = &manager->batches[manager->current_batch];
     
     // 复制顶点数据
-    memcpy((char*)manager->vertex_mapped + manager->vertex_used * sizeof(float), 
-           vertices, vertex_count * sizeof(float));
+    memcpy(vertex_dst, vertices, vertex_count * sizeof(float));
     
-    // 复制索引数据，并调整索引值
-    uint32_t base_vertex = manager->vertex_used;
-    for (uint32_t i = 0; i < index_count; i++) {
-        ((uint32_t*)manager->index_mapped)[manager->index_used + i] = base_vertex + indices[i];
+    // 索引相对批次起点，绘制时通过vertexOffset定位，批次的第一次添加可直接复制
+    uint32_t base_vertex = batch->vertex_count;
+    if (base_vertex == 0) {
+        memcpy(index_dst, indices, index_count * sizeof(uint32_t));
+    } else {
+        uint32_t* dst = (uint32_t*)index_dst;
+        for (uint32_t i = 0; i < index_count; i++) {
+            dst[i] = base_vertex + indices[i];
+        }
     }
     
     // 更新计数
@@ -2080,14 +2500,19 @@ int vulkan_render_batches(struct vulkan_state* vk, VkCommandBuffer command_buffe
     }
     
     struct batch_manager* manager = &vk->batch_manager;
+    if (manager->batch_count == 0) {
+        return 0;
+    }
     
-    // 绑定顶点和索引缓冲区
-    VkDeviceSize offsets[] = {0};
-    vkCmdBindVertexBuffers(command_buffer, 0, 1, &manager->vertex_buffer, offsets);
-    vkCmdBindIndexBuffer(command_buffer, manager->index_buffer, 0, VK_INDEX_TYPE_UINT32);
+    // 绑定当前帧分区的顶点和索引缓冲区
+    struct stream_ring* vertex_ring = &manager->vertex_ring;
+    struct stream_ring* index_ring = &manager->index_ring;
+    VkDeviceSize vertex_offset = vertex_ring->partition * vertex_ring->partition_size;
+    vkCmdBindVertexBuffers(command_buffer, 0, 1, &vertex_ring->buffer, &vertex_offset);
+    vkCmdBindIndexBuffer(command_buffer, index_ring->buffer, index_ring->partition * index_ring->partition_size,
+                         VK_INDEX_TYPE_UINT32);
     
     // 渲染所有批次
-    uint32_t index_offset = 0;
     for (uint32_t i = 0; i < manager->batch_count; i++) {
         struct render_batch* batch = &manager->batches[i];
         
@@ -2098,11 +2523,630 @@ int vulkan_render_batches(struct vulkan_state* vk, VkCommandBuffer command_buffe
                                    VK_NULL_HANDLE, 0, 1, &batch->descriptor_set, 0, NULL);
             
             // 绘制
-            vkCmdDrawIndexed(command_buffer, batch->index_count, 1, index_offset, 0, 0);
-            
-            index_offset += batch->index_count;
+            vkCmdDrawIndexed(command_buffer, batch->index_count, 1, batch->first_index,
+                             (int32_t)batch->first_vertex, 0);
+        }
+    }
+    
+    return 0;
+}
+
+// 获取当前时间（微秒）
+static uint64_t pipeline_cache_get_time_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+}
+
+// 用当前设备属性填充文件头
+static void pipeline_cache_fill_header(struct vulkan_state* vk, struct pipeline_cache_file_header* header) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(vk->physical_device, &properties);
+    
+    pipeline_cache_init_header(header, properties.vendorID, properties.deviceID, properties.driverVersion,
+                               properties.pipelineCacheUUID);
+}
+
+// 管线缓存预热线程：读取并校验磁盘缓存，创建VkPipelineCache
+static void* pipeline_cache_warm_thread(void* arg) {
+    struct vulkan_state* vk = (struct vulkan_state*)arg;
+    struct pipeline_cache* pc = &vk->pipeline_cache;
+    uint64_t start = pipeline_cache_get_time_us();
+    
+    size_t size = 0;
+    uint32_t checksum = 0;
+    void* data = NULL;
+    if (pc->path[0]) {
+        struct pipeline_cache_file_header expected;
+        pipeline_cache_fill_header(vk, &expected);
+        data = pipeline_cache_read_file(pc->path, &expected, &size, &checksum);
+    }
+    
+    VkPipelineCacheCreateInfo create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .initialDataSize = size,
+        .pInitialData = data
+    };
+    
+    VkResult result = vkCreatePipelineCache(vk->device, &create_info, NULL, &pc->cache);
+    if (result != VK_SUCCESS && data) {
+        // 驱动拒绝了旧数据，退回到空缓存
+        LOGE("Failed to create pipeline cache from disk data: %d", result);
+        create_info.initialDataSize = 0;
+        create_info.pInitialData = NULL;
+        size = 0;
+        result = vkCreatePipelineCache(vk->device, &create_info, NULL, &pc->cache);
+    }
+    
+    if (result != VK_SUCCESS) {
+        LOGE("Failed to create pipeline cache: %d", result);
+        pc->cache = VK_NULL_HANDLE;
+    }
+    
+    free(data);
+    
+    // 磁盘上已有的数据，保存时内容相同则跳过
+    pc->saved_checksum = checksum;
+    pc->stats.warm = pc->cache != VK_NULL_HANDLE && size > 0;
+    pc->stats.loaded_size = size;
+    pc->stats.load_time_us = pipeline_cache_get_time_us() - start;
+    
+    LOGI("Pipeline cache %s: %zu bytes in %.2f ms", pc->stats.warm ? "warm" : "cold",
+         size, pc->stats.load_time_us / 1000.0f);
+    return NULL;
+}
+
+// 等待预热线程完成
+static void pipeline_cache_wait_warm(struct pipeline_cache* pc) {
+    pthread_mutex_lock(&pc->mutex);
+    if (pc->warm_pending) {
+        pthread_join(pc->warm_thread, NULL);
+        pc->warm_pending = false;
+    }
+    pthread_mutex_unlock(&pc->mutex);
+}
+
+// 初始化管线缓存（在后台线程中加载，data_dir为NULL时不持久化）
+int vulkan_init_pipeline_cache(struct vulkan_state* vk, const char* data_dir) {
+    if (!vk || !vk->initialized) {
+        LOGE("Invalid parameters");
+        return -1;
+    }
+    
+    struct pipeline_cache* pc = &vk->pipeline_cache;
+    if (pc->initialized) {
+        LOGE("Pipeline cache already initialized");
+        return -1;
+    }
+    
+    memset(pc, 0, sizeof(struct pipeline_cache));
+    
+    if (data_dir && data_dir[0]) {
+        int len = snprintf(pc->path, sizeof(pc->path), "%s/%s", data_dir, VULKAN_PIPELINE_CACHE_FILE);
+        if (len < 0 || (size_t)len >= sizeof(pc->path)) {
+            LOGE("Pipeline cache path too long, cache will not be persisted");
+            pc->path[0] = '\0';
+        }
+    }
+    
+    if (pthread_mutex_init(&pc->mutex, NULL) != 0) {
+        LOGE("Failed to initialize pipeline cache mutex");
+        return -1;
+    }
+    
+    // 读取文件和驱动解析缓存数据都比较慢，放到后台线程中与其余初始化并行
+    if (pthread_create(&pc->warm_thread, NULL, pipeline_cache_warm_thread, vk) == 0) {
+        pc->warm_pending = true;
+    } else {
+        LOGE("Failed to create pipeline cache thread, loading synchronously");
+        pipeline_cache_warm_thread(vk);
+    }
+    
+    pc->initialized = true;
+    return 0;
+}
+
+// 销毁管线缓存（销毁前保存到磁盘）
+void vulkan_destroy_pipeline_cache(struct vulkan_state* vk) {
+    if (!vk || !vk->pipeline_cache.initialized) {
+        return;
+    }
+    
+    struct pipeline_cache* pc = &vk->pipeline_cache;
+    
+    vulkan_save_pipeline_cache(vk);
+    
+    if (pc->cache != VK_NULL_HANDLE) {
+        vkDestroyPipelineCache(vk->device, pc->cache, NULL);
+    }
+    
+    pthread_mutex_destroy(&pc->mutex);
+    memset(pc, 0, sizeof(struct pipeline_cache));
+}
+
+// 获取管线缓存（预热未完成时等待）
+VkPipelineCache vulkan_get_pipeline_cache(struct vulkan_state* vk) {
+    if (!vk || !vk->pipeline_cache.initialized) {
+        return VK_NULL_HANDLE;
+    }
+    
+    pipeline_cache_wait_warm(&vk->pipeline_cache);
+    return vk->pipeline_cache.cache;
+}
+
+// 保存管线缓存到磁盘
+int vulkan_save_pipeline_cache(struct vulkan_state* vk) {
+    if (!vk || !vk->pipeline_cache.initialized) {
+        return -1;
+    }
+    
+    struct pipeline_cache* pc = &vk->pipeline_cache;
+    pipeline_cache_wait_warm(pc);
+    
+    if (pc->cache == VK_NULL_HANDLE || !pc->path[0]) {
+        return 0;
+    }
+    
+    size_t size = 0;
+    if (vkGetPipelineCacheData(vk->device, pc->cache, &size, NULL) != VK_SUCCESS || size == 0) {
+        return 0;
+    }
+    
+    if (size > PIPELINE_CACHE_MAX_SIZE) {
+        LOGE("Pipeline cache too large to save: %zu bytes", size);
+        return -1;
+    }
+    
+    void* data = malloc(size);
+    if (!data) {
+        LOGE("Failed to allocate pipeline cache data");
+        return -1;
+    }
+    
+    if (vkGetPipelineCacheData(vk->device, pc->cache, &size, data) != VK_SUCCESS) {
+        LOGE("Failed to get pipeline cache data");
+        free(data);
+        return -1;
+    }
+    
+    // 驱动可能替换条目而不改变大小，按内容判断是否有新编译的管线
+    uint32_t checksum = pipeline_cache_checksum((const uint8_t*)data, size);
+    if (pc->saved_checksum != 0 && checksum == pc->saved_checksum) {
+        free(data);
+        return 0;
+    }
+    
+    struct pipeline_cache_file_header header;
+    pipeline_cache_fill_header(vk, &header);
+    header.data_size = size;
+    header.checksum = checksum;
+    
+    int result = pipeline_cache_write_file(pc->path, &header, data, size);
+    free(data);
+    
+    if (result == 0) {
+        pc->saved_checksum = checksum;
+        pc->stats.saved_size = size;
+        LOGI("Pipeline cache saved: %zu bytes", size);
+    }
+    
+    return result;
+}
+
+// 获取管线缓存统计
+void vulkan_get_pipeline_cache_stats(struct vulkan_state* vk, struct pipeline_cache_stats* stats) {
+    if (!stats) {
+        return;
+    }
+    
+    memset(stats, 0, sizeof(struct pipeline_cache_stats));
+    if (!vk || !vk->pipeline_cache.initialized) {
+        return;
+    }
+    
+    pipeline_cache_wait_warm(&vk->pipeline_cache);
+    *stats = vk->pipeline_cache.stats;
+}
+
+// 初始化GPU计时器
+int vulkan_init_gpu_timer(struct vulkan_state* vk) {
+    if (!vk || vk->device == VK_NULL_HANDLE) {
+        LOGE("Invalid parameters");
+        return -1;
+    }
+    
+    struct vulkan_gpu_timer* timer = &vk->gpu_timer;
+    memset(timer, 0, sizeof(struct vulkan_gpu_timer));
+    
+    // 检查图形队列是否支持时间戳
+    uint32_t queue_family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(vk->physical_device, &queue_family_count, NULL);
+    if (vk->queue_family_index >= queue_family_count) {
+        return -1;
+    }
+    
+    VkQueueFamilyProperties* queue_families =
+        (VkQueueFamilyProperties*)malloc(sizeof(VkQueueFamilyProperties) * queue_family_count);
+    if (!queue_families) {
+        return -1;
+    }
+    vkGetPhysicalDeviceQueueFamilyProperties(vk->physical_device, &queue_family_count, queue_families);
+    uint32_t valid_bits = queue_families[vk->queue_family_index].timestampValidBits;
+    free(queue_families);
+    
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(vk->physical_device, &properties);
+    
+    if (valid_bits == 0 || properties.limits.timestampPeriod <= 0.0f) {
+        LOGI("GPU timestamps not supported, GPU timing disabled");
+        return -1;
+    }
+    
+    VkQueryPoolCreateInfo pool_info = {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .queryType = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = VULKAN_MAX_FRAMES_IN_FLIGHT * VULKAN_TIMESTAMP_COUNT,
+        .pipelineStatistics = 0
+    };
+    
+    VkResult result = vkCreateQueryPool(vk->device, &pool_info, NULL, &timer->query_pool);
+    if (result != VK_SUCCESS) {
+        LOGE("Failed to create timestamp query pool: %d", result);
+        timer->query_pool = VK_NULL_HANDLE;
+        return -1;
+    }
+    
+    timer->timestamp_period = properties.limits.timestampPeriod;
+    timer->timestamp_mask = valid_bits >= 64 ? UINT64_MAX : ((1ULL << valid_bits) - 1);
+    timer->supported = true;
+    
+    LOGI("GPU timer initialized: %u valid bits, %.2f ns per tick", valid_bits, timer->timestamp_period);
+    return 0;
+}
+
+// 销毁GPU计时器
+void vulkan_destroy_gpu_timer(struct vulkan_state* vk) {
+    if (!vk || vk->gpu_timer.query_pool == VK_NULL_HANDLE) {
+        return;
+    }
+    
+    vkDestroyQueryPool(vk->device, vk->gpu_timer.query_pool, NULL);
+    memset(&vk->gpu_timer, 0, sizeof(struct vulkan_gpu_timer));
+}
+
+// 在渲染通道开始前调用：重置本帧槽的查询并写入帧开始时间戳
+void vulkan_gpu_timer_begin_frame(struct vulkan_state* vk, VkCommandBuffer command_buffer) {
+    if (!vk || !vk->gpu_timer.supported || command_buffer == VK_NULL_HANDLE) {
+        return;
+    }
+    
+    struct vulkan_gpu_timer* timer = &vk->gpu_timer;
+    uint32_t first_query = vk->frame_index * VULKAN_TIMESTAMP_COUNT;
+    
+    vkCmdResetQueryPool(command_buffer, timer->query_pool, first_query, VULKAN_TIMESTAMP_COUNT);
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timer->query_pool,
+                        first_query + VULKAN_TIMESTAMP_FRAME_BEGIN);
+    timer->pending_frame[vk->frame_index] = vk->current_frame + 1;
+}
+
+// 在渲染通道结束后调用：写入帧结束时间戳
+void vulkan_gpu_timer_end_frame(struct vulkan_state* vk, VkCommandBuffer command_buffer) {
+    vulkan_gpu_timer_write(vk, command_buffer, VULKAN_TIMESTAMP_FRAME_END);
+}
+
+// 写入时间戳（可在渲染线程的次要命令缓冲区中调用）
+void vulkan_gpu_timer_write(struct vulkan_state* vk, VkCommandBuffer command_buffer, vulkan_timestamp_t timestamp) {
+    if (!vk || !vk->gpu_timer.supported || command_buffer == VK_NULL_HANDLE || timestamp >= VULKAN_TIMESTAMP_COUNT) {
+        return;
+    }
+    
+    // 在前面的命令全部完成后写入，相邻时间戳之差即为一个阶段的耗时
+    vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, vk->gpu_timer.query_pool,
+                        vk->frame_index * VULKAN_TIMESTAMP_COUNT + timestamp);
+}
+
+// 获取最近读回的GPU耗时
+int vulkan_get_gpu_timings(struct vulkan_state* vk, struct vulkan_gpu_timings* timings) {
+    if (!vk || !timings) {
+        return -1;
+    }
+    
+    *timings = vk->gpu_timer.last;
+    return timings->valid ? 0 : -1;
+}
+
+// 内部函数：读回本帧槽上次提交的时间戳（栅栏已等待，结果必然可用，不会阻塞）
+static void collect_gpu_timings(struct vulkan_state* vk) {
+    struct vulkan_gpu_timer* timer = &vk->gpu_timer;
+    if (!timer->supported || timer->pending_frame[vk->frame_index] == 0) {
+        return;
+    }
+    
+    uint64_t frame = timer->pending_frame[vk->frame_index] - 1;
+    timer->pending_frame[vk->frame_index] = 0;
+    
+    // 每个查询两个值：时间戳和可用性（未写入的查询可用性为0）
+    uint64_t results[VULKAN_TIMESTAMP_COUNT][2];
+    VkResult result = vkGetQueryPoolResults(vk->device, timer->query_pool,
+                                            vk->frame_index * VULKAN_TIMESTAMP_COUNT, VULKAN_TIMESTAMP_COUNT,
+                                            sizeof(results), results, sizeof(results[0]),
+                                            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    if (result != VK_SUCCESS && result != VK_NOT_READY) {
+        return;
+    }
+    
+    if (!results[VULKAN_TIMESTAMP_FRAME_BEGIN][1] || !results[VULKAN_TIMESTAMP_FRAME_END][1]) {
+        return;
+    }
+    
+    // 按有效位计算差值，处理计数器回绕
+    float ns_per_tick = timer->timestamp_period;
+    uint64_t begin = results[VULKAN_TIMESTAMP_FRAME_BEGIN][0];
+    uint64_t end = results[VULKAN_TIMESTAMP_FRAME_END][0];
+    
+    struct vulkan_gpu_timings* timings = &timer->last;
+    memset(timings, 0, sizeof(struct vulkan_gpu_timings));
+    timings->frame = frame;
+    timings->frame_ms = (float)((end - begin) & timer->timestamp_mask) * ns_per_tick / 1000000.0f;
+    
+    // 阶段i结束于时间戳i+1；本帧没有写入的时间戳（如没有背景任务）的耗时并入下一个阶段
+    uint64_t previous = begin;
+    for (uint32_t i = 0; i < VULKAN_GPU_STAGE_COUNT; i++) {
+        if (!results[i + 1][1]) {
+            continue;
         }
+        
+        uint64_t current = results[i + 1][0];
+        timings->stage_ms[i] = (float)((current - previous) & timer->timestamp_mask) * ns_per_tick / 1000000.0f;
+        previous = current;
     }
     
+    for (uint32_t i = VULKAN_GPU_STAGE_BACKGROUND; i <= VULKAN_GPU_STAGE_UI; i++) {
+        timings->layers_ms += timings->stage_ms[i];
+    }
+    
+    timings->valid = true;
+}
+
+// 计算本帧的重绘区域并记录增量呈现的矩形（rects为NULL表示损伤未知，整帧重绘；rect_count为0表示本帧没有损伤）
+int vulkan_prepare_frame_damage(struct vulkan_state* vk, uint32_t image_index, const VkRect2D* rects,
+                                uint32_t rect_count, struct vulkan_frame_damage* damage) {
+    if (!vk || !damage || !vk->damage.image_frame || image_index >= vk->image_count) {
+        LOGE("Invalid parameters");
+        return -1;
+    }
+    
+    struct vulkan_damage_tracker* tracker = &vk->damage;
+    VkRect2D screen = {
+        .offset = {0, 0},
+        .extent = {(uint32_t)vk->width, (uint32_t)vk->height}
+    };
+    uint64_t frame = vk->current_frame;
+    bool unknown = rects == NULL;
+    
+    // 本帧损伤裁剪到屏幕后的包围盒，矩形本身交给增量呈现
+    VkRect2D bounds = {{0, 0}, {0, 0}};
+    tracker->present_rect_count = 0;
+    for (uint32_t i = 0; !unknown && i < rect_count; i++) {
+        VkRect2D rect;
+        if (!damage_clip_rect(&rects[i], &screen, &rect)) {
+            continue;
+        }
+        
+        bounds = damage_union_rect(&bounds, &rect);
+        if (tracker->present_rect_count < VULKAN_MAX_DAMAGE_RECTS) {
+            tracker->present_rects[tracker->present_rect_count++] = (VkRectLayerKHR){
+                .offset = rect.offset,
+                .extent = rect.extent,
+                .layer = 0
+            };
+        }
+    }
+    
+    // 矩形太多时只呈现包围盒；没有损伤或损伤全在屏幕外时也要给出一个矩形（0个矩形表示整帧）
+    if (rect_count > VULKAN_MAX_DAMAGE_RECTS || tracker->present_rect_count == 0) {
+        VkRect2D rect = bounds.extent.width > 0 ? bounds : (VkRect2D){{0, 0}, {1, 1}};
+        tracker->present_rects[0] = (VkRectLayerKHR){.offset = rect.offset, .extent = rect.extent, .layer = 0};
+        tracker->present_rect_count = 1;
+    }
+    
+    // 损伤未知时本帧视为全屏损伤，所有保留的图像都会在下次使用时整帧重绘
+    if (unknown) {
+        bounds = screen;
+        tracker->present_rect_count = 0;
+    }
+    tracker->history[frame % VULKAN_DAMAGE_HISTORY] = bounds;
+    
+    // 图像内容未定义或比历史更旧时整帧重绘
+    uint64_t last = tracker->image_frame[image_index];
+    damage->skip = false;
+    damage->full = unknown || last == 0 || frame + 1 - last > VULKAN_DAMAGE_HISTORY;
+    if (damage->full) {
+        damage->render_area = screen;
+        return 0;
+    }
+    
+    // 图像停留在第last-1帧的内容，需要补上之后各帧的损伤
+    VkRect2D area = bounds;
+    for (uint64_t f = last; f < frame; f++) {
+        area = damage_union_rect(&area, &tracker->history[f % VULKAN_DAMAGE_HISTORY]);
+    }
+    
+    // 本帧和该图像上次绘制以来都没有损伤时不需要绘制；renderArea不能为空，仍给出最小区域
+    if (area.extent.width == 0 || area.extent.height == 0) {
+        damage->skip = true;
+        area = (VkRect2D){{0, 0}, {1, 1}};
+    }
+    
+    damage->render_area = area;
     return 0;
-}
\ No newline at end of file
+}
+
+// 内部函数：把矩形裁剪到边界内，结果为空时返回false
+static bool damage_clip_rect(const VkRect2D* rect, const VkRect2D* bounds, VkRect2D* out) {
+    int64_t x0 = rect->offset.x > bounds->offset.x ? rect->offset.x : bounds->offset.x;
+    int64_t y0 = rect->offset.y > bounds->offset.y ? rect->offset.y : bounds->offset.y;
+    int64_t x1 = (int64_t)rect->offset.x + rect->extent.width;
+    int64_t y1 = (int64_t)rect->offset.y + rect->extent.height;
+    int64_t bx1 = (int64_t)bounds->offset.x + bounds->extent.width;
+    int64_t by1 = (int64_t)bounds->offset.y + bounds->extent.height;
+    if (x1 > bx1) x1 = bx1;
+    if (y1 > by1) y1 = by1;
+    
+    if (x1 <= x0 || y1 <= y0) {
+        return false;
+    }
+    
+    out->offset.x = (int32_t)x0;
+    out->offset.y = (int32_t)y0;
+    out->extent.width = (uint32_t)(x1 - x0);
+    out->extent.height = (uint32_t)(y1 - y0);
+    return true;
+}
+
+// 内部函数：两个矩形的包围盒（空矩形不参与）
+static VkRect2D damage_union_rect(const VkRect2D* a, const VkRect2D* b) {
+    if (a->extent.width == 0 || a->extent.height == 0) {
+        return *b;
+    }
+    if (b->extent.width == 0 || b->extent.height == 0) {
+        return *a;
+    }
+    
+    int64_t x0 = a->offset.x < b->offset.x ? a->offset.x : b->offset.x;
+    int64_t y0 = a->offset.y < b->offset.y ? a->offset.y : b->offset.y;
+    int64_t ax1 = (int64_t)a->offset.x + a->extent.width;
+    int64_t ay1 = (int64_t)a->offset.y + a->extent.height;
+    int64_t bx1 = (int64_t)b->offset.x + b->extent.width;
+    int64_t by1 = (int64_t)b->offset.y + b->extent.height;
+    
+    VkRect2D result = {
+        .offset = {(int32_t)x0, (int32_t)y0},
+        .extent = {(uint32_t)((ax1 > bx1 ? ax1 : bx1) - x0), (uint32_t)((ay1 > by1 ? ay1 : by1) - y0)}
+    };
+    return result;
+}
+
+// 查询客户端缓冲区能否直接复制到交换链图像
+vulkan_direct_present_mode_t vulkan_get_direct_present_mode(struct vulkan_state* vk, VkFormat format,
+                                                            uint32_t width, uint32_t height) {
+    if (!vk || !vk->initialized || !vk->swapchain_transfer_dst || width == 0 || height == 0) {
+        return VULKAN_DIRECT_PRESENT_NONE;
+    }
+    
+    // 格式和尺寸完全一致时直接复制
+    if (format == vk->swapchain_format && width == (uint32_t)vk->width && height == (uint32_t)vk->height) {
+        return VULKAN_DIRECT_PRESENT_COPY;
+    }
+    
+    // 否则需要两端格式都支持blit
+    if (!vk->swapchain_blit_dst) {
+        return VULKAN_DIRECT_PRESENT_NONE;
+    }
+    
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(vk->physical_device, format, &properties);
+    if (!(properties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_SRC_BIT)) {
+        return VULKAN_DIRECT_PRESENT_NONE;
+    }
+    
+    return VULKAN_DIRECT_PRESENT_BLIT;
+}
+
+// 把客户端缓冲区复制或blit到交换链图像（不经过渲染通道）
+int vulkan_direct_present(struct vulkan_state* vk, VkCommandBuffer command_buffer, uint32_t image_index,
+                          VkImage source, VkFormat format, uint32_t width, uint32_t height) {
+    if (!vk || command_buffer == VK_NULL_HANDLE || source == VK_NULL_HANDLE || image_index >= vk->image_count) {
+        return -1;
+    }
+    
+    vulkan_direct_present_mode_t mode = vulkan_get_direct_present_mode(vk, format, width, height);
+    if (mode == VULKAN_DIRECT_PRESENT_NONE) {
+        return -1;
+    }
+    
+    VkImage target = vk->images[image_index];
+    
+    // 源缓冲区等上一帧的采样结束后转为复制源；交换链图像整帧覆盖，旧内容丢弃。
+    // 交换链图像的转换从颜色输出阶段开始，与提交时等待图像获取信号量的阶段衔接
+    direct_present_barrier(command_buffer, source, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                           VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, 0, VK_ACCESS_TRANSFER_READ_BIT,
+                           VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    direct_present_barrier(command_buffer, target, VK_IMAGE_LAYOUT_UNDEFINED,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+                           VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    
+    VkImageSubresourceLayers subresource = {
+        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+        .mipLevel = 0,
+        .baseArrayLayer = 0,
+        .layerCount = 1
+    };
+    
+    if (mode == VULKAN_DIRECT_PRESENT_COPY) {
+        VkImageCopy region = {
+            .srcSubresource = subresource,
+            .srcOffset = {0, 0, 0},
+            .dstSubresource = subresource,
+            .dstOffset = {0, 0, 0},
+            .extent = {width, height, 1}
+        };
+        vkCmdCopyImage(command_buffer, source, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       target, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    } else {
+        // 缩放时格式支持线性过滤才使用线性过滤
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(vk->physical_device, format, &properties);
+        VkFilter filter = (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ?
+                          VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+        
+        VkImageBlit region = {
+            .srcSubresource = subresource,
+            .srcOffsets = {{0, 0, 0}, {(int32_t)width, (int32_t)height, 1}},
+            .dstSubresource = subresource,
+            .dstOffsets = {{0, 0, 0}, {vk->width, vk->height, 1}}
+        };
+        vkCmdBlitImage(command_buffer, source, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       target, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region, filter);
+    }
+    
+    // 交换链图像转为呈现布局，源缓冲区恢复为着色器只读布局
+    direct_present_barrier(command_buffer, target, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_ACCESS_TRANSFER_WRITE_BIT, 0,
+                           VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+    direct_present_barrier(command_buffer, source, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, VK_ACCESS_SHADER_READ_BIT,
+                           VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    
+    return 0;
+}
+
+// 内部函数：记录单个图像的布局转换
+static void direct_present_barrier(VkCommandBuffer command_buffer, VkImage image, VkImageLayout old_layout,
+                                   VkImageLayout new_layout, VkAccessFlags src_access, VkAccessFlags dst_access,
+                                   VkPipelineStageFlags src_stage, VkPipelineStageFlags dst_stage) {
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .pNext = NULL,
+        .srcAccessMask = src_access,
+        .dstAccessMask = dst_access,
+        .oldLayout = old_layout,
+        .newLayout = new_layout,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        }
+    };
+    
+    vkCmdPipelineBarrier(command_buffer, src_stage, dst_stage, 0, 0, NULL, 0, NULL, 1, &barrier);
+}
@@ -4,14 +4,26 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include "vulkan.h"
 #include "vulkan_android.h"
 #include "android/native_window.h"
+#include "compositor_pipeline_cache.h"
+#include "compositor_vulkan_alloc.h"
+#include "compositor_vulkan_layers.h"
+#include "compositor_vulkan_upload.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// 默认同时在途的帧数
+#define VULKAN_DEFAULT_FRAMES_IN_FLIGHT 2
+// 最大在途帧数
+#define VULKAN_MAX_FRAMES_IN_FLIGHT 4
+// 每帧上传区大小
+#define VULKAN_FRAME_UPLOAD_SIZE (1024 * 1024)
+
 // 命令缓冲区类型
 typedef enum {
     COMMAND_BUFFER_TYPE_PRIMARY = 0,  // 主要命令缓冲区，每帧使用
@@ -27,10 +39,55 @@ struct command_buffer_cache {
     uint64_t last_used_frame;
 };
 
+// 每帧上传区（线性分配，帧栅栏信号后整体回收）
+struct frame_upload_arena {
+    VkBuffer buffer;
+    struct vulkan_allocation allocation;
+    void* mapped;
+    VkDeviceSize size;
+    VkDeviceSize offset;
+};
+
+// 在途帧资源（与交换链图像数量无关）
+struct frame_context {
+    VkCommandPool command_pool;       // 每帧独立的命令池，栅栏信号后整体重置
+    VkCommandBuffer command_buffer;
+    VkSemaphore image_available;      // 图像获取完成
+    bool image_available_pending;     // 本帧的获取会信号image_available，提交时须等待
+    VkFence in_flight;                // 本帧GPU工作完成（提交前才重置，保证每个开始的帧都会信号）
+    struct frame_upload_arena upload;
+};
+
+// 流式环形缓冲区待回收的旧缓冲区上限
+#define STREAM_RING_MAX_GARBAGE 8
+
+// 流式环形缓冲区增长后待回收的旧缓冲区
+struct stream_ring_garbage {
+    VkBuffer buffer;
+    struct vulkan_allocation allocation;
+    uint64_t retire_frame;            // 替换时的帧号，之后的帧不再引用
+};
+
+// 流式环形缓冲区（常驻映射，每个在途帧独占一个分区）
+struct stream_ring {
+    VkBuffer buffer;
+    struct vulkan_allocation allocation;
+    uint8_t* mapped;
+    VkBufferUsageFlags usage;
+    VkDeviceSize partition_size;      // 每个分区的字节数
+    uint32_t partition_count;         // 分区数（等于在途帧数）
+    uint32_t partition;               // 当前写入的分区
+    VkDeviceSize used;                // 当前分区已用字节数
+    struct stream_ring_garbage garbage[STREAM_RING_MAX_GARBAGE];
+    uint32_t garbage_count;
+};
+
 // 渲染批次
 struct render_batch {
     uint32_t vertex_count;
     uint32_t index_count;
+    uint32_t first_vertex;            // 批次在当前分区中的起始顶点
+    uint32_t first_index;             // 批次在当前分区中的起始索引
     VkBuffer vertex_buffer;
     VkBuffer index_buffer;
     VkDescriptorSet descriptor_set;
@@ -45,55 +102,63 @@ struct batch_manager {
     uint32_t batch_count;
     uint32_t max_batches;
     uint32_t current_batch;
-    VkBuffer vertex_buffer;
-    VkBuffer index_buffer;
-    void* vertex_mapped;
-    void* index_mapped;
-    uint32_t vertex_capacity;
-    uint32_t index_capacity;
-    uint32_t vertex_used;
-    uint32_t index_used;
+    struct stream_ring vertex_ring;   // 顶点流
+    struct stream_ring index_ring;    // 索引流
+    uint32_t vertex_used;             // 当前分区已用顶点数
+    uint32_t index_used;              // 当前分区已用索引数
     bool initialized;
 };
 
-// 渲染任务函数类型
-typedef void (*render_task_func_t)(VkCommandBuffer, void*);
+// 渲染任务函数类型（在次要命令缓冲区中记录第task_index个任务）
+typedef void (*render_task_func_t)(VkCommandBuffer command_buffer, uint32_t task_index, void* user_data);
+
+// 工作线程数上限（0表示按在线CPU核心数自动选择）
+#define MULTITHREAD_MAX_THREADS 8
+// 每个参与线程平均分到的任务块数（兼顾负载均衡和次要命令缓冲区数量）
+#define MULTITHREAD_CHUNKS_PER_THREAD 4
+
+// 线程在一个帧槽中使用的命令池（帧槽的栅栏等待后整体重置）
+struct render_thread_pool {
+    VkCommandPool command_pool;
+    VkCommandBuffer* buffers;           // 已分配的次要命令缓冲区
+    uint32_t buffer_count;
+    uint32_t used;                      // 本帧已使用的数量
+    uint64_t reset_frame;               // 上次重置时的帧号+1（0表示从未使用）
+};
 
 // 渲染线程数据
 struct render_thread_data {
     pthread_t thread_id;
     uint32_t thread_index;
     struct vulkan_state* vk;
-    VkCommandPool command_pool;
-    VkCommandBuffer command_buffer;
-    VkSemaphore semaphore;
-    VkFence fence;
-    bool should_exit;
-    bool is_ready;
-    bool active;
-    bool has_work;
-    pthread_mutex_t mutex;
-    pthread_cond_t condition;
-    struct {
-        void (*render_func)(VkCommandBuffer, void*);
-        void* user_data;
-        uint32_t task_id;
-        uint32_t start_task;
-        uint32_t end_task;
-    } task;
+    struct render_thread_pool pools[VULKAN_MAX_FRAMES_IN_FLIGHT];
+    uint64_t chunks_recorded;           // 累计记录的任务块数
+    bool started;
 };
 
 // 多线程渲染管理器
 struct multithread_renderer {
-    struct render_thread_data* threads;
-    uint32_t thread_count;
+    struct render_thread_data* threads; // 工作线程，最后一项供调用线程使用（不创建线程）
+    uint32_t thread_count;              // 工作线程数
     bool enabled;
-    pthread_mutex_t mutex;
-    pthread_cond_t condition;
-    bool has_work;
-    bool work_done;
     bool initialized;
-    VkSemaphore render_complete_semaphore;
+    bool should_exit;
+    bool failed;                        // 本轮有任务块记录失败
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond;           // 通知工作线程有新一轮任务
+    pthread_cond_t done_cond;           // 通知调用线程工作线程已完成
+    uint64_t generation;                // 每分发一轮任务加一
+    uint32_t active_workers;            // 本轮尚未完成的工作线程数
+    // 本轮任务（分发前由调用线程写入）
+    render_task_func_t render_func;
+    void* user_data;
+    VkCommandBufferInheritanceInfo inheritance;
+    uint32_t task_count;
+    uint32_t chunk_size;
+    uint32_t chunk_count;
+    atomic_uint next_chunk;             // 共享任务范围中下一个待领取的块
+    VkCommandBuffer* chunk_buffers;     // 按块号存放的次要命令缓冲区，主命令缓冲区按此顺序执行
+    uint32_t max_chunks;
 };
 
 // Android特定优化
@@ -112,6 +177,101 @@ struct android_optimizations {
     float thermal_throttling_factor; // 热节流因子
 };
 
+// 管线缓存文件名（位于应用数据目录下）
+#define VULKAN_PIPELINE_CACHE_FILE "pipeline_cache.bin"
+
+// 管线缓存统计
+struct pipeline_cache_stats {
+    bool warm;                  // 是否从磁盘加载了有效缓存
+    size_t loaded_size;         // 加载的缓存数据大小
+    size_t saved_size;          // 最近一次保存的缓存数据大小
+    uint64_t load_time_us;      // 读取、校验和创建缓存的耗时
+};
+
+// 持久化管线缓存
+struct pipeline_cache {
+    VkPipelineCache cache;
+    char path[PIPELINE_CACHE_PATH_SIZE]; // 缓存文件路径（为空时不持久化）
+    pthread_t warm_thread;      // 后台预热线程
+    bool warm_pending;          // 预热线程尚未回收
+    bool initialized;
+    pthread_mutex_t mutex;
+    uint32_t saved_checksum;    // 磁盘上缓存数据的校验和（0表示没有）
+    struct pipeline_cache_stats stats;
+};
+
+// GPU时间戳位置（每个帧槽一组查询，按命令流中的先后顺序排列）
+typedef enum {
+    VULKAN_TIMESTAMP_FRAME_BEGIN = 0,   // 命令缓冲区开始（主命令缓冲区）
+    VULKAN_TIMESTAMP_CACHE_END,         // 离屏层缓存重建结束，主渲染通道开始前
+    VULKAN_TIMESTAMP_LAYERS_BEGIN,      // 第一个任务开始（次要命令缓冲区）
+    VULKAN_TIMESTAMP_BACKGROUND_END,    // 背景任务结束
+    VULKAN_TIMESTAMP_WINDOWS_END,       // 窗口任务结束（批处理任务开始，直接呈现时为复制结束）
+    VULKAN_TIMESTAMP_BATCHES_END,       // 批处理任务结束
+    VULKAN_TIMESTAMP_LAYERS_END,        // UI任务结束
+    VULKAN_TIMESTAMP_FRAME_END,         // 渲染通道结束后（主命令缓冲区）
+    VULKAN_TIMESTAMP_COUNT
+} vulkan_timestamp_t;
+
+// GPU计时阶段：阶段i从上一个已写入的时间戳到时间戳i+1，未写入的时间戳所在阶段计为0
+typedef enum {
+    VULKAN_GPU_STAGE_CACHE = 0,         // 离屏层缓存的渲染通道
+    VULKAN_GPU_STAGE_BASE,              // 附件加载/清除和预记录的背景、UI层
+    VULKAN_GPU_STAGE_BACKGROUND,        // 背景层任务
+    VULKAN_GPU_STAGE_WINDOWS,           // 窗口层任务（或直接呈现的复制）
+    VULKAN_GPU_STAGE_BATCHES,           // 批处理任务
+    VULKAN_GPU_STAGE_UI,                // UI层任务
+    VULKAN_GPU_STAGE_RESOLVE,           // 附件存储和渲染通道结束
+    VULKAN_GPU_STAGE_COUNT
+} vulkan_gpu_stage_t;
+
+// 一帧的GPU耗时
+struct vulkan_gpu_timings {
+    bool valid;
+    uint64_t frame;                     // 测得的帧号
+    float frame_ms;                     // 整帧的GPU耗时
+    float layers_ms;                    // 背景、窗口、批处理和UI任务的合计耗时
+    float stage_ms[VULKAN_GPU_STAGE_COUNT];
+};
+
+// GPU时间戳计时器（结果在帧槽复用时读回，不等待GPU）
+struct vulkan_gpu_timer {
+    VkQueryPool query_pool;             // 每个帧槽VULKAN_TIMESTAMP_COUNT个查询
+    float timestamp_period;             // 每个时间戳单位的纳秒数
+    uint64_t timestamp_mask;            // 时间戳有效位掩码
+    uint64_t pending_frame[VULKAN_MAX_FRAMES_IN_FLIGHT]; // 帧槽中待读回的帧号+1（0表示没有）
+    struct vulkan_gpu_timings last;     // 最近读回的结果
+    bool supported;
+};
+
+// 保留多少帧的损伤历史（交换链图像比这更旧时整帧重绘）
+#define VULKAN_DAMAGE_HISTORY 8
+// 每帧交给增量呈现的损伤矩形上限
+#define VULKAN_MAX_DAMAGE_RECTS 16
+
+// 一帧的重绘区域
+struct vulkan_frame_damage {
+    bool full;                  // 整帧重绘（使用清除附件的渲染通道）
+    bool skip;                  // 图像内容已是最新，本帧不需要绘制（仍需呈现）
+    VkRect2D render_area;       // 重绘区域：该图像上次绘制以来累积损伤的包围盒
+};
+
+// 交换链图像内容保留时的损伤跟踪
+struct vulkan_damage_tracker {
+    uint64_t* image_frame;                      // 每个交换链图像上次绘制的帧号+1（0表示内容未定义）
+    VkRect2D history[VULKAN_DAMAGE_HISTORY];    // 最近各帧损伤的包围盒（按帧号取模）
+    VkRectLayerKHR present_rects[VULKAN_MAX_DAMAGE_RECTS]; // 本帧交给增量呈现的矩形
+    uint32_t present_rect_count;                // 0表示整帧呈现
+    bool incremental_present;                   // 已启用VK_KHR_incremental_present
+};
+
+// 客户端缓冲区直接呈现的方式
+typedef enum {
+    VULKAN_DIRECT_PRESENT_NONE = 0,   // 不能直接呈现，需要合成
+    VULKAN_DIRECT_PRESENT_COPY,       // 格式和尺寸与交换链一致，逐像素复制
+    VULKAN_DIRECT_PRESENT_BLIT        // 需要格式转换或缩放
+} vulkan_direct_present_mode_t;
+
 // Vulkan状态结构
 struct vulkan_state {
     VkInstance instance;
@@ -119,19 +279,30 @@ struct vulkan_state {
     VkSurfaceKHR surface;
     VkDevice device;
     VkQueue queue;
+    pthread_mutex_t queue_mutex;             // 图形队列和上传队列的提交、呈现以及设备级等待
     VkSwapchainKHR swapchain;
     VkImage* images;
     VkImageView* image_views;
     VkFramebuffer* framebuffers;
-    VkRenderPass render_pass;
+    VkRenderPass render_pass;                // 清除附件，整帧重绘
+    VkRenderPass render_pass_load;           // 保留图像内容，只重绘损伤区域（与render_pass兼容）
     VkCommandPool command_pool;
-    VkCommandBuffer* command_buffers;
-    VkSemaphore* image_available_semaphores;
-    VkSemaphore* render_finished_semaphores;
-    VkFence* in_flight_fences;
+    VkSemaphore* render_finished_semaphores; // 按交换链图像索引，呈现完成前不能复用
+    VkFence* images_in_flight;               // 每个交换链图像当前所属帧的栅栏
     uint32_t image_count;
-    uint32_t current_image;
+    uint32_t retained_image;                 // 放弃的帧已获取但未呈现的图像，下一帧直接使用
+    bool has_retained_image;
+    VkFormat swapchain_format;
+    bool swapchain_transfer_dst;             // 交换链图像可作为复制目标（直接呈现）
+    bool swapchain_blit_dst;                 // 交换链格式支持作为blit目标
+    
+    // 在途帧环
+    struct frame_context* frames;
+    uint32_t frames_in_flight;
+    uint32_t frame_index;
+    uint64_t submit_end_ns;                   // 上一帧vkQueueSubmit返回的时间（CLOCK_MONOTONIC），用于区分提交和呈现耗时
     uint32_t queue_family_index;
+    bool memory_budget_enabled;               // 已启用VK_EXT_memory_budget
     bool initialized;
     int width, height;
     
@@ -150,6 +321,24 @@ struct vulkan_state {
     
     // Android特定优化
     struct android_optimizations android_opts;
+    
+    // 持久化管线缓存
+    struct pipeline_cache pipeline_cache;
+    
+    // 设备内存子分配器（缓冲区和图像内存都从这里分配）
+    struct vulkan_allocator allocator;
+    
+    // GPU时间戳计时
+    struct vulkan_gpu_timer gpu_timer;
+    
+    // 局部重绘的损伤跟踪
+    struct vulkan_damage_tracker damage;
+    
+    // 静态层的离屏缓存
+    struct vulkan_layer_cache layer_cache;
+    
+    // 后台纹理上传
+    struct vulkan_uploader uploader;
 };
 
 // 初始化Vulkan
@@ -164,15 +353,40 @@ int vulkan_recreate_swapchain(struct vulkan_state* vk, int width, int height);
 // 开始渲染帧
 int vulkan_begin_frame(struct vulkan_state* vk, uint32_t* image_index);
 
-// 结束渲染帧
+// 结束渲染帧（提交失败时自动放弃本帧）
 int vulkan_end_frame(struct vulkan_state* vk, uint32_t image_index);
 
+// 放弃已开始但无法提交的帧：提交只等待图像获取并信号帧栅栏的空批次，保证帧槽退役，图像留给下一帧
+void vulkan_abort_frame(struct vulkan_state* vk, uint32_t image_index);
+
+// 等待设备空闲（持有queue_mutex，避免与上传线程的提交并发）
+void vulkan_device_wait_idle(struct vulkan_state* vk);
+
 // 获取当前帧缓冲区
 VkFramebuffer vulkan_get_current_framebuffer(struct vulkan_state* vk, uint32_t image_index);
 
-// 获取命令缓冲区
+// 获取命令缓冲区（当前在途帧的主命令缓冲区）
 VkCommandBuffer vulkan_get_command_buffer(struct vulkan_state* vk, uint32_t image_index);
 
+// 计算本帧的重绘区域并记录增量呈现的矩形（rects为NULL表示损伤未知，整帧重绘；rect_count为0表示本帧没有损伤）
+int vulkan_prepare_frame_damage(struct vulkan_state* vk, uint32_t image_index, const VkRect2D* rects,
+                                uint32_t rect_count, struct vulkan_frame_damage* damage);
+
+// 查询客户端缓冲区能否直接复制到交换链图像
+vulkan_direct_present_mode_t vulkan_get_direct_present_mode(struct vulkan_state* vk, VkFormat format,
+                                                            uint32_t width, uint32_t height);
+
+// 把客户端缓冲区复制或blit到交换链图像（不经过渲染通道），source平时处于着色器只读布局
+int vulkan_direct_present(struct vulkan_state* vk, VkCommandBuffer command_buffer, uint32_t image_index,
+                          VkImage source, VkFormat format, uint32_t width, uint32_t height);
+
+// 设置同时在途的帧数（1-VULKAN_MAX_FRAMES_IN_FLIGHT）
+int vulkan_set_frames_in_flight(struct vulkan_state* vk, uint32_t count);
+
+// 从当前帧上传区分配，返回映射地址（本帧GPU工作完成后自动回收）
+void* vulkan_frame_upload_alloc(struct vulkan_state* vk, VkDeviceSize size, VkDeviceSize alignment,
+                                VkBuffer* buffer, VkDeviceSize* offset);
+
 // 初始化命令缓冲区缓存
 int vulkan_init_command_buffer_cache(struct vulkan_state* vk, uint32_t secondary_buffer_count);
 
@@ -192,6 +406,9 @@ int vulkan_record_secondary_command_buffer(struct vulkan_state* vk, uint32_t ind
 // 执行缓存的命令缓冲区
 void vulkan_execute_cached_command_buffers(struct vulkan_state* vk, VkCommandBuffer primary_buffer);
 
+// 执行单个缓存的次要命令缓冲区
+void vulkan_execute_cached_command_buffer(struct vulkan_state* vk, VkCommandBuffer primary_buffer, uint32_t index);
+
 // 更新帧计数
 void vulkan_update_frame_counter(struct vulkan_state* vk);
 
@@ -204,14 +421,14 @@ int vulkan_begin_batch(struct vulkan_state* vk, VkPipeline pipeline, VkDescripto
 int vulkan_add_to_batch(struct vulkan_state* vk, const void* vertices, uint32_t vertex_count,
                         const uint32_t* indices, uint32_t index_count);
 int vulkan_end_batch(struct vulkan_state* vk);
+void vulkan_reset_batches(struct vulkan_state* vk);
 int vulkan_render_batches(struct vulkan_state* vk, VkCommandBuffer command_buffer);
 
 // 多线程渲染相关函数
 int vulkan_init_multithread_renderer(struct vulkan_state* vk, uint32_t thread_count);
 void vulkan_destroy_multithread_renderer(struct vulkan_state* vk);
-int vulkan_render_multithread(struct vulkan_state* vk, render_task_func_t render_func, void* user_data, 
-                              uint32_t task_count);
-static void* render_thread_func(void* arg);
+int vulkan_render_multithread(struct vulkan_state* vk, VkCommandBuffer primary_buffer, render_task_func_t render_func,
+                              void* user_data, uint32_t task_count);
 
 // Android优化相关函数
 int vulkan_init_android_optimizations(struct vulkan_state* vk);
@@ -223,6 +440,21 @@ int vulkan_enable_android_hardware_buffer(struct vulkan_state* vk, bool enable);
 int vulkan_enable_android_external_memory(struct vulkan_state* vk, bool enable);
 int vulkan_update_thermal_throttling(struct vulkan_state* vk, float factor);
 
+// 管线缓存相关函数
+int vulkan_init_pipeline_cache(struct vulkan_state* vk, const char* data_dir);
+void vulkan_destroy_pipeline_cache(struct vulkan_state* vk);
+VkPipelineCache vulkan_get_pipeline_cache(struct vulkan_state* vk);
+int vulkan_save_pipeline_cache(struct vulkan_state* vk);
+void vulkan_get_pipeline_cache_stats(struct vulkan_state* vk, struct pipeline_cache_stats* stats);
+
+// GPU计时相关函数
+int vulkan_init_gpu_timer(struct vulkan_state* vk);
+void vulkan_destroy_gpu_timer(struct vulkan_state* vk);
+void vulkan_gpu_timer_begin_frame(struct vulkan_state* vk, VkCommandBuffer command_buffer);
+void vulkan_gpu_timer_end_frame(struct vulkan_state* vk, VkCommandBuffer command_buffer);
+void vulkan_gpu_timer_write(struct vulkan_state* vk, VkCommandBuffer command_buffer, vulkan_timestamp_t timestamp);
+int vulkan_get_gpu_timings(struct vulkan_state* vk, struct vulkan_gpu_timings* timings);
+
 #ifdef __cplusplus
 }
 #endif
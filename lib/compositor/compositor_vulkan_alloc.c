@@ -0,0 +1,693 @@
+#include "compositor_vulkan_alloc.h"
+#include <stdlib.h>
+#include <string.h>
+#include <android/log.h>
+
+#define LOG_TAG "VulkanAlloc"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+
+// 内部函数声明
+static uint32_t alloc_order_for_size(VkDeviceSize size);
+static void buddy_update_parents(uint8_t* tree, uint32_t index, uint32_t order);
+static bool buddy_alloc(struct vulkan_memory_block* block, uint32_t order, VkDeviceSize* offset);
+static void buddy_free(struct vulkan_memory_block* block, VkDeviceSize offset, uint32_t order);
+static int alloc_device_memory(struct vulkan_allocator* allocator, uint32_t memory_type, VkDeviceSize size,
+                               VkDeviceMemory* memory, void** mapped);
+static void free_device_memory(struct vulkan_allocator* allocator, uint32_t memory_type, VkDeviceSize size,
+                               VkDeviceMemory memory, void* mapped);
+static struct vulkan_memory_block* create_block(struct vulkan_allocator* allocator, uint32_t memory_type, bool linear);
+static void release_block(struct vulkan_allocator* allocator, struct vulkan_memory_block* block);
+static int alloc_from_type(struct vulkan_allocator* allocator, uint32_t memory_type, VkDeviceSize size,
+                           VkDeviceSize alignment, bool linear, struct vulkan_allocation* allocation);
+
+// 初始化分配器
+int vulkan_alloc_init(struct vulkan_allocator* allocator, VkPhysicalDevice physical_device, VkDevice device,
+                      bool budget_supported) {
+    if (!allocator || physical_device == VK_NULL_HANDLE || device == VK_NULL_HANDLE) {
+        LOGE("Invalid parameters");
+        return -1;
+    }
+    
+    memset(allocator, 0, sizeof(struct vulkan_allocator));
+    allocator->device = device;
+    allocator->physical_device = physical_device;
+    allocator->budget_supported = budget_supported;
+    
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &allocator->memory_properties);
+    
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    allocator->buffer_image_granularity = properties.limits.bufferImageGranularity;
+    allocator->stats.max_device_allocations = properties.limits.maxMemoryAllocationCount;
+    
+    // 小堆（如部分集成GPU的专用堆）按堆大小的1/8选择块大小，避免一个块占满整个堆
+    for (uint32_t i = 0; i < allocator->memory_properties.memoryHeapCount; i++) {
+        VkDeviceSize block_size = VULKAN_ALLOC_BLOCK_SIZE;
+        VkDeviceSize heap_size = allocator->memory_properties.memoryHeaps[i].size;
+        
+        while (block_size > heap_size / 8 && block_size > VULKAN_ALLOC_MIN_SIZE * 256) {
+            block_size /= 2;
+        }
+        allocator->block_size[i] = block_size;
+    }
+    
+    if (pthread_mutex_init(&allocator->mutex, NULL) != 0) {
+        LOGE("Failed to initialize allocator mutex");
+        return -1;
+    }
+    
+    allocator->initialized = true;
+    
+    LOGI("Vulkan allocator initialized: %u memory types, %u heaps, granularity %llu, budget %s",
+         allocator->memory_properties.memoryTypeCount, allocator->memory_properties.memoryHeapCount,
+         (unsigned long long)allocator->buffer_image_granularity, budget_supported ? "driver" : "estimated");
+    return 0;
+}
+
+// 销毁分配器（释放所有内存块）
+void vulkan_alloc_destroy(struct vulkan_allocator* allocator) {
+    if (!allocator || !allocator->initialized) {
+        return;
+    }
+    
+    pthread_mutex_lock(&allocator->mutex);
+    
+    for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; i++) {
+        struct vulkan_memory_block* block = allocator->blocks[i];
+        while (block) {
+            struct vulkan_memory_block* next = block->next;
+            if (block->allocation_count > 0) {
+                LOGE("Memory block of type %u destroyed with %u live allocations", i, block->allocation_count);
+            }
+            release_block(allocator, block);
+            block = next;
+        }
+        allocator->blocks[i] = NULL;
+    }
+    
+    if (allocator->stats.dedicated_count > 0) {
+        LOGE("%u dedicated allocations leaked", allocator->stats.dedicated_count);
+    }
+    
+    LOGI("Vulkan allocator destroyed: %llu allocs, %llu frees, %llu failed",
+         (unsigned long long)allocator->stats.alloc_calls, (unsigned long long)allocator->stats.free_calls,
+         (unsigned long long)allocator->stats.failed_allocs);
+    
+    pthread_mutex_unlock(&allocator->mutex);
+    pthread_mutex_destroy(&allocator->mutex);
+    allocator->initialized = false;
+}
+
+// 按内存需求分配（linear为false表示最优排列的图像）
+int vulkan_alloc_memory(struct vulkan_allocator* allocator, const VkMemoryRequirements* requirements,
+                        VkMemoryPropertyFlags properties, bool linear, struct vulkan_allocation* allocation) {
+    if (!allocator || !allocator->initialized || !requirements || !allocation || requirements->size == 0) {
+        LOGE("Invalid parameters");
+        return -1;
+    }
+    
+    memset(allocation, 0, sizeof(struct vulkan_allocation));
+    
+    pthread_mutex_lock(&allocator->mutex);
+    allocator->stats.alloc_calls++;
+    
+    // 依次尝试所有满足属性要求的内存类型，某个堆耗尽时退到下一个
+    const VkPhysicalDeviceMemoryProperties* mem_properties = &allocator->memory_properties;
+    for (uint32_t i = 0; i < mem_properties->memoryTypeCount; i++) {
+        if (!(requirements->memoryTypeBits & (1u << i)) ||
+            (mem_properties->memoryTypes[i].propertyFlags & properties) != properties) {
+            continue;
+        }
+        
+        if (alloc_from_type(allocator, i, requirements->size, requirements->alignment, linear, allocation) == 0) {
+            pthread_mutex_unlock(&allocator->mutex);
+            return 0;
+        }
+    }
+    
+    allocator->stats.failed_allocs++;
+    pthread_mutex_unlock(&allocator->mutex);
+    
+    LOGE("Failed to allocate %llu bytes (type bits 0x%x, properties 0x%x)",
+         (unsigned long long)requirements->size, requirements->memoryTypeBits, properties);
+    return -1;
+}
+
+// 释放分配
+void vulkan_alloc_free(struct vulkan_allocator* allocator, struct vulkan_allocation* allocation) {
+    if (!allocator || !allocator->initialized || !allocation || allocation->memory == VK_NULL_HANDLE) {
+        return;
+    }
+    
+    pthread_mutex_lock(&allocator->mutex);
+    allocator->stats.free_calls++;
+    
+    struct vulkan_memory_block* block = allocation->block;
+    if (!block) {
+        // 独立分配直接还给驱动
+        free_device_memory(allocator, allocation->memory_type, allocation->size,
+                           allocation->memory, allocation->mapped);
+        allocator->stats.dedicated_count--;
+        allocator->stats.dedicated_bytes -= allocation->size;
+    } else {
+        buddy_free(block, allocation->offset, alloc_order_for_size(allocation->size));
+        block->used -= allocation->size;
+        block->requested -= allocation->requested_size;
+        block->allocation_count--;
+        allocator->stats.used_bytes -= allocation->size;
+        allocator->stats.requested_bytes -= allocation->requested_size;
+        allocator->stats.allocation_count--;
+        
+        // 每种内存类型最多保留一个空块，避免频繁映射/取消映射时反复向驱动申请
+        if (block->allocation_count == 0) {
+            bool release = block->evacuating;
+            for (struct vulkan_memory_block* other = allocator->blocks[block->memory_type];
+                 other && !release; other = other->next) {
+                if (other != block && other->allocation_count == 0) {
+                    release = true;
+                }
+            }
+            
+            if (release) {
+                struct vulkan_memory_block** link = &allocator->blocks[block->memory_type];
+                while (*link != block) {
+                    link = &(*link)->next;
+                }
+                *link = block->next;
+                release_block(allocator, block);
+            }
+        }
+    }
+    
+    pthread_mutex_unlock(&allocator->mutex);
+    memset(allocation, 0, sizeof(struct vulkan_allocation));
+}
+
+// 创建缓冲区并绑定子分配的内存
+int vulkan_alloc_create_buffer(struct vulkan_allocator* allocator, VkDeviceSize size, VkBufferUsageFlags usage,
+                               VkMemoryPropertyFlags properties, VkBuffer* buffer, struct vulkan_allocation* allocation) {
+    if (!allocator || !allocator->initialized || !buffer || !allocation) {
+        LOGE("Invalid parameters");
+        return -1;
+    }
+    
+    VkBufferCreateInfo buffer_info = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .size = size,
+        .usage = usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE
+    };
+    
+    VkResult result = vkCreateBuffer(allocator->device, &buffer_info, NULL, buffer);
+    if (result != VK_SUCCESS) {
+        LOGE("Failed to create buffer: %d", result);
+        return -1;
+    }
+    
+    VkMemoryRequirements mem_requirements;
+    vkGetBufferMemoryRequirements(allocator->device, *buffer, &mem_requirements);
+    
+    if (vulkan_alloc_memory(allocator, &mem_requirements, properties, true, allocation) != 0) {
+        vkDestroyBuffer(allocator->device, *buffer, NULL);
+        *buffer = VK_NULL_HANDLE;
+        return -1;
+    }
+    
+    result = vkBindBufferMemory(allocator->device, *buffer, allocation->memory, allocation->offset);
+    if (result != VK_SUCCESS) {
+        LOGE("Failed to bind buffer memory: %d", result);
+        vkDestroyBuffer(allocator->device, *buffer, NULL);
+        *buffer = VK_NULL_HANDLE;
+        vulkan_alloc_free(allocator, allocation);
+        return -1;
+    }
+    
+    return 0;
+}
+
+// 销毁缓冲区并释放其内存
+void vulkan_alloc_destroy_buffer(struct vulkan_allocator* allocator, VkBuffer buffer, struct vulkan_allocation* allocation) {
+    if (!allocator || !allocator->initialized) {
+        return;
+    }
+    
+    if (buffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(allocator->device, buffer, NULL);
+    }
+    
+    vulkan_alloc_free(allocator, allocation);
+}
+
+// 创建图像并绑定子分配的内存
+int vulkan_alloc_create_image(struct vulkan_allocator* allocator, const VkImageCreateInfo* image_info,
+                              VkMemoryPropertyFlags properties, VkImage* image, struct vulkan_allocation* allocation) {
+    if (!allocator || !allocator->initialized || !image_info || !image || !allocation) {
+        LOGE("Invalid parameters");
+        return -1;
+    }
+    
+    VkResult result = vkCreateImage(allocator->device, image_info, NULL, image);
+    if (result != VK_SUCCESS) {
+        LOGE("Failed to create image: %d", result);
+        return -1;
+    }
+    
+    VkMemoryRequirements mem_requirements;
+    vkGetImageMemoryRequirements(allocator->device, *image, &mem_requirements);
+    
+    bool linear = image_info->tiling == VK_IMAGE_TILING_LINEAR;
+    if (vulkan_alloc_memory(allocator, &mem_requirements, properties, linear, allocation) != 0) {
+        vkDestroyImage(allocator->device, *image, NULL);
+        *image = VK_NULL_HANDLE;
+        return -1;
+    }
+    
+    result = vkBindImageMemory(allocator->device, *image, allocation->memory, allocation->offset);
+    if (result != VK_SUCCESS) {
+        LOGE("Failed to bind image memory: %d", result);
+        vkDestroyImage(allocator->device, *image, NULL);
+        *image = VK_NULL_HANDLE;
+        vulkan_alloc_free(allocator, allocation);
+        return -1;
+    }
+    
+    return 0;
+}
+
+// 销毁图像并释放其内存
+void vulkan_alloc_destroy_image(struct vulkan_allocator* allocator, VkImage image, struct vulkan_allocation* allocation) {
+    if (!allocator || !allocator->initialized) {
+        return;
+    }
+    
+    if (image != VK_NULL_HANDLE) {
+        vkDestroyImage(allocator->device, image, NULL);
+    }
+    
+    vulkan_alloc_free(allocator, allocation);
+}
+
+// 获取分配器统计
+void vulkan_alloc_get_stats(struct vulkan_allocator* allocator, struct vulkan_alloc_stats* stats) {
+    if (!stats) {
+        return;
+    }
+    
+    if (!allocator || !allocator->initialized) {
+        memset(stats, 0, sizeof(struct vulkan_alloc_stats));
+        return;
+    }
+    
+    pthread_mutex_lock(&allocator->mutex);
+    *stats = allocator->stats;
+    pthread_mutex_unlock(&allocator->mutex);
+}
+
+// 查询内存预算
+int vulkan_alloc_get_budget(struct vulkan_allocator* allocator, struct vulkan_memory_budget* budget) {
+    if (!allocator || !allocator->initialized || !budget) {
+        return -1;
+    }
+    
+    memset(budget, 0, sizeof(struct vulkan_memory_budget));
+    const VkPhysicalDeviceMemoryProperties* mem_properties = &allocator->memory_properties;
+    budget->heap_count = mem_properties->memoryHeapCount;
+    
+    if (allocator->budget_supported) {
+        // 驱动给出的预算考虑了其他进程和系统的占用
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_properties = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT,
+            .pNext = NULL
+        };
+        VkPhysicalDeviceMemoryProperties2 properties2 = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2,
+            .pNext = &budget_properties
+        };
+        vkGetPhysicalDeviceMemoryProperties2(allocator->physical_device, &properties2);
+        
+        for (uint32_t i = 0; i < budget->heap_count; i++) {
+            budget->heap_budget[i] = budget_properties.heapBudget[i];
+            budget->heap_usage[i] = budget_properties.heapUsage[i];
+        }
+        budget->from_driver = true;
+    } else {
+        // 没有扩展时按堆大小的固定比例估算，使用量只能统计本分配器的部分
+        pthread_mutex_lock(&allocator->mutex);
+        for (uint32_t i = 0; i < budget->heap_count; i++) {
+            budget->heap_budget[i] = mem_properties->memoryHeaps[i].size / 100 * VULKAN_ALLOC_FALLBACK_BUDGET_PERCENT;
+            budget->heap_usage[i] = allocator->heap_allocated[i];
+        }
+        pthread_mutex_unlock(&allocator->mutex);
+    }
+    
+    // 汇总设备本地堆；统一内存架构下通常只有一个堆
+    bool has_device_local = false;
+    for (uint32_t i = 0; i < budget->heap_count; i++) {
+        budget->heap_size[i] = mem_properties->memoryHeaps[i].size;
+        if (mem_properties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            budget->total_budget += budget->heap_budget[i];
+            budget->total_usage += budget->heap_usage[i];
+            has_device_local = true;
+        }
+    }
+    
+    if (!has_device_local) {
+        for (uint32_t i = 0; i < budget->heap_count; i++) {
+            budget->total_budget += budget->heap_budget[i];
+            budget->total_usage += budget->heap_usage[i];
+        }
+    }
+    
+    return 0;
+}
+
+// 开始碎片整理：利用率低于阈值的块不再接收新分配，返回标记的块数
+uint32_t vulkan_alloc_begin_defrag(struct vulkan_allocator* allocator, float max_utilization) {
+    if (!allocator || !allocator->initialized) {
+        return 0;
+    }
+    
+    pthread_mutex_lock(&allocator->mutex);
+    
+    uint32_t marked = 0;
+    for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; i++) {
+        // 同一类型至少要留一个块接收迁移出来的分配
+        uint32_t block_count = 0;
+        for (struct vulkan_memory_block* block = allocator->blocks[i]; block; block = block->next) {
+            block_count++;
+        }
+        
+        for (struct vulkan_memory_block* block = allocator->blocks[i]; block; block = block->next) {
+            float utilization = (float)block->used / (float)block->size;
+            if (block_count - marked > 1 && block->allocation_count > 0 && utilization < max_utilization) {
+                block->evacuating = true;
+                marked++;
+            }
+        }
+    }
+    
+    allocator->defrag_active = marked > 0;
+    pthread_mutex_unlock(&allocator->mutex);
+    
+    if (marked > 0) {
+        LOGI("Defragmentation started: %u blocks below %.0f%% utilization", marked, max_utilization * 100.0f);
+    }
+    
+    return marked;
+}
+
+// 碎片整理期间检查分配是否应当迁移（调用方重新分配、复制后释放旧分配）
+bool vulkan_alloc_should_move(struct vulkan_allocator* allocator, const struct vulkan_allocation* allocation) {
+    if (!allocator || !allocator->defrag_active || !allocation || !allocation->block) {
+        return false;
+    }
+    
+    return allocation->block->evacuating;
+}
+
+// 结束碎片整理并释放已清空的内存块
+void vulkan_alloc_end_defrag(struct vulkan_allocator* allocator) {
+    if (!allocator || !allocator->initialized) {
+        return;
+    }
+    
+    pthread_mutex_lock(&allocator->mutex);
+    
+    uint32_t released = 0;
+    for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; i++) {
+        struct vulkan_memory_block** link = &allocator->blocks[i];
+        while (*link) {
+            struct vulkan_memory_block* block = *link;
+            if (block->evacuating && block->allocation_count == 0) {
+                *link = block->next;
+                release_block(allocator, block);
+                released++;
+            } else {
+                block->evacuating = false;
+                link = &block->next;
+            }
+        }
+    }
+    
+    allocator->defrag_active = false;
+    pthread_mutex_unlock(&allocator->mutex);
+    
+    LOGI("Defragmentation finished: %u blocks released", released);
+}
+
+// 内部函数：计算容纳指定大小的伙伴阶数
+static uint32_t alloc_order_for_size(VkDeviceSize size) {
+    uint32_t order = 0;
+    while (((VkDeviceSize)VULKAN_ALLOC_MIN_SIZE << order) < size) {
+        order++;
+    }
+    return order;
+}
+
+// 内部函数：自底向上更新祖先节点，两个子节点都完全空闲时合并
+static void buddy_update_parents(uint8_t* tree, uint32_t index, uint32_t order) {
+    while (index > 0) {
+        index = (index - 1) / 2;
+        order++;
+        
+        // 子节点阶数为order-1，完全空闲时其值为order
+        uint8_t left = tree[2 * index + 1];
+        uint8_t right = tree[2 * index + 2];
+        if (left == order && right == order) {
+            tree[index] = (uint8_t)(order + 1);
+        } else {
+            tree[index] = left > right ? left : right;
+        }
+    }
+}
+
+// 内部函数：在块中分配指定阶数的伙伴
+static bool buddy_alloc(struct vulkan_memory_block* block, uint32_t order, VkDeviceSize* offset) {
+    uint8_t* tree = block->tree;
+    if (order > block->max_order || tree[0] < order + 1) {
+        return false;
+    }
+    
+    // 从根向下，优先左子树以把分配集中在块的低地址
+    uint32_t index = 0;
+    uint32_t node_order = block->max_order;
+    while (node_order > order) {
+        uint32_t left = 2 * index + 1;
+        index = tree[left] >= order + 1 ? left : left + 1;
+        node_order--;
+    }
+    
+    tree[index] = 0;
+    buddy_update_parents(tree, index, order);
+    
+    // 同一层第一个节点的下标为2^depth-1
+    uint32_t depth = block->max_order - order;
+    uint32_t position = index - ((1u << depth) - 1);
+    *offset = (VkDeviceSize)position * ((VkDeviceSize)VULKAN_ALLOC_MIN_SIZE << order);
+    return true;
+}
+
+// 内部函数：释放伙伴，分配时的阶数由分配大小得出
+static void buddy_free(struct vulkan_memory_block* block, VkDeviceSize offset, uint32_t order) {
+    uint32_t depth = block->max_order - order;
+    uint32_t position = (uint32_t)(offset / ((VkDeviceSize)VULKAN_ALLOC_MIN_SIZE << order));
+    uint32_t index = position + ((1u << depth) - 1);
+    
+    block->tree[index] = (uint8_t)(order + 1);
+    buddy_update_parents(block->tree, index, order);
+}
+
+// 内部函数：向驱动申请设备内存，主机可见时常驻映射
+static int alloc_device_memory(struct vulkan_allocator* allocator, uint32_t memory_type, VkDeviceSize size,
+                               VkDeviceMemory* memory, void** mapped) {
+    if (allocator->stats.max_device_allocations > 0 &&
+        allocator->stats.device_allocation_count >= allocator->stats.max_device_allocations) {
+        LOGE("maxMemoryAllocationCount (%u) reached", allocator->stats.max_device_allocations);
+        return -1;
+    }
+    
+    VkMemoryAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .pNext = NULL,
+        .allocationSize = size,
+        .memoryTypeIndex = memory_type
+    };
+    
+    VkResult result = vkAllocateMemory(allocator->device, &alloc_info, NULL, memory);
+    if (result != VK_SUCCESS) {
+        LOGE("Failed to allocate %llu bytes of memory type %u: %d", (unsigned long long)size, memory_type, result);
+        return -1;
+    }
+    
+    *mapped = NULL;
+    VkMemoryPropertyFlags flags = allocator->memory_properties.memoryTypes[memory_type].propertyFlags;
+    if (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        // 同一VkDeviceMemory只能映射一次，所以整块映射，子分配按偏移取地址
+        result = vkMapMemory(allocator->device, *memory, 0, size, 0, mapped);
+        if (result != VK_SUCCESS) {
+            LOGE("Failed to map memory: %d", result);
+            vkFreeMemory(allocator->device, *memory, NULL);
+            *memory = VK_NULL_HANDLE;
+            return -1;
+        }
+    }
+    
+    uint32_t heap = allocator->memory_properties.memoryTypes[memory_type].heapIndex;
+    allocator->heap_allocated[heap] += size;
+    allocator->stats.device_allocation_count++;
+    return 0;
+}
+
+// 内部函数：把设备内存还给驱动
+static void free_device_memory(struct vulkan_allocator* allocator, uint32_t memory_type, VkDeviceSize size,
+                               VkDeviceMemory memory, void* mapped) {
+    if (mapped) {
+        vkUnmapMemory(allocator->device, memory);
+    }
+    vkFreeMemory(allocator->device, memory, NULL);
+    
+    uint32_t heap = allocator->memory_properties.memoryTypes[memory_type].heapIndex;
+    allocator->heap_allocated[heap] -= size;
+    allocator->stats.device_allocation_count--;
+}
+
+// 内部函数：为内存类型创建新的内存块
+static struct vulkan_memory_block* create_block(struct vulkan_allocator* allocator, uint32_t memory_type, bool linear) {
+    uint32_t heap = allocator->memory_properties.memoryTypes[memory_type].heapIndex;
+    VkDeviceSize size = allocator->block_size[heap];
+    uint32_t max_order = alloc_order_for_size(size);
+    
+    struct vulkan_memory_block* block = (struct vulkan_memory_block*)calloc(1, sizeof(struct vulkan_memory_block));
+    if (!block) {
+        LOGE("Failed to allocate memory block");
+        return NULL;
+    }
+    
+    // 完全二叉树共2^(max_order+1)-1个节点
+    uint32_t node_count = (2u << max_order) - 1;
+    block->tree = (uint8_t*)malloc(node_count);
+    if (!block->tree) {
+        LOGE("Failed to allocate buddy tree");
+        free(block);
+        return NULL;
+    }
+    
+    // 深度为d的节点阶数为max_order-d，初始全部空闲
+    for (uint32_t depth = 0, first = 0; depth <= max_order; depth++) {
+        uint32_t count = 1u << depth;
+        memset(block->tree + first, (int)(max_order - depth + 1), count);
+        first += count;
+    }
+    
+    if (alloc_device_memory(allocator, memory_type, size, &block->memory, &block->mapped) != 0) {
+        free(block->tree);
+        free(block);
+        return NULL;
+    }
+    
+    block->size = size;
+    block->max_order = max_order;
+    block->memory_type = memory_type;
+    block->linear = linear;
+    
+    allocator->stats.block_count++;
+    allocator->stats.block_bytes += size;
+    
+    LOGD("Created %llu byte block for memory type %u (%s)", (unsigned long long)size, memory_type,
+         linear ? "linear" : "optimal");
+    return block;
+}
+
+// 内部函数：释放内存块（调用方负责从链表中移除）
+static void release_block(struct vulkan_allocator* allocator, struct vulkan_memory_block* block) {
+    free_device_memory(allocator, block->memory_type, block->size, block->memory, block->mapped);
+    
+    allocator->stats.block_count--;
+    allocator->stats.block_bytes -= block->size;
+    allocator->stats.used_bytes -= block->used;
+    allocator->stats.requested_bytes -= block->requested;
+    allocator->stats.allocation_count -= block->allocation_count;
+    
+    free(block->tree);
+    free(block);
+}
+
+// 内部函数：从指定内存类型分配（调用方持有锁）
+static int alloc_from_type(struct vulkan_allocator* allocator, uint32_t memory_type, VkDeviceSize size,
+                           VkDeviceSize alignment, bool linear, struct vulkan_allocation* allocation) {
+    uint32_t heap = allocator->memory_properties.memoryTypes[memory_type].heapIndex;
+    VkDeviceSize block_size = allocator->block_size[heap];
+    
+    // 大分配单独向驱动申请：伙伴取整会浪费接近一半（如1080p RGBA纹理8.3MB占16MB），也会让块很快被占满
+    if (size > block_size / VULKAN_ALLOC_DEDICATED_DIVISOR) {
+        VkDeviceMemory memory;
+        void* mapped;
+        if (alloc_device_memory(allocator, memory_type, size, &memory, &mapped) != 0) {
+            return -1;
+        }
+        
+        allocation->memory = memory;
+        allocation->offset = 0;
+        allocation->size = size;
+        allocation->requested_size = size;
+        allocation->mapped = mapped;
+        allocation->block = NULL;
+        allocation->memory_type = memory_type;
+        
+        allocator->stats.dedicated_count++;
+        allocator->stats.dedicated_bytes += size;
+        return 0;
+    }
+    
+    // 伙伴的偏移是其大小的整数倍，取大小和对齐中较大者即可满足对齐
+    uint32_t order = alloc_order_for_size(size > alignment ? size : alignment);
+    
+    // 粒度大于1时缓冲区和最优排列图像不能相邻，分开放在不同的块中
+    bool separate = allocator->buffer_image_granularity > 1;
+    
+    struct vulkan_memory_block* block = allocator->blocks[memory_type];
+    VkDeviceSize offset = 0;
+    for (; block; block = block->next) {
+        if (block->evacuating || (separate && block->linear != linear)) {
+            continue;
+        }
+        if (buddy_alloc(block, order, &offset)) {
+            break;
+        }
+    }
+    
+    if (!block) {
+        block = create_block(allocator, memory_type, linear);
+        if (!block) {
+            return -1;
+        }
+        block->next = allocator->blocks[memory_type];
+        allocator->blocks[memory_type] = block;
+        
+        if (!buddy_alloc(block, order, &offset)) {
+            return -1;
+        }
+    }
+    
+    VkDeviceSize buddy_size = (VkDeviceSize)VULKAN_ALLOC_MIN_SIZE << order;
+    block->used += buddy_size;
+    block->requested += size;
+    block->allocation_count++;
+    
+    allocation->memory = block->memory;
+    allocation->offset = offset;
+    allocation->size = buddy_size;
+    allocation->requested_size = size;
+    allocation->mapped = block->mapped ? (uint8_t*)block->mapped + offset : NULL;
+    allocation->block = block;
+    allocation->memory_type = memory_type;
+    
+    allocator->stats.used_bytes += buddy_size;
+    allocator->stats.requested_bytes += size;
+    allocator->stats.allocation_count++;
+    return 0;
+}
@@ -0,0 +1,139 @@
+#ifndef COMPOSITOR_VULKAN_ALLOC_H
+#define COMPOSITOR_VULKAN_ALLOC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "vulkan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 默认内存块大小（小堆按堆大小的1/8缩小）
+#define VULKAN_ALLOC_BLOCK_SIZE (64ULL * 1024 * 1024)
+// 伙伴分配的最小单元（字节，必须是2的幂）
+#define VULKAN_ALLOC_MIN_SIZE 4096
+// 超过块大小1/N的分配单独向驱动申请（伙伴按2的幂取整，大分配的取整浪费最多接近一半）
+#define VULKAN_ALLOC_DEDICATED_DIVISOR 8
+// 没有VK_EXT_memory_budget时按堆大小的百分比估算预算
+#define VULKAN_ALLOC_FALLBACK_BUDGET_PERCENT 80
+
+// 设备内存块（一个VkDeviceMemory，内部用伙伴树分配）
+struct vulkan_memory_block {
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    void* mapped;                       // 主机可见内存常驻映射，否则为NULL
+    uint8_t* tree;                      // 伙伴树：每个节点保存子树最大空闲阶数+1，0表示已满
+    uint32_t max_order;                 // 块大小 = VULKAN_ALLOC_MIN_SIZE << max_order
+    uint32_t memory_type;
+    bool linear;                        // 存放缓冲区/线性图像（与最优排列图像分开以满足bufferImageGranularity）
+    bool evacuating;                    // 碎片整理中，不再放入新分配
+    VkDeviceSize used;                  // 已分配字节数（按伙伴大小）
+    VkDeviceSize requested;             // 请求的字节数（不含伙伴取整）
+    uint32_t allocation_count;
+    struct vulkan_memory_block* next;
+};
+
+// 一次子分配的结果
+struct vulkan_allocation {
+    VkDeviceMemory memory;
+    VkDeviceSize offset;
+    VkDeviceSize size;                  // 实际占用大小（子分配为伙伴大小）
+    VkDeviceSize requested_size;        // 请求的大小
+    void* mapped;                       // 主机可见时的映射地址
+    struct vulkan_memory_block* block;  // 独立分配时为NULL
+    uint32_t memory_type;
+};
+
+// 分配器统计
+struct vulkan_alloc_stats {
+    uint32_t block_count;               // 内存块数
+    uint32_t dedicated_count;           // 独立分配数
+    uint32_t allocation_count;          // 存活的子分配数
+    uint32_t device_allocation_count;   // 驱动分配对象数（受maxMemoryAllocationCount限制）
+    uint32_t max_device_allocations;    // 驱动分配对象上限
+    uint64_t block_bytes;               // 内存块总字节数
+    uint64_t used_bytes;                // 子分配占用字节数（含伙伴取整）
+    uint64_t requested_bytes;           // 子分配请求的字节数（与used_bytes之差为取整浪费）
+    uint64_t dedicated_bytes;           // 独立分配字节数
+    uint64_t alloc_calls;
+    uint64_t free_calls;
+    uint64_t failed_allocs;
+};
+
+// 内存预算
+struct vulkan_memory_budget {
+    uint32_t heap_count;
+    VkDeviceSize heap_size[VK_MAX_MEMORY_HEAPS];
+    VkDeviceSize heap_budget[VK_MAX_MEMORY_HEAPS];  // 本进程可用的预算
+    VkDeviceSize heap_usage[VK_MAX_MEMORY_HEAPS];   // 本进程已使用
+    VkDeviceSize total_budget;          // 设备本地堆的预算之和
+    VkDeviceSize total_usage;           // 设备本地堆的使用之和
+    bool from_driver;                   // 来自VK_EXT_memory_budget，否则为估算
+};
+
+// 设备内存分配器
+struct vulkan_allocator {
+    VkDevice device;
+    VkPhysicalDevice physical_device;
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    VkDeviceSize block_size[VK_MAX_MEMORY_HEAPS];   // 每个堆的内存块大小
+    VkDeviceSize buffer_image_granularity;
+    struct vulkan_memory_block* blocks[VK_MAX_MEMORY_TYPES]; // 按内存类型的块链表
+    VkDeviceSize heap_allocated[VK_MAX_MEMORY_HEAPS];        // 本分配器向驱动申请的字节数
+    bool budget_supported;              // 是否启用了VK_EXT_memory_budget
+    bool defrag_active;
+    bool initialized;
+    pthread_mutex_t mutex;
+    struct vulkan_alloc_stats stats;
+};
+
+// 初始化分配器
+int vulkan_alloc_init(struct vulkan_allocator* allocator, VkPhysicalDevice physical_device, VkDevice device,
+                      bool budget_supported);
+
+// 销毁分配器（释放所有内存块）
+void vulkan_alloc_destroy(struct vulkan_allocator* allocator);
+
+// 按内存需求分配（linear为false表示最优排列的图像）
+int vulkan_alloc_memory(struct vulkan_allocator* allocator, const VkMemoryRequirements* requirements,
+                        VkMemoryPropertyFlags properties, bool linear, struct vulkan_allocation* allocation);
+
+// 释放分配
+void vulkan_alloc_free(struct vulkan_allocator* allocator, struct vulkan_allocation* allocation);
+
+// 创建缓冲区并绑定子分配的内存
+int vulkan_alloc_create_buffer(struct vulkan_allocator* allocator, VkDeviceSize size, VkBufferUsageFlags usage,
+                               VkMemoryPropertyFlags properties, VkBuffer* buffer, struct vulkan_allocation* allocation);
+
+// 销毁缓冲区并释放其内存
+void vulkan_alloc_destroy_buffer(struct vulkan_allocator* allocator, VkBuffer buffer, struct vulkan_allocation* allocation);
+
+// 创建图像并绑定子分配的内存
+int vulkan_alloc_create_image(struct vulkan_allocator* allocator, const VkImageCreateInfo* image_info,
+                              VkMemoryPropertyFlags properties, VkImage* image, struct vulkan_allocation* allocation);
+
+// 销毁图像并释放其内存
+void vulkan_alloc_destroy_image(struct vulkan_allocator* allocator, VkImage image, struct vulkan_allocation* allocation);
+
+// 获取分配器统计
+void vulkan_alloc_get_stats(struct vulkan_allocator* allocator, struct vulkan_alloc_stats* stats);
+
+// 查询内存预算
+int vulkan_alloc_get_budget(struct vulkan_allocator* allocator, struct vulkan_memory_budget* budget);
+
+// 开始碎片整理：利用率低于阈值的块不再接收新分配，返回标记的块数
+uint32_t vulkan_alloc_begin_defrag(struct vulkan_allocator* allocator, float max_utilization);
+
+// 碎片整理期间检查分配是否应当迁移（调用方重新分配、复制后释放旧分配）
+bool vulkan_alloc_should_move(struct vulkan_allocator* allocator, const struct vulkan_allocation* allocation);
+
+// 结束碎片整理并释放已清空的内存块
+void vulkan_alloc_end_defrag(struct vulkan_allocator* allocator);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COMPOSITOR_VULKAN_ALLOC_H
@@ -0,0 +1,780 @@
+#include "compositor_vulkan_layers.h"
+#include "compositor_vulkan.h"
+#include <string.h>
+#include <android/log.h>
+
+#define LOG_TAG "VulkanLayers"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+
+// 内部函数声明
+static int create_layer_render_pass(struct vulkan_state* vk, bool load, VkRenderPass* render_pass);
+static int create_layer_image(struct vulkan_state* vk, struct vulkan_cached_layer* cached);
+static void destroy_layer_image(struct vulkan_state* vk, struct vulkan_cached_layer* cached);
+static bool damage_bounds(const struct dirty_region* regions, uint32_t region_count, int width, int height,
+                          VkRect2D* bounds);
+
+// 初始化层缓存（不创建图像，按层启用时再创建）
+int vulkan_layer_cache_init(struct vulkan_state* vk) {
+    if (!vk || vk->device == VK_NULL_HANDLE) {
+        LOGE("Invalid parameters");
+        return -1;
+    }
+    
+    struct vulkan_layer_cache* cache = &vk->layer_cache;
+    memset(cache, 0, sizeof(struct vulkan_layer_cache));
+    cache->width = vk->width;
+    cache->height = vk->height;
+    cache->format = vk->swapchain_format != VK_FORMAT_UNDEFINED ? vk->swapchain_format : VULKAN_LAYER_CACHE_FORMAT;
+    
+    if (create_layer_render_pass(vk, false, &cache->render_pass_clear) != 0 ||
+        create_layer_render_pass(vk, true, &cache->render_pass_load) != 0) {
+        vulkan_layer_cache_destroy(vk);
+        return -1;
+    }
+    
+    // 层图像与屏幕同尺寸，一一对应采样，最近邻即可
+    VkSamplerCreateInfo sampler_info = {
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .magFilter = VK_FILTER_NEAREST,
+        .minFilter = VK_FILTER_NEAREST,
+        .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .mipLodBias = 0.0f,
+        .anisotropyEnable = VK_FALSE,
+        .maxAnisotropy = 1.0f,
+        .compareEnable = VK_FALSE,
+        .compareOp = VK_COMPARE_OP_ALWAYS,
+        .minLod = 0.0f,
+        .maxLod = 0.0f,
+        .borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK,
+        .unnormalizedCoordinates = VK_FALSE
+    };
+    
+    VkResult result = vkCreateSampler(vk->device, &sampler_info, NULL, &cache->sampler);
+    if (result != VK_SUCCESS) {
+        LOGE("Failed to create layer sampler: %d", result);
+        vulkan_layer_cache_destroy(vk);
+        return -1;
+    }
+    
+    VkDescriptorSetLayoutBinding binding = {
+        .binding = 0,
+        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .descriptorCount = 1,
+        .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+        .pImmutableSamplers = NULL
+    };
+    
+    VkDescriptorSetLayoutCreateInfo layout_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .bindingCount = 1,
+        .pBindings = &binding
+    };
+    
+    result = vkCreateDescriptorSetLayout(vk->device, &layout_info, NULL, &cache->set_layout);
+    if (result != VK_SUCCESS) {
+        LOGE("Failed to create layer descriptor set layout: %d", result);
+        vulkan_layer_cache_destroy(vk);
+        return -1;
+    }
+    
+    // 每层一个描述符集，图像重建时原地更新
+    VkDescriptorPoolSize pool_size = {
+        .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .descriptorCount = RENDER_LAYER_COUNT
+    };
+    
+    VkDescriptorPoolCreateInfo pool_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .maxSets = RENDER_LAYER_COUNT,
+        .poolSizeCount = 1,
+        .pPoolSizes = &pool_size
+    };
+    
+    result = vkCreateDescriptorPool(vk->device, &pool_info, NULL, &cache->descriptor_pool);
+    if (result != VK_SUCCESS) {
+        LOGE("Failed to create layer descriptor pool: %d", result);
+        vulkan_layer_cache_destroy(vk);
+        return -1;
+    }
+    
+    VkDescriptorSetLayout set_layouts[RENDER_LAYER_COUNT];
+    VkDescriptorSet sets[RENDER_LAYER_COUNT];
+    for (uint32_t i = 0; i < RENDER_LAYER_COUNT; i++) {
+        set_layouts[i] = cache->set_layout;
+    }
+    
+    VkDescriptorSetAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .pNext = NULL,
+        .descriptorPool = cache->descriptor_pool,
+        .descriptorSetCount = RENDER_LAYER_COUNT,
+        .pSetLayouts = set_layouts
+    };
+    
+    result = vkAllocateDescriptorSets(vk->device, &alloc_info, sets);
+    if (result != VK_SUCCESS) {
+        LOGE("Failed to allocate layer descriptor sets: %d", result);
+        vulkan_layer_cache_destroy(vk);
+        return -1;
+    }
+    
+    for (uint32_t i = 0; i < RENDER_LAYER_COUNT; i++) {
+        cache->layers[i].descriptor_set = sets[i];
+    }
+    
+    VkPipelineLayoutCreateInfo pipeline_layout_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .setLayoutCount = 1,
+        .pSetLayouts = &cache->set_layout,
+        .pushConstantRangeCount = 0,
+        .pPushConstantRanges = NULL
+    };
+    
+    result = vkCreatePipelineLayout(vk->device, &pipeline_layout_info, NULL, &cache->pipeline_layout);
+    if (result != VK_SUCCESS) {
+        LOGE("Failed to create layer pipeline layout: %d", result);
+        vulkan_layer_cache_destroy(vk);
+        return -1;
+    }
+    
+    cache->initialized = true;
+    
+    LOGI("Layer cache initialized: %dx%d", cache->width, cache->height);
+    return 0;
+}
+
+// 销毁层缓存
+void vulkan_layer_cache_destroy(struct vulkan_state* vk) {
+    if (!vk || vk->device == VK_NULL_HANDLE) {
+        return;
+    }
+    
+    struct vulkan_layer_cache* cache = &vk->layer_cache;
+    
+    for (uint32_t i = 0; i < RENDER_LAYER_COUNT; i++) {
+        destroy_layer_image(vk, &cache->layers[i]);
+    }
+    
+    if (cache->owns_pipeline && cache->pipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(vk->device, cache->pipeline, NULL);
+    }
+    
+    // 描述符集随描述符池一起释放
+    if (cache->descriptor_pool != VK_NULL_HANDLE) {
+        vkDestroyDescriptorPool(vk->device, cache->descriptor_pool, NULL);
+    }
+    if (cache->pipeline_layout != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(vk->device, cache->pipeline_layout, NULL);
+    }
+    if (cache->set_layout != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(vk->device, cache->set_layout, NULL);
+    }
+    if (cache->sampler != VK_NULL_HANDLE) {
+        vkDestroySampler(vk->device, cache->sampler, NULL);
+    }
+    if (cache->render_pass_clear != VK_NULL_HANDLE) {
+        vkDestroyRenderPass(vk->device, cache->render_pass_clear, NULL);
+    }
+    if (cache->render_pass_load != VK_NULL_HANDLE) {
+        vkDestroyRenderPass(vk->device, cache->render_pass_load, NULL);
+    }
+    
+    memset(cache, 0, sizeof(struct vulkan_layer_cache));
+}
+
+// 屏幕尺寸改变时重建已启用层的图像（所有层内容失效）
+int vulkan_layer_cache_resize(struct vulkan_state* vk, int width, int height) {
+    if (!vk || !vk->layer_cache.initialized || width <= 0 || height <= 0) {
+        return -1;
+    }
+    
+    struct vulkan_layer_cache* cache = &vk->layer_cache;
+    cache->width = width;
+    cache->height = height;
+    
+    // 调用方（交换链重建）已等待设备空闲
+    int ret = 0;
+    for (uint32_t i = 0; i < RENDER_LAYER_COUNT; i++) {
+        struct vulkan_cached_layer* cached = &cache->layers[i];
+        destroy_layer_image(vk, cached);
+        
+        if (cached->enabled && cache->pipeline != VK_NULL_HANDLE && create_layer_image(vk, cached) != 0) {
+            LOGE("Failed to recreate cache image for layer %u", i);
+            cached->enabled = false;
+            ret = -1;
+        }
+    }
+    
+    return ret;
+}
+
+// 设置合成管线
+void vulkan_layer_cache_set_pipeline(struct vulkan_state* vk, VkPipeline pipeline) {
+    if (!vk || !vk->layer_cache.initialized) {
+        return;
+    }
+    
+    struct vulkan_layer_cache* cache = &vk->layer_cache;
+    
+    // 替换自己创建的管线时等在途帧完成后再释放
+    if (cache->owns_pipeline && cache->pipeline != VK_NULL_HANDLE && cache->pipeline != pipeline) {
+        vulkan_device_wait_idle(vk);
+        vkDestroyPipeline(vk->device, cache->pipeline, NULL);
+    }
+    cache->owns_pipeline = false;
+    cache->pipeline = pipeline;
+    if (pipeline == VK_NULL_HANDLE) {
+        return;
+    }
+    
+    // 已启用但还没有图像的层现在才分配
+    for (uint32_t i = 0; i < RENDER_LAYER_COUNT; i++) {
+        struct vulkan_cached_layer* cached = &cache->layers[i];
+        if (cached->enabled && cached->image == VK_NULL_HANDLE && create_layer_image(vk, cached) != 0) {
+            LOGE("Failed to create cache image for layer %u", i);
+            cached->enabled = false;
+        }
+    }
+}
+
+// 用着色器模块创建合成管线并设置
+int vulkan_layer_cache_create_pipeline(struct vulkan_state* vk, VkShaderModule vertex_shader,
+                                       VkShaderModule fragment_shader) {
+    if (!vk || !vk->layer_cache.initialized || vertex_shader == VK_NULL_HANDLE ||
+        fragment_shader == VK_NULL_HANDLE) {
+        LOGE("Invalid parameters");
+        return -1;
+    }
+    
+    struct vulkan_layer_cache* cache = &vk->layer_cache;
+    
+    VkPipelineShaderStageCreateInfo stages[2] = {
+        {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .stage = VK_SHADER_STAGE_VERTEX_BIT,
+            .module = vertex_shader,
+            .pName = "main",
+            .pSpecializationInfo = NULL
+        },
+        {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .pNext = NULL,
+            .flags = 0,
+            .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .module = fragment_shader,
+            .pName = "main",
+            .pSpecializationInfo = NULL
+        }
+    };
+    
+    // 顶点由gl_VertexIndex生成，没有顶点输入
+    VkPipelineVertexInputStateCreateInfo vertex_input = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .vertexBindingDescriptionCount = 0,
+        .pVertexBindingDescriptions = NULL,
+        .vertexAttributeDescriptionCount = 0,
+        .pVertexAttributeDescriptions = NULL
+    };
+    
+    VkPipelineInputAssemblyStateCreateInfo input_assembly = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
+        .primitiveRestartEnable = VK_FALSE
+    };
+    
+    // 视口和裁剪矩形在绘制时设置
+    VkPipelineViewportStateCreateInfo viewport_state = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .viewportCount = 1,
+        .pViewports = NULL,
+        .scissorCount = 1,
+        .pScissors = NULL
+    };
+    
+    VkPipelineRasterizationStateCreateInfo rasterization = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .depthClampEnable = VK_FALSE,
+        .rasterizerDiscardEnable = VK_FALSE,
+        .polygonMode = VK_POLYGON_MODE_FILL,
+        .cullMode = VK_CULL_MODE_NONE,
+        .frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+        .depthBiasEnable = VK_FALSE,
+        .depthBiasConstantFactor = 0.0f,
+        .depthBiasClamp = 0.0f,
+        .depthBiasSlopeFactor = 0.0f,
+        .lineWidth = 1.0f
+    };
+    
+    VkPipelineMultisampleStateCreateInfo multisample = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+        .sampleShadingEnable = VK_FALSE,
+        .minSampleShading = 0.0f,
+        .pSampleMask = NULL,
+        .alphaToCoverageEnable = VK_FALSE,
+        .alphaToOneEnable = VK_FALSE
+    };
+    
+    // 层图像清除为透明，内容是预乘alpha，按over混合到帧上
+    VkPipelineColorBlendAttachmentState blend_attachment = {
+        .blendEnable = VK_TRUE,
+        .srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
+        .dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+        .colorBlendOp = VK_BLEND_OP_ADD,
+        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+        .alphaBlendOp = VK_BLEND_OP_ADD,
+        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                          VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
+    };
+    
+    VkPipelineColorBlendStateCreateInfo color_blend = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .logicOpEnable = VK_FALSE,
+        .logicOp = VK_LOGIC_OP_COPY,
+        .attachmentCount = 1,
+        .pAttachments = &blend_attachment,
+        .blendConstants = {0.0f, 0.0f, 0.0f, 0.0f}
+    };
+    
+    VkDynamicState dynamic_states[2] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamic_state = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .dynamicStateCount = 2,
+        .pDynamicStates = dynamic_states
+    };
+    
+    // 在主渲染通道中合成（render_pass_load与其兼容）
+    VkGraphicsPipelineCreateInfo pipeline_info = {
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .stageCount = 2,
+        .pStages = stages,
+        .pVertexInputState = &vertex_input,
+        .pInputAssemblyState = &input_assembly,
+        .pTessellationState = NULL,
+        .pViewportState = &viewport_state,
+        .pRasterizationState = &rasterization,
+        .pMultisampleState = &multisample,
+        .pDepthStencilState = NULL,
+        .pColorBlendState = &color_blend,
+        .pDynamicState = &dynamic_state,
+        .layout = cache->pipeline_layout,
+        .renderPass = vk->render_pass,
+        .subpass = 0,
+        .basePipelineHandle = VK_NULL_HANDLE,
+        .basePipelineIndex = -1
+    };
+    
+    // 经持久化的管线缓存编译，第二次启动起驱动直接命中缓存
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkResult result = vkCreateGraphicsPipelines(vk->device, vulkan_get_pipeline_cache(vk), 1, &pipeline_info,
+                                                NULL, &pipeline);
+    if (result != VK_SUCCESS) {
+        LOGE("Failed to create layer composition pipeline: %d", result);
+        return -1;
+    }
+    
+    vulkan_layer_cache_set_pipeline(vk, pipeline);
+    cache->owns_pipeline = true;
+    
+    // 立即持久化：进程可能被直接杀死而不经过销毁流程（内容未变时不重写文件）
+    vulkan_save_pipeline_cache(vk);
+    
+    LOGI("Layer composition pipeline created");
+    return 0;
+}
+
+// 启用/禁用层的离屏缓存
+int vulkan_layer_cache_set_enabled(struct vulkan_state* vk, render_layer_type_t layer, bool enabled) {
+    if (!vk || !vk->layer_cache.initialized || layer < 0 || layer >= RENDER_LAYER_COUNT) {
+        return -1;
+    }
+    
+    struct vulkan_cached_layer* cached = &vk->layer_cache.layers[layer];
+    if (cached->enabled == enabled) {
+        return 0;
+    }
+    
+    // 没有合成管线时缓存不会生效，图像推迟到设置管线时创建
+    if (enabled) {
+        if (vk->layer_cache.pipeline != VK_NULL_HANDLE && create_layer_image(vk, cached) != 0) {
+            LOGE("Failed to create cache image for layer %d", layer);
+            return -1;
+        }
+    } else {
+        // 图像可能仍被在途帧采样
+        vulkan_device_wait_idle(vk);
+        destroy_layer_image(vk, cached);
+    }
+    
+    cached->enabled = enabled;
+    
+    LOGI("Layer %d cache %s", layer, enabled ? "enabled" : "disabled");
+    return 0;
+}
+
+// 检查层是否通过离屏缓存合成
+bool vulkan_layer_cache_is_active(struct vulkan_state* vk, render_layer_type_t layer) {
+    if (!vk || !vk->layer_cache.initialized || layer < 0 || layer >= RENDER_LAYER_COUNT) {
+        return false;
+    }
+    
+    const struct vulkan_cached_layer* cached = &vk->layer_cache.layers[layer];
+    return cached->enabled && cached->image != VK_NULL_HANDLE && vk->layer_cache.pipeline != VK_NULL_HANDLE;
+}
+
+// 使层的缓存内容失效
+void vulkan_layer_cache_invalidate(struct vulkan_state* vk, render_layer_type_t layer) {
+    if (!vk || !vk->layer_cache.initialized || layer < 0 || layer >= RENDER_LAYER_COUNT) {
+        return;
+    }
+    
+    vk->layer_cache.layers[layer].valid = false;
+}
+
+// 按本层的损伤重建缓存（须在渲染通道外调用）
+int vulkan_layer_cache_update(struct vulkan_state* vk, VkCommandBuffer command_buffer, render_layer_type_t layer,
+                              const struct dirty_region* regions, uint32_t region_count,
+                              vulkan_layer_record_func_t record_func) {
+    if (!vulkan_layer_cache_is_active(vk, layer) || command_buffer == VK_NULL_HANDLE || !record_func) {
+        return -1;
+    }
+    
+    struct vulkan_layer_cache* cache = &vk->layer_cache;
+    struct vulkan_cached_layer* cached = &cache->layers[layer];
+    
+    // 内容有效时只重建本层损伤的包围盒，没有损伤就直接复用
+    VkRect2D area = {
+        .offset = {0, 0},
+        .extent = {(uint32_t)cache->width, (uint32_t)cache->height}
+    };
+    if (cached->valid && !damage_bounds(regions, region_count, cache->width, cache->height, &area)) {
+        return 0;
+    }
+    
+    VkClearValue clear_value = {.color = {{0.0f, 0.0f, 0.0f, 0.0f}}};
+    VkRenderPassBeginInfo begin_info = {
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+        .pNext = NULL,
+        .renderPass = cached->valid ? cache->render_pass_load : cache->render_pass_clear,
+        .framebuffer = cached->framebuffer,
+        .renderArea = area,
+        .clearValueCount = 1,
+        .pClearValues = &clear_value
+    };
+    
+    vkCmdBeginRenderPass(command_buffer, &begin_info, VK_SUBPASS_CONTENTS_INLINE);
+    
+    // 局部重建时先清除损伤区域，层内容按透明背景重新绘制
+    if (cached->valid) {
+        VkClearAttachment clear_attachment = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .colorAttachment = 0,
+            .clearValue = clear_value
+        };
+        VkClearRect clear_rect = {
+            .rect = area,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        };
+        vkCmdClearAttachments(command_buffer, 1, &clear_attachment, 1, &clear_rect);
+    }
+    
+    record_func(command_buffer, &area);
+    vkCmdEndRenderPass(command_buffer);
+    
+    cached->valid = true;
+    cached->rebuild_count++;
+    
+    LOGD("Layer %d cache rebuilt: %ux%u at (%d,%d)", layer, area.extent.width, area.extent.height,
+         area.offset.x, area.offset.y);
+    return 0;
+}
+
+// 在当前渲染通道中把层缓存作为全屏四边形合成
+void vulkan_layer_cache_draw(struct vulkan_state* vk, VkCommandBuffer command_buffer, render_layer_type_t layer,
+                             const VkRect2D* clip) {
+    if (!vulkan_layer_cache_is_active(vk, layer) || command_buffer == VK_NULL_HANDLE) {
+        return;
+    }
+    
+    struct vulkan_layer_cache* cache = &vk->layer_cache;
+    
+    VkViewport viewport = {
+        .x = 0.0f,
+        .y = 0.0f,
+        .width = (float)cache->width,
+        .height = (float)cache->height,
+        .minDepth = 0.0f,
+        .maxDepth = 1.0f
+    };
+    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+    
+    VkRect2D scissor = {
+        .offset = {0, 0},
+        .extent = {(uint32_t)cache->width, (uint32_t)cache->height}
+    };
+    if (clip) {
+        scissor = *clip;
+    }
+    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+    
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, cache->pipeline);
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, cache->pipeline_layout,
+                            0, 1, &cache->layers[layer].descriptor_set, 0, NULL);
+    vkCmdDraw(command_buffer, 4, 1, 0, 0);
+}
+
+// 内部函数：创建层图像的渲染通道
+static int create_layer_render_pass(struct vulkan_state* vk, bool load, VkRenderPass* render_pass) {
+    // 整层重建时不关心旧内容；局部重建时加载上次的内容（上次合成后处于着色器只读布局）
+    VkAttachmentDescription color_attachment = {
+        .flags = 0,
+        .format = vk->layer_cache.format,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .loadOp = load ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+        .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .initialLayout = load ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+        .finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    };
+    
+    VkAttachmentReference color_attachment_ref = {
+        .attachment = 0,
+        .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+    };
+    
+    VkSubpassDescription subpass = {
+        .flags = 0,
+        .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+        .inputAttachmentCount = 0,
+        .pInputAttachments = NULL,
+        .colorAttachmentCount = 1,
+        .pColorAttachments = &color_attachment_ref,
+        .pResolveAttachments = NULL,
+        .pDepthStencilAttachment = NULL,
+        .preserveAttachmentCount = 0,
+        .pPreserveAttachments = NULL
+    };
+    
+    // 写入前等待之前帧的合成采样完成；写入完成后本帧的合成才能采样
+    VkSubpassDependency dependencies[2] = {
+        {
+            .srcSubpass = VK_SUBPASS_EXTERNAL,
+            .dstSubpass = 0,
+            .srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            .srcAccessMask = 0,
+            .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            .dependencyFlags = 0
+        },
+        {
+            .srcSubpass = 0,
+            .dstSubpass = VK_SUBPASS_EXTERNAL,
+            .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            .dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+            .dependencyFlags = 0
+        }
+    };
+    
+    VkRenderPassCreateInfo render_pass_info = {
+        .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .attachmentCount = 1,
+        .pAttachments = &color_attachment,
+        .subpassCount = 1,
+        .pSubpasses = &subpass,
+        .dependencyCount = 2,
+        .pDependencies = dependencies
+    };
+    
+    VkResult result = vkCreateRenderPass(vk->device, &render_pass_info, NULL, render_pass);
+    if (result != VK_SUCCESS) {
+        LOGE("Failed to create layer render pass: %d", result);
+        return -1;
+    }
+    
+    return 0;
+}
+
+// 内部函数：创建层图像、视图和帧缓冲区，并更新描述符集
+static int create_layer_image(struct vulkan_state* vk, struct vulkan_cached_layer* cached) {
+    struct vulkan_layer_cache* cache = &vk->layer_cache;
+    
+    VkImageCreateInfo image_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = vk->layer_cache.format,
+        .extent = {(uint32_t)cache->width, (uint32_t)cache->height, 1},
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 0,
+        .pQueueFamilyIndices = NULL,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+    };
+    
+    if (vulkan_alloc_create_image(&vk->allocator, &image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                  &cached->image, &cached->allocation) != 0) {
+        return -1;
+    }
+    
+    VkImageViewCreateInfo view_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .image = cached->image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = vk->layer_cache.format,
+        .components = {
+            VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY,
+            VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY
+        },
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        }
+    };
+    
+    VkResult result = vkCreateImageView(vk->device, &view_info, NULL, &cached->view);
+    if (result != VK_SUCCESS) {
+        LOGE("Failed to create layer image view: %d", result);
+        destroy_layer_image(vk, cached);
+        return -1;
+    }
+    
+    VkFramebufferCreateInfo framebuffer_info = {
+        .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .renderPass = cache->render_pass_clear,
+        .attachmentCount = 1,
+        .pAttachments = &cached->view,
+        .width = (uint32_t)cache->width,
+        .height = (uint32_t)cache->height,
+        .layers = 1
+    };
+    
+    result = vkCreateFramebuffer(vk->device, &framebuffer_info, NULL, &cached->framebuffer);
+    if (result != VK_SUCCESS) {
+        LOGE("Failed to create layer framebuffer: %d", result);
+        destroy_layer_image(vk, cached);
+        return -1;
+    }
+    
+    VkDescriptorImageInfo descriptor_image = {
+        .sampler = cache->sampler,
+        .imageView = cached->view,
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+    };
+    
+    VkWriteDescriptorSet write = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .pNext = NULL,
+        .dstSet = cached->descriptor_set,
+        .dstBinding = 0,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .pImageInfo = &descriptor_image,
+        .pBufferInfo = NULL,
+        .pTexelBufferView = NULL
+    };
+    vkUpdateDescriptorSets(vk->device, 1, &write, 0, NULL);
+    
+    // 新图像内容未定义，首次更新时整层重建
+    cached->valid = false;
+    return 0;
+}
+
+// 内部函数：销毁层图像（保留描述符集和启用状态）
+static void destroy_layer_image(struct vulkan_state* vk, struct vulkan_cached_layer* cached) {
+    if (cached->framebuffer != VK_NULL_HANDLE) {
+        vkDestroyFramebuffer(vk->device, cached->framebuffer, NULL);
+        cached->framebuffer = VK_NULL_HANDLE;
+    }
+    if (cached->view != VK_NULL_HANDLE) {
+        vkDestroyImageView(vk->device, cached->view, NULL);
+        cached->view = VK_NULL_HANDLE;
+    }
+    if (cached->image != VK_NULL_HANDLE) {
+        vulkan_alloc_destroy_image(&vk->allocator, cached->image, &cached->allocation);
+        cached->image = VK_NULL_HANDLE;
+    }
+    
+    cached->valid = false;
+}
+
+// 内部函数：计算损伤的包围盒（裁剪到层图像内），没有损伤时返回false
+static bool damage_bounds(const struct dirty_region* regions, uint32_t region_count, int width, int height,
+                          VkRect2D* bounds) {
+    int x0 = width, y0 = height, x1 = 0, y1 = 0;
+    
+    for (uint32_t i = 0; regions && i < region_count; i++) {
+        int rx0 = regions[i].x < 0 ? 0 : regions[i].x;
+        int ry0 = regions[i].y < 0 ? 0 : regions[i].y;
+        int rx1 = regions[i].x + regions[i].width > width ? width : regions[i].x + regions[i].width;
+        int ry1 = regions[i].y + regions[i].height > height ? height : regions[i].y + regions[i].height;
+        if (rx1 <= rx0 || ry1 <= ry0) {
+            continue;
+        }
+        
+        if (rx0 < x0) x0 = rx0;
+        if (ry0 < y0) y0 = ry0;
+        if (rx1 > x1) x1 = rx1;
+        if (ry1 > y1) y1 = ry1;
+    }
+    
+    if (x1 <= x0 || y1 <= y0) {
+        return false;
+    }
+    
+    bounds->offset.x = x0;
+    bounds->offset.y = y0;
+    bounds->extent.width = (uint32_t)(x1 - x0);
+    bounds->extent.height = (uint32_t)(y1 - y0);
+    return true;
+}
@@ -0,0 +1,89 @@
+#ifndef COMPOSITOR_VULKAN_LAYERS_H
+#define COMPOSITOR_VULKAN_LAYERS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "vulkan.h"
+#include "compositor_render_opt.h"
+#include "compositor_vulkan_alloc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 交换链格式未知时的层缓存图像格式（正常情况下使用交换链格式，采样后写回时不改变颜色编码）
+#define VULKAN_LAYER_CACHE_FORMAT VK_FORMAT_B8G8R8A8_SRGB
+
+struct vulkan_state;
+
+// 层内容记录函数（user_data为本次重建区域的VkRect2D，记录的绘制需裁剪到其中）
+typedef void (*vulkan_layer_record_func_t)(VkCommandBuffer command_buffer, void* user_data);
+
+// 单个层的离屏缓存
+struct vulkan_cached_layer {
+    VkImage image;
+    struct vulkan_allocation allocation;
+    VkImageView view;
+    VkFramebuffer framebuffer;
+    VkDescriptorSet descriptor_set;     // 合成时采样本层图像
+    bool enabled;                       // 本层渲染到离屏缓存
+    bool valid;                         // 内容有效，为false时下次更新整层重建
+    uint64_t rebuild_count;             // 重建次数（整层或局部）
+};
+
+// 离屏层缓存（每层一张屏幕大小的图像，只在本层有损伤时重建）
+struct vulkan_layer_cache {
+    VkRenderPass render_pass_clear;     // 整层重建
+    VkRenderPass render_pass_load;      // 只重建本层的损伤区域
+    VkSampler sampler;
+    VkDescriptorSetLayout set_layout;   // binding 0：层图像的组合图像采样器
+    VkDescriptorPool descriptor_pool;
+    VkPipelineLayout pipeline_layout;   // 合成管线须基于此布局创建
+    VkPipeline pipeline;                // 合成管线（未设置时缓存不生效，也不创建图像）
+    bool owns_pipeline;                 // 合成管线由层缓存创建，替换或销毁时释放
+    VkFormat format;                    // 层图像格式（交换链格式）
+    int width, height;
+    struct vulkan_cached_layer layers[RENDER_LAYER_COUNT];
+    bool initialized;
+};
+
+// 初始化层缓存（不创建图像，层已启用且设置了合成管线时再创建）
+int vulkan_layer_cache_init(struct vulkan_state* vk);
+
+// 销毁层缓存
+void vulkan_layer_cache_destroy(struct vulkan_state* vk);
+
+// 屏幕尺寸改变时重建已启用层的图像（所有层内容失效）
+int vulkan_layer_cache_resize(struct vulkan_state* vk, int width, int height);
+
+// 设置合成管线：按gl_VertexIndex生成4个顶点的全屏三角形带，在set 0 binding 0采样层图像；
+// 此时为已启用的层创建图像
+void vulkan_layer_cache_set_pipeline(struct vulkan_state* vk, VkPipeline pipeline);
+
+// 用着色器模块创建上述合成管线（经持久化管线缓存编译，由层缓存持有）并设置，之后保存管线缓存
+int vulkan_layer_cache_create_pipeline(struct vulkan_state* vk, VkShaderModule vertex_shader,
+                                       VkShaderModule fragment_shader);
+
+// 启用/禁用层的离屏缓存
+int vulkan_layer_cache_set_enabled(struct vulkan_state* vk, render_layer_type_t layer, bool enabled);
+
+// 检查层是否通过离屏缓存合成（已启用、图像已创建且合成管线已设置）
+bool vulkan_layer_cache_is_active(struct vulkan_state* vk, render_layer_type_t layer);
+
+// 使层的缓存内容失效（下次更新时整层重建）
+void vulkan_layer_cache_invalidate(struct vulkan_state* vk, render_layer_type_t layer);
+
+// 按本层的损伤重建缓存（须在渲染通道外调用），缓存有效且没有损伤时不记录任何命令
+int vulkan_layer_cache_update(struct vulkan_state* vk, VkCommandBuffer command_buffer, render_layer_type_t layer,
+                              const struct dirty_region* regions, uint32_t region_count,
+                              vulkan_layer_record_func_t record_func);
+
+// 在当前渲染通道中把层缓存作为全屏四边形合成，裁剪到clip
+void vulkan_layer_cache_draw(struct vulkan_state* vk, VkCommandBuffer command_buffer, render_layer_type_t layer,
+                             const VkRect2D* clip);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COMPOSITOR_VULKAN_LAYERS_H
@@ -0,0 +1,861 @@
+#include "compositor_vulkan_upload.h"
+#include "compositor_vulkan.h"
+#include "compositor_trace.h"
+#include <string.h>
+#include <android/log.h>
+
+#define LOG_TAG "VulkanUpload"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+
+// 上传的纹理都是4字节像素
+#define UPLOAD_BYTES_PER_PIXEL 4
+
+// 内部函数声明
+static void* upload_thread_main(void* arg);
+static void process_request(struct vulkan_state* vk, const struct vulkan_upload_request* request, VkFormat format);
+static int reserve_submit(struct vulkan_state* vk, VkDeviceSize size, VkDeviceSize* offset);
+static bool staging_fits(struct vulkan_uploader* up, VkDeviceSize size, VkDeviceSize* offset);
+static void reclaim_submits(struct vulkan_state* vk, bool wait_oldest);
+static int create_texture_image(struct vulkan_state* vk, VkFormat format, uint32_t width, uint32_t height,
+                                struct vulkan_texture_image* image);
+static void destroy_texture_image(struct vulkan_state* vk, struct vulkan_texture_image* image);
+static void record_upload(struct vulkan_state* vk, VkCommandBuffer command_buffer, VkDeviceSize offset,
+                          const struct vulkan_texture_image* image);
+static void retire_image_locked(struct vulkan_state* vk, const struct vulkan_texture_image* image, uint64_t value,
+                                uint64_t retire_frame);
+
+// 初始化上传器并启动上传线程（队列由设备创建时选定）
+int vulkan_upload_init(struct vulkan_state* vk) {
+    if (!vk || vk->device == VK_NULL_HANDLE) {
+        LOGE("Invalid parameters");
+        return -1;
+    }
+    
+    struct vulkan_uploader* up = &vk->uploader;
+    if (up->queue == VK_NULL_HANDLE) {
+        LOGE("No upload queue selected");
+        return -1;
+    }
+    
+    // 保留设备创建时选定的队列和时间线信号量支持
+    struct vulkan_uploader selected = *up;
+    memset(up, 0, sizeof(struct vulkan_uploader));
+    up->queue = selected.queue;
+    up->queue_family_index = selected.queue_family_index;
+    up->dedicated_queue = selected.dedicated_queue;
+    up->timeline_supported = selected.timeline_supported;
+    
+    if (up->timeline_supported) {
+        up->get_counter_value = (PFN_vkGetSemaphoreCounterValueKHR)vkGetDeviceProcAddr(
+            vk->device, "vkGetSemaphoreCounterValueKHR");
+        up->wait_semaphores = (PFN_vkWaitSemaphoresKHR)vkGetDeviceProcAddr(vk->device, "vkWaitSemaphoresKHR");
+        if (!up->get_counter_value || !up->wait_semaphores) {
+            LOGE("Timeline semaphore entry points not found");
+            up->timeline_supported = false;
+        }
+    }
+    
+    // 没有时间线信号量时不能跨队列交接，只能共用图形队列按提交顺序保证先后
+    if (!up->timeline_supported && up->dedicated_queue) {
+        up->queue = vk->queue;
+        up->queue_family_index = vk->queue_family_index;
+        up->dedicated_queue = false;
+    }
+    
+    if (up->timeline_supported) {
+        VkSemaphoreTypeCreateInfo type_info = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+            .pNext = NULL,
+            .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+            .initialValue = 0
+        };
+        VkSemaphoreCreateInfo semaphore_info = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+            .pNext = &type_info,
+            .flags = 0
+        };
+        
+        VkResult result = vkCreateSemaphore(vk->device, &semaphore_info, NULL, &up->timeline);
+        if (result != VK_SUCCESS) {
+            LOGE("Failed to create timeline semaphore: %d", result);
+            return -1;
+        }
+    }
+    
+    VkCommandPoolCreateInfo pool_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .pNext = NULL,
+        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+        .queueFamilyIndex = up->queue_family_index
+    };
+    
+    VkResult result = vkCreateCommandPool(vk->device, &pool_info, NULL, &up->command_pool);
+    if (result != VK_SUCCESS) {
+        LOGE("Failed to create upload command pool: %d", result);
+        vulkan_upload_destroy(vk);
+        return -1;
+    }
+    
+    VkCommandBuffer command_buffers[VULKAN_UPLOAD_MAX_SUBMITS];
+    VkCommandBufferAllocateInfo alloc_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .pNext = NULL,
+        .commandPool = up->command_pool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = VULKAN_UPLOAD_MAX_SUBMITS
+    };
+    
+    result = vkAllocateCommandBuffers(vk->device, &alloc_info, command_buffers);
+    if (result != VK_SUCCESS) {
+        LOGE("Failed to allocate upload command buffers: %d", result);
+        vulkan_upload_destroy(vk);
+        return -1;
+    }
+    
+    VkFenceCreateInfo fence_info = {
+        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0
+    };
+    
+    for (uint32_t i = 0; i < VULKAN_UPLOAD_MAX_SUBMITS; i++) {
+        up->submits[i].command_buffer = command_buffers[i];
+        result = vkCreateFence(vk->device, &fence_info, NULL, &up->submits[i].fence);
+        if (result != VK_SUCCESS) {
+            LOGE("Failed to create upload fence: %d", result);
+            vulkan_upload_destroy(vk);
+            return -1;
+        }
+    }
+    
+    // 暂存环常驻映射，上传线程直接写入
+    if (vulkan_alloc_create_buffer(&vk->allocator, VULKAN_UPLOAD_STAGING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                   &up->staging, &up->staging_allocation) != 0 ||
+        !up->staging_allocation.mapped) {
+        LOGE("Failed to create upload staging ring");
+        vulkan_upload_destroy(vk);
+        return -1;
+    }
+    up->staging_mapped = (uint8_t*)up->staging_allocation.mapped;
+    
+    pthread_mutex_init(&up->mutex, NULL);
+    pthread_cond_init(&up->cond, NULL);
+    
+    if (pthread_create(&up->thread, NULL, upload_thread_main, vk) != 0) {
+        LOGE("Failed to create upload thread");
+        pthread_mutex_destroy(&up->mutex);
+        pthread_cond_destroy(&up->cond);
+        vulkan_upload_destroy(vk);
+        return -1;
+    }
+    
+    up->initialized = true;
+    up->stats.dedicated_queue = up->dedicated_queue;
+    up->stats.timeline = up->timeline_supported;
+    LOGI("Texture uploader initialized (queue family %u, %s queue, %s)", up->queue_family_index,
+         up->dedicated_queue ? "dedicated" : "graphics", up->timeline_supported ? "timeline semaphore" : "queue order");
+    return 0;
+}
+
+// 停止上传线程并销毁上传器（未处理的请求只调用done）
+void vulkan_upload_destroy(struct vulkan_state* vk) {
+    if (!vk) {
+        return;
+    }
+    
+    struct vulkan_uploader* up = &vk->uploader;
+    
+    if (up->initialized) {
+        pthread_mutex_lock(&up->mutex);
+        up->should_exit = true;
+        pthread_cond_broadcast(&up->cond);
+        pthread_mutex_unlock(&up->mutex);
+        pthread_join(up->thread, NULL);
+        
+        // 排队的请求不再上传，但调用方仍等待释放源像素
+        while (up->request_count > 0) {
+            struct vulkan_upload_request* request = &up->requests[up->request_head];
+            if (request->done) {
+                request->done(request->user_data);
+            }
+            up->request_head = (up->request_head + 1) % VULKAN_UPLOAD_MAX_REQUESTS;
+            up->request_count--;
+        }
+        
+        pthread_mutex_destroy(&up->mutex);
+        pthread_cond_destroy(&up->cond);
+        up->initialized = false;
+    }
+    
+    // 上传线程已退出，等待所有队列上的上传和采样完成后回收
+    vulkan_device_wait_idle(vk);
+    
+    for (uint32_t i = 0; i < up->garbage_count; i++) {
+        destroy_texture_image(vk, &up->garbage[i].image);
+    }
+    up->garbage_count = 0;
+    
+    if (up->staging != VK_NULL_HANDLE) {
+        vulkan_alloc_destroy_buffer(&vk->allocator, up->staging, &up->staging_allocation);
+        up->staging = VK_NULL_HANDLE;
+        up->staging_mapped = NULL;
+    }
+    
+    for (uint32_t i = 0; i < VULKAN_UPLOAD_MAX_SUBMITS; i++) {
+        if (up->submits[i].fence != VK_NULL_HANDLE) {
+            vkDestroyFence(vk->device, up->submits[i].fence, NULL);
+            up->submits[i].fence = VK_NULL_HANDLE;
+        }
+    }
+    
+    if (up->command_pool != VK_NULL_HANDLE) {
+        vkDestroyCommandPool(vk->device, up->command_pool, NULL);
+        up->command_pool = VK_NULL_HANDLE;
+    }
+    
+    if (up->timeline != VK_NULL_HANDLE) {
+        vkDestroySemaphore(vk->device, up->timeline, NULL);
+        up->timeline = VK_NULL_HANDLE;
+    }
+}
+
+// 初始化纹理（不创建图像，第一次上传完成后才有内容）
+void vulkan_texture_init(struct vulkan_texture* texture, VkFormat format) {
+    if (!texture) {
+        return;
+    }
+    
+    memset(texture, 0, sizeof(struct vulkan_texture));
+    texture->format = format;
+}
+
+// 销毁纹理：取消排队的请求，图像在GPU不再引用后回收（渲染线程调用）
+void vulkan_texture_destroy(struct vulkan_state* vk, struct vulkan_texture* texture) {
+    if (!vk || !texture) {
+        return;
+    }
+    
+    struct vulkan_uploader* up = &vk->uploader;
+    if (!up->initialized) {
+        // 没有上传器时不会有内容
+        memset(texture, 0, sizeof(struct vulkan_texture));
+        return;
+    }
+    
+    pthread_mutex_lock(&up->mutex);
+    
+    // 排队的请求只调用done，正在处理的请求提交后把图像直接回收
+    for (uint32_t i = 0; i < up->request_count; i++) {
+        struct vulkan_upload_request* request = &up->requests[(up->request_head + i) % VULKAN_UPLOAD_MAX_REQUESTS];
+        if (request->texture == texture) {
+            request->texture = NULL;
+        }
+    }
+    if (up->active_texture == texture) {
+        up->active_texture = NULL;
+    }
+    
+    // 当前版本可能仍被在途帧采样，待交接的版本可能仍在上传
+    if (texture->current.image != VK_NULL_HANDLE) {
+        retire_image_locked(vk, &texture->current, 0, vk->current_frame);
+    }
+    if (texture->pending.image != VK_NULL_HANDLE) {
+        retire_image_locked(vk, &texture->pending, texture->pending_value, UINT64_MAX);
+    }
+    
+    pthread_mutex_unlock(&up->mutex);
+    memset(texture, 0, sizeof(struct vulkan_texture));
+}
+
+// 排队上传整张纹理，像素在上传线程中复制到暂存区后调用done（入队失败时立即调用）
+int vulkan_upload_texture(struct vulkan_state* vk, struct vulkan_texture* texture, const void* data,
+                          uint32_t width, uint32_t height, uint32_t stride,
+                          vulkan_upload_done_func_t done, void* user_data) {
+    if (!vk || !texture || !data || width == 0 || height == 0 || stride < width * UPLOAD_BYTES_PER_PIXEL) {
+        LOGE("Invalid parameters");
+        if (done) {
+            done(user_data);
+        }
+        return -1;
+    }
+    
+    struct vulkan_uploader* up = &vk->uploader;
+    if (!up->initialized) {
+        if (done) {
+            done(user_data);
+        }
+        return -1;
+    }
+    
+    VkDeviceSize size = (VkDeviceSize)width * height * UPLOAD_BYTES_PER_PIXEL;
+    
+    pthread_mutex_lock(&up->mutex);
+    
+    if (size > VULKAN_UPLOAD_STAGING_SIZE || up->request_count >= VULKAN_UPLOAD_MAX_REQUESTS) {
+        up->stats.rejected++;
+        pthread_mutex_unlock(&up->mutex);
+        LOGE("Upload rejected (%ux%u, %u queued)", width, height, up->request_count);
+        if (done) {
+            done(user_data);
+        }
+        return -1;
+    }
+    
+    struct vulkan_upload_request* request =
+        &up->requests[(up->request_head + up->request_count) % VULKAN_UPLOAD_MAX_REQUESTS];
+    request->texture = texture;
+    request->data = data;
+    request->width = width;
+    request->height = height;
+    request->stride = stride;
+    request->done = done;
+    request->user_data = user_data;
+    up->request_count++;
+    texture->queued++;
+    
+    pthread_cond_broadcast(&up->cond);
+    pthread_mutex_unlock(&up->mutex);
+    return 0;
+}
+
+// 新版本上传完成时交接给渲染线程，返回纹理当前是否有可采样的内容（渲染线程记录命令前调用）
+bool vulkan_texture_acquire(struct vulkan_state* vk, struct vulkan_texture* texture) {
+    if (!vk || !texture) {
+        return false;
+    }
+    
+    struct vulkan_uploader* up = &vk->uploader;
+    if (!up->initialized) {
+        return texture->current.image != VK_NULL_HANDLE;
+    }
+    
+    pthread_mutex_lock(&up->mutex);
+    
+    // 上传未完成时继续采样当前版本，不等待
+    if (texture->pending_value != 0 && up->completed_value >= texture->pending_value) {
+        // 旧版本可能仍被在途帧采样，等这些帧完成后回收
+        if (texture->current.image != VK_NULL_HANDLE) {
+            retire_image_locked(vk, &texture->current, 0, vk->current_frame);
+        }
+        
+        // 本帧提交等待该值，让上传队列的写入对图形队列可见（已完成，不会阻塞）
+        if (texture->pending_value > up->frame_wait_value) {
+            up->frame_wait_value = texture->pending_value;
+        }
+        
+        texture->current = texture->pending;
+        memset(&texture->pending, 0, sizeof(texture->pending));
+        texture->pending_value = 0;
+        texture->swap_count++;
+        up->stats.swapped++;
+    }
+    
+    bool ready = texture->current.image != VK_NULL_HANDLE;
+    pthread_mutex_unlock(&up->mutex);
+    return ready;
+}
+
+// 检查纹理是否还有尚未交接的上传
+bool vulkan_texture_has_pending(struct vulkan_state* vk, struct vulkan_texture* texture) {
+    if (!vk || !texture || !vk->uploader.initialized) {
+        return false;
+    }
+    
+    pthread_mutex_lock(&vk->uploader.mutex);
+    bool pending = texture->queued > 0 || texture->pending_value != 0;
+    pthread_mutex_unlock(&vk->uploader.mutex);
+    return pending;
+}
+
+// 帧开始时更新已完成的时间线值并回收不再引用的图像
+void vulkan_upload_begin_frame(struct vulkan_state* vk) {
+    if (!vk || !vk->uploader.initialized) {
+        return;
+    }
+    
+    struct vulkan_uploader* up = &vk->uploader;
+    
+    // 共用图形队列时，已提交的上传排在之后的帧之前，提交即可交接
+    uint64_t completed = 0;
+    if (up->timeline_supported) {
+        if (up->get_counter_value(vk->device, up->timeline, &completed) != VK_SUCCESS) {
+            return;
+        }
+    }
+    
+    pthread_mutex_lock(&up->mutex);
+    up->completed_value = up->timeline_supported ? completed : up->next_value;
+    
+    // 替换后又经过了一整圈在途帧、且写入它的上传已完成，GPU不再引用
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < up->garbage_count; i++) {
+        struct vulkan_upload_garbage* garbage = &up->garbage[i];
+        
+        if (garbage->retire_frame == UINT64_MAX) {
+            garbage->retire_frame = vk->current_frame;
+        }
+        
+        if (vk->current_frame >= garbage->retire_frame + vk->frames_in_flight &&
+            up->completed_value >= garbage->value) {
+            destroy_texture_image(vk, &garbage->image);
+        } else {
+            up->garbage[kept++] = *garbage;
+        }
+    }
+    
+    // 上传线程可能在等待回收列表的空位
+    if (kept != up->garbage_count) {
+        up->garbage_count = kept;
+        pthread_cond_broadcast(&up->cond);
+    }
+    
+    pthread_mutex_unlock(&up->mutex);
+}
+
+// 获取本帧提交需要等待的时间线信号量（没有需要等待的上传时返回false）
+bool vulkan_upload_get_frame_wait(struct vulkan_state* vk, VkSemaphore* semaphore, uint64_t* value) {
+    if (!vk || !semaphore || !value || !vk->uploader.timeline_supported) {
+        return false;
+    }
+    
+    struct vulkan_uploader* up = &vk->uploader;
+    if (up->frame_wait_value == 0) {
+        return false;
+    }
+    
+    *semaphore = up->timeline;
+    *value = up->frame_wait_value;
+    up->frame_wait_value = 0;
+    return true;
+}
+
+// 获取上传统计
+void vulkan_upload_get_stats(struct vulkan_state* vk, struct vulkan_upload_stats* stats) {
+    if (!vk || !stats) {
+        return;
+    }
+    
+    struct vulkan_uploader* up = &vk->uploader;
+    if (!up->initialized) {
+        memset(stats, 0, sizeof(struct vulkan_upload_stats));
+        return;
+    }
+    
+    pthread_mutex_lock(&up->mutex);
+    *stats = up->stats;
+    stats->queued = up->request_count;
+    pthread_mutex_unlock(&up->mutex);
+}
+
+// 上传线程：逐个取出请求，复制到暂存环后提交到上传队列
+static void* upload_thread_main(void* arg) {
+    struct vulkan_state* vk = (struct vulkan_state*)arg;
+    struct vulkan_uploader* up = &vk->uploader;
+    
+    trace_set_thread_name("texture-upload");
+    
+    pthread_mutex_lock(&up->mutex);
+    while (true) {
+        while (!up->should_exit && up->request_count == 0) {
+            pthread_cond_wait(&up->cond, &up->mutex);
+        }
+        
+        if (up->should_exit) {
+            break;
+        }
+        
+        struct vulkan_upload_request request = up->requests[up->request_head];
+        up->request_head = (up->request_head + 1) % VULKAN_UPLOAD_MAX_REQUESTS;
+        up->request_count--;
+        
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        if (request.texture) {
+            request.texture->queued--;
+            format = request.texture->format;
+        }
+        up->active_texture = request.texture;
+        pthread_mutex_unlock(&up->mutex);
+        
+        if (request.texture) {
+            TRACE_SCOPE("upload");
+            process_request(vk, &request, format);
+        } else if (request.done) {
+            request.done(request.user_data);
+        }
+        
+        pthread_mutex_lock(&up->mutex);
+        up->active_texture = NULL;
+    }
+    pthread_mutex_unlock(&up->mutex);
+    
+    return NULL;
+}
+
+// 处理一个上传请求（done恰好调用一次）
+static void process_request(struct vulkan_state* vk, const struct vulkan_upload_request* request, VkFormat format) {
+    struct vulkan_uploader* up = &vk->uploader;
+    VkDeviceSize row_size = (VkDeviceSize)request->width * UPLOAD_BYTES_PER_PIXEL;
+    VkDeviceSize size = row_size * request->height;
+    
+    VkDeviceSize offset = 0;
+    if (reserve_submit(vk, size, &offset) != 0) {
+        if (request->done) {
+            request->done(request->user_data);
+        }
+        return;
+    }
+    
+    // 逐行紧密排列到暂存环（暂存内存主机一致，不需要刷新）
+    const uint8_t* src = (const uint8_t*)request->data;
+    uint8_t* dst = up->staging_mapped + offset;
+    if (request->stride == row_size) {
+        memcpy(dst, src, (size_t)size);
+    } else {
+        for (uint32_t y = 0; y < request->height; y++) {
+            memcpy(dst + y * row_size, src + (size_t)y * request->stride, (size_t)row_size);
+        }
+    }
+    
+    // 源像素已不再需要，调用方可以立即释放客户端缓冲区
+    if (request->done) {
+        request->done(request->user_data);
+    }
+    
+    // 每次上传写入新图像，渲染线程在交接前一直采样旧图像
+    struct vulkan_texture_image image;
+    if (create_texture_image(vk, format, request->width, request->height, &image) != 0) {
+        return;
+    }
+    
+    struct vulkan_upload_submit* submit =
+        &up->submits[(up->submit_head + up->submit_count) % VULKAN_UPLOAD_MAX_SUBMITS];
+    record_upload(vk, submit->command_buffer, offset, &image);
+    
+    uint64_t value = up->next_value + 1;
+    VkTimelineSemaphoreSubmitInfo timeline_info = {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .pNext = NULL,
+        .waitSemaphoreValueCount = 0,
+        .pWaitSemaphoreValues = NULL,
+        .signalSemaphoreValueCount = 1,
+        .pSignalSemaphoreValues = &value
+    };
+    VkSubmitInfo submit_info = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = up->timeline_supported ? &timeline_info : NULL,
+        .waitSemaphoreCount = 0,
+        .pWaitSemaphores = NULL,
+        .pWaitDstStageMask = NULL,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &submit->command_buffer,
+        .signalSemaphoreCount = up->timeline_supported ? 1 : 0,
+        .pSignalSemaphores = up->timeline_supported ? &up->timeline : NULL
+    };
+    
+    // 与渲染线程的提交和呈现互斥；独立队列也要加锁，vkDeviceWaitIdle要求设备上所有队列都外部同步
+    pthread_mutex_lock(&vk->queue_mutex);
+    VkResult result = vkQueueSubmit(up->queue, 1, &submit_info, submit->fence);
+    pthread_mutex_unlock(&vk->queue_mutex);
+    
+    if (result != VK_SUCCESS) {
+        LOGE("Failed to submit texture upload: %d", result);
+        destroy_texture_image(vk, &image);
+        return;
+    }
+    
+    submit->value = value;
+    submit->staging_begin = offset;
+    submit->staging_end = offset + size;
+    up->staging_head = submit->staging_end;
+    up->submit_count++;
+    
+    pthread_mutex_lock(&up->mutex);
+    up->next_value = value;
+    up->stats.submitted++;
+    up->stats.bytes += size;
+    
+    // 回收列表满时等渲染线程回收（上传线程可以阻塞，渲染线程不行）
+    while (up->garbage_count >= VULKAN_UPLOAD_MAX_GARBAGE && !up->should_exit) {
+        pthread_cond_wait(&up->cond, &up->mutex);
+    }
+    
+    struct vulkan_texture* texture = up->active_texture;
+    if (texture == request->texture) {
+        // 尚未交接的旧版本被更新的内容取代，渲染线程从未采样过它
+        if (texture->pending.image != VK_NULL_HANDLE) {
+            retire_image_locked(vk, &texture->pending, texture->pending_value, UINT64_MAX);
+            up->stats.superseded++;
+        }
+        texture->pending = image;
+        texture->pending_value = value;
+    } else {
+        // 纹理在上传期间被销毁
+        retire_image_locked(vk, &image, value, UINT64_MAX);
+    }
+    pthread_mutex_unlock(&up->mutex);
+}
+
+// 为一次上传预留提交槽和暂存区，不足时等待最早的上传完成
+static int reserve_submit(struct vulkan_state* vk, VkDeviceSize size, VkDeviceSize* offset) {
+    struct vulkan_uploader* up = &vk->uploader;
+    
+    reclaim_submits(vk, false);
+    
+    while (up->submit_count >= VULKAN_UPLOAD_MAX_SUBMITS || !staging_fits(up, size, offset)) {
+        if (up->submit_count == 0) {
+            LOGE("Upload of %llu bytes does not fit the staging ring", (unsigned long long)size);
+            return -1;
+        }
+        
+        pthread_mutex_lock(&up->mutex);
+        up->stats.staging_waits++;
+        pthread_mutex_unlock(&up->mutex);
+        
+        reclaim_submits(vk, true);
+    }
+    
+    return 0;
+}
+
+// 在暂存环中查找连续空间（在途提交按顺序占用[tail, head)，可能绕回开头）
+static bool staging_fits(struct vulkan_uploader* up, VkDeviceSize size, VkDeviceSize* offset) {
+    if (up->submit_count == 0) {
+        up->staging_head = 0;
+    }
+    
+    VkDeviceSize head = (up->staging_head + VULKAN_UPLOAD_STAGING_ALIGNMENT - 1) &
+                        ~((VkDeviceSize)VULKAN_UPLOAD_STAGING_ALIGNMENT - 1);
+    
+    if (up->submit_count == 0) {
+        *offset = 0;
+        return size <= VULKAN_UPLOAD_STAGING_SIZE;
+    }
+    
+    VkDeviceSize tail = up->submits[up->submit_head].staging_begin;
+    if (tail < up->staging_head) {
+        // 没有绕回：先用末尾，不够再从开头用到tail
+        if (head + size <= VULKAN_UPLOAD_STAGING_SIZE) {
+            *offset = head;
+            return true;
+        }
+        if (size <= tail) {
+            *offset = 0;
+            return true;
+        }
+        return false;
+    }
+    
+    // 已绕回：只能用到tail
+    if (head + size <= tail) {
+        *offset = head;
+        return true;
+    }
+    return false;
+}
+
+// 回收已完成的上传提交（wait_oldest为true时至少等待最早的一个完成）
+static void reclaim_submits(struct vulkan_state* vk, bool wait_oldest) {
+    struct vulkan_uploader* up = &vk->uploader;
+    
+    while (up->submit_count > 0) {
+        struct vulkan_upload_submit* submit = &up->submits[up->submit_head];
+        
+        if (wait_oldest) {
+            vkWaitForFences(vk->device, 1, &submit->fence, VK_TRUE, UINT64_MAX);
+            wait_oldest = false;
+        } else if (vkGetFenceStatus(vk->device, submit->fence) != VK_SUCCESS) {
+            break;
+        }
+        
+        vkResetFences(vk->device, 1, &submit->fence);
+        submit->value = 0;
+        up->submit_head = (up->submit_head + 1) % VULKAN_UPLOAD_MAX_SUBMITS;
+        up->submit_count--;
+    }
+}
+
+// 创建纹理图像（独立队列族时两个队列族并发访问，省去所有权转移）
+static int create_texture_image(struct vulkan_state* vk, VkFormat format, uint32_t width, uint32_t height,
+                                struct vulkan_texture_image* image) {
+    struct vulkan_uploader* up = &vk->uploader;
+    uint32_t queue_families[2] = {vk->queue_family_index, up->queue_family_index};
+    bool concurrent = up->queue_family_index != vk->queue_family_index;
+    
+    memset(image, 0, sizeof(struct vulkan_texture_image));
+    image->width = width;
+    image->height = height;
+    
+    // 可作为复制源，供全屏窗口直接呈现
+    VkImageCreateInfo image_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = format,
+        .extent = {width, height, 1},
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        .sharingMode = concurrent ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = concurrent ? 2 : 0,
+        .pQueueFamilyIndices = concurrent ? queue_families : NULL,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED
+    };
+    
+    if (vulkan_alloc_create_image(&vk->allocator, &image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                  &image->image, &image->allocation) != 0) {
+        LOGE("Failed to create %ux%u texture image", width, height);
+        return -1;
+    }
+    
+    VkImageViewCreateInfo view_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .image = image->image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = format,
+        .components = {
+            .r = VK_COMPONENT_SWIZZLE_IDENTITY,
+            .g = VK_COMPONENT_SWIZZLE_IDENTITY,
+            .b = VK_COMPONENT_SWIZZLE_IDENTITY,
+            .a = VK_COMPONENT_SWIZZLE_IDENTITY
+        },
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        }
+    };
+    
+    VkResult result = vkCreateImageView(vk->device, &view_info, NULL, &image->view);
+    if (result != VK_SUCCESS) {
+        LOGE("Failed to create texture image view: %d", result);
+        destroy_texture_image(vk, image);
+        return -1;
+    }
+    
+    return 0;
+}
+
+// 销毁纹理图像
+static void destroy_texture_image(struct vulkan_state* vk, struct vulkan_texture_image* image) {
+    if (image->view != VK_NULL_HANDLE) {
+        vkDestroyImageView(vk->device, image->view, NULL);
+    }
+    if (image->image != VK_NULL_HANDLE) {
+        vulkan_alloc_destroy_image(&vk->allocator, image->image, &image->allocation);
+    }
+    memset(image, 0, sizeof(struct vulkan_texture_image));
+}
+
+// 记录从暂存环复制到图像的命令，结束时图像处于着色器只读布局
+static void record_upload(struct vulkan_state* vk, VkCommandBuffer command_buffer, VkDeviceSize offset,
+                          const struct vulkan_texture_image* image) {
+    struct vulkan_uploader* up = &vk->uploader;
+    
+    VkCommandBufferBeginInfo begin_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = NULL,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = NULL
+    };
+    vkBeginCommandBuffer(command_buffer, &begin_info);
+    
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .pNext = NULL,
+        .srcAccessMask = 0,
+        .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image->image,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        }
+    };
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, NULL, 0, NULL, 1, &barrier);
+    
+    VkBufferImageCopy region = {
+        .bufferOffset = offset,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel = 0,
+            .baseArrayLayer = 0,
+            .layerCount = 1
+        },
+        .imageOffset = {0, 0, 0},
+        .imageExtent = {image->width, image->height, 1}
+    };
+    vkCmdCopyBufferToImage(command_buffer, up->staging, image->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           1, &region);
+    
+    // 独立队列上的可见性由图形队列等待时间线信号量保证；
+    // 共用图形队列时由这里的屏障覆盖之后提交的采样和复制
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    VkPipelineStageFlags dst_stage;
+    if (up->dedicated_queue) {
+        barrier.dstAccessMask = 0;
+        dst_stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+    } else {
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+        dst_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+    }
+    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dst_stage,
+                         0, 0, NULL, 0, NULL, 1, &barrier);
+    
+    vkEndCommandBuffer(command_buffer);
+}
+
+// 把图像加入回收列表（调用方持有上传器的锁）
+static void retire_image_locked(struct vulkan_state* vk, const struct vulkan_texture_image* image, uint64_t value,
+                                uint64_t retire_frame) {
+    struct vulkan_uploader* up = &vk->uploader;
+    
+    // 回收列表已满（只会发生在渲染线程）：等待图形队列和上传完成后直接释放
+    if (up->garbage_count >= VULKAN_UPLOAD_MAX_GARBAGE) {
+        LOGD("Upload garbage list full, waiting for the GPU");
+        pthread_mutex_lock(&vk->queue_mutex);
+        vkQueueWaitIdle(vk->queue);
+        pthread_mutex_unlock(&vk->queue_mutex);
+        
+        if (up->timeline_supported && value != 0) {
+            VkSemaphoreWaitInfo wait_info = {
+                .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+                .pNext = NULL,
+                .flags = 0,
+                .semaphoreCount = 1,
+                .pSemaphores = &up->timeline,
+                .pValues = &value
+            };
+            up->wait_semaphores(vk->device, &wait_info, UINT64_MAX);
+        }
+        
+        struct vulkan_texture_image dead = *image;
+        destroy_texture_image(vk, &dead);
+        return;
+    }
+    
+    struct vulkan_upload_garbage* garbage = &up->garbage[up->garbage_count++];
+    garbage->image = *image;
+    garbage->value = value;
+    garbage->retire_frame = retire_frame;
+}
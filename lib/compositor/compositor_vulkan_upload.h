@@ -0,0 +1,164 @@
+#ifndef COMPOSITOR_VULKAN_UPLOAD_H
+#define COMPOSITOR_VULKAN_UPLOAD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "vulkan.h"
+#include "compositor_vulkan_alloc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 暂存环大小（单次上传不能超过）
+#define VULKAN_UPLOAD_STAGING_SIZE (32ULL * 1024 * 1024)
+// 暂存区内每次上传的起始对齐
+#define VULKAN_UPLOAD_STAGING_ALIGNMENT 256
+// 排队等待上传线程处理的请求上限
+#define VULKAN_UPLOAD_MAX_REQUESTS 32
+// 同时在途的上传提交数（每个占用一个命令缓冲区）
+#define VULKAN_UPLOAD_MAX_SUBMITS 4
+// 等待回收的纹理图像上限
+#define VULKAN_UPLOAD_MAX_GARBAGE 32
+
+struct vulkan_state;
+
+// 源像素已复制到暂存区（之后调用方可以释放或复用源缓冲区），在上传线程中调用
+typedef void (*vulkan_upload_done_func_t)(void* user_data);
+
+// 纹理的一个版本
+struct vulkan_texture_image {
+    VkImage image;
+    VkImageView view;
+    struct vulkan_allocation allocation;
+    uint32_t width, height;
+};
+
+// 后台更新的纹理（新内容上传完成前渲染线程继续采样当前版本）
+struct vulkan_texture {
+    struct vulkan_texture_image current;   // 渲染线程采样的版本（image为VK_NULL_HANDLE表示还没有内容）
+    struct vulkan_texture_image pending;   // 已提交上传、尚未交接的版本
+    uint64_t pending_value;                // pending上传完成时的时间线值（0表示没有）
+    VkFormat format;                       // 4字节像素格式
+    uint32_t queued;                       // 排队中尚未提交的请求数
+    uint64_t swap_count;                   // 交接到渲染线程的版本数
+};
+
+// 上传请求
+struct vulkan_upload_request {
+    struct vulkan_texture* texture;        // 纹理已销毁时为NULL，只调用done
+    const void* data;
+    uint32_t width, height;
+    uint32_t stride;                       // 每行字节数
+    vulkan_upload_done_func_t done;
+    void* user_data;
+};
+
+// 在途的上传提交
+struct vulkan_upload_submit {
+    VkCommandBuffer command_buffer;
+    VkFence fence;                         // 上传线程据此回收暂存区和命令缓冲区
+    uint64_t value;                        // 提交的时间线值（0表示空闲）
+    VkDeviceSize staging_begin;            // 占用的暂存区范围
+    VkDeviceSize staging_end;
+};
+
+// 已替换、等待GPU不再引用的纹理图像
+struct vulkan_upload_garbage {
+    struct vulkan_texture_image image;
+    uint64_t value;                        // 写入该图像的上传的时间线值
+    uint64_t retire_frame;                 // 替换时的帧号（UINT64_MAX表示渲染线程尚未记录）
+};
+
+// 上传统计
+struct vulkan_upload_stats {
+    uint64_t submitted;                    // 提交的上传数
+    uint64_t swapped;                      // 交接到渲染线程的版本数
+    uint64_t superseded;                   // 交接前被更新的上传取代的版本数
+    uint64_t rejected;                     // 队列满或尺寸超限而丢弃的请求数
+    uint64_t bytes;                        // 上传的像素字节数
+    uint64_t staging_waits;                // 因暂存区或提交槽不足而等待GPU的次数
+    uint32_t queued;                       // 当前排队的请求数
+    bool dedicated_queue;                  // 使用独立的传输队列
+    bool timeline;                         // 使用时间线信号量交接
+};
+
+// 纹理上传器（独立线程把像素写入暂存环并在传输队列上复制到图像）
+struct vulkan_uploader {
+    // 设备创建时选定
+    VkQueue queue;                         // 上传队列（提交须持有queue_mutex）
+    uint32_t queue_family_index;
+    bool dedicated_queue;                  // 独立队列（不同队列族或同族的第二个队列）
+    bool timeline_supported;               // 已启用VK_KHR_timeline_semaphore
+    PFN_vkGetSemaphoreCounterValueKHR get_counter_value;
+    PFN_vkWaitSemaphoresKHR wait_semaphores;
+    
+    VkSemaphore timeline;                  // 每次上传完成时信号为其时间线值
+    VkCommandPool command_pool;            // 只由上传线程使用
+    struct vulkan_upload_submit submits[VULKAN_UPLOAD_MAX_SUBMITS];
+    uint32_t submit_head;                  // 最早的在途提交
+    uint32_t submit_count;
+    
+    VkBuffer staging;
+    struct vulkan_allocation staging_allocation;
+    uint8_t* staging_mapped;
+    VkDeviceSize staging_head;             // 下一次写入位置
+    
+    struct vulkan_upload_request requests[VULKAN_UPLOAD_MAX_REQUESTS];
+    uint32_t request_head;
+    uint32_t request_count;
+    struct vulkan_texture* active_texture; // 上传线程正在处理的纹理（销毁时置NULL）
+    
+    struct vulkan_upload_garbage garbage[VULKAN_UPLOAD_MAX_GARBAGE];
+    uint32_t garbage_count;
+    
+    uint64_t next_value;                   // 上一次提交的时间线值
+    uint64_t completed_value;              // 渲染线程观察到的已完成值
+    uint64_t frame_wait_value;             // 本帧提交需要等待的时间线值（0表示不等待）
+    
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool should_exit;
+    bool initialized;
+    struct vulkan_upload_stats stats;
+};
+
+// 初始化上传器并启动上传线程（队列由设备创建时选定）
+int vulkan_upload_init(struct vulkan_state* vk);
+
+// 停止上传线程并销毁上传器（未处理的请求只调用done）
+void vulkan_upload_destroy(struct vulkan_state* vk);
+
+// 初始化纹理（不创建图像，第一次上传完成后才有内容）
+void vulkan_texture_init(struct vulkan_texture* texture, VkFormat format);
+
+// 销毁纹理：取消排队的请求，图像在GPU不再引用后回收（渲染线程调用）
+void vulkan_texture_destroy(struct vulkan_state* vk, struct vulkan_texture* texture);
+
+// 排队上传整张纹理，像素在上传线程中复制到暂存区后调用done（入队失败时立即调用）
+int vulkan_upload_texture(struct vulkan_state* vk, struct vulkan_texture* texture, const void* data,
+                          uint32_t width, uint32_t height, uint32_t stride,
+                          vulkan_upload_done_func_t done, void* user_data);
+
+// 新版本上传完成时交接给渲染线程，返回纹理当前是否有可采样的内容（渲染线程记录命令前调用）
+bool vulkan_texture_acquire(struct vulkan_state* vk, struct vulkan_texture* texture);
+
+// 检查纹理是否还有尚未交接的上传
+bool vulkan_texture_has_pending(struct vulkan_state* vk, struct vulkan_texture* texture);
+
+// 帧开始时更新已完成的时间线值并回收不再引用的图像
+void vulkan_upload_begin_frame(struct vulkan_state* vk);
+
+// 获取本帧提交需要等待的时间线信号量（没有需要等待的上传时返回false）
+bool vulkan_upload_get_frame_wait(struct vulkan_state* vk, VkSemaphore* semaphore, uint64_t* value);
+
+// 获取上传统计
+void vulkan_upload_get_stats(struct vulkan_state* vk, struct vulkan_upload_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COMPOSITOR_VULKAN_UPLOAD_H
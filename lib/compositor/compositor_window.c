@@ -1,4 +1,5 @@
 #include "compositor_window.h"
+#include "compositor.h"
 #include <stdlib.h>
 #include <string.h>
 #include <android/log.h>
@@ -117,6 +118,9 @@ void window_destroy(struct window* window) {
     // 从列表中移除
     window_remove_from_list(window);
     
+    // 释放合成器为窗口上传的纹理，之后的帧不会再访问该窗口
+    compositor_release_window_texture(window);
+    
     LOGI("Destroyed window %d", window->id);
     free(window);
 }
@@ -263,6 +267,22 @@ int window_set_state(struct window* window, window_state_t state) {
     return 0;
 }
 
+// 附加客户端缓冲区（buffer为NULL时分离）
+int window_attach_buffer(struct window* window, const struct window_buffer* buffer) {
+    if (!window) {
+        LOGE("Invalid window");
+        return -1;
+    }
+    
+    if (buffer) {
+        window->buffer = *buffer;
+    } else {
+        memset(&window->buffer, 0, sizeof(window->buffer));
+    }
+    
+    return 0;
+}
+
 // 设置窗口焦点
 void window_set_focus(struct window* window) {
     if (!window || !window->attrs.focusable) {
@@ -359,6 +379,30 @@ struct window* window_find_at_point(int x, int y) {
     return NULL;
 }
 
+// 获取所有可见窗口（按从底到顶的绘制顺序），返回窗口数量
+uint32_t window_get_visible_windows(struct window** windows, uint32_t max_windows) {
+    if (!windows || max_windows == 0 || !g_wm.windows) {
+        return 0;
+    }
+    
+    // 链表从顶层开始，先找到底层窗口再反向遍历
+    struct window* window = g_wm.windows;
+    while (window->next) {
+        window = window->next;
+    }
+    
+    uint32_t count = 0;
+    while (window && count < max_windows) {
+        if (window->attrs.state != WINDOW_STATE_HIDDEN && 
+            window->attrs.state != WINDOW_STATE_MINIMIZED) {
+            windows[count++] = window;
+        }
+        window = window->prev;
+    }
+    
+    return count;
+}
+
 // 处理窗口移动
 int window_handle_move(struct window* window, int dx, int dy) {
     if (!window || !window->attrs.movable) {
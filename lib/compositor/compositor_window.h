@@ -40,6 +40,15 @@ struct window_attributes {
     uint32_t max_height;   // 最大高度
 };
 
+// 客户端缓冲区（导入为GPU图像后由合成器采样或直接复制）
+struct window_buffer {
+    uint64_t image;        // 导入后的VkImage句柄（0表示没有缓冲区），平时处于着色器只读布局
+    uint32_t format;       // VkFormat
+    uint32_t width;        // 缓冲区宽度
+    uint32_t height;       // 缓冲区高度
+    bool opaque;           // 不含需要混合的透明像素
+};
+
 // 窗口结构
 struct window {
     uint32_t id;                           // 窗口ID
@@ -47,6 +56,7 @@ struct window {
     bool has_focus;                        // 是否有焦点
     uint32_t z_order;                      // Z轴顺序
     void* user_data;                       // 用户数据
+    struct window_buffer buffer;           // 当前提交的客户端缓冲区
     struct window* parent;                 // 父窗口
     struct window* next;                    // 下一个窗口（链表）
     struct window* prev;                    // 上一个窗口（链表）
@@ -88,6 +98,9 @@ int window_set_size(struct window* window, int width, int height);
 // 设置窗口状态
 int window_set_state(struct window* window, window_state_t state);
 
+// 附加客户端缓冲区（buffer为NULL时分离）
+int window_attach_buffer(struct window* window, const struct window_buffer* buffer);
+
 // 设置窗口焦点
 void window_set_focus(struct window* window);
 
@@ -103,6 +116,9 @@ void window_lower_to_bottom(struct window* window);
 // 查找指定点下的窗口
 struct window* window_find_at_point(int x, int y);
 
+// 获取所有可见窗口（按从底到顶的绘制顺序），返回窗口数量
+uint32_t window_get_visible_windows(struct window** windows, uint32_t max_windows);
+
 // 处理窗口移动
 int window_handle_move(struct window* window, int dx, int dy);
 
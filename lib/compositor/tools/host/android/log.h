@@ -0,0 +1,28 @@
+#ifndef TOOLS_HOST_ANDROID_LOG_H
+#define TOOLS_HOST_ANDROID_LOG_H
+
+// 主机构建工具时替代NDK的android/log.h，日志输出到stderr
+
+#include <stdarg.h>
+#include <stdio.h>
+
+enum {
+    ANDROID_LOG_DEBUG = 3,
+    ANDROID_LOG_INFO = 4,
+    ANDROID_LOG_WARN = 5,
+    ANDROID_LOG_ERROR = 6
+};
+
+static inline int __android_log_print(int prio, const char* tag, const char* fmt, ...) {
+    va_list args;
+    
+    (void)prio;
+    fprintf(stderr, "%s: ", tag);
+    va_start(args, fmt);
+    int result = vfprintf(stderr, fmt, args);
+    va_end(args);
+    fputc('\n', stderr);
+    return result;
+}
+
+#endif // TOOLS_HOST_ANDROID_LOG_H
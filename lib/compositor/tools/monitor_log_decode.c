@@ -0,0 +1,169 @@
+// 监控二进制日志解码工具（在主机上运行）
+// 构建：cc -std=c99 -O2 -I.. -o monitor_log_decode monitor_log_decode.c
+// 用法：monitor_log_decode <log.bin> [csv|json] [output]
+
+#include "compositor_monitor_log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 解码后的数据点
+struct decoded_point {
+    uint64_t time_us;                      // 绝对时间（CLOCK_MONOTONIC微秒）
+    uint32_t type;
+    float value;
+};
+
+// 内部函数声明
+static int read_log(const char* path, struct monitor_log_header* header, struct decoded_point** points, size_t* count);
+static void write_csv(FILE* file, const struct monitor_log_header* header, const struct decoded_point* points, size_t count);
+static void write_json(FILE* file, const struct monitor_log_header* header, const struct decoded_point* points, size_t count);
+static const char* type_name(const struct monitor_log_header* header, uint32_t type, char* buffer, size_t size);
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <log.bin> [csv|json] [output]\n", argv[0]);
+        return 1;
+    }
+    
+    const char* format = argc > 2 ? argv[2] : "csv";
+    if (strcmp(format, "csv") != 0 && strcmp(format, "json") != 0) {
+        fprintf(stderr, "Unknown format: %s\n", format);
+        return 1;
+    }
+    
+    struct monitor_log_header header;
+    struct decoded_point* points = NULL;
+    size_t count = 0;
+    if (read_log(argv[1], &header, &points, &count) != 0) {
+        return 1;
+    }
+    
+    FILE* file = stdout;
+    if (argc > 3) {
+        file = fopen(argv[3], "w");
+        if (!file) {
+            fprintf(stderr, "Failed to open %s for writing\n", argv[3]);
+            free(points);
+            return 1;
+        }
+    }
+    
+    if (strcmp(format, "csv") == 0) {
+        write_csv(file, &header, points, count);
+    } else {
+        write_json(file, &header, points, count);
+    }
+    
+    if (file != stdout) {
+        fclose(file);
+    }
+    
+    fprintf(stderr, "Decoded %zu data points\n", count);
+    free(points);
+    return 0;
+}
+
+// 读取并解码日志文件（记录数以文件头为准，未正常关闭的文件只解码已刷新的部分）
+static int read_log(const char* path, struct monitor_log_header* header, struct decoded_point** points, size_t* count) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return -1;
+    }
+    
+    if (fread(header, sizeof(*header), 1, file) != 1 ||
+        header->magic != MONITOR_LOG_MAGIC ||
+        header->version != MONITOR_LOG_VERSION ||
+        header->header_size != sizeof(struct monitor_log_header) ||
+        header->record_size != sizeof(struct monitor_log_record) ||
+        header->type_count > MONITOR_LOG_MAX_TYPES) {
+        fprintf(stderr, "%s is not a supported monitor log\n", path);
+        fclose(file);
+        return -1;
+    }
+    
+    *points = malloc((header->record_count ? header->record_count : 1) * sizeof(struct decoded_point));
+    if (!*points) {
+        fprintf(stderr, "Out of memory\n");
+        fclose(file);
+        return -1;
+    }
+    
+    uint64_t time_us = 0;
+    *count = 0;
+    for (uint64_t i = 0; i < header->record_count; i++) {
+        struct monitor_log_record record;
+        if (fread(&record, sizeof(record), 1, file) != 1) {
+            fprintf(stderr, "Log truncated after %llu records\n", (unsigned long long)i);
+            break;
+        }
+        
+        if (record.type == MONITOR_LOG_TYPE_SYNC) {
+            time_us = ((uint64_t)record.data.time_high_us << 32) | record.delta_us;
+            continue;
+        }
+        
+        time_us += record.delta_us;
+        struct decoded_point* point = &(*points)[(*count)++];
+        point->time_us = time_us;
+        point->type = record.type;
+        point->value = record.data.value;
+    }
+    
+    fclose(file);
+    return 0;
+}
+
+// 输出CSV：每个数据点一行
+static void write_csv(FILE* file, const struct monitor_log_header* header, const struct decoded_point* points, size_t count) {
+    char name[MONITOR_LOG_NAME_SIZE + 16];
+    
+    fprintf(file, "Timestamp,Type,Value,Unit\n");
+    for (size_t i = 0; i < count; i++) {
+        const struct decoded_point* point = &points[i];
+        const char* unit = point->type < header->type_count ? header->types[point->type].unit : "";
+        
+        fprintf(file, "%.6f,%s,%.6f,%.*s\n", point->time_us / 1000000.0,
+                type_name(header, point->type, name, sizeof(name)), point->value,
+                MONITOR_LOG_UNIT_SIZE, unit);
+    }
+}
+
+// 输出JSON：与monitor_export_all_to_json相同，按类型分组
+static void write_json(FILE* file, const struct monitor_log_header* header, const struct decoded_point* points, size_t count) {
+    fprintf(file, "{\n");
+    fprintf(file, "  \"start_wall_time\": %llu,\n", (unsigned long long)header->start_wall_time);
+    fprintf(file, "  \"start_time\": %llu", (unsigned long long)header->start_time_ns);
+    
+    for (uint32_t type = 0; type < header->type_count; type++) {
+        fprintf(file, ",\n  \"%.*s\": {\n", MONITOR_LOG_NAME_SIZE, header->types[type].name);
+        fprintf(file, "    \"unit\": \"%.*s\",\n", MONITOR_LOG_UNIT_SIZE, header->types[type].unit);
+        fprintf(file, "    \"data\": [");
+        
+        bool first = true;
+        for (size_t i = 0; i < count; i++) {
+            if (points[i].type != type) {
+                continue;
+            }
+            
+            fprintf(file, "%s\n      {\"timestamp\": %llu, \"value\": %.6f}", first ? "" : ",",
+                    (unsigned long long)points[i].time_us * 1000ULL, points[i].value);
+            first = false;
+        }
+        
+        fprintf(file, "\n    ]\n  }");
+    }
+    
+    fprintf(file, "\n}\n");
+}
+
+// 获取类型名称（名称不一定以空字符结尾，超出文件头中的类型时使用编号）
+static const char* type_name(const struct monitor_log_header* header, uint32_t type, char* buffer, size_t size) {
+    if (type < header->type_count) {
+        snprintf(buffer, size, "%.*s", MONITOR_LOG_NAME_SIZE, header->types[type].name);
+    } else {
+        snprintf(buffer, size, "type_%u", type);
+    }
+    return buffer;
+}
@@ -0,0 +1,193 @@
+// 自适应帧率/质量控制器回放工具（在主机上运行）
+// 构建：cc -std=c99 -O2 -I.. -o perf_ctrl_replay perf_ctrl_replay.c ../compositor_perf_ctrl.c -lm
+// 用法：perf_ctrl_replay <trace> [recorded_quality] [level_cost_ratio] [-v]
+// trace为每行一个帧耗时（毫秒），或monitor_log_decode输出的CSV（使用RenderTime行）；
+// 回放时其他质量等级的耗时按level_cost_ratio的幂由记录时的等级推算。
+// 记录中的"# expect changes <min> <max>"和"# expect over_rate <max_percent>"行声明预期结果，
+// 有预期时逐项检查，全部满足时返回0（traces/目录下为带预期的合成记录）
+
+#include "compositor_perf_ctrl.h"
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// 记录中声明的预期结果
+struct expectation {
+    bool has_changes;
+    uint64_t min_changes;
+    uint64_t max_changes;
+    bool has_over_rate;
+    double max_over_rate;          // 超出帧间隔的帧所占百分比上限
+};
+
+// 内部函数声明
+static float* read_trace(const char* path, size_t* count, struct expectation* expect);
+static bool parse_line(const char* line, float* value_ms);
+static void parse_expectation(const char* line, struct expectation* expect);
+static int check(bool condition, const char* format, ...);
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <trace> [recorded_quality] [level_cost_ratio] [-v]\n", argv[0]);
+        return 1;
+    }
+    
+    bool verbose = strcmp(argv[argc - 1], "-v") == 0;
+    int args = verbose ? argc - 1 : argc;
+    uint32_t recorded_quality = args > 2 ? (uint32_t)atoi(argv[2]) : 2;
+    float ratio = args > 3 ? (float)atof(argv[3]) : 1.3f;
+    
+    size_t count = 0;
+    struct expectation expect = {0};
+    float* trace = read_trace(argv[1], &count, &expect);
+    if (!trace) {
+        return 1;
+    }
+    
+    struct perf_ctrl_config config;
+    struct perf_ctrl ctrl;
+    perf_ctrl_default_config(&config);
+    uint32_t fps = config.max_fps;
+    uint32_t quality = config.quality_levels - 1;
+    perf_ctrl_init(&ctrl, &config, fps, quality);
+    
+    // 统计：超出帧间隔的帧数和平均帧率（各质量等级的帧数由控制器统计）
+    uint64_t over_interval = 0;
+    double fps_sum = 0.0;
+    
+    for (size_t i = 0; i < count; i++) {
+        float cost_us = trace[i] * 1000.0f * powf(ratio, (float)quality - (float)recorded_quality);
+        
+        if (cost_us > 1000000.0f / fps) {
+            over_interval++;
+        }
+        fps_sum += fps;
+        
+        uint32_t old_fps = fps;
+        uint32_t old_quality = quality;
+        if (perf_ctrl_update(&ctrl, cost_us, true, &fps, &quality) && verbose) {
+            printf("frame %zu: %u fps q%u -> %u fps q%u (cost %.2f ms, estimate %.2f ms)\n", i, old_fps,
+                   old_quality, fps, quality, cost_us / 1000.0f, ctrl.cost_us / 1000.0f);
+        }
+    }
+    
+    double over_rate = count ? over_interval * 100.0 / count : 0.0;
+    printf("frames: %zu\n", count);
+    printf("changes: %llu\n", (unsigned long long)ctrl.changes);
+    printf("frames over interval: %llu (%.2f%%)\n", (unsigned long long)over_interval, over_rate);
+    printf("average fps: %.1f\n", count ? fps_sum / count : 0.0);
+    for (uint32_t level = 0; level < config.quality_levels; level++) {
+        printf("quality %u: %.1f%% of frames, learned cost x%.3f (replayed x%.3f)\n", level,
+               count ? ctrl.level_frames[level] * 100.0 / count : 0.0, ctrl.level_scale[level],
+               powf(ratio, (float)level));
+    }
+    
+    // 检查记录中声明的预期
+    int failures = 0;
+    if (expect.has_changes) {
+        failures += check(ctrl.changes >= expect.min_changes && ctrl.changes <= expect.max_changes,
+                          "changes %llu within %llu-%llu", (unsigned long long)ctrl.changes,
+                          (unsigned long long)expect.min_changes, (unsigned long long)expect.max_changes);
+    }
+    if (expect.has_over_rate) {
+        failures += check(over_rate <= expect.max_over_rate, "over-interval rate %.2f%% <= %.2f%%", over_rate,
+                          expect.max_over_rate);
+    }
+    if (expect.has_changes || expect.has_over_rate) {
+        printf("%s (%d failures)\n", failures ? "FAIL" : "PASS", failures);
+    }
+    
+    free(trace);
+    return failures ? 1 : 0;
+}
+
+// 读取帧耗时记录（毫秒）和其中声明的预期
+static float* read_trace(const char* path, size_t* count, struct expectation* expect) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return NULL;
+    }
+    
+    size_t capacity = 4096;
+    float* values = malloc(capacity * sizeof(float));
+    char line[256];
+    *count = 0;
+    
+    while (values && fgets(line, sizeof(line), file)) {
+        float value_ms;
+        if (line[0] == '#') {
+            parse_expectation(line, expect);
+            continue;
+        }
+        if (!parse_line(line, &value_ms)) {
+            continue;
+        }
+        
+        if (*count == capacity) {
+            capacity *= 2;
+            float* grown = realloc(values, capacity * sizeof(float));
+            if (!grown) {
+                free(values);
+                values = NULL;
+                break;
+            }
+            values = grown;
+        }
+        values[(*count)++] = value_ms;
+    }
+    
+    fclose(file);
+    if (!values) {
+        fprintf(stderr, "Out of memory\n");
+    }
+    return values;
+}
+
+// 解析一行：纯数字，或解码工具CSV中类型为RenderTime的行（Timestamp,Type,Value,Unit）
+static bool parse_line(const char* line, float* value_ms) {
+    char* end = NULL;
+    const char* type = strchr(line, ',');
+    
+    if (!type) {
+        *value_ms = strtof(line, &end);
+        return end != line && *value_ms > 0.0f;
+    }
+    
+    if (strncmp(type + 1, "RenderTime,", 11) != 0) {
+        return false;
+    }
+    *value_ms = strtof(type + 12, &end);
+    return end != type + 12 && *value_ms > 0.0f;
+}
+
+// 解析预期行：# expect changes <min> <max> 或 # expect over_rate <max_percent>
+static void parse_expectation(const char* line, struct expectation* expect) {
+    unsigned long long min_changes;
+    unsigned long long max_changes;
+    double max_over_rate;
+    
+    if (sscanf(line, "# expect changes %llu %llu", &min_changes, &max_changes) == 2) {
+        expect->has_changes = true;
+        expect->min_changes = min_changes;
+        expect->max_changes = max_changes;
+    } else if (sscanf(line, "# expect over_rate %lf", &max_over_rate) == 1) {
+        expect->has_over_rate = true;
+        expect->max_over_rate = max_over_rate;
+    }
+}
+
+// 输出一项检查结果，失败时返回1
+static int check(bool condition, const char* format, ...) {
+    va_list args;
+    
+    printf("%s: ", condition ? "ok" : "FAILED");
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    printf("\n");
+    
+    return condition ? 0 : 1;
+}
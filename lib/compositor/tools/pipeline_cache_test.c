@@ -0,0 +1,178 @@
+// 管线缓存文件测试工具（在主机上运行）
+// 构建：cc -std=c99 -D_GNU_SOURCE -O2 -I.. -Ihost -o pipeline_cache_test pipeline_cache_test.c ../compositor_pipeline_cache.c
+// 用法：pipeline_cache_test
+// 在临时目录中写入缓存文件，检查读回的内容、设备键不匹配和数据损坏时的拒绝，以及写入失败时旧文件保持不变；
+// 全部通过时返回0
+
+#include "compositor_pipeline_cache.h"
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// 模拟的缓存数据大小（包含开头的Vulkan头部）
+#define TEST_DATA_SIZE 4096
+
+// 测试状态
+static struct {
+    char root[64];
+    char path[PIPELINE_CACHE_PATH_SIZE];
+    char tmp_path[PIPELINE_CACHE_PATH_SIZE + 8];
+    uint8_t data[TEST_DATA_SIZE];
+    struct pipeline_cache_file_header header;
+    int failures;
+} g_test;
+
+// 内部函数声明
+static void make_data(uint32_t vendor_id, uint32_t device_id, const uint8_t* uuid, uint8_t seed);
+static int save(void);
+static bool load_matches(const struct pipeline_cache_file_header* expected);
+static void corrupt_byte(long offset);
+static bool file_exists(const char* path);
+static void check(bool condition, const char* format, ...);
+
+int main(void) {
+    snprintf(g_test.root, sizeof(g_test.root), "/tmp/pipeline_cache_test.XXXXXX");
+    if (!mkdtemp(g_test.root)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(g_test.path, sizeof(g_test.path), "%s/pipeline_cache.bin", g_test.root);
+    snprintf(g_test.tmp_path, sizeof(g_test.tmp_path), "%s.tmp", g_test.path);
+    
+    const uint8_t uuid[PIPELINE_CACHE_UUID_SIZE] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+    struct pipeline_cache_file_header expected;
+    pipeline_cache_init_header(&expected, 0x5143, 0x6030001, 512, uuid);
+    
+    // 写入后原样读回，不留下临时文件
+    make_data(0x5143, 0x6030001, uuid, 1);
+    check(save() == 0, "write succeeds");
+    check(!file_exists(g_test.tmp_path), "no temporary file left after write");
+    check(load_matches(&expected), "data reads back with matching checksum");
+    
+    // 驱动版本、设备或UUID变化时拒绝
+    struct pipeline_cache_file_header other = expected;
+    other.driver_version++;
+    size_t size = 0;
+    check(pipeline_cache_read_file(g_test.path, &other, &size, NULL) == NULL, "driver version mismatch rejected");
+    other = expected;
+    other.device_id++;
+    check(pipeline_cache_read_file(g_test.path, &other, &size, NULL) == NULL, "device id mismatch rejected");
+    other = expected;
+    other.uuid[0] ^= 0xff;
+    check(pipeline_cache_read_file(g_test.path, &other, &size, NULL) == NULL, "pipeline cache UUID mismatch rejected");
+    
+    // 数据中任一字节损坏时校验和不匹配
+    corrupt_byte((long)sizeof(struct pipeline_cache_file_header) + TEST_DATA_SIZE / 2);
+    check(pipeline_cache_read_file(g_test.path, &expected, &size, NULL) == NULL, "corrupted data rejected by checksum");
+    
+    // 截断的文件
+    check(save() == 0 && truncate(g_test.path, (off_t)sizeof(struct pipeline_cache_file_header) + 100) == 0,
+          "truncate cache file");
+    check(pipeline_cache_read_file(g_test.path, &expected, &size, NULL) == NULL, "truncated file rejected");
+    
+    // 外层文件头和校验和正确，但数据内的Vulkan头部属于另一设备
+    make_data(0x5143, 0x6030002, uuid, 2);
+    check(save() == 0, "write data with foreign Vulkan header");
+    check(pipeline_cache_read_file(g_test.path, &expected, &size, NULL) == NULL, "Vulkan header mismatch rejected");
+    
+    // 临时文件无法创建时写入失败，旧文件保持可用
+    make_data(0x5143, 0x6030001, uuid, 3);
+    check(save() == 0, "write valid cache");
+    struct pipeline_cache_file_header written = g_test.header;
+    check(mkdir(g_test.tmp_path, 0700) == 0, "block temporary path");
+    make_data(0x5143, 0x6030001, uuid, 4);
+    check(save() != 0, "write fails when temporary file cannot be created");
+    rmdir(g_test.tmp_path);
+    make_data(0x5143, 0x6030001, uuid, 3);
+    g_test.header = written;
+    check(load_matches(&expected), "previous cache intact after failed write");
+    
+    // 上次异常退出留下的临时文件被覆盖
+    FILE* stale = fopen(g_test.tmp_path, "wb");
+    if (stale) {
+        fputs("stale", stale);
+        fclose(stale);
+    }
+    make_data(0x5143, 0x6030001, uuid, 5);
+    check(save() == 0 && !file_exists(g_test.tmp_path), "stale temporary file replaced");
+    check(load_matches(&expected), "new cache reads back after replacing stale temporary file");
+    
+    unlink(g_test.tmp_path);
+    unlink(g_test.path);
+    rmdir(g_test.root);
+    
+    printf("%s (%d failures)\n", g_test.failures ? "FAIL" : "PASS", g_test.failures);
+    return g_test.failures ? 1 : 0;
+}
+
+// 生成带Vulkan头部的模拟缓存数据，并填好对应的文件头
+static void make_data(uint32_t vendor_id, uint32_t device_id, const uint8_t* uuid, uint8_t seed) {
+    uint32_t vk_header[4] = {PIPELINE_CACHE_VK_HEADER_SIZE, PIPELINE_CACHE_VK_HEADER_VERSION_ONE, vendor_id, device_id};
+    
+    for (size_t i = 0; i < TEST_DATA_SIZE; i++) {
+        g_test.data[i] = (uint8_t)(i * 31 + seed);
+    }
+    memcpy(g_test.data, vk_header, sizeof(vk_header));
+    memcpy(g_test.data + 16, uuid, PIPELINE_CACHE_UUID_SIZE);
+    
+    pipeline_cache_init_header(&g_test.header, 0x5143, 0x6030001, 512, uuid);
+    g_test.header.data_size = TEST_DATA_SIZE;
+    g_test.header.checksum = pipeline_cache_checksum(g_test.data, TEST_DATA_SIZE);
+}
+
+// 写入当前数据
+static int save(void) {
+    return pipeline_cache_write_file(g_test.path, &g_test.header, g_test.data, TEST_DATA_SIZE);
+}
+
+// 读回缓存并与当前数据比较
+static bool load_matches(const struct pipeline_cache_file_header* expected) {
+    size_t size = 0;
+    uint32_t checksum = 0;
+    uint8_t* data = pipeline_cache_read_file(g_test.path, expected, &size, &checksum);
+    
+    bool match = data && size == TEST_DATA_SIZE && memcmp(data, g_test.data, size) == 0 &&
+                 checksum == g_test.header.checksum;
+    free(data);
+    return match;
+}
+
+// 翻转文件中的一个字节
+static void corrupt_byte(long offset) {
+    FILE* file = fopen(g_test.path, "r+b");
+    if (!file) {
+        return;
+    }
+    
+    if (fseek(file, offset, SEEK_SET) == 0) {
+        int value = fgetc(file);
+        fseek(file, offset, SEEK_SET);
+        fputc(value ^ 0xff, file);
+    }
+    fclose(file);
+}
+
+// 检查文件是否存在
+static bool file_exists(const char* path) {
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+// 输出一项检查结果
+static void check(bool condition, const char* format, ...) {
+    va_list args;
+    
+    printf("%s: ", condition ? "ok" : "FAILED");
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    printf("\n");
+    
+    if (!condition) {
+        g_test.failures++;
+    }
+}
@@ -0,0 +1,273 @@
+// 热调节器模拟测试工具（在主机上运行）
+// 构建：cc -std=c99 -D_GNU_SOURCE -O2 -I.. -Ihost -o thermal_sim thermal_sim.c ../compositor_thermal.c ../compositor_trace.c -lpthread
+// 用法：thermal_sim [-v]
+// 在临时目录中生成假的sysfs（thermal_zone*/type、temp、trip_point_*和cpu*/cpufreq），按模拟时间逐秒改写温度，
+// 手动驱动热调节器采样并检查热状态、各温区趋势和读取失败时的退避；全部通过时返回0
+
+#include "compositor_thermal.h"
+#include <ftw.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define NS_PER_S 1000000000ULL
+
+// 假sysfs中的温区（编号即thermal_zone目录的序号）
+enum {
+    ZONE_CPU,
+    ZONE_GPU,
+    ZONE_BATTERY,
+    ZONE_TSENS,
+    ZONE_COUNT
+};
+
+// 模拟状态
+static struct {
+    char root[64];
+    uint64_t now_s;
+    bool verbose;
+    int failures;
+} g_sim;
+
+// 内部函数声明
+static int create_tree(void);
+static int write_file(const char* relative, const char* format, ...);
+static void set_temp(int zone, float temp_c);
+static void set_unreadable(int zone);
+static void set_freq_cap(float ratio);
+static thermal_state_t run(uint64_t seconds, float cpu_start_c, float cpu_rise_c_per_s);
+static void check(bool condition, const char* format, ...);
+static int remove_entry(const char* path, const struct stat* st, int flag, struct FTW* ftw);
+static const char* state_name(int state);
+
+int main(int argc, char** argv) {
+    g_sim.verbose = argc > 1 && strcmp(argv[1], "-v") == 0;
+    snprintf(g_sim.root, sizeof(g_sim.root), "/tmp/thermal_sim.XXXXXX");
+    if (!mkdtemp(g_sim.root)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    
+    if (create_tree() != 0 || thermal_governor_init(g_sim.root) != 0) {
+        fprintf(stderr, "Failed to set up fake sysfs under %s\n", g_sim.root);
+        nftw(g_sim.root, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+        return 1;
+    }
+    
+    struct thermal_governor_stats stats;
+    struct thermal_zone_info zones[THERMAL_MAX_ZONES];
+    thermal_state_t state = THERMAL_STATE_NORMAL;
+    g_sim.now_s = 1;
+    
+    // 发现：电池没有触发点被跳过，片上传感器使用默认触发点
+    thermal_governor_get_stats(&stats);
+    uint32_t zone_count = thermal_governor_get_zones(zones, THERMAL_MAX_ZONES);
+    check(stats.zone_count == 3 && zone_count == 3, "discovered %u zones (expected 3)", stats.zone_count);
+    check(stats.cpu_count == 2, "discovered %u CPUs (expected 2)", stats.cpu_count);
+    check(thermal_governor_get_state(&state) != 0, "state unavailable before the first sample");
+    
+    // 稳定：GPU余量最小（15°C）但没有升温
+    run(30, 50.0f, 0.0f);
+    thermal_governor_get_stats(&stats);
+    check(thermal_governor_get_state(&state) == 0 && state == THERMAL_STATE_NORMAL,
+          "steady: state %s (expected NORMAL)", state_name(state));
+    check(strcmp(stats.zone, "gpu-usr") == 0, "steady: nearest zone %s (expected gpu-usr)", stats.zone);
+    
+    // CPU以0.5°C/s升温，余量仍大于GPU：趋势按温区分别计算，应在CPU余量还很大时提前警告
+    state = run(20, 50.0f, 0.5f);
+    thermal_governor_get_stats(&stats);
+    check(state >= THERMAL_STATE_WARNING, "cpu ramp to 60 C: state %s (expected >= WARNING)", state_name(state));
+    check(strcmp(stats.zone, "gpu-usr") == 0 && stats.time_to_throttle_s > 0.0f,
+          "cpu ramp: time to throttle %.1f s from the cpu trend while gpu stays nearest", stats.time_to_throttle_s);
+    state = run(40, 60.0f, 0.5f);
+    check(state >= THERMAL_STATE_THROTTLING, "cpu ramp to 80 C: state %s (expected >= THROTTLING)", state_name(state));
+    
+    // 冷却：滞后后回到正常
+    state = run(60, 50.0f, 0.0f);
+    check(state == THERMAL_STATE_NORMAL, "cool down: state %s (expected NORMAL)", state_name(state));
+    
+    // 内核限频
+    set_freq_cap(0.8f);
+    state = run(2, 50.0f, 0.0f);
+    check(state == THERMAL_STATE_THROTTLING, "freq cap 80%%: state %s (expected THROTTLING)", state_name(state));
+    set_freq_cap(1.0f);
+    state = run(60, 50.0f, 0.0f);
+    check(state == THERMAL_STATE_NORMAL, "freq cap removed: state %s (expected NORMAL)", state_name(state));
+    
+    // 所有温区都读取失败：状态不可用，采样间隔逐次加倍
+    for (int zone = 0; zone < ZONE_COUNT; zone++) {
+        set_unreadable(zone);
+    }
+    for (uint64_t i = 0; i < 60; i++, g_sim.now_s++) {
+        thermal_governor_sample(g_sim.now_s * NS_PER_S);
+    }
+    thermal_governor_get_stats(&stats);
+    check(thermal_governor_get_state(&state) != 0, "unreadable: state unavailable");
+    check(stats.failed_samples >= 3 && stats.failed_samples <= 6,
+          "unreadable for 60 s: %u scans (expected 3-6 with backoff, not 60)", stats.failed_samples);
+    
+    // 恢复后在退避间隔内重新可用
+    uint64_t samples = stats.sample_count;
+    state = run(40, 50.0f, 0.0f);
+    thermal_governor_get_stats(&stats);
+    check(thermal_governor_get_state(&state) == 0 && stats.failed_samples == 0 && stats.sample_count > samples,
+          "recovered after backoff: state %s", state_name(state));
+    
+    thermal_governor_destroy();
+    nftw(g_sim.root, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    
+    printf("%s (%d failures)\n", g_sim.failures ? "FAIL" : "PASS", g_sim.failures);
+    return g_sim.failures ? 1 : 0;
+}
+
+// 生成假的sysfs目录树
+static int create_tree(void) {
+    static const char* dirs[] = {
+        "class", "class/thermal",
+        "class/thermal/thermal_zone0", "class/thermal/thermal_zone1",
+        "class/thermal/thermal_zone2", "class/thermal/thermal_zone3",
+        "devices", "devices/system", "devices/system/cpu", "devices/system/cpu/cpuidle",
+        "devices/system/cpu/cpu0", "devices/system/cpu/cpu0/cpufreq",
+        "devices/system/cpu/cpu1", "devices/system/cpu/cpu1/cpufreq"
+    };
+    char path[256];
+    
+    for (size_t i = 0; i < sizeof(dirs) / sizeof(dirs[0]); i++) {
+        snprintf(path, sizeof(path), "%s/%s", g_sim.root, dirs[i]);
+        if (mkdir(path, 0755) != 0) {
+            perror(path);
+            return -1;
+        }
+    }
+    
+    int result = 0;
+    result |= write_file("class/thermal/thermal_zone0/type", "cpu-0-0-usr\n");
+    result |= write_file("class/thermal/thermal_zone0/trip_point_0_type", "passive\n");
+    result |= write_file("class/thermal/thermal_zone0/trip_point_0_temp", "85000\n");
+    result |= write_file("class/thermal/thermal_zone0/trip_point_1_type", "critical\n");
+    result |= write_file("class/thermal/thermal_zone0/trip_point_1_temp", "105000\n");
+    result |= write_file("class/thermal/thermal_zone1/type", "gpu-usr\n");
+    result |= write_file("class/thermal/thermal_zone1/trip_point_0_type", "hot\n");
+    result |= write_file("class/thermal/thermal_zone1/trip_point_0_temp", "95000\n");
+    result |= write_file("class/thermal/thermal_zone2/type", "battery\n");
+    result |= write_file("class/thermal/thermal_zone3/type", "tsens_tz_sensor12\n");
+    
+    for (int cpu = 0; cpu < 2; cpu++) {
+        snprintf(path, sizeof(path), "devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq", cpu);
+        result |= write_file(path, "2000000\n");
+        snprintf(path, sizeof(path), "devices/system/cpu/cpu%d/cpufreq/scaling_cur_freq", cpu);
+        result |= write_file(path, "1200000\n");
+    }
+    set_freq_cap(1.0f);
+    
+    set_temp(ZONE_CPU, 50.0f);
+    set_temp(ZONE_GPU, 80.0f);
+    set_temp(ZONE_BATTERY, 35.0f);
+    set_temp(ZONE_TSENS, 55.0f);
+    return result;
+}
+
+// 写入假sysfs中的文件（覆盖，热调节器常开的文件描述符读到新内容）
+static int write_file(const char* relative, const char* format, ...) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", g_sim.root, relative);
+    
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        perror(path);
+        return -1;
+    }
+    
+    va_list args;
+    va_start(args, format);
+    vfprintf(file, format, args);
+    va_end(args);
+    fclose(file);
+    return 0;
+}
+
+// 设置温区温度（毫摄氏度）
+static void set_temp(int zone, float temp_c) {
+    char relative[64];
+    snprintf(relative, sizeof(relative), "class/thermal/thermal_zone%d/temp", zone);
+    write_file(relative, "%ld\n", (long)(temp_c * 1000.0f));
+}
+
+// 清空温区温度文件，模拟读取失败
+static void set_unreadable(int zone) {
+    char relative[64];
+    snprintf(relative, sizeof(relative), "class/thermal/thermal_zone%d/temp", zone);
+    write_file(relative, "%s", "");
+}
+
+// 设置各CPU的频率上限（相对最高频率）
+static void set_freq_cap(float ratio) {
+    char relative[64];
+    
+    for (int cpu = 0; cpu < 2; cpu++) {
+        snprintf(relative, sizeof(relative), "devices/system/cpu/cpu%d/cpufreq/scaling_max_freq", cpu);
+        write_file(relative, "%ld\n", (long)(2000000.0f * ratio));
+    }
+}
+
+// 逐秒模拟：CPU温度从cpu_start_c按cpu_rise_c_per_s变化，其他温区保持不变，返回最后的热状态
+static thermal_state_t run(uint64_t seconds, float cpu_start_c, float cpu_rise_c_per_s) {
+    thermal_state_t state = THERMAL_STATE_NORMAL;
+    
+    set_temp(ZONE_GPU, 80.0f);
+    set_temp(ZONE_BATTERY, 35.0f);
+    set_temp(ZONE_TSENS, 55.0f);
+    
+    for (uint64_t i = 0; i < seconds; i++, g_sim.now_s++) {
+        float cpu_c = cpu_start_c + cpu_rise_c_per_s * i;
+        set_temp(ZONE_CPU, cpu_c);
+        thermal_governor_sample(g_sim.now_s * NS_PER_S);
+        
+        int available = thermal_governor_get_state(&state);
+        if (g_sim.verbose) {
+            struct thermal_governor_stats stats;
+            thermal_governor_get_stats(&stats);
+            printf("t=%3llus cpu %5.1f C: %-10s nearest %s headroom %5.1f C, trend %6.2f C/s, ttt %6.1f s\n",
+                   (unsigned long long)g_sim.now_s, cpu_c, available == 0 ? state_name(state) : "-",
+                   stats.zone, stats.headroom_c, stats.trend_c_per_s, stats.time_to_throttle_s);
+        }
+    }
+    return state;
+}
+
+// 检查条件并打印结果
+static void check(bool condition, const char* format, ...) {
+    va_list args;
+    
+    printf("%s: ", condition ? "ok" : "FAILED");
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    printf("\n");
+    
+    if (!condition) {
+        g_sim.failures++;
+    }
+}
+
+// 删除临时目录中的条目
+static int remove_entry(const char* path, const struct stat* st, int flag, struct FTW* ftw) {
+    (void)st;
+    (void)flag;
+    (void)ftw;
+    return remove(path);
+}
+
+// 获取热状态名称
+static const char* state_name(int state) {
+    switch (state) {
+        case THERMAL_STATE_NORMAL: return "NORMAL";
+        case THERMAL_STATE_WARNING: return "WARNING";
+        case THERMAL_STATE_THROTTLING: return "THROTTLING";
+        case THERMAL_STATE_CRITICAL: return "CRITICAL";
+        default: return "UNKNOWN";
+    }
+}